@@ -65,6 +65,15 @@ waveforms = { analog.GR_SIN_WAVE    : "Sinusoid",
               "sweep"               : "Freq. Sweep",
               "gsm"                 : "GSM Bursts" }
 
+# waveforms served by the native osmosdr.siggen block; gsm keeps its
+# python chain
+native_waveforms = { analog.GR_SIN_WAVE   : osmosdr.SIGGEN_TONE,
+                     analog.GR_CONST_WAVE : osmosdr.SIGGEN_CONST,
+                     analog.GR_GAUSSIAN   : osmosdr.SIGGEN_NOISE_GAUSSIAN,
+                     analog.GR_UNIFORM    : osmosdr.SIGGEN_NOISE_UNIFORM,
+                     "2tone"              : osmosdr.SIGGEN_TWO_TONE,
+                     "sweep"              : osmosdr.SIGGEN_SWEEP }
+
 class gsm_source_c(gr.hier_block2):
     def __init__(self, sample_rate, amplitude):
         gr.hier_block2.__init__(self, "gsm_source_c",
@@ -263,14 +272,8 @@ class top_block(gr.top_block, pubsub):
     def set_samp_rate(self, sr):
         sr = self._sink.set_sample_rate(sr)
 
-        if self[TYPE_KEY] in (analog.GR_SIN_WAVE, analog.GR_CONST_WAVE):
-            self._src.set_sampling_freq(self[SAMP_RATE_KEY])
-        elif self[TYPE_KEY] == "2tone":
-            self._src1.set_sampling_freq(self[SAMP_RATE_KEY])
-            self._src2.set_sampling_freq(self[SAMP_RATE_KEY])
-        elif self[TYPE_KEY] == "sweep":
-            self._src1.set_sampling_freq(self[SAMP_RATE_KEY])
-            self._src2.set_sampling_freq(self[WAVEFORM_FREQ_KEY]*2*math.pi/self[SAMP_RATE_KEY])
+        if self[TYPE_KEY] in native_waveforms:
+            self._src.set_sample_rate(self[SAMP_RATE_KEY])
         elif self[TYPE_KEY] == "gsm":
             self._src.set_sampling_freq(self[SAMP_RATE_KEY])
         else:
@@ -361,69 +364,37 @@ class top_block(gr.top_block, pubsub):
             print "Set frequency correction to:", ppm
 
     def set_waveform_freq(self, freq):
-        if self[TYPE_KEY] == analog.GR_SIN_WAVE:
-            self._src.set_frequency(freq)
-        elif self[TYPE_KEY] == "2tone":
-            self._src1.set_frequency(freq)
-        elif self[TYPE_KEY] == 'sweep':
-            #there is no set sensitivity, redo fg
-            self[TYPE_KEY] = self[TYPE_KEY]
+        if self[TYPE_KEY] in native_waveforms:
+            self._src.set_freq(freq)
         return True
 
     def set_waveform2_freq(self, freq):
         if freq is None:
             self[WAVEFORM2_FREQ_KEY] = -self[WAVEFORM_FREQ_KEY]
             return
-        if self[TYPE_KEY] == "2tone":
-            self._src2.set_frequency(freq)
-        elif self[TYPE_KEY] == "sweep":
-            self._src1.set_frequency(freq)
+        if self[TYPE_KEY] in native_waveforms:
+            self._src.set_freq2(freq)
         return True
 
     def set_waveform(self, type):
         self.lock()
         self.disconnect_all()
-        if type == analog.GR_SIN_WAVE or type == analog.GR_CONST_WAVE:
-            self._src = analog.sig_source_c(self[SAMP_RATE_KEY],        # Sample rate
-                                        type,                       # Waveform type
-                                        self[WAVEFORM_FREQ_KEY],    # Waveform frequency
-                                        self[AMPLITUDE_KEY],        # Waveform amplitude
-                                        self[WAVEFORM_OFFSET_KEY])  # Waveform offset
-        elif type == analog.GR_GAUSSIAN or type == analog.GR_UNIFORM:
-            self._src = analog.noise_source_c(type, self[AMPLITUDE_KEY])
-        elif type == "2tone":
-            self._src1 = analog.sig_source_c(self[SAMP_RATE_KEY],
-                                         analog.GR_SIN_WAVE,
-                                         self[WAVEFORM_FREQ_KEY],
-                                         self[AMPLITUDE_KEY]/2.0,
-                                         0)
-            if(self[WAVEFORM2_FREQ_KEY] is None):
-                self[WAVEFORM2_FREQ_KEY] = -self[WAVEFORM_FREQ_KEY]
-
-            self._src2 = analog.sig_source_c(self[SAMP_RATE_KEY],
-                                         analog.GR_SIN_WAVE,
-                                         self[WAVEFORM2_FREQ_KEY],
-                                         self[AMPLITUDE_KEY]/2.0,
-                                         0)
-            self._src = blocks.add_cc()
-            self.connect(self._src1,(self._src,0))
-            self.connect(self._src2,(self._src,1))
-        elif type == "sweep":
+        if type in native_waveforms:
             # rf freq is center frequency
-            # waveform_freq is total swept width
-            # waveform2_freq is sweep rate
-            # will sweep from (rf_freq-waveform_freq/2) to (rf_freq+waveform_freq/2)
-            if self[WAVEFORM2_FREQ_KEY] is None:
+            # for sweep, waveform_freq is total swept width and
+            # waveform2_freq is sweep rate: will sweep from
+            # (rf_freq-waveform_freq/2) to (rf_freq+waveform_freq/2)
+            if type == "2tone" and self[WAVEFORM2_FREQ_KEY] is None:
+                self[WAVEFORM2_FREQ_KEY] = -self[WAVEFORM_FREQ_KEY]
+            elif type == "sweep" and self[WAVEFORM2_FREQ_KEY] is None:
                 self[WAVEFORM2_FREQ_KEY] = 0.1
 
-            self._src1 = analog.sig_source_f(self[SAMP_RATE_KEY],
-                                         analog.GR_TRI_WAVE,
-                                         self[WAVEFORM2_FREQ_KEY],
-                                         1.0,
-                                         -0.5)
-            self._src2 = analog.frequency_modulator_fc(self[WAVEFORM_FREQ_KEY]*2*math.pi/self[SAMP_RATE_KEY])
-            self._src = blocks.multiply_const_cc(self[AMPLITUDE_KEY])
-            self.connect(self._src1,self._src2,self._src)
+            self._src = osmosdr.siggen(self[SAMP_RATE_KEY],
+                                       self[AMPLITUDE_KEY])
+            self._src.set_waveform(native_waveforms[type])
+            self._src.set_freq(self[WAVEFORM_FREQ_KEY])
+            if self[WAVEFORM2_FREQ_KEY] is not None:
+                self._src.set_freq2(self[WAVEFORM2_FREQ_KEY])
         elif type == "gsm":
             self._src = gsm_source_c(self[SAMP_RATE_KEY], self[AMPLITUDE_KEY])
         else:
@@ -453,13 +424,8 @@ class top_block(gr.top_block, pubsub):
                 print "Amplitude out of range:", amplitude
             return False
 
-        if self[TYPE_KEY] in (analog.GR_SIN_WAVE, analog.GR_CONST_WAVE, analog.GR_GAUSSIAN, analog.GR_UNIFORM):
+        if self[TYPE_KEY] in native_waveforms:
             self._src.set_amplitude(amplitude)
-        elif self[TYPE_KEY] == "2tone":
-            self._src1.set_amplitude(amplitude/2.0)
-            self._src2.set_amplitude(amplitude/2.0)
-        elif self[TYPE_KEY] == "sweep":
-            self._src.set_k(amplitude)
         elif self[TYPE_KEY] == "gsm":
             self._src.set_amplitude(amplitude)
         else:
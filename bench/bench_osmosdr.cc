@@ -0,0 +1,190 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Microbenchmarks for the per-sample hot loops: the shared format
+ * conversion kernels, the airspy half-band decimation stages and the
+ * producer/consumer handoff through buffer_ring. Build with
+ * -DENABLE_BENCHMARKS=ON and run bench_osmosdr before and after
+ * touching any of these paths; rates are printed in MS/s (millions of
+ * individual values for the conversions, complex samples for the FIR,
+ * buffers for the ring).
+ */
+
+#include "convert/convert.h"
+#include "buffer_ring.h"
+#include "airspy/airspy_fir_kernels.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define BUF_VALUES (1 << 18) /* values per conversion call, ~rtl BUF_LEN */
+
+static double now_secs(void)
+{
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* run fn repeatedly for ~min_secs, return calls per second */
+template <typename F>
+static double rate_of(F fn, double min_secs = 0.5)
+{
+  unsigned int calls = 0;
+  double start = now_secs();
+  double elapsed;
+
+  do {
+    fn();
+    calls++;
+    elapsed = now_secs() - start;
+  } while (elapsed < min_secs);
+
+  return calls / elapsed;
+}
+
+static void report(const char *name, double units_per_call, double calls_per_sec)
+{
+  printf("%-24s %10.1f MS/s\n", name, units_per_call * calls_per_sec / 1e6);
+}
+
+struct conv_data
+{
+  std::vector<unsigned char> u8;
+  std::vector<float> f32;
+
+  conv_data() : u8(BUF_VALUES), f32(BUF_VALUES)
+  {
+    for (int i = 0; i < BUF_VALUES; i++)
+      u8[i] = rand() & 0xff;
+  }
+};
+
+static conv_data data;
+
+static void bench_u8(void)
+{
+  osmosdr::convert::u8_fc32(&data.u8[0], &data.f32[0], BUF_VALUES);
+}
+
+static void bench_s8(void)
+{
+  osmosdr::convert::s8_fc32((const signed char *)&data.u8[0], &data.f32[0],
+                            BUF_VALUES);
+}
+
+static void bench_s16(void)
+{
+  osmosdr::convert::s16_fc32((const short *)&data.u8[0], &data.f32[0],
+                             BUF_VALUES / 2, 2048.0f);
+}
+
+static void bench_s12(void)
+{
+  osmosdr::convert::s12_fc32(&data.u8[0], &data.f32[0], (BUF_VALUES / 3) * 2);
+}
+
+static void bench_halfband(const float *taps, int len, const char *name)
+{
+  halfband_decim_stage stage(taps, len);
+  std::vector<gr_complex> in(BUF_VALUES / 2), out(BUF_VALUES / 2);
+
+  struct runner {
+    halfband_decim_stage *stage;
+    gr_complex *in, *out;
+    void operator()() { stage->process(in, BUF_VALUES / 2, out); }
+  } run = { &stage, &in[0], &out[0] };
+
+  report(name, BUF_VALUES / 2, rate_of(run));
+}
+
+/* one producer thread against a consuming main thread, mirroring the
+ * USB-callback-to-work() handoff in the live backends */
+static void bench_ring(void)
+{
+  const unsigned int num = 32, len = 1 << 15;
+  const uint64_t total = 100000;
+  osmosdr::buffer_ring ring;
+  std::vector<unsigned char> payload(len);
+
+  ring.resize(num, len);
+
+  struct producer {
+    osmosdr::buffer_ring *ring;
+    const unsigned char *payload;
+    uint64_t total;
+
+    void operator()()
+    {
+      uint64_t sent = 0;
+      while (sent < total) {
+        if (ring->write(payload, len))
+          sent++;
+      }
+    }
+  } prod = { &ring, &payload[0], total };
+
+  double start = now_secs();
+  boost::thread thread(prod);
+
+  uint64_t received = 0;
+  while (received < total) {
+    if (!ring.wait(1))
+      break;
+    while (ring.used()) {
+      ring.pop();
+      received++;
+    }
+  }
+  thread.join();
+
+  double elapsed = now_secs() - start;
+  printf("%-24s %10.1f buffers/s (%.1f MB/s)\n", "buffer_ring spsc",
+         total / elapsed, total / elapsed * len / 1e6);
+}
+
+int main(void)
+{
+#ifdef HAVE_VOLK
+  printf("conversion kernels use VOLK runtime dispatch\n\n");
+#else
+  printf("built without VOLK, scalar fallbacks only\n\n");
+#endif
+
+  report("u8_fc32 (rtl)", BUF_VALUES, rate_of(bench_u8));
+  report("s8_fc32 (hackrf)", BUF_VALUES, rate_of(bench_s8));
+  report("s16_fc32 (bladerf)", BUF_VALUES / 2, rate_of(bench_s16));
+  report("s12_fc32 (packed)", (BUF_VALUES / 3) * 2, rate_of(bench_s12));
+  printf("\n");
+
+  bench_halfband(KERNEL_16_110, KERNEL_16_110_LEN, "halfband 7 taps");
+  bench_halfband(KERNEL_8_100, KERNEL_8_100_LEN, "halfband 11 taps");
+  bench_halfband(KERNEL_4_90, KERNEL_4_90_LEN, "halfband 15 taps");
+  bench_halfband(KERNEL_2_80, KERNEL_2_80_LEN, "halfband 47 taps");
+  printf("\n");
+
+  bench_ring();
+
+  return 0;
+}
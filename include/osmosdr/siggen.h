@@ -0,0 +1,104 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_SIGGEN_H
+#define INCLUDED_OSMOSDR_SIGGEN_H
+
+#include <osmosdr/api.h>
+#include <gnuradio/sync_block.h>
+
+namespace osmosdr {
+
+class siggen;
+
+/*! The test waveforms osmocom_siggen offers. */
+enum siggen_waveform_t {
+  SIGGEN_CONST = 0,       /*!< constant amplitude, a pure carrier on the air */
+  SIGGEN_TONE,            /*!< single complex tone at freq */
+  SIGGEN_TWO_TONE,        /*!< tones at freq and freq2, half amplitude each */
+  SIGGEN_SWEEP,           /*!< triangular sweep of width freq at rate freq2 */
+  SIGGEN_NOISE_UNIFORM,   /*!< uniform noise on I and Q */
+  SIGGEN_NOISE_GAUSSIAN   /*!< gaussian noise with std dev ampl */
+};
+
+/*!
+ * \brief Native signal generation: tones, sweeps and noise.
+ * \ingroup block
+ *
+ * Produces the osmocom_siggen test waveforms entirely in C++ so a
+ * single core can feed a sink at full rate. Tones come from a
+ * table-based phase accumulator, the sweep modulates the accumulator's
+ * increment with a triangle ramp exactly like the Python chain it
+ * replaces, and the final amplitude scaling runs through VOLK.
+ *
+ * All parameters can be changed at runtime through the setters or by
+ * posting a dict on the "cmd" message port with any of the keys
+ * "waveform" (symbol or enum value), "freq", "freq2", "ampl", "rate".
+ */
+class OSMOSDR_API siggen : virtual public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr< siggen > sptr;
+
+  /*!
+   * \brief Return a shared_ptr to a new instance of siggen.
+   *
+   * \param sample_rate the output sample rate in Sps
+   * \param ampl peak amplitude of the generated waveform
+   * \return a new osmosdr siggen block object
+   */
+  static sptr make( double sample_rate, double ampl = 0.5 );
+
+  /*!
+   * Set the output sample rate; frequencies keep their absolute value.
+   * \param rate the rate in Sps
+   */
+  virtual void set_sample_rate( double rate ) = 0;
+
+  /*!
+   * Switch to another waveform. The generator is phase continuous
+   * across the switch.
+   * \param waveform the new waveform
+   */
+  virtual void set_waveform( siggen_waveform_t waveform ) = 0;
+
+  /*!
+   * Set the primary frequency: the tone offset for SIGGEN_TONE and
+   * SIGGEN_TWO_TONE, the total swept width for SIGGEN_SWEEP.
+   * \param freq the frequency in Hz
+   */
+  virtual void set_freq( double freq ) = 0;
+
+  /*!
+   * Set the secondary frequency: the second tone's offset for
+   * SIGGEN_TWO_TONE, the sweep repetition rate for SIGGEN_SWEEP.
+   * \param freq the frequency in Hz
+   */
+  virtual void set_freq2( double freq ) = 0;
+
+  /*!
+   * Set the peak amplitude (the std dev for gaussian noise).
+   * \param ampl the amplitude, sensible values are in (0.0, 1.0]
+   */
+  virtual void set_amplitude( double ampl ) = 0;
+};
+
+} /* namespace osmosdr */
+
+#endif /* INCLUDED_OSMOSDR_SIGGEN_H */
@@ -22,9 +22,14 @@
 
 #include <osmosdr/api.h>
 #include <osmosdr/ranges.h>
+#include <osmosdr/stream_stats.h>
 #include <osmosdr/time_spec.h>
 #include <gnuradio/hier_block2.h>
 
+#include <boost/thread/future.hpp>
+
+#include <map>
+
 namespace osmosdr {
 
 class sink;
@@ -94,6 +99,28 @@ public:
    */
   virtual double set_center_freq( double freq, size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a retune request instead of blocking on the hardware.
+   * The request is executed out-of-band on a command thread, so the
+   * caller - e.g. a GUI thread or a message handler - is never stalled
+   * by the control transfer. Requests complete in order.
+   * \param freq the desired frequency in Hz
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_center_freq_async( double freq, size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a retune request and obtain a future for its completion.
+   * The future becomes ready once the hardware call finished and
+   * carries the actual frequency (or the exception the hardware call
+   * threw).
+   * \param freq the desired frequency in Hz
+   * \param chan the channel index 0 to N-1
+   * \return a future delivering the actual frequency in Hz
+   */
+  virtual boost::unique_future<double> set_center_freq_future( double freq,
+                                                               size_t chan = 0 ) = 0;
+
   /*!
    * Get the center frequency the underlying radio hardware is tuned to.
    * This is the actual frequency and may differ from the frequency set.
@@ -177,6 +204,37 @@ public:
                            const std::string & name,
                            size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a gain change instead of blocking on the hardware.
+   * The request executes on the command thread, serialized with all
+   * other asynchronous control requests.
+   * \param gain the gain in dB
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_gain_async( double gain, size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a named gain change instead of blocking on the hardware.
+   * \param gain the gain in dB
+   * \param name the name of the gain stage
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_gain_async( double gain,
+                               const std::string & name,
+                               size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a gain change and obtain a future for its completion.
+   * The future becomes ready once the hardware call finished and
+   * carries the actual gain (or the exception the hardware call
+   * threw).
+   * \param gain the gain in dB
+   * \param chan the channel index 0 to N-1
+   * \return a future delivering the actual gain in dB
+   */
+  virtual boost::unique_future<double> set_gain_future( double gain,
+                                                        size_t chan = 0 ) = 0;
+
   /*!
    * Get the actual gain setting of the underlying radio hardware.
    * \param chan the channel index 0 to N-1
@@ -261,6 +319,15 @@ public:
    */
   virtual double set_bandwidth( double bandwidth, size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a bandwidth change instead of blocking on the hardware.
+   * The request executes on the command thread, serialized with all
+   * other asynchronous control requests.
+   * \param bandwidth the filter bandwidth in Hz, set to 0 for automatic selection
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_bandwidth_async( double bandwidth, size_t chan = 0 ) = 0;
+
   /*!
    * Get the actual bandpass filter setting on the radio frontend.
    * \param chan the channel index 0 to N-1
@@ -371,6 +438,55 @@ public:
    * \param time_spec the new time
    */
   virtual void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec) = 0;
+
+  /*!
+   * Schedule a timed transmit burst. The next \p nsamps samples fed
+   * into the given channel form one burst that starts transmitting at
+   * \p time (device time, see set_time_now and friends) and ends with
+   * an end-of-burst marker, after which the transmitter idles without
+   * zero padding. Bursts may be queued ahead of their start time and
+   * are staged into the driver's stream buffers, so back-to-back TDMA
+   * slots do not need a host round-trip in between. On hardware
+   * without timed TX support the call is ignored and samples stream
+   * continuously.
+   * \param time the absolute device time the burst starts at
+   * \param nsamps the burst length in samples
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void queue_burst( const ::osmosdr::time_spec_t &time,
+                            size_t nsamps, size_t chan = 0 ) = 0;
+
+  /*!
+   * Get streaming health counters for the specified channel: dropped
+   * buffers/samples, the ring fill-level high-water mark and a histogram
+   * of the device-callback-to-scheduler handoff latency. The counters
+   * accumulate from block creation and are cheap to poll periodically.
+   * \param chan the channel index 0 to N-1
+   * \return a snapshot of the counters
+   */
+  virtual osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 ) = 0;
+
+  /*!
+   * Forget the last-applied values of the setter cache. Setter calls
+   * repeating the current value are normally dropped before they reach
+   * the hardware; clearing the cache forces the next call of every
+   * setter through to the device.
+   */
+  virtual void clear_settings_cache( void ) = 0;
+
+  /*!
+   * Apply several settings as one transaction. Supported keys are
+   * rate, corr, freq, gain_mode, gain, if_gain, bb_gain, antenna and
+   * bandwidth, with the same string values the device arguments take;
+   * unknown keys are ignored. Backends controlling remote hardware
+   * coalesce the batch into as few device commands as possible, so
+   * reconfiguring a network-attached transmitter costs one or two
+   * round trips instead of one per parameter.
+   * \param settings the settings to apply, keyed as in device args
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void apply( const std::map< std::string, std::string > &settings,
+                      size_t chan = 0 ) = 0;
 };
 
 } /* namespace osmosdr */
@@ -22,9 +22,14 @@
 
 #include <osmosdr/api.h>
 #include <osmosdr/ranges.h>
+#include <osmosdr/stream_stats.h>
 #include <osmosdr/time_spec.h>
 #include <gnuradio/hier_block2.h>
 
+#include <boost/thread/future.hpp>
+
+#include <map>
+
 namespace osmosdr {
 
 class source;
@@ -67,6 +72,21 @@ public:
    */
   virtual bool seek( long seek_point, int whence, size_t chan = 0 ) = 0;
 
+  /*!
+   * \brief seek file to the absolute \p timestamp
+   *
+   * With a SigMF recording whose capture segments carry core:datetime
+   * stamps, the timestamp is in UNIX epoch seconds and positions
+   * between the stamped anchors are interpolated at the rate the
+   * anchors imply. Without such anchors the timestamp simply counts
+   * seconds from the start of the file.
+   *
+   * \param timestamp target time in seconds
+   * \param chan the channel index 0 to N-1
+   * \return true on success
+   */
+  virtual bool seek_time( double timestamp, size_t chan = 0 ) = 0;
+
   /*!
    * Get the possible sample rates for the underlying radio hardware.
    * \return a range of rates in Sps
@@ -103,6 +123,55 @@ public:
    */
   virtual double set_center_freq( double freq, size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a retune request instead of blocking on the hardware.
+   * The request is executed out-of-band on a command thread, so sweep
+   * loops can keep consuming samples while the (potentially several
+   * milliseconds long) control transfer is in flight. Requests on one
+   * channel complete in order; watch get_tune_count() to learn when a
+   * request has taken effect.
+   * \param freq the desired frequency in Hz
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_center_freq_async( double freq, size_t chan = 0 ) = 0;
+
+  /*!
+   * Number of asynchronous retune requests that have completed on a
+   * channel since block creation. The counter increments after the
+   * hardware call returned, i.e. samples arriving afterwards were
+   * taken at (or after) the new frequency.
+   * \param chan the channel index 0 to N-1
+   * \return the completion count
+   */
+  virtual uint64_t get_tune_count( size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a retune request and obtain a future for its completion.
+   * Like set_center_freq_async(), but the returned future becomes
+   * ready once the hardware call finished and carries the actual
+   * frequency (or the exception the hardware call threw).
+   * \param freq the desired frequency in Hz
+   * \param chan the channel index 0 to N-1
+   * \return a future delivering the actual frequency in Hz
+   */
+  virtual boost::unique_future<double> set_center_freq_future( double freq,
+                                                               size_t chan = 0 ) = 0;
+
+  /*!
+   * Schedule a retune against the sample stream: the change is applied
+   * when the stream reaches the given absolute sample count (items
+   * produced on the channel, see gr::block::nitems_written), and the
+   * first affected sample carries a "freq" tag. This keeps hop
+   * boundaries sample accurate instead of smearing the transient
+   * across a measurement window.
+   * \param freq the desired frequency in Hz
+   * \param sample the absolute sample count to apply the change at
+   * \param chan the channel index 0 to N-1
+   * \return true if the backend supports scheduled changes
+   */
+  virtual bool set_center_freq_at( double freq, uint64_t sample,
+                                   size_t chan = 0 ) = 0;
+
   /*!
    * Get the center frequency the underlying radio hardware is tuned to.
    * This is the actual frequency and may differ from the frequency set.
@@ -186,6 +255,50 @@ public:
                            const std::string & name,
                            size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a gain change instead of blocking on the hardware.
+   * The request executes on the same command thread as asynchronous
+   * retunes, so all control I/O is serialized off the data path and
+   * interactive gain slews do not stall streaming.
+   * \param gain the gain in dB
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_gain_async( double gain, size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a named gain change instead of blocking on the hardware.
+   * \param gain the gain in dB
+   * \param name the name of the gain stage
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_gain_async( double gain,
+                               const std::string & name,
+                               size_t chan = 0 ) = 0;
+
+  /*!
+   * Schedule a gain change against the sample stream: applied when the
+   * stream reaches the given absolute sample count, with the first
+   * affected sample carrying a "gain" tag. See set_center_freq_at().
+   * \param gain the gain in dB
+   * \param sample the absolute sample count to apply the change at
+   * \param chan the channel index 0 to N-1
+   * \return true if the backend supports scheduled changes
+   */
+  virtual bool set_gain_at( double gain, uint64_t sample,
+                            size_t chan = 0 ) = 0;
+
+  /*!
+   * Queue a gain change and obtain a future for its completion.
+   * The future becomes ready once the hardware call finished and
+   * carries the actual gain (or the exception the hardware call
+   * threw).
+   * \param gain the gain in dB
+   * \param chan the channel index 0 to N-1
+   * \return a future delivering the actual gain in dB
+   */
+  virtual boost::unique_future<double> set_gain_future( double gain,
+                                                        size_t chan = 0 ) = 0;
+
   /*!
    * Get the actual gain setting of the underlying radio hardware.
    * \param chan the channel index 0 to N-1
@@ -305,6 +418,15 @@ public:
    */
   virtual double set_bandwidth( double bandwidth, size_t chan = 0 ) = 0;
 
+  /*!
+   * Queue a bandwidth change instead of blocking on the hardware.
+   * The request executes on the command thread, serialized with all
+   * other asynchronous control requests.
+   * \param bandwidth the filter bandwidth in Hz, set to 0 for automatic selection
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void set_bandwidth_async( double bandwidth, size_t chan = 0 ) = 0;
+
   /*!
    * Get the actual bandpass filter setting on the radio frontend.
    * \param chan the channel index 0 to N-1
@@ -415,6 +537,91 @@ public:
    * \param time_spec the new time
    */
   virtual void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec) = 0;
+
+  /*!
+   * Get streaming health counters for the specified channel: dropped
+   * buffers/samples, the ring fill-level high-water mark and a histogram
+   * of the device-callback-to-scheduler handoff latency. The counters
+   * accumulate from block creation and are cheap to poll periodically.
+   * \param chan the channel index 0 to N-1
+   * \return a snapshot of the counters
+   */
+  virtual osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 ) = 0;
+
+  /*!
+   * Depth in samples of the history probe attached to the given channel.
+   * A probe is requested with the probe=<depth> device argument and keeps
+   * the most recent samples of that channel in a fixed circular buffer
+   * which may be mapped without copying, e.g. as a NumPy array through
+   * the Python bindings. Returns 0 when no probe was requested.
+   * \param chan the channel index 0 to N-1
+   * \return the probe depth in samples
+   */
+  virtual size_t get_probe_depth( size_t chan = 0 ) = 0;
+
+  /*!
+   * Total number of samples written into the probe since streaming
+   * started. The write position inside the circular buffer is the count
+   * modulo the depth; the difference of two readings tells a poller how
+   * many samples are new.
+   * \param chan the channel index 0 to N-1
+   * \return the cumulative sample count
+   */
+  virtual uint64_t get_probe_count( size_t chan = 0 ) = 0;
+
+  /*!
+   * Pointer to the probe's circular buffer holding interleaved complex
+   * float samples. The buffer stays valid and at a fixed address for the
+   * lifetime of the block, so a view created once may be reused across
+   * polls. Returns NULL when no probe was requested.
+   * \param chan the channel index 0 to N-1
+   * \return read-only pointer to depth complex samples
+   */
+  virtual const void *get_probe_buffer( size_t chan = 0 ) = 0;
+
+  /*!
+   * Forget the last-applied values of the setter cache. Setter calls
+   * repeating the current value are normally dropped before they reach
+   * the hardware; clearing the cache forces the next call of every
+   * setter through to the device, e.g. after an external tool touched
+   * the hardware behind the block's back.
+   */
+  virtual void clear_settings_cache( void ) = 0;
+
+  /*!
+   * Execute a frequency scan plan autonomously in the driver.
+   * The backend cycles through \p freqs with \p dwell seconds per hop
+   * until the plan is cleared, marking each hop with a "freq" stream
+   * tag carrying the tuning frequency of the following samples. This
+   * avoids paying the per-hop control latency of driving a scan
+   * through set_center_freq from application code.
+   * \param freqs the frequencies to visit, in order, repeated forever
+   * \param dwell seconds to stay on each frequency
+   * \param chan the channel index 0 to N-1
+   * \return true when the underlying radio hardware executes the plan
+   */
+  virtual bool set_scan_plan( const std::vector<double> &freqs,
+                              double dwell, size_t chan = 0 ) = 0;
+
+  /*!
+   * Stop a running scan plan. The tuner stays on the last hop.
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void clear_scan_plan( size_t chan = 0 ) = 0;
+
+  /*!
+   * Apply several settings as one transaction. Supported keys are
+   * rate, corr, freq, gain_mode, gain, if_gain, bb_gain, antenna and
+   * bandwidth, with the same string values the device arguments take;
+   * unknown keys are ignored. Backends controlling remote hardware
+   * coalesce the batch into as few device commands as possible, so
+   * reconfiguring a network-attached receiver costs one or two round
+   * trips instead of one per parameter.
+   * \param settings the settings to apply, keyed as in device args
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void apply( const std::map< std::string, std::string > &settings,
+                      size_t chan = 0 ) = 0;
 };
 
 } /* namespace osmosdr */
@@ -0,0 +1,109 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_SPECTRUM_H
+#define INCLUDED_OSMOSDR_SPECTRUM_H
+
+#include <osmosdr/api.h>
+#include <gnuradio/sync_block.h>
+
+namespace osmosdr {
+
+class spectrum;
+
+/*!
+ * \brief Native spectrum acquisition: windowed FFT, averaging, max-hold.
+ * \ingroup block
+ *
+ * Consumes a complex stream and computes power spectra entirely in C++,
+ * so applications like osmocom_fft and osmocom_spectrum_sense only move
+ * compact per-segment results across the language boundary instead of
+ * raw FFT frames. Every emit_every frames the averaged spectrum is
+ * published as a message on the "spectrum" port: a pair of a metadata
+ * dict (freq, rate, frames) and an f32vector of dB bins in display
+ * (DC centered) order. The latest result can also be polled with
+ * levels() / max_hold().
+ */
+class OSMOSDR_API spectrum : virtual public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr< spectrum > sptr;
+
+  /*!
+   * \brief Return a shared_ptr to a new instance of spectrum.
+   *
+   * \param fft_size the number of bins, also the frame length
+   * \param avg_alpha single pole IIR averaging constant, 1.0 disables
+   * \param emit_every number of frames between result messages
+   * \return a new osmosdr spectrum block object
+   */
+  static sptr make( size_t fft_size, double avg_alpha = 0.65,
+                    size_t emit_every = 16 );
+
+  /*!
+   * Replace the analysis window. Must contain fft_size coefficients.
+   * The default is a Blackman-Harris window.
+   * \param window the window coefficients
+   */
+  virtual void set_window( const std::vector<float> &window ) = 0;
+
+  /*!
+   * Set the single pole IIR averaging constant. 1.0 disables averaging.
+   * \param alpha the new constant in (0.0, 1.0]
+   */
+  virtual void set_avg_alpha( double alpha ) = 0;
+
+  /*!
+   * Tell the block the center frequency the stream is tuned to; it is
+   * only echoed in the metadata of emitted messages so a consumer can
+   * attribute segments of a sweep.
+   * \param freq the frequency in Hz
+   */
+  virtual void set_center_freq( double freq ) = 0;
+
+  /*!
+   * Tell the block the stream's sample rate for the emitted metadata.
+   * \param rate the rate in Sps
+   */
+  virtual void set_sample_rate( double rate ) = 0;
+
+  /*! Restart the average from the next frame, e.g. after a retune. */
+  virtual void reset_avg( void ) = 0;
+
+  /*! Clear the max-hold trace. */
+  virtual void reset_max_hold( void ) = 0;
+
+  /*!
+   * Get the most recently emitted averaged spectrum.
+   * \return fft_size dB values in display order, empty before the
+   *         first emission
+   */
+  virtual std::vector<float> levels( void ) = 0;
+
+  /*!
+   * Get the max-hold trace accumulated since the last reset.
+   * \return fft_size dB values in display order, empty before the
+   *         first emission
+   */
+  virtual std::vector<float> max_hold( void ) = 0;
+};
+
+} /* namespace osmosdr */
+
+#endif /* INCLUDED_OSMOSDR_SPECTRUM_H */
@@ -0,0 +1,73 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_STREAM_STATS_H
+#define INCLUDED_OSMOSDR_STREAM_STATS_H
+
+#include <osmosdr/api.h>
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Snapshot of streaming health counters for one channel.
+ *
+ * The counters are maintained with relaxed atomics on the streaming
+ * paths and accumulate from block creation, so querying them any time
+ * (e.g. once per second from a monitoring thread) is safe and cheap.
+ * Backends without instrumentation report all zeros.
+ */
+struct OSMOSDR_API stream_stats_t
+{
+  static const size_t NUM_LATENCY_BINS = 16;
+
+  stream_stats_t()
+    : dropped_buffers(0),
+      dropped_samples(0),
+      ring_high_water(0),
+      ring_capacity(0),
+      latency_us(NUM_LATENCY_BINS, 0)
+  {
+  }
+
+  /*! Buffers discarded because the ring between the device callback
+   * and work() was full. */
+  uint64_t dropped_buffers;
+
+  /*! Samples contained in those discarded buffers. */
+  uint64_t dropped_samples;
+
+  /*! Most buffers ever queued at once - a fill-level high-water mark
+   * relative to ring_capacity. */
+  size_t ring_high_water;
+
+  /*! Number of buffers in the ring. */
+  size_t ring_capacity;
+
+  /*! log2 histogram of callback-to-work handoff latency: bin i counts
+   * buffers consumed within [2^i, 2^(i+1)) microseconds. */
+  std::vector<uint64_t> latency_us;
+};
+
+} /* namespace osmosdr */
+
+#endif /* INCLUDED_OSMOSDR_STREAM_STATS_H */
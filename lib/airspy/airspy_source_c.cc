@@ -40,9 +40,10 @@
 #include <gnuradio/io_signature.h>
 
 #include "airspy_source_c.h"
-#include "airspy_fir_kernels.h"
 
 #include "arg_helpers.h"
+#include "convert/convert.h"
+#include "handle_cache.h"
 
 using namespace boost::assign;
 
@@ -59,6 +60,9 @@ using namespace boost::assign;
 #define AIRSPY_FUNC_STR(func, arg) \
   boost::str(boost::format(func "(%1%)") % arg) + " has failed"
 
+#define BUF_LEN  (1 << 18) /* one libairspy transfer worth of s16 IQ */
+#define BUF_NUM  32
+
 airspy_source_c_sptr make_airspy_source_c (const std::string & args)
 {
   return gnuradio::get_initial_sptr(new airspy_source_c (args));
@@ -86,6 +90,10 @@ airspy_source_c::airspy_source_c (const std::string &args)
         gr::io_signature::make(MIN_IN, MAX_IN, sizeof (gr_complex)),
         gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof (gr_complex))),
     _dev(NULL),
+    _buf_offset(0),
+    _raw(false),
+    _raw_phase(0),
+    _raw_hb(osmosdr::KERNEL_2_80, KERNEL_2_80_LEN),
     _sample_rate(0),
     _center_freq(0),
     _freq_corr(0),
@@ -100,9 +108,21 @@ airspy_source_c::airspy_source_c (const std::string &args)
 
   dict_t dict = params_to_dict(args);
 
+  if ( osmosdr::handle_cache::wanted(dict) )
+    _cache_key = "airspy_source," + args;
+
   _dev = NULL;
-  ret = airspy_open( &_dev );
-  AIRSPY_THROW_ON_ERROR(ret, "Failed to open AirSpy device")
+
+  if ( _cache_key.length() )
+    _dev = (airspy_device *)
+        osmosdr::handle_cache::instance().acquire( _cache_key );
+
+  if ( _dev ) {
+    std::cerr << "Reattached to cached AirSpy handle." << std::endl;
+  } else {
+    ret = airspy_open( &_dev );
+    AIRSPY_THROW_ON_ERROR(ret, "Failed to open AirSpy device")
+  }
 
   uint8_t board_id;
   ret = airspy_board_id_read( _dev, &board_id );
@@ -117,6 +137,27 @@ airspy_source_c::airspy_source_c (const std::string &args)
   ret = airspy_board_partid_serialno_read( _dev, &part_serial );
   AIRSPY_THROW_ON_ERROR(ret, "Failed to read serial number")
 #endif
+  /* raw=1 requests packed 12 bit ADC samples (three bytes per two
+   * samples), cutting USB bandwidth by 25% over the default 16 bit
+   * containers. The real-to-complex conversion libairspy would do is
+   * deferred to work() instead (see there). */
+  if ( dict.count( "raw" ) )
+    _raw = boost::lexical_cast<bool>( dict["raw"] );
+
+  if ( _raw ) {
+    ret = airspy_set_sample_type( _dev, AIRSPY_SAMPLE_RAW );
+    AIRSPY_THROW_ON_ERROR(ret, "Failed to set sample type")
+
+    /* raw mode only pays off with bit packing on the wire */
+    ret = airspy_set_packing( _dev, 1 );
+    AIRSPY_THROW_ON_ERROR(ret, "Failed to set USB bit packing")
+  } else {
+    /* the ring keeps the native 12 bit samples in s16 containers, float
+     * conversion happens on the consumer side in work() */
+    ret = airspy_set_sample_type( _dev, AIRSPY_SAMPLE_INT16_IQ );
+    AIRSPY_THROW_ON_ERROR(ret, "Failed to set sample type")
+  }
+
   uint32_t num_rates;
   airspy_get_samplerates(_dev, &num_rates, 0);
   uint32_t *samplerates = (uint32_t *) malloc(num_rates * sizeof(uint32_t));
@@ -169,11 +210,10 @@ airspy_source_c::airspy_source_c (const std::string &args)
     AIRSPY_THROW_ON_ERROR(ret, "Failed to set USB bit packing")
   }
 
-  _fifo = new boost::circular_buffer<gr_complex>(5000000);
-  if (!_fifo) {
-    throw std::runtime_error( std::string(__FUNCTION__) + " " +
-                              "Failed to allocate a sample FIFO!" );
-  }
+  /* optional software decimation using the shared half-band cascade */
+  _decim.parse( dict );
+
+  _ring.resize(BUF_NUM, BUF_LEN);
 }
 
 /*
@@ -193,6 +233,14 @@ airspy_source_c::~airspy_source_c ()
       }
     }
 
+    if ( _cache_key.length() ) {
+      /* park the open handle for the next instance instead of closing */
+      osmosdr::handle_cache::instance().park( _cache_key, _dev,
+                                              _cache_close );
+      _dev = NULL;
+      return;
+    }
+
     ret = airspy_close( _dev );
     if ( ret != AIRSPY_SUCCESS )
     {
@@ -200,50 +248,29 @@ airspy_source_c::~airspy_source_c ()
     }
     _dev = NULL;
   }
+}
 
-  if (_fifo)
-  {
-    delete _fifo;
-    _fifo = NULL;
-  }
+void airspy_source_c::_cache_close( void *dev )
+{
+  airspy_close( (airspy_device *)dev );
 }
 
 int airspy_source_c::_airspy_rx_callback(airspy_transfer *transfer)
 {
   airspy_source_c *obj = (airspy_source_c *)transfer->ctx;
 
-  return obj->airspy_rx_callback((float *)transfer->samples, transfer->sample_count);
+  return obj->airspy_rx_callback(transfer->samples, transfer->sample_count);
 }
 
 int airspy_source_c::airspy_rx_callback(void *samples, int sample_count)
 {
-  size_t i, n_avail, to_copy, num_samples = sample_count;
-  float *sample = (float *)samples;
-
-  _fifo_lock.lock();
-
-  n_avail = _fifo->capacity() - _fifo->size();
-  to_copy = (n_avail < num_samples ? n_avail : num_samples);
-
-  for (i = 0; i < to_copy; i++ )
-  {
-    /* Push sample to the fifo */
-    _fifo->push_back( gr_complex( *sample, *(sample+1) ) );
-
-    /* offset to the next I+Q sample */
-    sample += 2;
-  }
-
-  _fifo_lock.unlock();
-
-  /* We have made some new samples available to the consumer in work() */
-  if (to_copy) {
-    //std::cerr << "+" << std::flush;
-    _samp_avail.notify_one();
-  }
+  /* in raw mode the transfer holds packed 12 bit real samples, i.e.
+   * three bytes per two samples */
+  size_t nbytes = _raw ? size_t(sample_count) * 3 / 2
+                       : size_t(sample_count) * 2 * sizeof(int16_t);
 
   /* Indicate overrun, if neccesary */
-  if (to_copy < num_samples)
+  if (!_ring.write((unsigned char *)samples, nbytes))
     std::cerr << "O" << std::flush;
 
   return 0; // TODO: return -1 on error/stop
@@ -254,6 +281,10 @@ bool airspy_source_c::start()
   if ( ! _dev )
     return false;
 
+  _ring.resize(BUF_NUM, BUF_LEN); /* drops stale buffers, clears shutdown */
+  _buf_offset = 0;
+  _raw_phase = 0;
+
   int ret = airspy_start_rx( _dev, _airspy_rx_callback, (void *)this );
   if ( ret != AIRSPY_SUCCESS ) {
     std::cerr << "Failed to start RX streaming (" << ret << ")" << std::endl;
@@ -269,6 +300,9 @@ bool airspy_source_c::stop()
     return false;
 
   int ret = airspy_stop_rx( _dev );
+
+  _ring.shutdown(); /* unblock a scheduler thread stuck in work() */
+
   if ( ret != AIRSPY_SUCCESS ) {
     std::cerr << "Failed to stop RX streaming (" << ret << ")" << std::endl;
     return false;
@@ -291,24 +325,118 @@ int airspy_source_c::work( int noutput_items,
   if ( ! running )
     return WORK_DONE;
 
-  boost::unique_lock<boost::mutex> lock(_fifo_lock);
+  if ( ! _ring.wait(1) )
+    return WORK_DONE;
+
+  if (_raw) {
+    /* packed 12 bit real samples at twice the IQ rate: unpack, slide
+     * the band center from fs/4 down to DC and half-band decimate by
+     * two - the same conversion libairspy performs internally for the
+     * IQ sample types, minus the USB overhead */
+    while (noutput_items) {
+      if (!_pending.empty()) {
+        const int ncopy = std::min((int)_pending.size(), noutput_items);
+
+        memcpy(out, &_pending[0], ncopy * sizeof(gr_complex));
+        out += ncopy;
+        noutput_items -= ncopy;
+
+        _pending.erase(_pending.begin(), _pending.begin() + ncopy);
+        continue;
+      }
+
+      if (!_ring.used())
+        break;
+
+      const int nreal = _ring.head_len() * 2 / 3;
+
+      _raw_buf.resize(nreal);
+
+      osmosdr::convert::u12p_fc32(_ring.head(), &_raw_buf[0], nreal);
+
+      _ring.pop();
+
+      /* multiplying by (-j)^n shifts the wanted band to DC, where the
+       * half-band stage cuts the rate in half */
+      _conv_buf.resize(nreal);
+      for (int i = 0; i < nreal; i++) {
+        const float v = _raw_buf[i];
+
+        switch (_raw_phase++ & 3) {
+        case 0: _conv_buf[i] = gr_complex(v, 0); break;
+        case 1: _conv_buf[i] = gr_complex(0, -v); break;
+        case 2: _conv_buf[i] = gr_complex(-v, 0); break;
+        case 3: _conv_buf[i] = gr_complex(0, v); break;
+        }
+      }
 
-  /* Wait until we have the requested number of samples */
-  int n_samples_avail = _fifo->size();
+      int n = _raw_hb.process(&_conv_buf[0], nreal, &_conv_buf[0]);
 
-  while (n_samples_avail < noutput_items) {
-    _samp_avail.wait(lock);
-    n_samples_avail = _fifo->size();
+      if (_decim.active())
+        n = _decim.process(&_conv_buf[0], n, &_conv_buf[0]);
+
+      _pending.insert(_pending.end(), _conv_buf.begin(), _conv_buf.begin() + n);
+    }
+
+    return (out - (gr_complex *)output_items[0]);
   }
 
-  for(int i = 0; i < noutput_items; ++i) {
-    out[i] = _fifo->at(0);
-    _fifo->pop_front();
+  if (!_decim.active()) {
+    while (noutput_items && _ring.used()) {
+      const int samp_avail = _ring.head_len() / (2 * sizeof(int16_t)) - _buf_offset;
+      const int nout = std::min(noutput_items, samp_avail);
+      const int16_t *in = (const int16_t *)_ring.head() + _buf_offset * 2;
+
+      osmosdr::convert::s16_fc32(in, (float *)out, nout * 2);
+      out += nout;
+
+      noutput_items -= nout;
+
+      if (nout == samp_avail) {
+        _ring.pop();
+        _buf_offset = 0;
+      } else {
+        _buf_offset += nout;
+      }
+    }
+
+    return (out - (gr_complex *)output_items[0]);
   }
 
-  //std::cerr << "-" << std::flush;
+  /* software decimation path */
+  while (noutput_items) {
+    if (!_pending.empty()) {
+      const int ncopy = std::min((int)_pending.size(), noutput_items);
+
+      memcpy(out, &_pending[0], ncopy * sizeof(gr_complex));
+      out += ncopy;
+      noutput_items -= ncopy;
+
+      _pending.erase(_pending.begin(), _pending.begin() + ncopy);
+      continue;
+    }
+
+    if (!_ring.used())
+      break;
+
+    /* convert the remainder of the head buffer in one go, then run it
+     * through the half-band cascade (stages may filter in place) */
+    const int samp_avail = _ring.head_len() / (2 * sizeof(int16_t)) - _buf_offset;
+    const int16_t *in = (const int16_t *)_ring.head() + _buf_offset * 2;
+
+    _conv_buf.resize(samp_avail);
+
+    osmosdr::convert::s16_fc32(in, (float *)&_conv_buf[0], samp_avail * 2);
 
-  return noutput_items;
+    _ring.pop();
+    _buf_offset = 0;
+
+    int n = _decim.process(&_conv_buf[0], samp_avail, &_conv_buf[0]);
+
+    _pending.insert(_pending.end(), _conv_buf.begin(), _conv_buf.begin() + n);
+  }
+
+  return (out - (gr_complex *)output_items[0]);
 }
 
 std::vector<std::string> airspy_source_c::get_devices()
@@ -393,7 +521,7 @@ double airspy_source_c::set_sample_rate( double rate )
 
 double airspy_source_c::get_sample_rate()
 {
-  return _sample_rate;
+  return _sample_rate / _decim.decim();
 }
 
 osmosdr::freq_range_t airspy_source_c::get_freq_range( size_t chan )
@@ -712,3 +840,10 @@ osmosdr::freq_range_t airspy_source_c::get_bandwidth_range( size_t chan )
 
   return bandwidths;
 }
+
+osmosdr::stream_stats_t airspy_source_c::get_stream_stats( size_t chan )
+{
+  /* one complex output sample corresponds to two packed 12 bit real
+   * samples in raw mode */
+  return _ring.stats( _raw ? 3 : 2 * sizeof(int16_t) );
+}
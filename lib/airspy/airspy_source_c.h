@@ -22,14 +22,12 @@
 #ifndef INCLUDED_AIRSPY_SOURCE_C_H
 #define INCLUDED_AIRSPY_SOURCE_C_H
 
-#include <boost/circular_buffer.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
-
 #include <gnuradio/sync_block.h>
 
 #include <libairspy/airspy.h>
 
+#include "buffer_ring.h"
+#include "halfband_decim.h"
 #include "source_iface.h"
 
 class airspy_source_c;
@@ -121,15 +119,28 @@ public:
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
   static int _airspy_rx_callback(airspy_transfer* transfer);
+  static void _cache_close(void *dev);
   int airspy_rx_callback(void *samples, int sample_count);
 
   airspy_device *_dev;
 
-  boost::circular_buffer<gr_complex> *_fifo;
-  boost::mutex _fifo_lock;
-  boost::condition_variable _samp_avail;
+  osmosdr::buffer_ring _ring;
+  unsigned int _buf_offset;
+
+  osmosdr::halfband_decimator _decim;
+  std::vector<gr_complex> _conv_buf;
+  std::vector<gr_complex> _pending;
+
+  /* raw=1: packed 12 bit ADC samples over USB, real-to-complex
+   * conversion (fs/4 shift plus half-band decimation) runs in work() */
+  bool _raw;
+  unsigned int _raw_phase;
+  osmosdr::halfband_decim_stage _raw_hb;
+  std::vector<float> _raw_buf;
 
   std::vector< std::pair<double, uint32_t> > _sample_rates;
   double _sample_rate;
@@ -147,6 +158,9 @@ private:
   double _mix_gain;
   double _vga_gain;
   double _bandwidth;
+
+  /* non-empty when this instance parks its handle on destruction */
+  std::string _cache_key;
 };
 
 #endif /* INCLUDED_AIRSPY_SOURCE_C_H */
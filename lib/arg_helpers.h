@@ -118,6 +118,31 @@ struct is_nchan_argument
   }
 };
 
+/*
+ * The format= argument selects the output item type of the whole
+ * block: "fc32" is the default gr_complex stream, "sc16" switches to
+ * interleaved 16 bit I/Q at half the memory bandwidth. Backends with
+ * native integer samples then skip the float conversion entirely.
+ */
+inline bool args_to_sc16_output( const std::string &args )
+{
+  std::vector< std::string > arg_list = args_to_vector( args );
+
+  BOOST_FOREACH( std::string arg, arg_list )
+  {
+    dict_t dict = params_to_dict(arg);
+    if (dict.count("format"))
+    {
+      if ("sc16" == dict["format"])
+        return true;
+      else if ("fc32" != dict["format"])
+        throw std::runtime_error("Unsupported output format: " + dict["format"]);
+    }
+  }
+
+  return false;
+}
+
 inline gr::io_signature::sptr args_to_io_signature( const std::string &args )
 {
   size_t max_nchan = 0;
@@ -159,7 +184,9 @@ inline gr::io_signature::sptr args_to_io_signature( const std::string &args )
     throw std::runtime_error("Wrong device arguments specified. Missing nchan?");
 
   const size_t nchan = std::max<size_t>(dev_nchan, 1); // assume at least one
-  return gr::io_signature::make(nchan, nchan, sizeof(gr_complex));
+  const size_t item_size = args_to_sc16_output(args) ?
+        2 * sizeof(short) : sizeof(gr_complex);
+  return gr::io_signature::make(nchan, nchan, item_size);
 }
 
 #endif // OSMOSDR_ARG_HELPERS_H
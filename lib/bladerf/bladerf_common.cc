@@ -142,7 +142,9 @@ bladerf_common::bladerf_common() :
   _samples_per_buffer(NUM_SAMPLES_PER_BUFFER),
   _num_transfers(NUM_TRANSFERS),
   _stream_timeout(STREAM_TIMEOUT_MS),
-  _format(BLADERF_FORMAT_SC16_Q11)
+  _format(BLADERF_FORMAT_SC16_Q11),
+  _sc8(false),
+  _use_metadata(false)
 {
 }
 
@@ -316,9 +318,36 @@ void bladerf_common::init(dict_t const &dict, bladerf_direction direction)
   }
 
   if (dict.count("enable_metadata") > 0) {
+    _use_metadata = true;
     _format = BLADERF_FORMAT_SC16_Q11_META;
   }
 
+  /* Handle setting of the wire sample format */
+  if (dict.count("fmt")) {
+    std::string const fmt = _get(dict, "fmt");
+
+    if ("sc8" == fmt) {
+      if (BLADERF_RX != direction) {
+        BLADERF_WARNING("fmt=sc8 is supported on the RX side only, "
+                        "keeping SC16_Q11");
+      } else {
+#ifdef BLADERF_SC8_AVAILABLE
+        /* trades 4 bits of dynamic range for half the USB bandwidth
+         * per sample, doubling the sustainable aggregate sample rate */
+        _sc8 = true;
+        _format = _use_metadata ? BLADERF_FORMAT_SC8_Q7_META
+                                : BLADERF_FORMAT_SC8_Q7;
+        BLADERF_INFO("Using the 8 bit wire format (SC8_Q7)");
+#else
+        BLADERF_THROW("fmt=sc8 requires libbladeRF 2.4.0 or later");
+#endif
+      }
+    } else if ("sc16" != fmt) {
+      BLADERF_WARNING(boost::str(boost::format("Invalid \"fmt\" value "
+                      "(%s). Supported values are sc16 and sc8.") % fmt));
+    }
+  }
+
   /* Require value to be >= 2 so we can ensure we have twice as many
    * buffers as transfers */
   if (_num_buffers <= 1) {
@@ -254,6 +254,8 @@ protected:
   unsigned int _stream_timeout; /**< timeout for backend transfers */
 
   bladerf_format _format;       /**< sample format to use */
+  bool _sc8;                    /**< use the 8 bit wire format (RX only) */
+  bool _use_metadata;           /**< stream with metadata timestamps */
 
   bladerf_channel_map _chanmap; /**< map of antennas to channels */
   bladerf_channel_enable_map _enables;  /**< enabled channels */
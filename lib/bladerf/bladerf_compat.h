@@ -75,4 +75,10 @@
     #define bladerf_get_board_name(name) "bladerf1"
 
 #endif // libbladeRF < 1.8.1
+
+/* The 8 bit wire formats (SC8_Q7) appeared in libbladeRF 2.4.0 */
+#if defined(LIBBLADERF_API_VERSION) && (LIBBLADERF_API_VERSION >= 0x02040000)
+    #define BLADERF_SC8_AVAILABLE
+#endif
+
 #endif // INCLUDED_BLADERF_COMPAT_H
@@ -0,0 +1,63 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * dlopen entry points for the bladeRF backend, compiled only when the
+ * backend is built as a plugin (see ENABLE_PLUGINS in lib/CMakeLists.txt
+ * and lib/plugin_loader.h).
+ */
+
+#include <boost/foreach.hpp>
+
+#include "plugin_loader.h"
+#include "bladerf_source_c.h"
+#include "bladerf_sink_c.h"
+
+extern "C" gr::basic_block_sptr
+osmosdr_plugin_make_source( const std::string &args, source_iface **iface )
+{
+  bladerf_source_c_sptr src = make_bladerf_source_c( args );
+  *iface = src.get();
+  return src;
+}
+
+extern "C" gr::basic_block_sptr
+osmosdr_plugin_make_sink( const std::string &args, sink_iface **iface )
+{
+  bladerf_sink_c_sptr sink = make_bladerf_sink_c( args );
+  *iface = sink.get();
+  return sink;
+}
+
+extern "C" void
+osmosdr_plugin_get_source_devices( std::vector< std::string > &devices )
+{
+  BOOST_FOREACH( std::string dev, bladerf_source_c::get_devices() )
+    devices.push_back( dev );
+}
+
+extern "C" void
+osmosdr_plugin_get_sink_devices( std::vector< std::string > &devices )
+{
+  BOOST_FOREACH( std::string dev, bladerf_sink_c::get_devices() )
+    devices.push_back( dev );
+}
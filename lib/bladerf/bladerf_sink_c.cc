@@ -71,7 +71,11 @@ bladerf_sink_c::bladerf_sink_c(const std::string &args) :
   _16icbuf(NULL),
   _32fcbuf(NULL),
   _in_burst(false),
-  _running(false)
+  _running(false),
+  _zero_copy(false),
+  _stream(NULL),
+  _stream_buffers(NULL),
+  _next_buffer(0)
 {
   dict_t dict = params_to_dict(args);
 
@@ -95,6 +99,19 @@ bladerf_sink_c::bladerf_sink_c(const std::string &args) :
     set_biastee_mode(dict["biastee"]);
   }
 
+  /* Zero-copy transmission: the float to int16 conversion writes
+   * directly into the stream's transfer buffers via the async API,
+   * saving the copy bladerf_sync_tx would do per sample */
+  if (dict.count("zerocopy")) {
+    _zero_copy = boost::lexical_cast<bool>(dict["zerocopy"]);
+
+    if (_zero_copy && _use_metadata) {
+      BLADERF_WARNING("zerocopy is not available with metadata/burst "
+                      "transmission, keeping the sync interface");
+      _zero_copy = false;
+    }
+  }
+
   /* Initialize channel <-> antenna map */
   BOOST_FOREACH(std::string ant, get_antennas()) {
     _chanmap[str2channel(ant)] = -1;
@@ -118,6 +135,12 @@ bladerf_sink_c::bladerf_sink_c(const std::string &args) :
   set_max_noutput_items(_samples_per_buffer);
   set_output_multiple(get_num_channels());
 
+  if (_zero_copy) {
+    /* the async interface transmits whole transfer buffers, so work()
+     * must deliver exactly one buffer's worth of samples per call */
+    set_output_multiple(_samples_per_buffer);
+  }
+
   /* Set channel layout */
   _layout = (get_num_channels() > 1) ? BLADERF_TX_X2 : BLADERF_TX_X1;
 
@@ -165,11 +188,22 @@ bool bladerf_sink_c::start()
 
   _in_burst = false;
 
-  status = bladerf_sync_config(_dev.get(), _layout, _format, _num_buffers,
-                               _samples_per_buffer, _num_transfers,
-                               _stream_timeout);
-  if (status != 0) {
-    BLADERF_THROW_STATUS(status, "bladerf_sync_config failed");
+  if (_zero_copy) {
+    status = bladerf_init_stream(&_stream, _dev.get(), _stream_callback,
+                                 &_stream_buffers, _num_buffers, _format,
+                                 _samples_per_buffer, _num_transfers, this);
+    if (status != 0) {
+      BLADERF_THROW_STATUS(status, "bladerf_init_stream failed");
+    }
+
+    _next_buffer = 0;
+  } else {
+    status = bladerf_sync_config(_dev.get(), _layout, _format, _num_buffers,
+                                 _samples_per_buffer, _num_transfers,
+                                 _stream_timeout);
+    if (status != 0) {
+      BLADERF_THROW_STATUS(status, "bladerf_sync_config failed");
+    }
   }
 
   for (size_t ch = 0; ch < get_max_channels(); ++ch) {
@@ -190,6 +224,10 @@ bool bladerf_sink_c::start()
 
   _running = true;
 
+  if (_zero_copy) {
+    _thread = gr::thread::thread(_stream_task, this);
+  }
+
   return true;
 }
 
@@ -208,6 +246,16 @@ bool bladerf_sink_c::stop()
 
   _running = false;
 
+  if (_stream) {
+    /* flags the stream for shutdown and wakes bladerf_stream() up */
+    bladerf_submit_stream_buffer(_stream, BLADERF_STREAM_SHUTDOWN,
+                                 _stream_timeout);
+    _thread.join();
+    bladerf_deinit_stream(_stream);
+    _stream = NULL;
+    _stream_buffers = NULL;
+  }
+
   for (size_t ch = 0; ch < get_max_channels(); ++ch) {
     bladerf_channel brfch = BLADERF_CHANNEL_TX(ch);
     if (get_channel_enable(brfch)) {
@@ -241,6 +289,10 @@ int bladerf_sink_c::work(int noutput_items,
     return 0;
   }
 
+  if (_zero_copy) {
+    return work_zero_copy(noutput_items, input_items);
+  }
+
   // copy the samples from input_items
   gr_complex const **in = reinterpret_cast<gr_complex const **>(&input_items[0]);
 
@@ -287,6 +339,84 @@ int bladerf_sink_c::work(int noutput_items,
   return noutput_items;
 }
 
+int bladerf_sink_c::work_zero_copy(int noutput_items,
+                                   gr_vector_const_void_star &input_items)
+{
+  int status;
+  size_t nstreams = num_streams(_layout);
+  gr_complex const **in = reinterpret_cast<gr_complex const **>(&input_items[0]);
+  int processed = 0;
+
+  /* set_output_multiple() sizes the work payload in whole transfer
+   * buffers, convert and submit them one by one */
+  while (processed < noutput_items) {
+    int16_t *buf = static_cast<int16_t *>(_stream_buffers[_next_buffer]);
+
+    if (nstreams > 1) {
+      /* interleave the streams, then convert into the submit buffer */
+      gr_complex *intl_out = _32fcbuf;
+
+      for (size_t i = 0; i < _samples_per_buffer / nstreams; ++i) {
+        for (size_t n = 0; n < nstreams; ++n) {
+          memcpy(intl_out++, in[n]++, sizeof(gr_complex));
+        }
+      }
+
+      volk_32f_s32f_convert_16i(buf,
+                                reinterpret_cast<float const *>(_32fcbuf),
+                                SCALING_FACTOR, 2*_samples_per_buffer);
+    } else {
+      /* a single stream converts straight from the input buffer */
+      volk_32f_s32f_convert_16i(buf,
+                                reinterpret_cast<float const *>(in[0] + processed),
+                                SCALING_FACTOR, 2*_samples_per_buffer);
+    }
+
+    /* blocks until a transfer slot is free, applying backpressure */
+    status = bladerf_submit_stream_buffer(_stream, buf, _stream_timeout);
+
+    if (status != 0) {
+      BLADERF_WARNING("bladerf_submit_stream_buffer error: "
+                      << bladerf_strerror(status));
+      ++_failures;
+
+      if (_failures >= MAX_CONSECUTIVE_FAILURES) {
+        BLADERF_WARNING("Consecutive error limit hit. Shutting down.");
+        return WORK_DONE;
+      }
+    } else {
+      _failures = 0;
+    }
+
+    _next_buffer = (_next_buffer + 1) % _num_buffers;
+    processed += _samples_per_buffer;
+  }
+
+  return processed;
+}
+
+void *bladerf_sink_c::_stream_callback(struct bladerf *dev,
+                                       struct bladerf_stream *stream,
+                                       struct bladerf_metadata *meta,
+                                       void *samples, size_t num_samples,
+                                       void *user_data)
+{
+  /* buffers are handed to libbladeRF from work() via
+   * bladerf_submit_stream_buffer(), the callback only acknowledges
+   * completed transfers */
+  return BLADERF_STREAM_NO_DATA;
+}
+
+void bladerf_sink_c::_stream_task(bladerf_sink_c *obj)
+{
+  int status = bladerf_stream(obj->_stream, obj->_layout);
+
+  if (status < 0) {
+    std::cerr << "bladerf_stream returned " << bladerf_strerror(status)
+              << std::endl;
+  }
+}
+
 int bladerf_sink_c::transmit_with_tags(int16_t const *samples,
                                         int noutput_items)
 {
@@ -22,6 +22,7 @@
 #define INCLUDED_BLADERF_SINK_C_H
 
 #include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
 #include "sink_iface.h"
 #include "bladerf_common.h"
 
@@ -121,6 +122,13 @@ public:
 
 private:
   int transmit_with_tags(int16_t const *samples, int noutput_items);
+  int work_zero_copy(int noutput_items, gr_vector_const_void_star &input_items);
+  static void *_stream_callback(struct bladerf *dev,
+                                struct bladerf_stream *stream,
+                                struct bladerf_metadata *meta,
+                                void *samples, size_t num_samples,
+                                void *user_data);
+  static void _stream_task(bladerf_sink_c *obj);
 
   // Sample-handling buffers
   int16_t *_16icbuf;              /**< raw samples to bladeRF */
@@ -130,6 +138,12 @@ private:
   bool _running;                  /**< is the sink running? */
   bladerf_channel_layout _layout; /**< channel layout */
 
+  bool _zero_copy;                /**< convert into the stream buffers */
+  struct bladerf_stream *_stream; /**< async stream handle (zero-copy) */
+  void **_stream_buffers;         /**< transfer buffers owned by _stream */
+  size_t _next_buffer;            /**< next stream buffer to fill */
+  gr::thread::thread _thread;     /**< runs bladerf_stream() */
+
   gr::thread::mutex d_mutex;      /**< mutex to protect set/work access */
 
   /* Scaling factor used when converting from float to int16_t */
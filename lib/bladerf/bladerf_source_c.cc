@@ -31,6 +31,7 @@
 #include <iostream>
 
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -40,10 +41,15 @@
 
 #include "arg_helpers.h"
 #include "bladerf_source_c.h"
+#include "convert_pool.h"
 #include "osmosdr/source.h"
 
 using namespace boost::assign;
 
+/* samples per conversion pool slice: a slice and its float output stay
+ * within L2 while still amortizing the per-slice handoff */
+#define CONV_SLICE 16384
+
 /******************************************************************************
  * Functions
  ******************************************************************************/
@@ -69,8 +75,11 @@ bladerf_source_c::bladerf_source_c(const std::string &args) :
                   gr::io_signature::make(0, 0, 0),
                   args_to_io_signature(args)),
   _16icbuf(NULL),
+  _8icbuf(NULL),
   _32fcbuf(NULL),
   _running(false),
+  _sc16(args_to_sc16_output(args)),
+  _conv_pool(false),
   _agcmode(BLADERF_GAIN_DEFAULT)
 {
   int status;
@@ -80,6 +89,23 @@ bladerf_source_c::bladerf_source_c(const std::string &args) :
   /* Perform src/sink agnostic initializations */
   init(dict, BLADERF_RX);
 
+  if (_sc16 && _sc8) {
+    BLADERF_THROW("fmt=sc8 cannot feed the sc16 output mode");
+  }
+
+  /* workers=<n>: convert on a pool of n shared worker threads (see
+   * lib/convert_pool.h) - at very high aggregate rates one core cannot
+   * both convert and copy */
+  if (dict.count("workers")) {
+    unsigned int workers =
+        boost::lexical_cast<unsigned int>(dict["workers"]);
+
+    if (workers > 0) {
+      osmosdr::convert_pool::instance().start(workers);
+      _conv_pool = true;
+    }
+  }
+
   /* Handle setting of sampling mode */
   if (dict.count("sampling")) {
     bladerf_sampling sampling = BLADERF_SAMPLING_UNKNOWN;
@@ -241,7 +267,10 @@ bool bladerf_source_c::start()
   /* Allocate memory for conversions in work() */
   size_t alignment = volk_get_alignment();
 
-  _16icbuf = reinterpret_cast<int16_t *>(volk_malloc(2*_samples_per_buffer*sizeof(int16_t), alignment));
+  if (_sc8)
+    _8icbuf = reinterpret_cast<int8_t *>(volk_malloc(2*_samples_per_buffer*sizeof(int8_t), alignment));
+  else
+    _16icbuf = reinterpret_cast<int16_t *>(volk_malloc(2*_samples_per_buffer*sizeof(int16_t), alignment));
   _32fcbuf = reinterpret_cast<gr_complex *>(volk_malloc(_samples_per_buffer*sizeof(gr_complex), alignment));
 
   _running = true;
@@ -276,13 +305,32 @@ bool bladerf_source_c::stop()
 
   /* Deallocate conversion memory */
   volk_free(_16icbuf);
+  volk_free(_8icbuf);
   volk_free(_32fcbuf);
   _16icbuf = NULL;
+  _8icbuf = NULL;
   _32fcbuf = NULL;
 
   return true;
 }
 
+/* One conversion pool slice: convert \p count complex samples starting
+ * at \p offset. The wire buffer holds interleaved I/Q, hence the
+ * factor of two on offsets and counts. */
+void bladerf_source_c::convert_slice_16(float *out, size_t offset,
+                                        size_t count)
+{
+  volk_16i_s32f_convert_32f(out + 2*offset, _16icbuf + 2*offset,
+                            SCALING_FACTOR, 2*count);
+}
+
+void bladerf_source_c::convert_slice_8(float *out, size_t offset,
+                                       size_t count)
+{
+  volk_8i_s32f_convert_32f(out + 2*offset, _8icbuf + 2*offset,
+                           SCALING_FACTOR_SC8, 2*count);
+}
+
 int bladerf_source_c::work(int noutput_items,
                           gr_vector_const_void_star &input_items,
                           gr_vector_void_star &output_items)
@@ -300,14 +348,27 @@ int bladerf_source_c::work(int noutput_items,
   }
 
   // set up metadata
-  if (BLADERF_FORMAT_SC16_Q11_META == _format) {
+  if (_use_metadata) {
     memset(&meta, 0, sizeof(meta));
     meta.flags = BLADERF_META_FLAG_RX_NOW;
     meta_ptr = &meta;
   }
 
-  // grab samples into temp buffer
-  status = bladerf_sync_rx(_dev.get(), static_cast<void *>(_16icbuf),
+  // Pick the receive target: the wire samples land in a staging buffer
+  // only when a conversion or deinterleave pass needs one. With sc16
+  // output and a single stream the wire format already is the output
+  // format, so the driver DMAs straight into the scheduler's buffer
+  // and work() touches no sample at all.
+  void *target;
+
+  if (_sc8)
+    target = static_cast<void *>(_8icbuf);
+  else if (_sc16 && nstreams == 1)
+    target = output_items[0];
+  else
+    target = static_cast<void *>(_16icbuf);
+
+  status = bladerf_sync_rx(_dev.get(), target,
                            noutput_items, meta_ptr, _stream_timeout);
   if (status != 0) {
     BLADERF_WARNING(boost::str(boost::format("bladerf_sync_rx error: %s")
@@ -322,27 +383,81 @@ int bladerf_source_c::work(int noutput_items,
     _failures = 0;
   }
 
-  // convert from int16_t to float
-  // output_items is gr_complex (2x float), so num_points is 2*noutput_items
-  volk_16i_s32f_convert_32f(reinterpret_cast<float *>(_32fcbuf), _16icbuf,
-                            SCALING_FACTOR, 2*noutput_items);
+  if (_sc16) {
+    // sc16 output: hand the native Q11 samples through without any
+    // float conversion, only deinterleaving the channel multiplex
+    std::complex<int16_t> const *icbuf =
+        reinterpret_cast<std::complex<int16_t> const *>(_16icbuf);
+    std::complex<int16_t> **iout =
+        reinterpret_cast<std::complex<int16_t> **>(&output_items[0]);
 
-  // copy the samples into output_items
-  gr_complex **out = reinterpret_cast<gr_complex **>(&output_items[0]);
-
-  if (nstreams > 1) {
-    // we need to deinterleave the multiplex as we copy
-    gr_complex const *deint_in = _32fcbuf;
+    if (nstreams > 1) {
+      size_t const samples_per_stream = noutput_items / nstreams;
 
-    for (size_t i = 0; i < (noutput_items/nstreams); ++i) {
       for (size_t n = 0; n < nstreams; ++n) {
-        memcpy(out[n]++, deint_in++, sizeof(gr_complex));
+        std::complex<int16_t> const *deint_in = icbuf + n;
+        std::complex<int16_t> *deint_out = iout[n];
+
+        for (size_t i = 0; i < samples_per_stream; ++i) {
+          deint_out[i] = *deint_in;
+          deint_in += nstreams;
+        }
       }
     }
+    // single stream: the samples were received into output_items[0]
+
+    return noutput_items;
+  }
+
+  // convert the wire samples to float; with a single stream straight
+  // into the scheduler's output buffer, the staging buffer is only for
+  // the deinterleave pass of the channel multiplex
+  // output_items is gr_complex (2x float), so num_points is 2*noutput_items
+  gr_complex **out = reinterpret_cast<gr_complex **>(&output_items[0]);
+  float *conv_target = nstreams > 1 ? reinterpret_cast<float *>(_32fcbuf)
+                                    : reinterpret_cast<float *>(out[0]);
+
+  if (_conv_pool) {
+    // the pool workers and this thread claim cache-sized slices
+    // dynamically; slice offsets are fixed, so the converted samples
+    // land in their final place without a reordering pass
+    osmosdr::convert_pool &pool = osmosdr::convert_pool::instance();
+
+    if (_sc8)
+      pool.run(boost::bind(&bladerf_source_c::convert_slice_8, this,
+                           conv_target, _1, _2),
+               noutput_items, CONV_SLICE);
+    else
+      pool.run(boost::bind(&bladerf_source_c::convert_slice_16, this,
+                           conv_target, _1, _2),
+               noutput_items, CONV_SLICE);
+  } else if (_sc8) {
+    volk_8i_s32f_convert_32f(conv_target, _8icbuf,
+                             SCALING_FACTOR_SC8, 2*noutput_items);
   } else {
-    // no deinterleaving to do: simply copy everything
-    memcpy(out[0], _32fcbuf, sizeof(gr_complex) * noutput_items);
+    volk_16i_s32f_convert_32f(conv_target, _16icbuf,
+                              SCALING_FACTOR, 2*noutput_items);
+  }
+
+  if (nstreams > 1) {
+    // deinterleave the multiplex one output stream at a time: a strided
+    // gather per channel keeps the stores sequential and lets the
+    // compiler vectorize, instead of one 8-byte memcpy call per sample
+    size_t const samples_per_stream = noutput_items / nstreams;
+
+    for (size_t n = 0; n < nstreams; ++n) {
+      gr_complex const *deint_in = _32fcbuf + n;
+      gr_complex *deint_out = out[n];
+
+      for (size_t i = 0; i < samples_per_stream; ++i) {
+        deint_out[i] = *deint_in;
+        deint_in += nstreams;
+      }
+
+      out[n] += samples_per_stream;
+    }
   }
+  // single stream: the conversion already wrote into output_items[0]
 
   return noutput_items;
 }
@@ -127,11 +127,17 @@ public:
   void set_agc_mode(const std::string &agcmode);
 
 private:
+  void convert_slice_16(float *out, size_t offset, size_t count);
+  void convert_slice_8(float *out, size_t offset, size_t count);
+
   // Sample-handling buffers
   int16_t *_16icbuf;              /**< raw samples from bladeRF */
+  int8_t *_8icbuf;                /**< raw samples in the 8 bit wire format */
   gr_complex *_32fcbuf;           /**< intermediate buffer to gnuradio */
 
   bool _running;                  /**< is the source running? */
+  bool _sc16;                     /**< pass sc16 samples through unconverted */
+  bool _conv_pool;                /**< convert on the shared worker pool */
   bladerf_channel_layout _layout; /**< channel layout */
   bladerf_gain_mode _agcmode;     /**< gain mode when AGC is enabled */
 
@@ -139,6 +145,9 @@ private:
 
   /* Scaling factor used when converting from int16_t to float */
   const float SCALING_FACTOR = 2048.0f;
+
+  /* Scaling factor of the 8 bit wire format (SC8_Q7) */
+  const float SCALING_FACTOR_SC8 = 128.0f;
 };
 
 #endif // INCLUDED_BLADERF_SOURCE_C_H
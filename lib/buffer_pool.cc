@@ -0,0 +1,211 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "buffer_pool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_LIBNUMA
+#include <numaif.h>
+#endif
+
+/* how many released buffers of one size to keep around. Enough for a
+ * couple of rings; anything beyond that goes back to the system. */
+#define BUFFER_POOL_MAX_FREE  64
+
+#define HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+namespace osmosdr {
+
+buffer_pool &buffer_pool::instance()
+{
+  static buffer_pool pool;
+
+  return pool;
+}
+
+buffer_pool::buffer_pool()
+  : _use_hugepages(false),
+    _numa_node(-1)
+{
+  const char *env = getenv("GR_OSMOSDR_HUGEPAGES");
+
+  _use_hugepages = env && *env && strcmp(env, "0");
+
+  env = getenv("GR_OSMOSDR_NUMA_NODE");
+
+  if (env && *env)
+    _numa_node = atoi(env);
+}
+
+void buffer_pool::set_numa_node(int node)
+{
+#ifdef HAVE_LIBNUMA
+  _numa_node = node;
+#else
+  if (node >= 0)
+    std::cerr << "Built without libnuma, ignoring NUMA node binding."
+              << std::endl;
+#endif
+}
+
+/* Bind the pages of a fresh mapping to one node. First touch has not
+ * happened yet, so the policy decides where the pages materialize. */
+static void bind_to_node(void *p, size_t len, int node)
+{
+#ifdef HAVE_LIBNUMA
+  if (node < 0)
+    return;
+
+  unsigned long mask = 1UL << node;
+
+  if (mbind(p, len, MPOL_BIND, &mask, 8 * sizeof(mask), 0))
+    std::cerr << "Failed to bind ring buffer to NUMA node " << node
+              << std::endl;
+#else
+  (void)p;
+  (void)len;
+  (void)node;
+#endif
+}
+
+unsigned char *buffer_pool::acquire(size_t len)
+{
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    std::vector<unsigned char *> &list = _free[len];
+
+    if (!list.empty()) {
+      unsigned char *buf = list.back();
+      list.pop_back();
+      return buf;
+    }
+  }
+
+  return allocate(len);
+}
+
+void buffer_pool::release(unsigned char *buf, size_t len)
+{
+  if (!buf)
+    return;
+
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    std::vector<unsigned char *> &list = _free[len];
+
+    if (list.size() < BUFFER_POOL_MAX_FREE) {
+      list.push_back(buf);
+      return;
+    }
+  }
+
+  deallocate(buf);
+}
+
+unsigned char *buffer_pool::allocate(size_t len)
+{
+#if defined(MAP_HUGETLB)
+  if (_use_hugepages) {
+    size_t map_len = (len + HUGE_PAGE_SIZE - 1) & ~size_t(HUGE_PAGE_SIZE - 1);
+
+    void *p = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    if (p != MAP_FAILED) {
+      bind_to_node(p, map_len, _numa_node);
+
+      boost::mutex::scoped_lock lock(_mutex);
+      _mapped[(unsigned char *)p] = map_len;
+      return (unsigned char *)p;
+    }
+    /* no huge pages reserved, fall through to ordinary pages */
+  }
+#endif
+
+#ifndef _WIN32
+  if (_numa_node >= 0) {
+    /* a dedicated mapping, so the binding cannot spill over onto
+     * neighbouring heap allocations */
+    size_t map_len = (len + 4095) & ~size_t(4095);
+
+    void *p = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p != MAP_FAILED) {
+      bind_to_node(p, map_len, _numa_node);
+
+      boost::mutex::scoped_lock lock(_mutex);
+      _mapped[(unsigned char *)p] = map_len;
+      return (unsigned char *)p;
+    }
+  }
+#endif
+
+#ifdef _WIN32
+  return (unsigned char *)_aligned_malloc(len, 4096);
+#else
+  void *p = NULL;
+
+  if (posix_memalign(&p, 4096, len))
+    return NULL;
+
+  return (unsigned char *)p;
+#endif
+}
+
+void buffer_pool::deallocate(unsigned char *buf)
+{
+#if defined(MAP_HUGETLB)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    std::map<unsigned char *, size_t>::iterator it = _mapped.find(buf);
+
+    if (it != _mapped.end()) {
+      size_t map_len = it->second;
+      _mapped.erase(it);
+      lock.unlock();
+      munmap(buf, map_len);
+      return;
+    }
+  }
+#endif
+
+#ifdef _WIN32
+  _aligned_free(buf);
+#else
+  free(buf);
+#endif
+}
+
+} /* namespace osmosdr */
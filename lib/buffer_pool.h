@@ -0,0 +1,84 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_BUFFER_POOL_H
+#define OSMOSDR_BUFFER_POOL_H
+
+#include <boost/thread/mutex.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Process-wide pool of page-aligned transfer buffers.
+ *
+ * Backends tear their rings down on stop() and rebuild them on
+ * start(); applications that hop channels do this many times a minute.
+ * Instead of going through the allocator each time, released buffers
+ * are kept on a per-size free list and handed back out on the next
+ * acquire(), so a restart reuses the same (page-warm) memory without
+ * allocating at all.
+ *
+ * Setting GR_OSMOSDR_HUGEPAGES in the environment backs new buffers
+ * with anonymous huge pages where the platform supports it, falling
+ * back to ordinary pages when the mapping fails.
+ *
+ * On multi-socket machines the rings otherwise land on whichever
+ * node happened to run the allocating constructor. When built with
+ * libnuma, set_numa_node() - or GR_OSMOSDR_NUMA_NODE in the
+ * environment - binds buffers allocated from then on to one node,
+ * typically the one the rx_cpu pinned streaming thread runs on.
+ * Buffers already pooled keep their placement.
+ */
+class buffer_pool
+{
+public:
+  static buffer_pool &instance();
+
+  /*! A page-aligned buffer of \p len bytes, reused if possible. */
+  unsigned char *acquire(size_t len);
+
+  /*! Return a buffer obtained from acquire() with the same \p len. */
+  void release(unsigned char *buf, size_t len);
+
+  /*! Bind subsequent allocations to NUMA node \p node, -1 restores
+   * the default first-touch placement. A no-op without libnuma. */
+  void set_numa_node(int node);
+
+private:
+  buffer_pool();
+
+  unsigned char *allocate(size_t len);
+  void deallocate(unsigned char *buf);
+
+  bool _use_hugepages;
+  int _numa_node;
+
+  boost::mutex _mutex;
+  std::map< size_t, std::vector<unsigned char *> > _free;
+  std::map< unsigned char *, size_t > _mapped; /* mmap'd blocks */
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_BUFFER_POOL_H */
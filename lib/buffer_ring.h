@@ -0,0 +1,468 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_BUFFER_RING_H
+#define OSMOSDR_BUFFER_RING_H
+
+#include <osmosdr/stream_stats.h>
+
+#include "buffer_pool.h"
+#include "trace.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Fixed-size single-producer/single-consumer ring of sample buffers.
+ *
+ * The producer (typically a libusb transfer callback) and the consumer
+ * (the GR scheduler thread inside work()) each own one index. Indices
+ * are published with release stores and observed with acquire loads,
+ * so neither side takes a lock on the hot path. The mutex/condvar pair
+ * only backs the blocking wait in the consumer; the producer touches
+ * it just when the consumer has announced that it went to sleep.
+ *
+ * When the ring is full the overflow policy decides what gives: the
+ * default drop-newest throws the incoming buffer away, block-producer
+ * stalls the producer until the consumer made room, and drop-oldest
+ * asks the consumer to shed the stale half of its backlog at the next
+ * buffer boundary (only the consumer may move the head, so the shed
+ * happens one scheduler wakeup later). Every lost buffer is accounted
+ * sample-accurately in the drop counters.
+ *
+ * The buffers themselves come from the process-wide buffer_pool, so
+ * tearing a ring down on stop() and rebuilding it on start() reuses
+ * the same memory instead of churning the allocator.
+ */
+class buffer_ring
+{
+public:
+  enum overflow_policy_t {
+    OVERFLOW_DROP_NEWEST = 0, /* historic behavior, the default */
+    OVERFLOW_DROP_OLDEST,
+    OVERFLOW_BLOCK
+  };
+
+  buffer_ring()
+    : _buf_len(0),
+      _policy(OVERFLOW_DROP_NEWEST),
+      _head(0),
+      _tail(0),
+      _shutdown(false),
+      _waiting(false),
+      _room_waiting(false),
+      _overflow_pending(false),
+      _watermark(0),
+      _watermark_auto(false),
+      _dropped(0),
+      _dropped_bytes(0),
+      _high_water(0)
+  {
+    for (size_t i = 0; i < stream_stats_t::NUM_LATENCY_BINS; ++i)
+      _lat_bins[i].store(0, std::memory_order_relaxed);
+  }
+
+  ~buffer_ring()
+  {
+    for (size_t i = 0; i < _bufs.size(); ++i)
+      buffer_pool::instance().release(_bufs[i], _buf_len);
+  }
+
+  /*! (Re)acquire \p num buffers of \p len bytes each from the pool.
+   * Not thread safe, call before streaming starts. */
+  void resize(unsigned int num, unsigned int len)
+  {
+    if (num != _bufs.size() || len != _buf_len) {
+      for (size_t i = 0; i < _bufs.size(); ++i)
+        buffer_pool::instance().release(_bufs[i], _buf_len);
+
+      _bufs.resize(num);
+      _lens.resize(num);
+      _stamps.resize(num);
+      _buf_len = len;
+      for (unsigned int i = 0; i < num; ++i)
+        _bufs[i] = buffer_pool::instance().acquire(len);
+    }
+
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _shutdown.store(false, std::memory_order_relaxed);
+    _overflow_pending.store(false, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return _bufs.size(); }
+
+  void set_overflow_policy(overflow_policy_t policy) { _policy = policy; }
+  overflow_policy_t overflow_policy() const { return _policy; }
+
+  /*! Configure the overflow policy from the device arguments, e.g.
+   * overflow=drop-oldest. Accepts drop-newest, drop-oldest and block.
+   * Not thread safe, call before streaming starts. */
+  void parse_overflow_policy(const std::map<std::string, std::string> &dict)
+  {
+    std::map<std::string, std::string>::const_iterator it =
+        dict.find("overflow");
+
+    if (dict.end() == it)
+      return;
+
+    if ("drop-newest" == it->second)
+      _policy = OVERFLOW_DROP_NEWEST;
+    else if ("drop-oldest" == it->second)
+      _policy = OVERFLOW_DROP_OLDEST;
+    else if ("block" == it->second)
+      _policy = OVERFLOW_BLOCK;
+    else
+      std::cerr << "Unsupported overflow policy '" << it->second
+                << "', keeping drop-newest." << std::endl;
+  }
+
+  /*! Configure the consumer wakeup watermark from the device
+   * arguments: watermark=<N> wakes work() once N buffers are queued
+   * (N=1 for the lowest latency), watermark=auto adapts the count at
+   * runtime. Without the argument the backend's historic default
+   * stays in effect. Not thread safe, call before streaming starts. */
+  void parse_watermark(const std::map<std::string, std::string> &dict)
+  {
+    std::map<std::string, std::string>::const_iterator it =
+        dict.find("watermark");
+
+    if (dict.end() == it)
+      return;
+
+    if ("auto" == it->second) {
+      _watermark_auto = true;
+      _watermark = 1;
+    } else {
+      _watermark = boost::lexical_cast<size_t>(it->second);
+
+      if (0 == _watermark)
+        _watermark = 1;
+    }
+  }
+
+  /*! Consumer side: the effective wakeup watermark to pass to wait(),
+   * \p dflt being the backend's historic default. In adaptive mode the
+   * watermark doubles whenever the backlog has outrun it - the
+   * consumer is loaded, so deeper batches amortize the wakeups - and
+   * halves whenever the ring was found drained dry - the consumer
+   * keeps up, so waking per buffer minimizes latency. */
+  size_t watermark(size_t dflt)
+  {
+    if (_watermark_auto) {
+      const size_t u = used();
+
+      if (u >= 2 * _watermark && _watermark < _bufs.size() / 2)
+        _watermark *= 2;
+      else if (0 == u && _watermark > 1)
+        _watermark /= 2;
+
+      return _watermark;
+    }
+
+    if (0 == _watermark)
+      return dflt;
+
+    /* a fixed watermark the ring cannot reach would block forever */
+    return std::min(_watermark, _bufs.size());
+  }
+
+  /*! Allocated length in bytes of each buffer in the ring. */
+  size_t buf_len() const { return _buf_len; }
+
+  size_t used() const
+  {
+    return _tail.load(std::memory_order_acquire) -
+           _head.load(std::memory_order_acquire);
+  }
+
+  /*! Producer side: direct access to the next free buffer so it can be
+   * filled in place, e.g. by a format conversion reading straight from
+   * a USB transfer. Publish the data with commit() afterwards.
+   * \return NULL if the ring is full */
+  unsigned char *write_head()
+  {
+    uint64_t head = _head.load(std::memory_order_acquire);
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+    if (tail - head >= _bufs.size())
+      return NULL;
+
+    return _bufs[tail % _bufs.size()];
+  }
+
+  /*! Producer side: publish \p len bytes placed in write_head(). */
+  void commit(size_t len)
+  {
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+    _lens[tail % _bufs.size()] = len;
+    _stamps[tail % _bufs.size()] = now_us();
+    _tail.store(tail + 1, std::memory_order_release);
+
+    uint64_t fill = tail + 1 - _head.load(std::memory_order_relaxed);
+    if (fill > _high_water.load(std::memory_order_relaxed))
+      _high_water.store(fill, std::memory_order_relaxed);
+
+    OSMOSDR_TRACE2(ring_enqueue, len, fill);
+
+    if (_waiting.load(std::memory_order_acquire)) {
+      /* taking the (then uncontended) lock avoids a lost wakeup
+       * between the consumer's predicate check and its wait */
+      boost::mutex::scoped_lock lock(_mutex);
+      _cond.notify_one();
+    }
+  }
+
+  /*! Producer side: copy \p len bytes into the next free buffer.
+   * \return false if the ring was full and the data has been dropped */
+  bool write(const unsigned char *data, size_t len)
+  {
+    unsigned char *dest = write_head();
+
+    if (!dest) {
+      if (overflow(len))
+        dest = write_head();
+
+      if (!dest)
+        return false;
+    }
+
+    std::memcpy(dest, data, len);
+    commit(len);
+
+    return true;
+  }
+
+  /*! Producer side: the ring was full. Applies the overflow policy:
+   * block-producer waits for room, drop-oldest flags the consumer to
+   * shed backlog, and whenever the incoming buffer is lost it is
+   * accounted with count_drop(). write() does this itself; producers
+   * filling buffers in place via write_head() call it on NULL.
+   * \param len the length in bytes the producer wanted to write
+   * \return true when the producer should retry write_head() */
+  bool overflow(size_t len)
+  {
+    if (OVERFLOW_BLOCK == _policy && wait_room())
+      return true;
+
+    if (OVERFLOW_DROP_OLDEST == _policy)
+      _overflow_pending.store(true, std::memory_order_release);
+
+    count_drop(len);
+    return false;
+  }
+
+  /*! Consumer side: true when the producer hit a full ring under the
+   * drop-oldest policy and the consumer should shed backlog. */
+  bool overflow_pending() const
+  {
+    return _overflow_pending.load(std::memory_order_acquire);
+  }
+
+  /*! Consumer side: pop and account whole buffers until at most \p keep
+   * remain, then clear overflow_pending(). Only call at a buffer
+   * boundary - the head changes, so any offset into it becomes stale. */
+  void discard_backlog(size_t keep)
+  {
+    while (used() > keep) {
+      count_drop(head_len());
+      pop();
+    }
+
+    _overflow_pending.store(false, std::memory_order_release);
+  }
+
+  /*! Producer side: account for a buffer of \p len bytes that had to
+   * be thrown away. write() does this itself; producers that fill
+   * buffers in place via write_head() call it when the ring is full. */
+  void count_drop(size_t len)
+  {
+    uint64_t total = _dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+    _dropped_bytes.fetch_add(len, std::memory_order_relaxed);
+
+    OSMOSDR_TRACE2(ring_overflow, len, total);
+  }
+
+  /*! Producer side: block until at least one buffer is free or the
+   * ring has been shut down. Transmitters use this so work() applies
+   * backpressure to the scheduler instead of dropping samples.
+   * \return false once the ring was shut down */
+  bool wait_room()
+  {
+    if (used() < _bufs.size())
+      return !_shutdown.load(std::memory_order_acquire);
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    _room_waiting.store(true, std::memory_order_release);
+    while (used() >= _bufs.size() &&
+           !_shutdown.load(std::memory_order_acquire))
+      _cond.wait(lock);
+    _room_waiting.store(false, std::memory_order_release);
+
+    return !_shutdown.load(std::memory_order_acquire);
+  }
+
+  /*! Consumer side: block until at least \p min_used buffers are
+   * available or the ring has been shut down.
+   * \return false once the ring was shut down */
+  bool wait(size_t min_used)
+  {
+    if (used() >= min_used)
+      return !_shutdown.load(std::memory_order_acquire);
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    _waiting.store(true, std::memory_order_release);
+    while (used() < min_used && !_shutdown.load(std::memory_order_acquire))
+      _cond.wait(lock);
+    _waiting.store(false, std::memory_order_release);
+
+    return !_shutdown.load(std::memory_order_acquire);
+  }
+
+  /*! Consumer side: the oldest filled buffer. Valid while used() > 0. */
+  const unsigned char *head() const
+  {
+    return _bufs[_head.load(std::memory_order_relaxed) % _bufs.size()];
+  }
+
+  /*! Consumer side: number of valid bytes in head(). */
+  size_t head_len() const
+  {
+    return _lens[_head.load(std::memory_order_relaxed) % _bufs.size()];
+  }
+
+  /*! Consumer side: the \p i-th oldest filled buffer, \p i < used().
+   * Together with peek_len() this lets a consumer gather several
+   * buffers into one scatter/gather I/O call before releasing them. */
+  const unsigned char *peek(size_t i) const
+  {
+    return _bufs[(_head.load(std::memory_order_relaxed) + i) % _bufs.size()];
+  }
+
+  /*! Consumer side: number of valid bytes in peek(\p i). */
+  size_t peek_len(size_t i) const
+  {
+    return _lens[(_head.load(std::memory_order_relaxed) + i) % _bufs.size()];
+  }
+
+  /*! Consumer side: release the head buffer back to the producer. */
+  void pop()
+  {
+    uint64_t head = _head.load(std::memory_order_relaxed);
+
+    uint64_t dt = now_us() - _stamps[head % _bufs.size()];
+
+    OSMOSDR_TRACE2(ring_dequeue, _lens[head % _bufs.size()], dt);
+
+    size_t bin = 0;
+    while (dt > 1 && bin < stream_stats_t::NUM_LATENCY_BINS - 1) {
+      dt >>= 1;
+      bin++;
+    }
+    _lat_bins[bin].fetch_add(1, std::memory_order_relaxed);
+
+    _head.store(head + 1, std::memory_order_release);
+
+    if (_room_waiting.load(std::memory_order_acquire)) {
+      /* see commit() for why the lock is taken */
+      boost::mutex::scoped_lock lock(_mutex);
+      _cond.notify_one();
+    }
+  }
+
+  /*! Snapshot of the accumulated counters. \p bytes_per_sample scales
+   * the dropped byte count into samples, pass what one sample occupies
+   * inside the ring buffers. */
+  stream_stats_t stats(size_t bytes_per_sample = 0) const
+  {
+    stream_stats_t s;
+
+    s.dropped_buffers = _dropped.load(std::memory_order_relaxed);
+    if (bytes_per_sample)
+      s.dropped_samples =
+        _dropped_bytes.load(std::memory_order_relaxed) / bytes_per_sample;
+    s.ring_high_water = _high_water.load(std::memory_order_relaxed);
+    s.ring_capacity = _bufs.size();
+    for (size_t i = 0; i < stream_stats_t::NUM_LATENCY_BINS; ++i)
+      s.latency_us[i] = _lat_bins[i].load(std::memory_order_relaxed);
+
+    return s;
+  }
+
+  /*! Unblock the consumer for good, e.g. when streaming stops. */
+  void shutdown()
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _shutdown.store(true, std::memory_order_release);
+    }
+    _cond.notify_all();
+  }
+
+private:
+  static uint64_t now_us()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  std::vector<unsigned char *> _bufs;
+  unsigned int _buf_len;
+  overflow_policy_t _policy;
+  std::vector<size_t> _lens;
+  std::vector<uint64_t> _stamps;
+
+  std::atomic<uint64_t> _head;
+  std::atomic<uint64_t> _tail;
+  std::atomic<bool> _shutdown;
+  std::atomic<bool> _waiting;
+  std::atomic<bool> _room_waiting;
+  std::atomic<bool> _overflow_pending;
+
+  /* consumer-owned, only touched from watermark() */
+  size_t _watermark;
+  bool _watermark_auto;
+
+  std::atomic<uint64_t> _dropped;
+  std::atomic<uint64_t> _dropped_bytes;
+  std::atomic<uint64_t> _high_water;
+  std::atomic<uint64_t> _lat_bins[stream_stats_t::NUM_LATENCY_BINS];
+
+  boost::mutex _mutex;
+  boost::condition_variable _cond;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_BUFFER_RING_H */
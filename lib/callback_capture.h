@@ -0,0 +1,168 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_CALLBACK_CAPTURE_H
+#define OSMOSDR_CALLBACK_CAPTURE_H
+
+#include <boost/lexical_cast.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Record/replay for the byte streams a USB transfer callback sees.
+ *
+ * callback_recorder sits inside a device's transfer callback and logs
+ * every buffer - payload plus arrival time - to a compact binary file.
+ * callback_player reads such a file back, so a driver thread can feed
+ * the recorded buffers into the same ring the live callback would
+ * fill, paced with the recorded arrival times or flat out. Together
+ * they make work() and the conversion kernels benchmarkable without
+ * hardware on the desk.
+ *
+ * File layout: the 8 byte magic "OSMOCB01", then per buffer a header
+ * of uint32 microseconds-since-previous-buffer and uint32 payload
+ * length (host byte order), followed by the payload.
+ */
+
+#define CALLBACK_CAPTURE_MAGIC  "OSMOCB01"
+
+class callback_recorder
+{
+public:
+  callback_recorder() : _first(true) { }
+
+  /*!
+   * Start recording if the device arguments ask for it.
+   *
+   * record=<path> names the output file; when the block drives more
+   * than one device, each one gets its channel number appended.
+   */
+  void parse(const std::map<std::string, std::string> &dict,
+             size_t chan = 0, size_t nchan = 1)
+  {
+    std::map<std::string, std::string>::const_iterator it =
+        dict.find("record");
+
+    if (dict.end() == it)
+      return;
+
+    std::string path = it->second;
+
+    if (nchan > 1)
+      path += "." + boost::lexical_cast<std::string>(chan);
+
+    _file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!_file)
+      throw std::runtime_error("Failed to open recording file: " + path);
+
+    _file.write(CALLBACK_CAPTURE_MAGIC, 8);
+
+    std::cerr << "Recording callback stream to " << path << std::endl;
+  }
+
+  bool active() const { return _file.is_open(); }
+
+  /*! Log one callback invocation. Cheap no-op when not recording. */
+  void record(const unsigned char *buf, uint32_t len)
+  {
+    if (!_file.is_open())
+      return;
+
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+
+    uint32_t delta_us = 0;
+
+    if (_first)
+      _first = false;
+    else
+      delta_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - _last).count();
+
+    _last = now;
+
+    _file.write((const char *)&delta_us, sizeof(delta_us));
+    _file.write((const char *)&len, sizeof(len));
+    _file.write((const char *)buf, len);
+  }
+
+private:
+  std::ofstream _file;
+  std::chrono::steady_clock::time_point _last;
+  bool _first;
+};
+
+class callback_player
+{
+public:
+  /*! Open a recording, throws when the file is missing or foreign. */
+  void open(const std::string &path)
+  {
+    char magic[8];
+
+    _file.open(path.c_str(), std::ios::binary);
+
+    if (!_file)
+      throw std::runtime_error("Failed to open recording file: " + path);
+
+    _file.read(magic, 8);
+
+    if (!_file || memcmp(magic, CALLBACK_CAPTURE_MAGIC, 8))
+      throw std::runtime_error("Not a callback recording: " + path);
+  }
+
+  /*!
+   * Fetch the next recorded buffer and its original arrival delay.
+   * Returns false at the end of the recording.
+   */
+  bool next(std::vector<unsigned char> &buf, uint32_t &delay_us)
+  {
+    uint32_t len;
+
+    _file.read((char *)&delay_us, sizeof(delay_us));
+    _file.read((char *)&len, sizeof(len));
+
+    if (!_file)
+      return false;
+
+    buf.resize(len);
+    _file.read((char *)&buf[0], len);
+
+    return bool(_file);
+  }
+
+private:
+  std::ifstream _file;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_CALLBACK_CAPTURE_H */
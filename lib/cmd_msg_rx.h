@@ -0,0 +1,62 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_CMD_MSG_RX_H
+#define OSMOSDR_CMD_MSG_RX_H
+
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+
+#include <boost/function.hpp>
+
+#include <pmt/pmt.h>
+
+namespace osmosdr {
+
+/*!
+ * Terminates the public "cmd" message port of source_impl/sink_impl.
+ * A hier block cannot carry a message handler of its own, so the hier
+ * port is forwarded into this otherwise empty block, which hands every
+ * message to the owner's handler.
+ */
+class cmd_msg_rx : public gr::block
+{
+public:
+  typedef boost::shared_ptr<cmd_msg_rx> sptr;
+  typedef boost::function<void (pmt::pmt_t)> handler_t;
+
+  static sptr make(const handler_t &handler)
+  {
+    return gnuradio::get_initial_sptr(new cmd_msg_rx(handler));
+  }
+
+  cmd_msg_rx(const handler_t &handler)
+    : gr::block("cmd_msg_rx",
+                gr::io_signature::make(0, 0, 0),
+                gr::io_signature::make(0, 0, 0))
+  {
+    message_port_register_in(pmt::mp("cmd"));
+    set_msg_handler(pmt::mp("cmd"), handler);
+  }
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_CMD_MSG_RX_H */
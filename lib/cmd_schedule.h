@@ -0,0 +1,116 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_CMD_SCHEDULE_H
+#define OSMOSDR_CMD_SCHEDULE_H
+
+#include <gnuradio/sync_block.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Control changes scheduled against an absolute output sample count.
+ *
+ * Setters queue a change (a functor performing the hardware call)
+ * against the sample count at which it shall take effect, counted in
+ * items written on the channel. The consumer first calls apply_due()
+ * to run everything that is due at the current position, then clamp()
+ * so the next boundary lands exactly on a work() call boundary - a
+ * change is therefore sample accurate no matter how the scheduler
+ * slices the stream. The first affected sample is marked with a tag,
+ * so measurement windows downstream can line up with the change.
+ *
+ * Any thread may queue; applying happens only on the consumer thread.
+ */
+class cmd_schedule
+{
+public:
+  /*! Queue \p fn to run when the stream reaches \p sample. The first
+   * sample it affects is tagged \p tag_key = \p tag_value. */
+  void insert( uint64_t sample, const boost::function<void ()> &fn,
+               const std::string &tag_key, double tag_value )
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    entry e = { fn, tag_key, tag_value };
+    _entries.insert(std::make_pair(sample, e));
+  }
+
+  /*! Clamp \p nitems so no scheduled boundary is crossed mid-buffer.
+   * \p sample is the absolute count already produced. */
+  uint64_t clamp( uint64_t sample, uint64_t nitems )
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    std::multimap<uint64_t, entry>::iterator it =
+        _entries.upper_bound(sample);
+
+    if (_entries.end() == it)
+      return nitems;
+
+    return std::min(nitems, it->first - sample);
+  }
+
+  /*! Run and tag every change due at or before \p sample. */
+  void apply_due( gr::sync_block *block, size_t chan, uint64_t sample )
+  {
+    std::vector<entry> due;
+
+    { /* collect under the lock, run unlocked - the hardware call may
+       * take a while and must not stall the queueing side */
+      boost::mutex::scoped_lock lock(_mutex);
+
+      while (!_entries.empty() && _entries.begin()->first <= sample) {
+        due.push_back(_entries.begin()->second);
+        _entries.erase(_entries.begin());
+      }
+    }
+
+    for (size_t i = 0; i < due.size(); i++) {
+      due[i].apply();
+
+      block->add_item_tag(chan, sample, pmt::mp(due[i].tag_key),
+                          pmt::from_double(due[i].tag_value));
+    }
+  }
+
+private:
+  struct entry
+  {
+    boost::function<void ()> apply;
+    std::string tag_key;
+    double tag_value;
+  };
+
+  std::multimap<uint64_t, entry> _entries;
+  boost::mutex _mutex;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_CMD_SCHEDULE_H */
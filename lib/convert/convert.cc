@@ -0,0 +1,275 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "convert.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+#ifdef HAVE_VOLK
+#include <volk/volk.h>
+#endif
+
+namespace osmosdr {
+namespace convert {
+
+void u8_fc32(const unsigned char *in, float *out, size_t n)
+{
+#ifdef HAVE_VOLK
+  /* VOLK has no unsigned variant, so flip to two's complement in small
+   * blocks and let volk_8i_s32f_convert_32f do the heavy lifting. The
+   * final pass re-centers on 127.4 like the old lookup tables did. */
+  signed char tmp[4096];
+
+  while (n) {
+    size_t chunk = std::min(n, sizeof(tmp));
+
+    for (size_t i = 0; i < chunk; i++)
+      tmp[i] = in[i] ^ 0x80;
+
+    volk_8i_s32f_convert_32f(out, tmp, 128.0f, chunk);
+
+    for (size_t i = 0; i < chunk; i++)
+      out[i] += 0.6f * (1.0f/128.0f);
+
+    in += chunk;
+    out += chunk;
+    n -= chunk;
+  }
+#else
+  /* one immutable process-wide table; the function local static is
+   * built exactly once even when two streams start concurrently,
+   * unlike the plain ready-flag this replaces */
+  struct u8_lut {
+    float v[0x100];
+    u8_lut() {
+      for (int i = 0; i < 0x100; i++)
+        v[i] = (float(i) - 127.4f) * (1.0f/128.0f);
+    }
+  };
+  static const u8_lut lut;
+
+  for (size_t i = 0; i < n; i++)
+    out[i] = lut.v[in[i]];
+#endif
+}
+
+void u8_s16(const unsigned char *in, short *out, size_t n)
+{
+  /* subtracting the offset turns offset binary into two's complement,
+   * the factor scales the 8 significant bits to full 16 bit range */
+  for (size_t i = 0; i < n; i++)
+    out[i] = short((int(in[i]) - 128) * 256);
+}
+
+void s8_fc32(const signed char *in, float *out, size_t n)
+{
+#ifdef HAVE_VOLK
+  volk_8i_s32f_convert_32f(out, in, 128.0f, n);
+#else
+  for (size_t i = 0; i < n; i++)
+    out[i] = float(in[i]) * (1.0f/128.0f);
+#endif
+}
+
+void s16_fc32(const short *in, float *out, size_t n, float full_scale)
+{
+#ifdef HAVE_VOLK
+  volk_16i_s32f_convert_32f(out, in, full_scale, n);
+#else
+  const float scale = 1.0f / full_scale;
+
+  for (size_t i = 0; i < n; i++)
+    out[i] = float(in[i]) * scale;
+#endif
+}
+
+void s12_fc32(const unsigned char *in, float *out, size_t n,
+              float full_scale)
+{
+  const float scale = 1.0f / full_scale;
+
+  for (size_t i = 0; i < n; i += 2) {
+    int32_t v0 = in[0] | ((in[1] & 0x0f) << 8);
+    int32_t v1 = (in[1] >> 4) | (in[2] << 4);
+
+    /* sign extend from 12 bits */
+    v0 = (v0 << 20) >> 20;
+    v1 = (v1 << 20) >> 20;
+
+    out[i] = float(v0) * scale;
+    out[i + 1] = float(v1) * scale;
+
+    in += 3;
+  }
+}
+
+void u12p_fc32(const unsigned char *in, float *out, size_t n)
+{
+  /* eight samples are packed MSB first into three 32 bit words */
+  const uint32_t *w = (const uint32_t *)in;
+
+#ifdef HAVE_VOLK
+  /* unpack into s16 containers in small blocks and leave the scaling
+   * to volk_16i_s32f_convert_32f */
+  int16_t tmp[4096];
+
+  while (n) {
+    size_t chunk = std::min(n, sizeof(tmp) / sizeof(tmp[0]));
+
+    for (size_t i = 0; i < chunk; i += 8) {
+      uint32_t w0 = w[0], w1 = w[1], w2 = w[2];
+
+      /* subtracting mid-scale turns the offset binary ADC values into
+       * two's complement */
+      tmp[i + 0] = int((w0 >> 20) & 0xfff) - 2048;
+      tmp[i + 1] = int((w0 >> 8) & 0xfff) - 2048;
+      tmp[i + 2] = int(((w0 & 0xff) << 4) | ((w1 >> 28) & 0xf)) - 2048;
+      tmp[i + 3] = int((w1 >> 16) & 0xfff) - 2048;
+      tmp[i + 4] = int((w1 >> 4) & 0xfff) - 2048;
+      tmp[i + 5] = int(((w1 & 0xf) << 8) | ((w2 >> 24) & 0xff)) - 2048;
+      tmp[i + 6] = int((w2 >> 12) & 0xfff) - 2048;
+      tmp[i + 7] = int(w2 & 0xfff) - 2048;
+
+      w += 3;
+    }
+
+    volk_16i_s32f_convert_32f(out, tmp, 2048.0f, chunk);
+
+    out += chunk;
+    n -= chunk;
+  }
+#else
+  const float scale = 1.0f / 2048.0f;
+
+  for (size_t i = 0; i < n; i += 8) {
+    uint32_t w0 = w[0], w1 = w[1], w2 = w[2];
+
+    out[i + 0] = (float((w0 >> 20) & 0xfff) - 2048.0f) * scale;
+    out[i + 1] = (float((w0 >> 8) & 0xfff) - 2048.0f) * scale;
+    out[i + 2] = (float(((w0 & 0xff) << 4) | ((w1 >> 28) & 0xf)) - 2048.0f) * scale;
+    out[i + 3] = (float((w1 >> 16) & 0xfff) - 2048.0f) * scale;
+    out[i + 4] = (float((w1 >> 4) & 0xfff) - 2048.0f) * scale;
+    out[i + 5] = (float(((w1 & 0xf) << 8) | ((w2 >> 24) & 0xff)) - 2048.0f) * scale;
+    out[i + 6] = (float((w2 >> 12) & 0xfff) - 2048.0f) * scale;
+    out[i + 7] = (float(w2 & 0xfff) - 2048.0f) * scale;
+
+    w += 3;
+  }
+#endif
+}
+
+void s24_fc32(const unsigned char *in, float *out, size_t n,
+              float full_scale)
+{
+#ifdef HAVE_VOLK
+  /* no packed-24 VOLK primitive exists, so widen to 32 bit integers in
+   * small blocks and let volk_32i_s32f_convert_32f do the scaling */
+  int32_t tmp[1024];
+
+  while (n) {
+    size_t chunk = std::min(n, sizeof(tmp) / sizeof(tmp[0]));
+
+    for (size_t i = 0; i < chunk; i++) {
+      /* shifting the three bytes to the top sign extends for free on
+       * the arithmetic shift back down */
+      tmp[i] = int32_t((in[0] << 8) | (in[1] << 16) |
+                       (uint32_t(in[2]) << 24)) >> 8;
+      in += 3;
+    }
+
+    volk_32i_s32f_convert_32f(out, tmp, full_scale, chunk);
+
+    out += chunk;
+    n -= chunk;
+  }
+#else
+  const float scale = 1.0f / full_scale;
+
+  for (size_t i = 0; i < n; i++) {
+    int32_t v = int32_t((in[0] << 8) | (in[1] << 16) |
+                        (uint32_t(in[2]) << 24)) >> 8;
+
+    out[i] = float(v) * scale;
+    in += 3;
+  }
+#endif
+}
+
+void fc32_u8(const float *in, unsigned char *out, size_t n)
+{
+#ifdef HAVE_VOLK
+  /* VOLK only converts to two's complement, so saturate to signed
+   * bytes in small blocks and flip back to offset binary afterwards */
+  signed char tmp[4096];
+
+  while (n) {
+    size_t chunk = std::min(n, sizeof(tmp));
+
+    volk_32f_s32f_convert_8i(tmp, in, 128.0f, chunk);
+
+    for (size_t i = 0; i < chunk; i++)
+      out[i] = tmp[i] ^ 0x80;
+
+    in += chunk;
+    out += chunk;
+    n -= chunk;
+  }
+#else
+  for (size_t i = 0; i < n; i++) {
+    long v = long(in[i] * 128.0f + 127.4f);
+
+    out[i] = std::min(std::max(v, 0L), 255L);
+  }
+#endif
+}
+
+void fc32_s8(const float *in, signed char *out, size_t n, float full_scale)
+{
+#ifdef HAVE_VOLK
+  volk_32f_s32f_convert_8i(out, in, full_scale, n);
+#else
+  for (size_t i = 0; i < n; i++) {
+    long v = long(in[i] * full_scale);
+
+    out[i] = std::min(std::max(v, -128L), 127L);
+  }
+#endif
+}
+
+void fc32_s16(const float *in, short *out, size_t n, float full_scale)
+{
+#ifdef HAVE_VOLK
+  volk_32f_s32f_convert_16i(out, in, full_scale, n);
+#else
+  for (size_t i = 0; i < n; i++) {
+    long v = long(in[i] * full_scale);
+
+    out[i] = std::min(std::max(v, -32768L), 32767L);
+  }
+#endif
+}
+
+} /* namespace convert */
+} /* namespace osmosdr */
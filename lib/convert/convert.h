@@ -0,0 +1,94 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_CONVERT_H
+#define OSMOSDR_CONVERT_H
+
+#include <cstddef>
+
+/*!
+ * Shared sample format conversion kernels.
+ *
+ * Every backend used to hand-roll its own integer-to-float conversion
+ * (lookup tables, open-coded loops, direct VOLK calls). These kernels
+ * put the fast implementation in one place: where VOLK is available
+ * its runtime SIMD dispatch is used, otherwise a plain loop does the
+ * job. All kernels operate on individual values, so interleaved I/Q
+ * data is converted by passing twice the complex sample count.
+ */
+namespace osmosdr {
+namespace convert {
+
+/*! Convert \p n offset-binary bytes (as delivered by the RTL2832, DC at
+ * 127.4) to floats scaled by 1/128. */
+void u8_fc32(const unsigned char *in, float *out, size_t n);
+
+/*! Convert \p n offset-binary bytes (as delivered by the RTL2832) to
+ * full-scale signed 16 bit values, for the sc16 output mode. */
+void u8_s16(const unsigned char *in, short *out, size_t n);
+
+/*! Convert \p n signed 8 bit values to floats scaled by 1/128. */
+void s8_fc32(const signed char *in, float *out, size_t n);
+
+/*! Convert \p n signed 16 bit values to floats scaled by
+ * 1/\p full_scale. Pass the ADC range, e.g. 2048 for 12 bit data in
+ * 16 bit containers. */
+void s16_fc32(const short *in, float *out, size_t n,
+              float full_scale = 32768.0f);
+
+/*! Unpack \p n packed little-endian signed 12 bit values (two values in
+ * three bytes, LSB first) and convert to floats scaled by
+ * 1/\p full_scale. \p n must be even. */
+void s12_fc32(const unsigned char *in, float *out, size_t n,
+              float full_scale = 2048.0f);
+
+/*! Unpack \p n packed unsigned 12 bit ADC samples (eight samples in
+ * three 32 bit words, MSB first, as delivered by the Airspy in RAW
+ * mode), remove the mid-scale offset and convert to floats scaled by
+ * 1/2048. \p n must be a multiple of 8 and \p in must be 32 bit
+ * aligned. */
+void u12p_fc32(const unsigned char *in, float *out, size_t n);
+
+/*! Unpack \p n packed little-endian signed 24 bit values (three bytes
+ * each, as delivered by the NetSDR family) and convert to floats
+ * scaled by 1/\p full_scale. */
+void s24_fc32(const unsigned char *in, float *out, size_t n,
+              float full_scale = 8388608.0f);
+
+/*! Convert \p n floats in [-1,1] to offset-binary bytes (DC at 127.4),
+ * the inverse of u8_fc32. Out-of-range input saturates. */
+void fc32_u8(const float *in, unsigned char *out, size_t n);
+
+/*! Convert \p n floats in [-1,1] to signed 8 bit values scaled by
+ * \p full_scale, the inverse of s8_fc32. Out-of-range input
+ * saturates. */
+void fc32_s8(const float *in, signed char *out, size_t n,
+             float full_scale = 127.0f);
+
+/*! Convert \p n floats in [-1,1] to signed 16 bit values scaled by
+ * \p full_scale, the inverse of s16_fc32. Out-of-range input
+ * saturates. */
+void fc32_s16(const float *in, short *out, size_t n,
+              float full_scale = 32768.0f);
+
+} /* namespace convert */
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_CONVERT_H */
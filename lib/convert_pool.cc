@@ -0,0 +1,159 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "convert_pool.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+
+namespace osmosdr {
+
+convert_pool &convert_pool::instance()
+{
+  /* intentionally leaked: the workers block on the condition variable
+   * until process exit and destroying it under them would abort */
+  static convert_pool *pool = new convert_pool;
+
+  return *pool;
+}
+
+convert_pool::convert_pool()
+  : _fn(NULL),
+    _nitems(0),
+    _slice(0),
+    _next(0),
+    _pending(0),
+    _generation(0)
+{
+}
+
+void convert_pool::start(unsigned int workers)
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  while (_workers.size() < workers)
+    _workers.push_back(
+        new boost::thread(boost::bind(&convert_pool::worker_task, this)));
+}
+
+void convert_pool::run(const slice_fn &fn, size_t nitems, size_t slice_items)
+{
+  if (0 == nitems)
+    return;
+
+  if (_workers.empty() || 0 == slice_items || slice_items >= nitems) {
+    fn(0, nitems);
+    return;
+  }
+
+  boost::mutex::scoped_lock run_lock(_run_mutex);
+
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    _fn = &fn;
+    _nitems = nitems;
+    _slice = slice_items;
+    _next = 0;
+    _pending = (nitems + slice_items - 1) / slice_items;
+    _generation++;
+
+    _job_cond.notify_all();
+  }
+
+  work_slices(); /* the caller converts too */
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  while (_pending)
+    _done_cond.wait(lock);
+
+  _fn = NULL;
+}
+
+/* Claim and convert slices until the current job runs dry. Slices are
+ * claimed under the lock - they are large enough that the locking cost
+ * vanishes - and workers that finish one early steal the next. */
+void convert_pool::work_slices()
+{
+  slice_fn fn;
+  uint64_t generation;
+
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_fn)
+      return;
+
+    fn = *_fn;
+    generation = _generation;
+  }
+
+  for (;;) {
+    size_t offset, count;
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+
+      /* a new job took over, this thread's fn no longer applies */
+      if (generation != _generation || _next >= _nitems)
+        return;
+
+      offset = _next;
+      count = std::min(_slice, _nitems - offset);
+      _next += count;
+    }
+
+    fn(offset, count);
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+
+      if (generation == _generation && 0 == --_pending)
+        _done_cond.notify_all();
+    }
+  }
+}
+
+void convert_pool::worker_task()
+{
+  uint64_t seen = 0;
+
+  for (;;) {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+
+      while (_generation == seen || !_fn)
+        _job_cond.wait(lock);
+
+      seen = _generation;
+    }
+
+    work_slices();
+  }
+}
+
+} /* namespace osmosdr */
@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_CONVERT_POOL_H
+#define OSMOSDR_CONVERT_POOL_H
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace boost { class thread; }
+
+namespace osmosdr {
+
+/*!
+ * Process-wide pool of format conversion workers.
+ *
+ * work() converts samples single-threaded; at 100+ Msps aggregate the
+ * conversion alone saturates one core's memory throughput and caps
+ * the device rate. Backends opting in with workers=<n> in the device
+ * arguments partition each conversion into cache-sized slices that
+ * the pool workers and the calling thread claim dynamically - threads
+ * that finish early simply take the next open slice. Slice offsets
+ * are fixed up front, so completed slices land in their final place
+ * in the output buffer and no reordering pass is needed; run()
+ * returns once the last slice finished.
+ *
+ * With no workers started, run() degenerates to one inline call of
+ * the conversion, i.e. the single-threaded behavior.
+ */
+class convert_pool
+{
+public:
+  static convert_pool &instance();
+
+  /*! A conversion slice: handle \p count items starting at \p offset. */
+  typedef boost::function<void (size_t offset, size_t count)> slice_fn;
+
+  /*! Ensure at least \p workers pool threads are running. Workers are
+   * shared between all backends and never torn down. */
+  void start(unsigned int workers);
+
+  /*! Convert \p nitems items by invoking \p fn over disjoint slices
+   * of at most \p slice_items, concurrently on the pool workers and
+   * the calling thread. Returns after the last slice completed. Runs
+   * inline when the pool is empty or one slice covers everything. */
+  void run(const slice_fn &fn, size_t nitems, size_t slice_items);
+
+private:
+  convert_pool();
+
+  void worker_task();
+  void work_slices();
+
+  std::vector<boost::thread *> _workers;
+
+  /* one job at a time; concurrent callers queue up here */
+  boost::mutex _run_mutex;
+
+  /* job state, guarded by _mutex */
+  boost::mutex _mutex;
+  boost::condition_variable _job_cond;
+  boost::condition_variable _done_cond;
+  const slice_fn *_fn;
+  size_t _nitems;
+  size_t _slice;
+  size_t _next;      /* first unclaimed item */
+  size_t _pending;   /* slices handed out but not yet completed */
+  uint64_t _generation;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_CONVERT_POOL_H */
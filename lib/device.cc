@@ -20,9 +20,15 @@
 
 #include <osmosdr/device.h>
 #include <stdexcept>
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <algorithm>
 #include <sstream>
 
@@ -42,6 +48,10 @@
 #include <file_source_c.h>
 #endif
 
+#ifdef ENABLE_NULL
+#include <null_source_c.h>
+#endif
+
 #ifdef ENABLE_RTL
 #include <rtl_source_c.h>
 #endif
@@ -135,6 +145,49 @@ std::string device_t::to_string(void) const
   return ss.str();
 }
 
+/*
+ * Device discovery runs every backend probe on its own thread: one
+ * unreachable network host or a slow-loading SoapySDR module then costs
+ * only as much wall time as the slowest backend within the deadline
+ * instead of the sum of all of them. Results keep the historic backend
+ * order regardless of completion order. A probe that misses the
+ * deadline keeps running detached and merely reports nothing this time.
+ */
+
+namespace {
+
+typedef boost::function< std::vector<std::string> (void) > probe_fn_t;
+
+struct probe_state_t
+{
+  probe_state_t(size_t num) : results(num), remaining(num) {}
+
+  boost::mutex mutex;
+  boost::condition_variable done;
+  std::vector< std::vector<std::string> > results;
+  size_t remaining;
+};
+
+typedef boost::shared_ptr< probe_state_t > probe_state_sptr;
+
+static void run_probe(probe_state_sptr state, size_t slot, probe_fn_t probe)
+{
+  std::vector<std::string> devs;
+
+  try {
+    devs = probe();
+  } catch (...) {
+    /* a backend that throws during discovery simply reports nothing */
+  }
+
+  boost::mutex::scoped_lock lock(state->mutex);
+  state->results[slot] = devs;
+  state->remaining--;
+  state->done.notify_one();
+}
+
+} /* namespace anonymous */
+
 devices_t device::find(const device_t &hint)
 {
   boost::mutex::scoped_lock lock(_device_mutex);
@@ -144,55 +197,48 @@ devices_t device::find(const device_t &hint)
   if ( hint.count("nofake") )
     fake = false;
 
-  devices_t devices;
+  long timeout_ms = 10000;
+
+  if ( hint.count("timeout") )
+    timeout_ms = boost::lexical_cast< long >( hint.find("timeout")->second );
+
+  std::vector< probe_fn_t > probes;
 
 #ifdef ENABLE_OSMOSDR
-  BOOST_FOREACH( std::string dev, osmosdr_src_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &osmosdr_src_c::get_devices ) );
 #endif
 #ifdef ENABLE_FCD
-  BOOST_FOREACH( std::string dev, fcd_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &fcd_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_RTL
-  BOOST_FOREACH( std::string dev, rtl_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &rtl_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_UHD
-  BOOST_FOREACH( std::string dev, uhd_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &uhd_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_MIRI
-  BOOST_FOREACH( std::string dev, miri_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &miri_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_SDRPLAY
-  BOOST_FOREACH( std::string dev, sdrplay_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &sdrplay_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_BLADERF
-  BOOST_FOREACH( std::string dev, bladerf_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &bladerf_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_HACKRF
-  BOOST_FOREACH( std::string dev, hackrf_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &hackrf_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_RFSPACE
-  BOOST_FOREACH( std::string dev, rfspace_source_c::get_devices( fake ) )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &rfspace_source_c::get_devices, fake ) );
 #endif
 #ifdef ENABLE_AIRSPY
-  BOOST_FOREACH( std::string dev, airspy_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &airspy_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_FREESRP
-  BOOST_FOREACH( std::string dev, freesrp_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &freesrp_source_c::get_devices ) );
 #endif
 #ifdef ENABLE_SOAPY
-  BOOST_FOREACH( std::string dev, soapy_source_c::get_devices() )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &soapy_source_c::get_devices ) );
 #endif
 
   /* software-only sources should be appended at the very end,
@@ -200,17 +246,42 @@ devices_t device::find(const device_t &hint)
    * in a graphical interface etc... */
 
 #ifdef ENABLE_RTL_TCP
-  BOOST_FOREACH( std::string dev, rtl_tcp_source_c::get_devices( fake ) )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &rtl_tcp_source_c::get_devices, fake ) );
 #endif
 #ifdef ENABLE_REDPITAYA
-  BOOST_FOREACH( std::string dev, redpitaya_source_c::get_devices( fake ) )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &redpitaya_source_c::get_devices, fake ) );
 #endif
 #ifdef ENABLE_FILE
-  BOOST_FOREACH( std::string dev, file_source_c::get_devices( fake ) )
-    devices.push_back( device_t(dev) );
+  probes.push_back( boost::bind( &file_source_c::get_devices, fake ) );
+#endif
+#ifdef ENABLE_NULL
+  probes.push_back( boost::bind( &null_source_c::get_devices, fake ) );
 #endif
 
+  probe_state_sptr state(new probe_state_t(probes.size()));
+
+  for (size_t i = 0; i < probes.size(); i++)
+  {
+    boost::thread thread( run_probe, state, i, probes[i] );
+    thread.detach();
+  }
+
+  boost::system_time deadline = boost::get_system_time()
+    + boost::posix_time::milliseconds(timeout_ms);
+
+  devices_t devices;
+
+  {
+    boost::mutex::scoped_lock state_lock(state->mutex);
+
+    while (state->remaining)
+      if (!state->done.timed_wait(state_lock, deadline))
+        break;
+
+    BOOST_FOREACH( std::vector<std::string> &result, state->results )
+      BOOST_FOREACH( std::string dev, result )
+        devices.push_back( device_t(dev) );
+  }
+
   return devices;
 }
@@ -0,0 +1,177 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "device_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+/*
+ * File layout: the first line is the USB fingerprint the enumeration
+ * was taken against, every following line is one device string exactly
+ * as a backend's get_devices() returned it. A fingerprint mismatch (or
+ * an unreadable file) makes load() report an empty result, which sends
+ * the caller down the regular full-discovery path.
+ */
+
+namespace osmosdr {
+namespace device_cache {
+
+static std::string cache_path()
+{
+  const char *dir = getenv("XDG_CACHE_HOME");
+  std::string base;
+
+  if (dir && *dir) {
+    base = dir;
+  } else {
+    const char *home = getenv("HOME");
+    if (!home || !*home)
+      return "";
+    base = std::string(home) + "/.cache";
+  }
+
+  return base + "/gr-osmosdr";
+}
+
+/*! One line per attached USB device: devpath, VID:PID and serial. The
+ * lines are sorted so enumeration order does not affect the result. */
+static std::string usb_fingerprint()
+{
+#ifdef _WIN32
+  return "";
+#else
+  const std::string sysfs = "/sys/bus/usb/devices";
+  std::vector< std::string > entries;
+
+  DIR *dirp = opendir(sysfs.c_str());
+  if (!dirp)
+    return "";
+
+  struct dirent *ent;
+  while ((ent = readdir(dirp))) {
+    std::string name = ent->d_name;
+
+    /* skip interfaces (1-2:1.0) and the . / .. entries, keep devices */
+    if (name.empty() || name[0] == '.' ||
+         name.find(':') != std::string::npos)
+      continue;
+
+    std::string entry = name;
+
+    const char *attrs[] = { "idVendor", "idProduct", "serial" };
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+      std::ifstream attr((sysfs + "/" + name + "/" + attrs[i]).c_str());
+      std::string value;
+      std::getline(attr, value);
+      entry += ":" + value;
+    }
+
+    entries.push_back(entry);
+  }
+
+  closedir(dirp);
+
+  std::sort(entries.begin(), entries.end());
+
+  std::string fp;
+  for (size_t i = 0; i < entries.size(); i++)
+    fp += entries[i] + ";";
+
+  return fp;
+#endif
+}
+
+bool enabled()
+{
+  const char *env = getenv("GR_OSMOSDR_DEVICE_CACHE");
+
+  return env && *env && std::string(env) != "0";
+}
+
+std::vector< std::string > load()
+{
+  std::vector< std::string > devices;
+
+  std::string path = cache_path();
+  std::string fp = usb_fingerprint();
+  if (path.empty() || fp.empty())
+    return devices;
+
+  std::ifstream file((path + "/devices").c_str());
+  if (!file)
+    return devices;
+
+  std::string line;
+  if (!std::getline(file, line) || line != fp)
+    return devices;
+
+  while (std::getline(file, line))
+    if (!line.empty())
+      devices.push_back(line);
+
+  return devices;
+}
+
+void store(const std::vector< std::string > &devices)
+{
+  std::string path = cache_path();
+  std::string fp = usb_fingerprint();
+  if (path.empty() || fp.empty())
+    return;
+
+#ifndef _WIN32
+  mkdir(path.c_str(), 0700); /* may exist already, that is fine */
+#endif
+
+  std::ofstream file((path + "/devices").c_str(),
+                     std::ios::out | std::ios::trunc);
+  if (!file)
+    return;
+
+  file << fp << std::endl;
+  for (size_t i = 0; i < devices.size(); i++)
+    file << devices[i] << std::endl;
+}
+
+void invalidate()
+{
+  std::string path = cache_path();
+  if (path.empty())
+    return;
+
+  std::remove((path + "/devices").c_str());
+}
+
+} /* namespace device_cache */
+} /* namespace osmosdr */
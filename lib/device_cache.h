@@ -0,0 +1,62 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_DEVICE_CACHE_H
+#define OSMOSDR_DEVICE_CACHE_H
+
+#include <string>
+#include <vector>
+
+namespace osmosdr {
+
+/*!
+ * Opt-in on-disk cache of the device strings found by a full discovery
+ * run, so that repeated instantiations against an unchanged set of
+ * devices skip the (potentially multi-second) backend probes.
+ *
+ * The cache is only consulted when the environment variable
+ * GR_OSMOSDR_DEVICE_CACHE is set. Entries are keyed by a fingerprint of
+ * the attached USB devices (bus topology, VID/PID and serial numbers,
+ * read from sysfs), so plugging or unplugging hardware invalidates the
+ * cache without any explicit action. A cached device string that no
+ * longer opens should be dropped with invalidate(); the next
+ * instantiation then falls back to a full discovery.
+ */
+namespace device_cache {
+
+/*! Whether the user has opted into enumeration caching. */
+bool enabled();
+
+/*! Cached device strings, or an empty vector if there is no usable
+ * cache entry for the currently attached hardware. */
+std::vector< std::string > load();
+
+/*! Store the result of a full discovery run for the currently attached
+ * hardware. Quietly does nothing if the cache directory is unusable. */
+void store(const std::vector< std::string > &devices);
+
+/*! Remove the cache entry, e.g. after a cached device failed to open. */
+void invalidate();
+
+} /* namespace device_cache */
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_DEVICE_CACHE_H */
@@ -0,0 +1,257 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_DRIFT_SYNC_H
+#define OSMOSDR_DRIFT_SYNC_H
+
+#include <gnuradio/block.h>
+#include <gnuradio/io_signature.h>
+#include <gnuradio/gr_complex.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <stdint.h>
+
+/* servo tuning: the horizon a measured skew is corrected over, the
+ * proportional and integral gains working on the normalized skew,
+ * and the hard cap on the commanded rate offset */
+#define DRIFT_TAU_S    1.0
+#define DRIFT_KP       0.5
+#define DRIFT_KI       0.02
+#define DRIFT_MAX_CORR 100e-6
+
+namespace osmosdr {
+
+/*!
+ * Pace board shared by the channels of one multi-device source.
+ * Every compensator publishes how many samples it has produced and
+ * when; channel 0 is the reference the others measure against. The
+ * board keeps a smoothed rate estimate per channel so a reference
+ * count can be projected to any point in time.
+ */
+class drift_group
+{
+public:
+  typedef boost::shared_ptr<drift_group> sptr;
+  typedef std::chrono::steady_clock::time_point stamp_t;
+
+  void update(size_t chan, uint64_t count, stamp_t now)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    pace_t &pace = _pace[chan];
+
+    if (pace.anchor_stamp == stamp_t()) {
+      pace.anchor_count = count;
+      pace.anchor_stamp = now;
+    } else {
+      double dt = seconds(now - pace.anchor_stamp);
+
+      /* a one second baseline keeps scheduler jitter out of the
+       * rate estimate */
+      if (dt >= 1.0) {
+        double rate = double(count - pace.anchor_count) / dt;
+
+        pace.rate = (0.0 == pace.rate) ?
+            rate : pace.rate + 0.1 * (rate - pace.rate);
+        pace.anchor_count = count;
+        pace.anchor_stamp = now;
+      }
+    }
+
+    pace.count = count;
+    pace.stamp = now;
+  }
+
+  /*! Project the reference channel's sample count to \p now.
+   * \return false until the reference rate estimate has converged */
+  bool reference(stamp_t now, double *count, double *rate)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    const pace_t &pace = _pace[0];
+
+    if (0.0 == pace.rate)
+      return false;
+
+    *count = double(pace.count) + pace.rate * seconds(now - pace.stamp);
+    *rate = pace.rate;
+
+    return true;
+  }
+
+private:
+  struct pace_t {
+    pace_t() : count(0), anchor_count(0), rate(0.0) { }
+
+    uint64_t count;
+    stamp_t stamp;
+    uint64_t anchor_count;
+    stamp_t anchor_stamp;
+    double rate; /* smoothed samples per second, 0 until estimated */
+  };
+
+  static double seconds(std::chrono::steady_clock::duration d)
+  {
+    return std::chrono::duration_cast< std::chrono::duration<double> >(d).count();
+  }
+
+  boost::mutex _mutex;
+  std::map<size_t, pace_t> _pace;
+};
+
+/*!
+ * Inter channel drift compensator (drift= argument). Independent
+ * dongles drift apart by tens of ppm, so the channels of an
+ * aggregated source slide by thousands of samples per minute.
+ * Channel 0 passes through untouched and only publishes its pace;
+ * every other channel measures its cumulative sample count against
+ * the projected reference count and servos a linear interpolation
+ * fractional resampler around unity rate until the skew is gone. A
+ * PI loop keeps the residual at zero over hours; the initial offset
+ * between the channels at start is left alone - the stage prevents
+ * sliding, it does not time-align what correlation has to find
+ * anyway. At ppm level corrections the interpolator error is far
+ * below the quantization noise of the 8 bit frontends.
+ */
+class drift_sync_c : public gr::block
+{
+public:
+  typedef boost::shared_ptr<drift_sync_c> sptr;
+
+  static sptr make(drift_group::sptr group, size_t chan)
+  {
+    return gnuradio::get_initial_sptr(new drift_sync_c(group, chan));
+  }
+
+  drift_sync_c(drift_group::sptr group, size_t chan)
+    : gr::block("drift_sync_c",
+                gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                gr::io_signature::make(1, 1, sizeof(gr_complex))),
+      _group(group),
+      _chan(chan),
+      _produced(0),
+      _phase(0.0),
+      _step(1.0),
+      _integ(0.0),
+      _offset(0.0),
+      _offset_valid(false)
+  {
+  }
+
+  void forecast(int noutput_items, gr_vector_int &ninput_items_required)
+  {
+    /* one sample of lookahead for the interpolator */
+    ninput_items_required[0] = noutput_items + 2;
+  }
+
+  int general_work(int noutput_items, gr_vector_int &ninput_items,
+                   gr_vector_const_void_star &input_items,
+                   gr_vector_void_star &output_items)
+  {
+    const gr_complex *in = (const gr_complex *)input_items[0];
+    gr_complex *out = (gr_complex *)output_items[0];
+    int nin = ninput_items[0];
+    int produced;
+
+    if (0 == _chan) {
+      /* the reference is never resampled */
+      produced = std::min(nin, noutput_items);
+      memcpy(out, in, produced * sizeof(gr_complex));
+      consume(0, produced);
+    } else {
+      update_step();
+
+      int o = 0;
+      while (o < noutput_items) {
+        int idx = int(_phase);
+        if (idx + 1 >= nin)
+          break;
+
+        float frac = float(_phase - idx);
+        out[o++] = in[idx] + frac * (in[idx + 1] - in[idx]);
+        _phase += _step;
+      }
+
+      /* keep the last sample around, the next buffer interpolates
+       * across the boundary */
+      int consumed = std::min(int(_phase), nin - 1);
+      if (consumed > 0) {
+        _phase -= consumed;
+        consume(0, consumed);
+      }
+
+      produced = o;
+    }
+
+    _produced += produced;
+    _group->update(_chan, _produced, std::chrono::steady_clock::now());
+
+    return produced;
+  }
+
+private:
+  void update_step(void)
+  {
+    double ref_count, ref_rate;
+
+    if (!_group->reference(std::chrono::steady_clock::now(),
+                           &ref_count, &ref_rate))
+      return;
+
+    if (!_offset_valid) {
+      /* freeze the startup offset, only further sliding is servoed */
+      _offset = ref_count - double(_produced);
+      _offset_valid = true;
+      return;
+    }
+
+    double skew = double(_produced) + _offset - ref_count;
+    double norm = skew / (ref_rate * DRIFT_TAU_S);
+
+    _integ += DRIFT_KI * norm;
+    _integ = std::max(-DRIFT_MAX_CORR, std::min(DRIFT_MAX_CORR, _integ));
+
+    double corr = DRIFT_KP * norm + _integ;
+    corr = std::max(-DRIFT_MAX_CORR, std::min(DRIFT_MAX_CORR, corr));
+
+    /* ahead of the reference -> consume input faster than we produce */
+    _step = 1.0 + corr;
+  }
+
+  drift_group::sptr _group;
+  size_t _chan;
+
+  uint64_t _produced;
+
+  double _phase; /* position of the next output in the input stream */
+  double _step;  /* input samples advanced per output sample */
+  double _integ;
+
+  double _offset; /* reference count minus own count at lock-in */
+  bool _offset_valid;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_DRIFT_SYNC_H */
@@ -0,0 +1,215 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+
+#include <gnuradio/io_signature.h>
+
+#include "fcd_audio_rx.h"
+#include "convert/convert.h"
+
+#define FCD_RING_BUFFERS  32
+#define BYTES_PER_FRAME   (2 * sizeof(short)) /* interleaved stereo S16 */
+
+fcd_audio_rx::sptr fcd_audio_rx::make( const std::string &device,
+                                       unsigned int rate,
+                                       unsigned int period_frames )
+{
+  return gnuradio::get_initial_sptr(
+        new fcd_audio_rx( device, rate, period_frames ) );
+}
+
+fcd_audio_rx::fcd_audio_rx( const std::string &device, unsigned int rate,
+                            unsigned int period_frames )
+  : gr::sync_block( "fcd_audio_rx",
+                    gr::io_signature::make(0, 0, 0),
+                    gr::io_signature::make(1, 1, sizeof(gr_complex)) ),
+    _pcm( NULL ),
+    _period_frames( period_frames ),
+    _run_read_task( false ),
+    _buf_offset( 0 )
+{
+  int err;
+
+  err = snd_pcm_open( &_pcm, device.c_str(), SND_PCM_STREAM_CAPTURE, 0 );
+  if ( err < 0 )
+    throw std::runtime_error( "Failed to open " + device + ": " +
+                              snd_strerror( err ) );
+
+  snd_pcm_hw_params_t *hw;
+  snd_pcm_hw_params_alloca( &hw );
+  snd_pcm_hw_params_any( _pcm, hw );
+
+  /* mmap access makes whole periods visible to us the moment the
+   * hardware pointer passes them, there is no extra staging copy */
+  err = snd_pcm_hw_params_set_access( _pcm, hw,
+                                      SND_PCM_ACCESS_MMAP_INTERLEAVED );
+  if ( err < 0 )
+    throw std::runtime_error( std::string("Failed to set mmap access: ") +
+                              snd_strerror( err ) );
+
+  if ( snd_pcm_hw_params_set_format( _pcm, hw, SND_PCM_FORMAT_S16_LE ) < 0 )
+    throw std::runtime_error( "Failed to set S16_LE capture format." );
+
+  if ( snd_pcm_hw_params_set_channels( _pcm, hw, 2 ) < 0 )
+    throw std::runtime_error( "Failed to set stereo capture." );
+
+  if ( snd_pcm_hw_params_set_rate( _pcm, hw, rate, 0 ) < 0 )
+    throw std::runtime_error( "Failed to set the capture rate." );
+
+  snd_pcm_uframes_t period = _period_frames;
+  int dir = 0;
+  snd_pcm_hw_params_set_period_size_near( _pcm, hw, &period, &dir );
+  _period_frames = period;
+
+  snd_pcm_uframes_t buffer = 4 * period;
+  snd_pcm_hw_params_set_buffer_size_near( _pcm, hw, &buffer );
+
+  err = snd_pcm_hw_params( _pcm, hw );
+  if ( err < 0 )
+    throw std::runtime_error( std::string("Failed to apply hw params: ") +
+                              snd_strerror( err ) );
+
+  snd_pcm_sw_params_t *sw;
+  snd_pcm_sw_params_alloca( &sw );
+  snd_pcm_sw_params_current( _pcm, sw );
+  snd_pcm_sw_params_set_avail_min( _pcm, sw, period );
+  snd_pcm_sw_params( _pcm, sw );
+
+  std::cerr << "Using ALSA mmap capture with " << _period_frames
+            << " frame periods ("
+            << 1e3 * _period_frames / rate << " ms)." << std::endl;
+}
+
+fcd_audio_rx::~fcd_audio_rx()
+{
+  if ( _run_read_task )
+    stop();
+
+  if ( _pcm )
+    snd_pcm_close( _pcm );
+}
+
+bool fcd_audio_rx::start()
+{
+  _ring.resize( FCD_RING_BUFFERS, _period_frames * BYTES_PER_FRAME );
+  _buf_offset = 0;
+
+  int err = snd_pcm_prepare( _pcm );
+  if ( err < 0 ) {
+    std::cerr << "snd_pcm_prepare failed: " << snd_strerror( err )
+              << std::endl;
+    return false;
+  }
+
+  _run_read_task = true;
+  _thread = gr::thread::thread(
+        boost::bind( &fcd_audio_rx::read_task, this ) );
+
+  return true;
+}
+
+bool fcd_audio_rx::stop()
+{
+  _run_read_task = false;
+  _ring.shutdown(); /* unblock a scheduler thread stuck in work() */
+  _thread.join();
+
+  snd_pcm_drop( _pcm );
+
+  return true;
+}
+
+void fcd_audio_rx::read_task()
+{
+  /* drop target when the ring is full, the capture must keep running */
+  std::vector<short> scratch( _period_frames * 2 );
+
+  snd_pcm_start( _pcm );
+
+  while ( _run_read_task ) {
+    short *slot = (short *)_ring.write_head();
+
+    if ( !slot ) {
+      if ( _ring.overflow( _period_frames * BYTES_PER_FRAME ) )
+        slot = (short *)_ring.write_head();
+
+      if ( !slot )
+        slot = &scratch[0];
+    }
+
+    snd_pcm_sframes_t n = snd_pcm_mmap_readi( _pcm, slot, _period_frames );
+
+    if ( n < 0 ) {
+      if ( !_run_read_task )
+        break;
+
+      n = snd_pcm_recover( _pcm, n, 1 );
+      if ( n < 0 ) {
+        std::cerr << "ALSA capture failed: " << snd_strerror( n )
+                  << std::endl;
+        _run_read_task = false;
+        _ring.shutdown();
+        break;
+      }
+
+      continue; /* recovered from an overrun, counters track the ring */
+    }
+
+    if ( slot != &scratch[0] && n > 0 )
+      _ring.commit( n * BYTES_PER_FRAME );
+  }
+}
+
+int fcd_audio_rx::work( int noutput_items,
+                        gr_vector_const_void_star &input_items,
+                        gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+
+  if ( !_ring.wait(1) )
+    return WORK_DONE;
+
+  int processed = 0;
+
+  while ( processed < noutput_items && _ring.used() ) {
+    const size_t head_samples = _ring.head_len() / BYTES_PER_FRAME;
+    const size_t chunk = std::min( (size_t)(noutput_items - processed),
+                                   head_samples - _buf_offset );
+    const short *in = (const short *)_ring.head() + _buf_offset * 2;
+
+    osmosdr::convert::s16_fc32( in, (float *)(out + processed),
+                                chunk * 2, 32768.0f );
+
+    processed += chunk;
+    _buf_offset += chunk;
+
+    if ( _buf_offset == head_samples ) {
+      _ring.pop();
+      _buf_offset = 0;
+    }
+  }
+
+  return processed;
+}
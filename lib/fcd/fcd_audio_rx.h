@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FCD_AUDIO_RX_H
+#define FCD_AUDIO_RX_H
+
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+
+#include "buffer_ring.h"
+
+#include <alsa/asoundlib.h>
+
+/*!
+ * Low latency ALSA capture feeding the FUNcube audio stream.
+ *
+ * Opens the dongle's PCM in mmap access mode with a small configurable
+ * period so samples become visible to userspace within a few
+ * milliseconds of hitting the hardware, instead of the tens of
+ * milliseconds gr-audio's conservative defaults add. A reader thread
+ * moves whole periods into a buffer_ring; work() converts them to
+ * complex float.
+ */
+class fcd_audio_rx : public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr<fcd_audio_rx> sptr;
+
+  /*!
+   * \param device the ALSA identifier, e.g. "hw:2"
+   * \param rate the dongle's fixed rate, 96000 or 192000
+   * \param period_frames frames per period, sets the capture latency
+   */
+  static sptr make( const std::string &device, unsigned int rate,
+                    unsigned int period_frames );
+
+  fcd_audio_rx( const std::string &device, unsigned int rate,
+                unsigned int period_frames );
+  ~fcd_audio_rx();
+
+  bool start();
+  bool stop();
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
+private:
+  void read_task();
+
+  snd_pcm_t *_pcm;
+  unsigned int _period_frames;
+
+  gr::thread::thread _thread;
+  bool _run_read_task;
+
+  osmosdr::buffer_ring _ring;
+  size_t _buf_offset; /* samples already consumed from the head buffer */
+};
+
+#endif /* FCD_AUDIO_RX_H */
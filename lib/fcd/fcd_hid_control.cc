@@ -0,0 +1,200 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "fcd_hid_control.h"
+
+#define FCD_USB_VID      0x04d8
+#define FCD_V1_USB_PID   0xfb56
+#define FCD_V2_USB_PID   0xfb31
+
+/* subset of the FUNcube Dongle HID command set */
+#define FCD_CMD_SET_FREQ_HZ     101
+#define FCD_CMD_SET_LNA_GAIN    110
+#define FCD_CMD_SET_MIXER_GAIN  114
+#define FCD_CMD_SET_IF_GAIN1    117
+
+fcd_hid_control::fcd_hid_control()
+  : _fd( -1 ),
+    _version( 0 )
+{
+}
+
+fcd_hid_control::~fcd_hid_control()
+{
+  close();
+}
+
+bool fcd_hid_control::open( int version, unsigned int index )
+{
+  const int pid = ( 1 == version ) ? FCD_V1_USB_PID : FCD_V2_USB_PID;
+  unsigned int count = 0;
+
+  close();
+
+  /* FIXME: non-portable, assumes hidraw */
+  DIR *dir = opendir( "/sys/class/hidraw" );
+  if ( !dir )
+    return false;
+
+  struct dirent *entry;
+  while ( (entry = readdir( dir )) ) {
+    if ( '.' == entry->d_name[0] )
+      continue;
+
+    char path[320];
+    snprintf( path, sizeof(path), "/sys/class/hidraw/%s/device/uevent",
+              entry->d_name );
+
+    FILE *uevent = fopen( path, "r" );
+    if ( !uevent )
+      continue;
+
+    bool match = false;
+    char line[256];
+    while ( fgets( line, sizeof(line), uevent ) ) {
+      unsigned int bus, dev_vid, dev_pid;
+      if ( 3 == sscanf( line, "HID_ID=%x:%x:%x", &bus, &dev_vid, &dev_pid ) )
+        match = ( FCD_USB_VID == (int)dev_vid && pid == (int)dev_pid );
+    }
+
+    fclose( uevent );
+
+    if ( !match )
+      continue;
+
+    if ( count++ < index )
+      continue;
+
+    snprintf( path, sizeof(path), "/dev/%s", entry->d_name );
+    _fd = ::open( path, O_RDWR );
+    if ( _fd < 0 )
+      std::cerr << "Failed to open " << path << " for FCD control."
+                << std::endl;
+    else
+      _version = version;
+
+    break;
+  }
+
+  closedir( dir );
+
+  return opened();
+}
+
+void fcd_hid_control::close()
+{
+  if ( _fd >= 0 )
+    ::close( _fd );
+
+  _fd = -1;
+  _version = 0;
+}
+
+bool fcd_hid_control::command( unsigned char cmd, const unsigned char *data,
+                               size_t len )
+{
+  if ( _fd < 0 )
+    return false;
+
+  /* report number 0 followed by a 64 byte report */
+  unsigned char report[65];
+  memset( report, 0, sizeof(report) );
+  report[1] = cmd;
+  if ( data && len )
+    memcpy( &report[2], data, len );
+
+  if ( write( _fd, report, sizeof(report) ) != (ssize_t)sizeof(report) )
+    return false;
+
+  /* the dongle echoes the command with a status byte */
+  if ( read( _fd, report, 64 ) < 2 )
+    return false;
+
+  return ( cmd == report[0] && 1 == report[1] );
+}
+
+bool fcd_hid_control::set_freq( double freq, double ppm )
+{
+  freq *= 1.0 + ppm / 1e6;
+
+  unsigned int hz = (unsigned int)(freq + 0.5);
+  unsigned char data[4];
+  data[0] = hz & 0xff;
+  data[1] = (hz >> 8) & 0xff;
+  data[2] = (hz >> 16) & 0xff;
+  data[3] = (hz >> 24) & 0xff;
+
+  return command( FCD_CMD_SET_FREQ_HZ, data, sizeof(data) );
+}
+
+bool fcd_hid_control::set_lna_gain( double gain )
+{
+  unsigned char value;
+
+  if ( 1 == _version ) {
+    /* enum of the V1 LNA gain steps from -5.0 to +30.0 dB */
+    static const double steps[] = {
+      -5.0, -2.5, 0.0, 2.5, 5.0, 7.5, 10.0, 12.5,
+      15.0, 17.5, 20.0, 25.0, 30.0
+    };
+    const size_t num_steps = sizeof(steps) / sizeof(steps[0]);
+
+    value = 0;
+    for ( size_t i = 0; i < num_steps; i++ )
+      if ( gain >= steps[i] - 1.0 )
+        value = ( i < 8 ) ? i : i + 2; /* the table skips codes 8 and 9 */
+  } else {
+    value = gain > 0.5 ? 1 : 0; /* on/off switch on the Pro+ */
+  }
+
+  return command( FCD_CMD_SET_LNA_GAIN, &value, 1 );
+}
+
+bool fcd_hid_control::set_mixer_gain( double gain )
+{
+  unsigned char value;
+
+  if ( 1 == _version )
+    value = gain >= 8.0 ? 1 : 0; /* 4 dB or 12 dB */
+  else
+    value = gain > 0.5 ? 1 : 0;
+
+  return command( FCD_CMD_SET_MIXER_GAIN, &value, 1 );
+}
+
+bool fcd_hid_control::set_if_gain( double gain )
+{
+  if ( gain < 0 )
+    gain = 0;
+  if ( gain > 59 )
+    gain = 59;
+
+  unsigned char value = (unsigned char)(gain + 0.5);
+
+  return command( FCD_CMD_SET_IF_GAIN1, &value, 1 );
+}
@@ -0,0 +1,61 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef FCD_HID_CONTROL_H
+#define FCD_HID_CONTROL_H
+
+#include <string>
+
+/*!
+ * Direct HID control of a FUNcube Dongle.
+ *
+ * The gr-fcd and gr-fcdproplus blocks bundle the control endpoint with
+ * their own PCM capture, so when we bypass them for low latency audio
+ * we have to talk to the dongle's HID interface ourselves. Uses the
+ * Linux hidraw interface, matching the non-portable /proc/asound
+ * device discovery above.
+ */
+class fcd_hid_control
+{
+public:
+  fcd_hid_control();
+  ~fcd_hid_control();
+
+  /*! Open the hidraw node of the \p index'th dongle of the given
+   * generation (1 or 2). \return false when no matching device was
+   * found. */
+  bool open( int version, unsigned int index = 0 );
+  void close();
+  bool opened() const { return _fd >= 0; }
+
+  /*! Tune to \p freq Hz, pre-corrected by \p ppm parts per million. */
+  bool set_freq( double freq, double ppm );
+
+  bool set_lna_gain( double gain );
+  bool set_mixer_gain( double gain );
+  bool set_if_gain( double gain );
+
+private:
+  bool command( unsigned char cmd, const unsigned char *data, size_t len );
+
+  int _fd;
+  int _version;
+};
+
+#endif /* FCD_HID_CONTROL_H */
@@ -92,7 +92,9 @@ fcd_source_c::fcd_source_c(const std::string &args) :
   gr::hier_block2("fcd_source_c",
                  gr::io_signature::make(0, 0, 0),
                  gr::io_signature::make(1, 1, sizeof (gr_complex))),
-  _type( FUNCUBE_UNKNOWN )
+  _type( FUNCUBE_UNKNOWN ),
+  _freq( 0 ),
+  _correct( 0 )
 {
   std::string dev_name;
   unsigned int dev_index = 0;
@@ -142,6 +144,46 @@ fcd_source_c::fcd_source_c(const std::string &args) :
 
   std::cerr << "Using " << name() << " (" << dev_name << ")" << std::endl;
 
+  bool lowlat = false;
+  if (dict.count("lowlat"))
+    lowlat = ("0" != dict["lowlat"]) && ("false" != dict["lowlat"]);
+
+#ifdef HAVE_FCD_ALSA
+  if ( lowlat )
+  {
+    unsigned int period = 256;
+    if (dict.count("period"))
+      period = boost::lexical_cast< unsigned int >( dict["period"] );
+
+    /* the gr-fcd/gr-fcdproplus blocks open the PCM exclusively, so the
+     * native capture path has to bring its own tuner control as well */
+    if ( ! _hid.open( FUNCUBE_V1 == _type ? 1 : 2, dev_index ) )
+      throw std::runtime_error("Failed to open FUNcube Dongle HID control.");
+
+    _src_ll = fcd_audio_rx::make( dev_name, (unsigned int)get_sample_rate(),
+                                  period );
+    connect( _src_ll, 0, self(), 0 );
+
+    if ( FUNCUBE_V1 == _type )
+    {
+      set_gain( 20, "LNA" );
+      set_gain( 12, "MIX" );
+    }
+    else
+    {
+      set_gain( 1, "LNA" );
+      set_gain( 1, "MIX" );
+      set_gain( 15, "BB" );
+    }
+
+    return;
+  }
+#else
+  if ( lowlat )
+    std::cerr << "Low latency capture not available, using the default path."
+              << std::endl;
+#endif
+
 #ifdef HAVE_FCD
   if ( FUNCUBE_V1 == _type )
   {
@@ -241,6 +283,16 @@ osmosdr::freq_range_t fcd_source_c::get_freq_range( size_t chan )
 
 double fcd_source_c::set_center_freq( double freq, size_t chan )
 {
+#ifdef HAVE_FCD_ALSA
+  if ( _hid.opened() )
+  {
+    _hid.set_freq( freq, _correct );
+    _freq = freq;
+
+    return get_center_freq(chan);
+  }
+#endif
+
 #ifdef HAVE_FCD
   if ( FUNCUBE_V1 == _type )
     _src_v1->set_freq( float(freq) );
@@ -263,6 +315,18 @@ double fcd_source_c::get_center_freq( size_t chan )
 
 double fcd_source_c::set_freq_corr( double ppm, size_t chan )
 {
+#ifdef HAVE_FCD_ALSA
+  if ( _hid.opened() )
+  {
+    _correct = ppm;
+
+    if ( _freq > 0 ) /* re-tune with the new correction applied */
+      _hid.set_freq( _freq, _correct );
+
+    return get_freq_corr( chan );
+  }
+#endif
+
 #ifdef HAVE_FCD
   if ( FUNCUBE_V1 == _type )
     _src_v1->set_freq_corr( ppm );
@@ -343,6 +407,32 @@ double fcd_source_c::set_gain( double gain, size_t chan )
 
 double fcd_source_c::set_gain( double gain, const std::string & name, size_t chan )
 {
+#ifdef HAVE_FCD_ALSA
+  if ( _hid.opened() )
+  {
+    if ( "LNA" == name )
+    {
+      _lna_gain = ( FUNCUBE_V2 == _type ) ? ( gain > 0 ? 1 : 0 ) : gain;
+      _hid.set_lna_gain(_lna_gain);
+    }
+    else if ( "MIX" == name )
+    {
+      if ( FUNCUBE_V1 == _type )
+        _mix_gain = gain > 4 ? 12 : 4;
+      else
+        _mix_gain = gain > 0 ? 1 : 0;
+      _hid.set_mixer_gain(_mix_gain);
+    }
+    else if ( "BB" == name )
+    {
+      _bb_gain = gain;
+      _hid.set_if_gain(_bb_gain);
+    }
+
+    return get_gain( name, chan );
+  }
+#endif
+
 #ifdef HAVE_FCD
   if ( FUNCUBE_V1 == _type )
   {
@@ -30,6 +30,11 @@
 #include <fcdproplus/fcdproplus.h>
 #endif
 
+#ifdef HAVE_FCD_ALSA
+#include "fcd_audio_rx.h"
+#include "fcd_hid_control.h"
+#endif
+
 #include "source_iface.h"
 
 class fcd_source_c;
@@ -38,6 +43,13 @@ typedef boost::shared_ptr< fcd_source_c > fcd_source_c_sptr;
 
 fcd_source_c_sptr make_fcd_source_c( const std::string & args = "" );
 
+/*!
+ * \brief Adapts the FUNcube Dongle blocks to the source_iface API.
+ *
+ * Like the uhd backend this is a hier shell around blocks living in
+ * external libraries; it carries no sample cost since flattening
+ * replaces the pass-through connection with a direct edge.
+ */
 class fcd_source_c :
     public gr::hier_block2,
     public source_iface
@@ -91,6 +103,10 @@ private:
 #endif
 #ifdef HAVE_FCDPP
   gr::fcdproplus::fcdproplus::sptr _src_v2;
+#endif
+#ifdef HAVE_FCD_ALSA
+  fcd_audio_rx::sptr _src_ll; /* lowlat=1, replaces _src_v1/_src_v2 */
+  fcd_hid_control _hid;
 #endif
   double _lna_gain, _mix_gain, _bb_gain, _freq;
   int _correct;
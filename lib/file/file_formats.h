@@ -0,0 +1,85 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FILE_FORMATS_H
+#define FILE_FORMATS_H
+
+#include <string>
+
+/*!
+ * On-disk sample formats shared by file_source_c and file_sink_c.
+ *
+ * The names follow the SigMF datatype convention: c for complex, then
+ * element type and width. cf32 is the historic raw gr_complex layout
+ * and stays the default; cu8 matches rtlsdr captures byte for byte and
+ * ci16 the 16 bit formats most other hardware delivers.
+ */
+enum file_format_t {
+  FORMAT_CF32 = 0, /* complex float32, 8 bytes/sample */
+  FORMAT_CU8,      /* complex offset-binary uint8, 2 bytes/sample */
+  FORMAT_CI16      /* complex int16, 4 bytes/sample */
+};
+
+/*! Map a format= argument or SigMF core:datatype to a format.
+ * \return false if the string names no supported format */
+inline bool file_format_from_string(const std::string &str,
+                                    file_format_t &format)
+{
+  if ("cf32" == str || "cf32_le" == str)
+    format = FORMAT_CF32;
+  else if ("cu8" == str)
+    format = FORMAT_CU8;
+  else if ("ci16" == str || "ci16_le" == str)
+    format = FORMAT_CI16;
+  else
+    return false;
+
+  return true;
+}
+
+/*! Bytes one complex sample occupies on disk. */
+inline size_t file_format_sample_size(file_format_t format)
+{
+  switch (format) {
+  case FORMAT_CU8:
+    return 2;
+  case FORMAT_CI16:
+    return 4;
+  case FORMAT_CF32:
+  default:
+    return 8;
+  }
+}
+
+/*! The SigMF core:datatype string for a format. */
+inline const char *file_format_sigmf_datatype(file_format_t format)
+{
+  switch (format) {
+  case FORMAT_CU8:
+    return "cu8";
+  case FORMAT_CI16:
+    return "ci16_le";
+  case FORMAT_CF32:
+  default:
+    return "cf32_le";
+  }
+}
+
+#endif /* FILE_FORMATS_H */
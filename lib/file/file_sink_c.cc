@@ -18,34 +18,121 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <string.h>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 
 #include <gnuradio/io_signature.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <thread>
+
+#include <iomanip>
+
 #include "file_sink_c.h"
 
 #include "arg_helpers.h"
+#include "convert/convert.h"
 
 using namespace boost::assign;
 
+static bool ends_with( const std::string &str, const std::string &suffix )
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/* Emit the SigMF metadata file accompanying a .sigmf-data capture. */
+static void write_sigmf_meta( const std::string &path, file_format_t format,
+                              double rate, double freq )
+{
+  std::ofstream meta(path.c_str(), std::ios::out | std::ios::trunc);
+  if (!meta)
+    throw std::runtime_error("Cannot open file '" + path + "'.");
+
+  meta << std::setprecision(15)
+       << "{\n"
+       << "    \"global\": {\n"
+       << "        \"core:datatype\": \""
+       << file_format_sigmf_datatype(format) << "\",\n";
+  if (rate > 0)
+    meta << "        \"core:sample_rate\": " << rate << ",\n";
+  meta << "        \"core:version\": \"1.0.0\"\n"
+       << "    },\n"
+       << "    \"captures\": [\n"
+       << "        {\n"
+       << "            \"core:sample_start\": 0,\n"
+       << "            \"core:frequency\": " << freq << "\n"
+       << "        }\n"
+       << "    ],\n"
+       << "    \"annotations\": []\n"
+       << "}\n";
+}
+
+/* Emit the manifest describing a stripe set: one extent of stripe_len
+ * bytes goes to each data file in turn, so file k holds extents k,
+ * k + N, k + 2N, ... file_source_c reassembles the stream from this. */
+static void write_stripe_manifest( const std::string &path,
+                                   const std::vector< std::string > &files,
+                                   size_t stripe_len, file_format_t format,
+                                   double rate, double freq )
+{
+  std::ofstream mf(path.c_str(), std::ios::out | std::ios::trunc);
+  if (!mf)
+    throw std::runtime_error("Cannot open file '" + path + "'.");
+
+  mf << std::setprecision(15)
+     << "osmosdr-stripes 1\n"
+     << "stripe_len " << stripe_len << "\n"
+     << "format " << file_format_sigmf_datatype(format) << "\n";
+  if (rate > 0)
+    mf << "rate " << rate << "\n";
+  if (freq > 0)
+    mf << "freq " << freq << "\n";
+  for (size_t i = 0; i < files.size(); i++)
+    mf << "data " << files[i] << "\n";
+}
+
+/* Staging ring geometry: 256K per buffer, 64 buffers (16M) by default.
+ * At 160 MB/s that absorbs a disk stall of about 100 ms; raise the
+ * buffers= argument for flakier storage. */
+#define FILE_SINK_BUF_SIZE (256 * 1024)
+#define FILE_SINK_NUM_BUFFERS 64
+
+/* number of ring buffers gathered into a single writev() call */
+#define FILE_SINK_IOV_MAX 16
+
 file_sink_c_sptr make_file_sink_c(const std::string &args)
 {
   return gnuradio::get_initial_sptr(new file_sink_c(args));
 }
 
 file_sink_c::file_sink_c(const std::string &args) :
-  gr::hier_block2("file_sink_c",
+  gr::sync_block("file_sink_c",
                  gr::io_signature::make(1, 1, sizeof (gr_complex)),
-                 gr::io_signature::make(0, 0, 0))
+                 gr::io_signature::make(0, 0, 0)),
+  _cur(0),
+  _fill(0),
+  _writer_failed(false),
+  _pace_samples(0)
 {
   std::string filename;
   bool append = false;
-  bool throttle = false;
+  unsigned int num_buffers = FILE_SINK_NUM_BUFFERS;
+  _throttle = false;
   _freq = 0;
   _rate = 0;
 
@@ -61,38 +148,280 @@ file_sink_c::file_sink_c(const std::string &args) :
     _rate = boost::lexical_cast< double >( dict["rate"] );
 
   if (dict.count("throttle"))
-    throttle = ("true" == dict["throttle"] ? true : false);
+    _throttle = ("true" == dict["throttle"] ? true : false);
 
   if (dict.count("append"))
     append = ("true" == dict["append"] ? true : false);
 
+  if (dict.count("buffers"))
+    num_buffers = boost::lexical_cast< unsigned int >( dict["buffers"] );
+
+  if (0 == num_buffers)
+    num_buffers = FILE_SINK_NUM_BUFFERS;
+
+  _format = FORMAT_CF32;
+
+  if (dict.count("format"))
+    if (!file_format_from_string( dict["format"], _format ))
+      throw std::runtime_error("Unsupported sample format '" +
+                               dict["format"] + "'.");
+
+  _sample_size = file_format_sample_size(_format);
+
   if (!filename.length())
     throw std::runtime_error("No file name specified.");
 
+  /* several targets joined with '+' stripe the recording across them */
+  std::vector< std::string > files;
+  boost::algorithm::split( files, filename, boost::is_any_of("+") );
+
+  if (files.size() > 1 && append)
+    throw std::runtime_error("Cannot append to a stripe set.");
+
   if (_freq < 0)
     throw std::runtime_error("Parameter 'freq' may not be negative.");
 
-  if (0 == _rate && throttle)
+  if (0 == _rate && _throttle)
     throw std::runtime_error("Parameter 'rate' is missing in arguments.");
 
   _file_rate = _rate;
 
-  _sink = gr::blocks::file_sink::make( sizeof(gr_complex),
-                                           filename.c_str(),
-                                           append);
+  /* recording under a SigMF name puts the samples into *.sigmf-data
+   * and describes them in the matching *.sigmf-meta */
+  if (1 == files.size() &&
+      (ends_with(files[0], ".sigmf-data") ||
+       ends_with(files[0], ".sigmf-meta"))) {
+    std::string stem = files[0].substr(0, files[0].rfind('.'));
+
+    write_sigmf_meta( stem + ".sigmf-meta", _format, _rate, _freq );
+
+    files[0] = stem + ".sigmf-data";
+  }
+
+  for (size_t i = 0; i < files.size(); i++) {
+    target_t *t = new target_t;
+    _targets.push_back( t );
+
+#ifndef _WIN32
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    t->fd = open( files[i].c_str(), flags, 0644 );
+    if (t->fd < 0)
+      throw std::runtime_error("Cannot open file '" + files[i] + "'.");
+#else
+    t->file = fopen( files[i].c_str(), append ? "ab" : "wb" );
+    if (!t->file)
+      throw std::runtime_error("Cannot open file '" + files[i] + "'.");
+#endif
+
+    t->ring.resize( num_buffers, FILE_SINK_BUF_SIZE );
+  }
+
+  if (files.size() > 1) {
+    std::string manifest = files[0] + ".stripes";
 
-  _throttle = gr::blocks::throttle::make( sizeof(gr_complex), _file_rate );
+    if (dict.count("manifest"))
+      manifest = dict["manifest"];
 
-  if (throttle) {
-    connect( self(), 0, _throttle, 0 );
-    connect( _throttle, 0, _sink, 0 );
-  } else {
-    connect( self(), 0, _sink, 0 );
+    write_stripe_manifest( manifest, files, FILE_SINK_BUF_SIZE,
+                           _format, _rate, _freq );
+
+    std::cerr << "Striping across " << files.size()
+              << " files, manifest in " << manifest << "." << std::endl;
   }
+
+  for (size_t i = 0; i < _targets.size(); i++)
+    _targets[i]->thread = gr::thread::thread(
+          boost::bind(&file_sink_c::writer_task, this, _targets[i]) );
 }
 
 file_sink_c::~file_sink_c()
 {
+  /* the trailing partial extent still needs to reach its target */
+  if (_fill)
+    _targets[_cur]->ring.commit( _fill );
+
+  /* wakes the writers, which drain whatever is still staged */
+  for (size_t i = 0; i < _targets.size(); i++)
+    _targets[i]->ring.shutdown();
+
+  for (size_t i = 0; i < _targets.size(); i++) {
+    target_t *t = _targets[i];
+
+    t->thread.join();
+
+#ifndef _WIN32
+    if (t->fd >= 0)
+      close( t->fd );
+#else
+    if (t->file)
+      fclose( t->file );
+#endif
+
+    delete t;
+  }
+
+  _targets.clear();
+}
+
+/* Write the \p num oldest staged buffers of \p t and release them. */
+bool file_sink_c::write_buffers( target_t *t, size_t num )
+{
+#ifndef _WIN32
+  struct iovec iov[FILE_SINK_IOV_MAX];
+  size_t total = 0;
+
+  for (size_t i = 0; i < num; i++) {
+    iov[i].iov_base = (void *)t->ring.peek(i);
+    iov[i].iov_len = t->ring.peek_len(i);
+    total += iov[i].iov_len;
+  }
+
+  size_t written = 0;
+  size_t skip = 0;
+  while (written < total) {
+    /* resume after a short write: skip whole iovecs already on disk
+     * and trim the partially written one */
+    struct iovec cur[FILE_SINK_IOV_MAX];
+    size_t ncur = 0;
+    size_t off = skip;
+    for (size_t i = 0; i < num; i++) {
+      if (off >= iov[i].iov_len) {
+        off -= iov[i].iov_len;
+        continue;
+      }
+      cur[ncur].iov_base = (char *)iov[i].iov_base + off;
+      cur[ncur].iov_len = iov[i].iov_len - off;
+      ncur++;
+      off = 0;
+    }
+
+    ssize_t ret = writev( t->fd, cur, ncur );
+    if (ret < 0) {
+      if (EINTR == errno)
+        continue;
+      std::cerr << "file_sink_c: write failed: "
+                << strerror(errno) << std::endl;
+      return false;
+    }
+
+    written += ret;
+    skip += ret;
+  }
+#else
+  for (size_t i = 0; i < num; i++) {
+    if (fwrite( t->ring.peek(i), 1, t->ring.peek_len(i), t->file )
+         != t->ring.peek_len(i)) {
+      std::cerr << "file_sink_c: write failed" << std::endl;
+      return false;
+    }
+  }
+#endif
+
+  for (size_t i = 0; i < num; i++)
+    t->ring.pop();
+
+  return true;
+}
+
+void file_sink_c::writer_task( target_t *t )
+{
+  while (t->ring.wait(1)) {
+    size_t num = std::min( t->ring.used(), (size_t)FILE_SINK_IOV_MAX );
+
+    if (!write_buffers( t, num )) {
+      _writer_failed = true;
+      return;
+    }
+  }
+
+  /* ring was shut down - flush what is still staged */
+  while (t->ring.used()) {
+    size_t num = std::min( t->ring.used(), (size_t)FILE_SINK_IOV_MAX );
+
+    if (!write_buffers( t, num )) {
+      _writer_failed = true;
+      return;
+    }
+  }
+}
+
+void file_sink_c::reset_pacing( void )
+{
+  _pace_epoch = std::chrono::steady_clock::now();
+  _pace_samples = 0;
+}
+
+bool file_sink_c::start( void )
+{
+  reset_pacing();
+
+  return true;
+}
+
+int file_sink_c::work( int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items )
+{
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  size_t remaining = noutput_items;
+
+  if (_writer_failed)
+    return WORK_DONE;
+
+  while (remaining) {
+    target_t *t = _targets[_cur];
+    unsigned char *dest = t->ring.write_head();
+
+    if (!dest) {
+      /* disk is not keeping up - drop instead of backpressuring */
+      t->ring.count_drop( remaining * _sample_size );
+      break;
+    }
+
+    size_t samples = std::min( remaining,
+                               (t->ring.buf_len() - _fill) / _sample_size );
+
+    if (FORMAT_CU8 == _format)
+      osmosdr::convert::fc32_u8( (const float *)in, dest + _fill,
+                                 samples * 2 );
+    else if (FORMAT_CI16 == _format)
+      osmosdr::convert::fc32_s16( (const float *)in,
+                                  (short *)(dest + _fill), samples * 2 );
+    else
+      memcpy( dest + _fill, in, samples * sizeof(gr_complex) );
+
+    _fill += samples * _sample_size;
+    in += samples;
+    remaining -= samples;
+
+    /* striped mode publishes only complete extents - the position in
+     * the round-robin order is what replay reassembles the stream
+     * from - while the single target gets every chunk right away */
+    bool full = (_fill == t->ring.buf_len());
+
+    if (full || 1 == _targets.size()) {
+      t->ring.commit( _fill );
+      _fill = 0;
+
+      if (full)
+        _cur = (_cur + 1) % _targets.size();
+    }
+  }
+
+  if (_throttle && _rate > 0) {
+    _pace_samples += noutput_items;
+
+    std::chrono::steady_clock::time_point deadline = _pace_epoch +
+      std::chrono::microseconds( (uint64_t)(_pace_samples * 1e6 / _rate) );
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (deadline > now)
+      std::this_thread::sleep_for( deadline - now );
+    else if (now - deadline > std::chrono::milliseconds(250))
+      reset_pacing();
+  }
+
+  return noutput_items;
 }
 
 std::string file_sink_c::name()
@@ -138,10 +467,10 @@ double file_sink_c::set_sample_rate( double rate )
               << std::endl;
   }
 
-  _throttle->set_sample_rate( rate );
-
   _rate = rate;
 
+  reset_pacing();
+
   return get_sample_rate();
 }
 
@@ -224,3 +553,22 @@ std::string file_sink_c::get_antenna( size_t chan )
 {
   return "";
 }
+
+osmosdr::stream_stats_t file_sink_c::get_stream_stats( size_t chan )
+{
+  osmosdr::stream_stats_t total = _targets[0]->ring.stats( _sample_size );
+
+  for (size_t i = 1; i < _targets.size(); i++) {
+    osmosdr::stream_stats_t s = _targets[i]->ring.stats( _sample_size );
+
+    total.dropped_buffers += s.dropped_buffers;
+    total.dropped_samples += s.dropped_samples;
+    total.ring_capacity += s.ring_capacity;
+    total.ring_high_water = std::max( total.ring_high_water,
+                                      s.ring_high_water );
+    for (size_t b = 0; b < osmosdr::stream_stats_t::NUM_LATENCY_BINS; b++)
+      total.latency_us[b] += s.latency_us[b];
+  }
+
+  return total;
+}
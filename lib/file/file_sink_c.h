@@ -20,10 +20,17 @@
 #ifndef FILE_SINK_C_H
 #define FILE_SINK_C_H
 
-#include <gnuradio/hier_block2.h>
-#include <gnuradio/blocks/file_sink.h>
-#include <gnuradio/blocks/throttle.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
 
+#include <cstdio>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "buffer_ring.h"
+#include "file_formats.h"
 #include "sink_iface.h"
 
 class file_sink_c;
@@ -32,8 +39,31 @@ typedef boost::shared_ptr< file_sink_c > file_sink_c_sptr;
 
 file_sink_c_sptr make_file_sink_c( const std::string & args = "" );
 
+/*!
+ * \brief Records a raw complex float IQ stream to a file.
+ *
+ * work() only copies into a staging ring; a dedicated writer thread
+ * drains the ring to disk with gathered writev() calls. A slow disk
+ * (or a stalled fsync elsewhere in the system) therefore fills the
+ * ring instead of backpressuring the radio, and once the ring is full
+ * samples are dropped and counted rather than lost silently upstream.
+ *
+ * The on-disk format defaults to raw gr_complex; format=cu8 or
+ * format=ci16 packs the stream to 2 or 4 bytes per sample with the
+ * shared conversion kernels, quartering or halving disk bandwidth.
+ * Naming the file *.sigmf-data additionally writes the matching
+ * .sigmf-meta file with datatype, sample rate and center frequency.
+ *
+ * Several target files joined with '+' (file=/mnt/a/cap+/mnt/b/cap)
+ * switch the sink into striping mode: fixed-size extents go to the
+ * targets round-robin, and every target has its own staging ring and
+ * writer thread, so the sustained rate scales with the number of
+ * disks behind the mounts. A small manifest (<first target>.stripes,
+ * or manifest=) describes the set; pointing file_source_c at it
+ * replays the stripes as one stream.
+ */
 class file_sink_c :
-    public gr::hier_block2,
+    public gr::sync_block,
     public sink_iface
 {
 private:
@@ -48,6 +78,12 @@ public:
 
   static std::vector< std::string > get_devices( bool fake = false );
 
+  bool start( void );
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
   size_t get_num_channels( void );
 
   osmosdr::meta_range_t get_sample_rates( void );
@@ -72,9 +108,45 @@ public:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
-  gr::blocks::file_sink::sptr _sink;
-  gr::blocks::throttle::sptr _throttle;
+  /*! One striping target: its own file and staging ring, drained by a
+   * dedicated writer thread. The non-striped mode is the one-target
+   * special case. */
+  struct target_t
+  {
+#ifndef _WIN32
+    target_t() : fd(-1) { }
+    int fd;
+#else
+    target_t() : file(NULL) { }
+    FILE *file;
+#endif
+    osmosdr::buffer_ring ring;
+    gr::thread::thread thread;
+  };
+
+  void writer_task( target_t *t );
+  /*! \return false once writing failed for good */
+  bool write_buffers( target_t *t, size_t num );
+  void reset_pacing( void );
+
+  std::vector< target_t * > _targets;
+  size_t _cur;  /* round-robin striping position */
+  size_t _fill; /* bytes staged in the current extent */
+
+  std::atomic<bool> _writer_failed;
+
+  bool _throttle;
+
+  file_format_t _format;
+  size_t _sample_size; /* bytes per complex sample on disk */
+
+  /* pacing state: samples accepted since the epoch was last reset */
+  std::chrono::steady_clock::time_point _pace_epoch;
+  uint64_t _pace_samples;
+
   double _file_rate;
   double _freq, _rate;
 };
@@ -18,36 +18,237 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <string.h>
+#include <time.h>
 
 #include <boost/assign.hpp>
 #include <boost/format.hpp>
 
 #include <gnuradio/io_signature.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <thread>
+
 #include "file_source_c.h"
 
 #include "arg_helpers.h"
+#include "convert/convert.h"
 
 using namespace boost::assign;
 
+/* number of samples converted per chunk when replaying packed formats */
+#define CONV_CHUNK_SAMPLES 65536
+
+/*! Extract the value of \p key from the flat JSON object \p json.
+ * Quoted strings lose their quotes, numbers are returned verbatim.
+ * This is no JSON parser, but all SigMF core fields we care about are
+ * simple scalars at a fixed nesting depth, which this handles fine. */
+static std::string sigmf_lookup( const std::string &json,
+                                 const std::string &key )
+{
+  size_t pos = json.find("\"" + key + "\"");
+  if (std::string::npos == pos)
+    return "";
+
+  /* the key itself contains a colon, look for the separator behind
+   * the closing quote */
+  pos = json.find(':', pos + key.size() + 2);
+  if (std::string::npos == pos)
+    return "";
+  pos++;
+
+  while (pos < json.size() && isspace(json[pos]))
+    pos++;
+
+  if (pos == json.size())
+    return "";
+
+  if ('"' == json[pos]) {
+    size_t end = json.find('"', pos + 1);
+    if (std::string::npos == end)
+      return "";
+    return json.substr(pos + 1, end - pos - 1);
+  }
+
+  size_t end = pos;
+  while (end < json.size() && (isdigit(json[end]) || '.' == json[end] ||
+          '-' == json[end] || '+' == json[end] ||
+          'e' == json[end] || 'E' == json[end]))
+    end++;
+
+  return json.substr(pos, end - pos);
+}
+
+/*! Convert a SigMF core:datetime stamp (ISO 8601, UTC) to UNIX epoch
+ * seconds, keeping fractional seconds. Returns a negative value when
+ * the stamp does not parse. */
+static double sigmf_datetime_to_epoch( const std::string &stamp )
+{
+  struct tm tm;
+  double seconds;
+
+  memset(&tm, 0, sizeof(tm));
+
+  if (6 != sscanf(stamp.c_str(), "%d-%d-%dT%d:%d:%lf",
+                  &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                  &tm.tm_hour, &tm.tm_min, &seconds))
+    return -1;
+
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+
+#ifdef _WIN32
+  time_t whole = _mkgmtime(&tm);
+#else
+  time_t whole = timegm(&tm);
+#endif
+
+  if (whole < 0)
+    return -1;
+
+  return double(whole) + seconds;
+}
+
+/*! Collect the time anchors from the SigMF captures array: every
+ * segment carrying both core:sample_start and core:datetime becomes
+ * one (sample number, epoch seconds) pair. */
+static std::vector< std::pair<uint64_t, double> >
+sigmf_time_index( const std::string &json )
+{
+  std::vector< std::pair<uint64_t, double> > index;
+  size_t pos = 0;
+
+  while (std::string::npos !=
+          (pos = json.find("\"core:sample_start\"", pos))) {
+    /* capture segments are flat objects, take the enclosing braces */
+    size_t obj_start = json.rfind('{', pos);
+    size_t obj_end = json.find('}', pos);
+
+    pos += 1;
+
+    if (std::string::npos == obj_start || std::string::npos == obj_end)
+      continue;
+
+    std::string obj = json.substr(obj_start, obj_end - obj_start + 1);
+
+    std::string sample = sigmf_lookup(obj, "core:sample_start");
+    std::string stamp = sigmf_lookup(obj, "core:datetime");
+
+    if (!sample.length() || !stamp.length())
+      continue;
+
+    double epoch = sigmf_datetime_to_epoch(stamp);
+    if (epoch < 0)
+      continue;
+
+    index.push_back(std::make_pair(
+        boost::lexical_cast< uint64_t >( sample ), epoch));
+  }
+
+  std::sort(index.begin(), index.end());
+
+  return index;
+}
+
+static bool ends_with( const std::string &str, const std::string &suffix )
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/* The manifest file_sink_c's striping mode writes next to the data. */
+struct stripe_manifest_t
+{
+  stripe_manifest_t() : stripe_len(0), rate(-1), freq(-1) { }
+
+  size_t stripe_len;
+  std::string format;
+  double rate; /* negative when the manifest carries none */
+  double freq;
+  std::vector< std::string > files;
+};
+
+static stripe_manifest_t parse_stripe_manifest( const std::string &path )
+{
+  stripe_manifest_t m;
+
+  std::ifstream mf(path.c_str());
+  if (!mf)
+    throw std::runtime_error("Cannot open file '" + path + "'.");
+
+  std::string line;
+  if (!std::getline(mf, line) || "osmosdr-stripes 1" != line)
+    throw std::runtime_error("'" + path + "' is not a stripe set manifest.");
+
+  std::string key;
+  while (mf >> key) {
+    if ("stripe_len" == key) {
+      mf >> m.stripe_len;
+    } else if ("format" == key) {
+      mf >> m.format;
+    } else if ("rate" == key) {
+      mf >> m.rate;
+    } else if ("freq" == key) {
+      mf >> m.freq;
+    } else if ("data" == key) {
+      mf >> std::ws;
+      if (std::getline(mf, line))
+        m.files.push_back(line);
+    } else {
+      std::getline(mf, line); /* skip fields a newer writer may add */
+    }
+  }
+
+  if (0 == m.stripe_len || m.files.empty())
+    throw std::runtime_error("Stripe set manifest '" + path +
+                             "' is incomplete.");
+
+  return m;
+}
+
+/* Size of one mapping window. Large enough that remapping is rare,
+ * small enough that a 32 bit address space can still take it. Must be
+ * a multiple of the page size; 64M is a multiple on any sane system. */
+#define MAP_WINDOW_SIZE (64 * 1024 * 1024)
+
 file_source_c_sptr make_file_source_c(const std::string &args)
 {
   return gnuradio::get_initial_sptr(new file_source_c(args));
 }
 
 file_source_c::file_source_c(const std::string &args) :
-  gr::hier_block2("file_source_c",
+  gr::sync_block("file_source_c",
                  gr::io_signature::make(0, 0, 0),
-                 gr::io_signature::make(1, 1, sizeof (gr_complex)))
+                 gr::io_signature::make(1, 1, sizeof (gr_complex))),
+#ifndef _WIN32
+  _fd(-1),
+  _map(NULL),
+  _map_len(0),
+  _map_offset(0),
+#else
+  _file(NULL),
+#endif
+  _file_len(0),
+  _pos(0),
+  _pace_samples(0)
 {
   std::string filename;
-  bool repeat = true;
-  bool throttle = true;
+  std::vector< std::string > stripe_files;
+  _repeat = true;
+  _throttle = true;
   _freq = 0;
   _rate = 0;
+  _stripe_len = 0;
 
   dict_t dict = params_to_dict(args);
 
@@ -61,38 +262,341 @@ file_source_c::file_source_c(const std::string &args) :
     _rate = boost::lexical_cast< double >( dict["rate"] );
 
   if (dict.count("repeat"))
-    repeat = ("true" == dict["repeat"] ? true : false);
+    _repeat = ("true" == dict["repeat"] ? true : false);
 
   if (dict.count("throttle"))
-    throttle = ("true" == dict["throttle"] ? true : false);
+    _throttle = ("true" == dict["throttle"] ? true : false);
+
+  _format = FORMAT_CF32;
+
+  if (dict.count("format"))
+    if (!file_format_from_string( dict["format"], _format ))
+      throw std::runtime_error("Unsupported sample format '" +
+                               dict["format"] + "'.");
 
   if (!filename.length())
     throw std::runtime_error("No file name specified.");
 
+  /* a SigMF recording brings its own datatype, rate and frequency;
+   * explicit device arguments take precedence over the metadata */
+  if (ends_with(filename, ".sigmf-meta") ||
+       ends_with(filename, ".sigmf-data")) {
+    std::string stem = filename.substr(0, filename.rfind('.'));
+
+    std::ifstream meta((stem + ".sigmf-meta").c_str());
+    if (!meta)
+      throw std::runtime_error("Cannot open file '" + stem +
+                               ".sigmf-meta'.");
+
+    std::stringstream json;
+    json << meta.rdbuf();
+
+    std::string value = sigmf_lookup(json.str(), "core:datatype");
+    if (value.length() && !dict.count("format"))
+      if (!file_format_from_string( value, _format ))
+        throw std::runtime_error("Unsupported SigMF datatype '" +
+                                 value + "'.");
+
+    value = sigmf_lookup(json.str(), "core:sample_rate");
+    if (value.length() && !dict.count("rate"))
+      _rate = boost::lexical_cast< double >( value );
+
+    value = sigmf_lookup(json.str(), "core:frequency");
+    if (value.length() && !dict.count("freq"))
+      _freq = boost::lexical_cast< double >( value );
+
+    _time_index = sigmf_time_index(json.str());
+
+    if (_time_index.size())
+      std::cerr << "SigMF time index with " << _time_index.size()
+                << " anchor(s) available for seeking." << std::endl;
+
+    filename = stem + ".sigmf-data";
+  }
+
+  /* a stripe set manifest names the data files; like SigMF metadata
+   * its format, rate and frequency yield to explicit arguments */
+  if (ends_with(filename, ".stripes")) {
+    stripe_manifest_t m = parse_stripe_manifest(filename);
+
+    _stripe_len = m.stripe_len;
+    stripe_files = m.files;
+
+    if (m.format.length() && !dict.count("format"))
+      if (!file_format_from_string( m.format, _format ))
+        throw std::runtime_error("Unsupported stripe set format '" +
+                                 m.format + "'.");
+
+    if (m.rate > 0 && !dict.count("rate"))
+      _rate = m.rate;
+
+    if (m.freq > 0 && !dict.count("freq"))
+      _freq = m.freq;
+  }
+
+  _sample_size = file_format_sample_size(_format);
+
+  if (FORMAT_CF32 != _format)
+    _conv_buf.resize( CONV_CHUNK_SAMPLES * _sample_size );
+
   if (_freq < 0)
     throw std::runtime_error("Parameter 'freq' may not be negative.");
 
-  if (0 == _rate && throttle)
+  if (0 == _rate && _throttle)
     throw std::runtime_error("Parameter 'rate' is missing in arguments.");
 
   _file_rate = _rate;
 
-  _source = gr::blocks::file_source::make( sizeof(gr_complex),
-                                           filename.c_str(),
-                                           repeat );
-
-  _throttle = gr::blocks::throttle::make( sizeof(gr_complex), _file_rate );
-
-  if (throttle) {
-    connect( _source, 0, _throttle, 0 );
-    connect( _throttle, 0, self(), 0 );
+  if (_stripe_len) {
+    if (_stripe_len % _sample_size)
+      throw std::runtime_error(
+            "Stripe length is not a whole number of samples.");
+
+    for (size_t i = 0; i < stripe_files.size(); i++) {
+#ifndef _WIN32
+      int fd = open( stripe_files[i].c_str(), O_RDONLY );
+      if (fd < 0)
+        throw std::runtime_error("Cannot open file '" +
+                                 stripe_files[i] + "'.");
+
+      struct stat st;
+      if (fstat( fd, &st ) < 0) {
+        close( fd );
+        throw std::runtime_error("Cannot stat file '" +
+                                 stripe_files[i] + "'.");
+      }
+
+      _stripe_fds.push_back( fd );
+      _file_len += st.st_size;
+#else
+      FILE *file = fopen( stripe_files[i].c_str(), "rb" );
+      if (!file)
+        throw std::runtime_error("Cannot open file '" +
+                                 stripe_files[i] + "'.");
+
+      fseek( file, 0, SEEK_END );
+      _file_len += ftell( file );
+
+      _stripe_files.push_back( file );
+#endif
+    }
+
+    std::cerr << "Replaying stripe set of " << stripe_files.size()
+              << " file(s) as one stream." << std::endl;
   } else {
-    connect( _source, 0, self(), 0 );
+#ifndef _WIN32
+    _fd = open( filename.c_str(), O_RDONLY );
+    if (_fd < 0)
+      throw std::runtime_error("Cannot open file '" + filename + "'.");
+
+    struct stat st;
+    if (fstat( _fd, &st ) < 0) {
+      close( _fd );
+      throw std::runtime_error("Cannot stat file '" + filename + "'.");
+    }
+
+    _file_len = st.st_size;
+#else
+    _file = fopen( filename.c_str(), "rb" );
+    if (!_file)
+      throw std::runtime_error("Cannot open file '" + filename + "'.");
+
+    fseek( _file, 0, SEEK_END );
+    _file_len = ftell( _file );
+#endif
   }
+
+  /* a trailing partial sample would desync I and Q, drop it */
+  _file_len -= _file_len % _sample_size;
+
+  if (0 == _file_len)
+    throw std::runtime_error("File '" + filename + "' contains no samples.");
 }
 
 file_source_c::~file_source_c()
 {
+#ifndef _WIN32
+  unmap_window();
+  if (_fd >= 0)
+    close( _fd );
+  for (size_t i = 0; i < _stripe_fds.size(); i++)
+    close( _stripe_fds[i] );
+#else
+  if (_file)
+    fclose( _file );
+  for (size_t i = 0; i < _stripe_files.size(); i++)
+    fclose( _stripe_files[i] );
+#endif
+}
+
+void file_source_c::unmap_window( void )
+{
+#ifndef _WIN32
+  if (_map) {
+    munmap( _map, _map_len );
+    _map = NULL;
+    _map_len = 0;
+  }
+#endif
+}
+
+/* Map the window containing file offset \p pos. The window start is
+ * aligned down to MAP_WINDOW_SIZE so consecutive positions keep
+ * hitting the same mapping. */
+void file_source_c::map_window( uint64_t pos )
+{
+#ifndef _WIN32
+  unmap_window();
+
+  uint64_t offset = pos - (pos % MAP_WINDOW_SIZE);
+  size_t len = std::min( (uint64_t)MAP_WINDOW_SIZE, _file_len - offset );
+
+  void *map = mmap( NULL, len, PROT_READ, MAP_SHARED, _fd, offset );
+  if (MAP_FAILED == map)
+    throw std::runtime_error("mmap() of IQ file failed.");
+
+  /* tell the kernel to read ahead aggressively and to drop what we
+   * already consumed, keeps 200G captures from evicting everything
+   * else from the page cache */
+  madvise( map, len, MADV_SEQUENTIAL );
+
+  _map = (unsigned char *)map;
+  _map_len = len;
+  _map_offset = offset;
+#else
+  (void)pos;
+#endif
+}
+
+/* Striped replay: extent e (_stripe_len bytes) lives in stripe file
+ * e % N at slot e / N. Reads stop at the extent boundary, the caller
+ * loops and comes back for the rest. */
+size_t file_source_c::read_at_striped( uint64_t pos, unsigned char *dest,
+                                       size_t len )
+{
+  len = std::min( (uint64_t)len, _file_len - pos );
+  if (0 == len)
+    return 0;
+
+#ifndef _WIN32
+  size_t n = _stripe_fds.size();
+#else
+  size_t n = _stripe_files.size();
+#endif
+
+  uint64_t extent = pos / _stripe_len;
+  uint64_t offset = (extent / n) * _stripe_len + pos % _stripe_len;
+
+  len = std::min( (uint64_t)len, (extent + 1) * _stripe_len - pos );
+
+#ifndef _WIN32
+  ssize_t ret = pread( _stripe_fds[extent % n], dest, len, offset );
+
+  return ret < 0 ? 0 : ret;
+#else
+  FILE *file = _stripe_files[extent % n];
+
+  fseek( file, (long)offset, SEEK_SET );
+
+  return fread( dest, 1, len, file );
+#endif
+}
+
+size_t file_source_c::read_at( uint64_t pos, unsigned char *dest, size_t len )
+{
+  if (_stripe_len)
+    return read_at_striped( pos, dest, len );
+
+  len = std::min( (uint64_t)len, _file_len - pos );
+  if (0 == len)
+    return 0;
+
+#ifndef _WIN32
+  if (!_map || pos < _map_offset || pos >= _map_offset + _map_len)
+    map_window( pos );
+
+  size_t chunk = std::min( (uint64_t)len, _map_offset + _map_len - pos );
+  memcpy( dest, _map + (pos - _map_offset), chunk );
+
+  return chunk;
+#else
+  fseek( _file, pos, SEEK_SET );
+
+  return fread( dest, 1, len, _file );
+#endif
+}
+
+void file_source_c::reset_pacing( void )
+{
+  _pace_epoch = std::chrono::steady_clock::now();
+  _pace_samples = 0;
+}
+
+bool file_source_c::start( void )
+{
+  reset_pacing();
+
+  return true;
+}
+
+int file_source_c::work( int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+  int processed = 0;
+
+  while (processed < noutput_items) {
+    if (_pos >= _file_len) {
+      if (!_repeat)
+        break;
+      _pos = 0;
+    }
+
+    size_t want = (noutput_items - processed) * _sample_size;
+    size_t got;
+
+    if (FORMAT_CF32 == _format) {
+      got = read_at( _pos, (unsigned char *)&out[processed], want );
+    } else {
+      want = std::min( want, _conv_buf.size() );
+      got = read_at( _pos, &_conv_buf[0], want );
+    }
+
+    if (0 == got)
+      break;
+
+    size_t samples = got / _sample_size;
+
+    if (FORMAT_CU8 == _format)
+      osmosdr::convert::u8_fc32( &_conv_buf[0],
+                                 (float *)&out[processed], samples * 2 );
+    else if (FORMAT_CI16 == _format)
+      osmosdr::convert::s16_fc32( (const short *)&_conv_buf[0],
+                                  (float *)&out[processed], samples * 2 );
+
+    _pos += samples * _sample_size;
+    processed += samples;
+  }
+
+  if (0 == processed)
+    return WORK_DONE;
+
+  if (_throttle && _rate > 0) {
+    _pace_samples += processed;
+
+    /* sleep until the wall clock catches up with the sample clock */
+    std::chrono::steady_clock::time_point deadline = _pace_epoch +
+      std::chrono::microseconds( (uint64_t)(_pace_samples * 1e6 / _rate) );
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (deadline > now)
+      std::this_thread::sleep_for( deadline - now );
+    else if (now - deadline > std::chrono::milliseconds(250))
+      reset_pacing(); /* fell far behind (e.g. paused in a debugger) */
+  }
+
+  return processed;
 }
 
 std::string file_source_c::name()
@@ -122,7 +626,63 @@ size_t file_source_c::get_num_channels( void )
 
 bool file_source_c::seek( long seek_point, int whence , size_t chan )
 {
-    return _source->seek( seek_point, whence );
+  uint64_t samples = _file_len / _sample_size;
+  int64_t target = seek_point;
+
+  if (SEEK_CUR == whence)
+    target += _pos / _sample_size;
+  else if (SEEK_END == whence)
+    target += samples;
+  else if (SEEK_SET != whence)
+    return false;
+
+  if (target < 0 || (uint64_t)target > samples)
+    return false;
+
+  _pos = target * _sample_size;
+  reset_pacing();
+
+  return true;
+}
+
+bool file_source_c::seek_time( double timestamp, size_t chan )
+{
+  int64_t sample;
+
+  if (_time_index.empty()) {
+    /* no anchors, the timestamp counts from the start of the file */
+    if (_file_rate <= 0 || timestamp < 0)
+      return false;
+
+    sample = int64_t(timestamp * _file_rate);
+  } else {
+    if (timestamp < _time_index.front().second)
+      return false;
+
+    /* the last anchor at or before the timestamp */
+    size_t i = 0;
+    while (i + 1 < _time_index.size() &&
+           _time_index[i + 1].second <= timestamp)
+      i++;
+
+    /* between two anchors the effective rate follows from the anchors
+     * themselves, which keeps variable rate captures honest; past the
+     * last anchor fall back to the nominal file rate */
+    double rate = _file_rate;
+
+    if (i + 1 < _time_index.size() &&
+        _time_index[i + 1].second > _time_index[i].second)
+      rate = double(_time_index[i + 1].first - _time_index[i].first) /
+             (_time_index[i + 1].second - _time_index[i].second);
+
+    if (rate <= 0)
+      return false;
+
+    sample = _time_index[i].first +
+             int64_t((timestamp - _time_index[i].second) * rate);
+  }
+
+  return seek( sample, SEEK_SET, chan );
 }
 
 osmosdr::meta_range_t file_source_c::get_sample_rates( void )
@@ -143,10 +703,10 @@ double file_source_c::set_sample_rate( double rate )
               << std::endl;
   }
 
-  _throttle->set_sample_rate( rate );
-
   _rate = rate;
 
+  reset_pacing();
+
   return get_sample_rate();
 }
 
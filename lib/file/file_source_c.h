@@ -20,10 +20,15 @@
 #ifndef FILE_SOURCE_C_H
 #define FILE_SOURCE_C_H
 
-#include <gnuradio/hier_block2.h>
-#include <gnuradio/blocks/file_source.h>
-#include <gnuradio/blocks/throttle.h>
+#include <gnuradio/sync_block.h>
 
+#include <cstdio>
+#include <stdint.h>
+
+#include <chrono>
+#include <vector>
+
+#include "file_formats.h"
 #include "source_iface.h"
 
 class file_source_c;
@@ -32,8 +37,31 @@ typedef boost::shared_ptr< file_source_c > file_source_c_sptr;
 
 file_source_c_sptr make_file_source_c( const std::string & args = "" );
 
+/*!
+ * \brief Replays a raw complex float IQ capture.
+ *
+ * The file is memory mapped in large sequential windows (with plain
+ * stdio as fallback on platforms without mmap), so replaying is one
+ * copy from the page cache straight into the scheduler's output
+ * buffer. Pacing to the configured sample rate happens inside work(),
+ * which makes the separate throttle block of the former hier block
+ * implementation unnecessary.
+ *
+ * Besides raw gr_complex the source replays packed cu8 and ci16
+ * captures (format= argument), converting with the same kernels the
+ * live backends use. Pointing file= at a SigMF recording (either the
+ * .sigmf-meta or .sigmf-data side) picks up datatype, sample rate and
+ * center frequency from the metadata; datetime stamped capture
+ * segments additionally become a sparse time index, so seek_time()
+ * jumps into huge captures by wall clock timestamp.
+ *
+ * Pointing file= at a .stripes manifest (written by file_sink_c's
+ * striping mode) replays a stripe set as one stream: the fixed-size
+ * extents are fetched from the stripe files in round-robin order, and
+ * seeking works on the logical stream position as usual.
+ */
 class file_source_c :
-    public gr::hier_block2,
+    public gr::sync_block,
     public source_iface
 {
 private:
@@ -48,9 +76,16 @@ public:
 
   static std::vector< std::string > get_devices( bool fake = false );
 
+  bool start( void );
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
   size_t get_num_channels( void );
 
   bool seek( long seek_point, int whence, size_t chan );
+  bool seek_time( double timestamp, size_t chan );
 
   osmosdr::meta_range_t get_sample_rates( void );
   double set_sample_rate( double rate );
@@ -75,10 +110,54 @@ public:
   std::string get_antenna( size_t chan = 0 );
 
 private:
-  gr::blocks::file_source::sptr _source;
-  gr::blocks::throttle::sptr _throttle;
+  /*! Copy \p len bytes at file offset \p pos into \p dest.
+   * \return the number of bytes actually delivered */
+  size_t read_at( uint64_t pos, unsigned char *dest, size_t len );
+  size_t read_at_striped( uint64_t pos, unsigned char *dest, size_t len );
+  void map_window( uint64_t pos );
+  void unmap_window( void );
+  void reset_pacing( void );
+
+#ifndef _WIN32
+  int _fd;
+  unsigned char *_map;
+  size_t _map_len;
+  uint64_t _map_offset;
+#else
+  FILE *_file;
+#endif
+
+  uint64_t _file_len; /* bytes, trimmed to whole samples */
+  uint64_t _pos;      /* current read position in bytes */
+  bool _repeat;
+  bool _throttle;
+
+  file_format_t _format;
+  size_t _sample_size; /* bytes per complex sample on disk */
+  std::vector<unsigned char> _conv_buf; /* staging for packed formats */
+
+  /* striped replay: extent size in bytes (0 when not striped) and the
+   * stripe files in round-robin order */
+  size_t _stripe_len;
+#ifndef _WIN32
+  std::vector<int> _stripe_fds;
+#else
+  std::vector<FILE *> _stripe_files;
+#endif
+
+  /* pacing state: samples emitted since the epoch was last reset */
+  std::chrono::steady_clock::time_point _pace_epoch;
+  uint64_t _pace_samples;
+
   double _file_rate;
   double _freq, _rate;
+
+  /* sparse time index from the SigMF capture segments: sample number
+   * of each core:datetime stamped anchor -> its UNIX epoch seconds.
+   * Sorted by sample number; seeks between anchors interpolate at the
+   * rate the bracketing anchors imply, so variable rate captures land
+   * on the right sample, too. */
+  std::vector< std::pair<uint64_t, double> > _time_index;
 };
 
 #endif // FILE_SOURCE_C_H
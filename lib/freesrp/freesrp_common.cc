@@ -138,7 +138,7 @@ size_t freesrp_common::get_num_channels( void )
   return 1;
 }
 
-osmosdr::meta_range_t freesrp_common::get_sample_rates( void )
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -157,6 +157,14 @@ osmosdr::meta_range_t freesrp_common::get_sample_rates( void )
   return range;
 }
 
+osmosdr::meta_range_t freesrp_common::get_sample_rates( void )
+{
+  // built once - UIs poll this during interactive tuning
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 osmosdr::freq_range_t freesrp_common::get_freq_range(size_t chan)
 {
   osmosdr::meta_range_t freq_ranges;
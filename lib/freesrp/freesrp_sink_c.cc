@@ -1,8 +1,15 @@
 #include "freesrp_sink_c.h"
 
+#include "convert/convert.h"
+
 using namespace FreeSRP;
 using namespace std;
 
+#define FREESRP_TX_BUF_NUM  32
+#define FREESRP_TX_BUF_LEN  (64 * 1024) /* bytes, 16384 samples */
+
+#define FREESRP_BYTES_PER_SAMPLE  4 /* 12 bit I and Q in int16 containers */
+
 freesrp_sink_c_sptr make_freesrp_sink_c (const string &args)
 {
     return gnuradio::get_initial_sptr(new freesrp_sink_c (args));
@@ -40,7 +47,14 @@ bool freesrp_sink_c::start()
     {
         return false;
     }
+
+    _ring.resize(FREESRP_TX_BUF_NUM, FREESRP_TX_BUF_LEN);
+    _buf_offset = 0;
+
     _srp->start_tx(std::bind(&freesrp_sink_c::freesrp_tx_callback, this, std::placeholders::_1));
+
+    _running = true;
+
     return true;
 }
 
@@ -48,55 +62,79 @@ bool freesrp_sink_c::stop()
 {
     _srp->send_cmd({SET_DATAPATH_EN, 0});
     _srp->stop_tx();
+
+    _running = false;
+
+    _ring.shutdown(); // unblock a scheduler thread stuck in work()
+
     return true;
 }
 
 void freesrp_sink_c::freesrp_tx_callback(vector<sample>& samples)
 {
-    unique_lock<std::mutex> lk(_buf_mut);
+    // drain whole ring buffers instead of dequeueing sample by sample -
+    // one atomic consume per block
+    size_t pos = 0;
 
-    for(sample &s : samples)
+    while(pos < samples.size() && _ring.used())
     {
-        if(!_buf_queue.try_dequeue(s))
+        size_t avail = _ring.head_len() / FREESRP_BYTES_PER_SAMPLE - _buf_offset;
+        size_t chunk = min(avail, samples.size() - pos);
+
+        const short *src = (const short *)_ring.head() + _buf_offset * 2;
+
+        for(size_t i = 0; i < chunk; ++i)
         {
-            s.i = 0;
-            s.q = 0;
+            samples[pos + i].i = src[i * 2];
+            samples[pos + i].q = src[i * 2 + 1];
         }
-        else
+
+        pos += chunk;
+        _buf_offset += chunk;
+
+        if(_buf_offset * FREESRP_BYTES_PER_SAMPLE == _ring.head_len())
         {
-            _buf_available_space++;
+            _ring.pop();
+            _buf_offset = 0;
         }
     }
 
-    _buf_cond.notify_one();
+    // underrun: pad the rest of the transfer with silence
+    for(; pos < samples.size(); ++pos)
+    {
+        samples[pos].i = 0;
+        samples[pos].q = 0;
+    }
 }
 
 int freesrp_sink_c::work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items)
 {
     const gr_complex *in = (const gr_complex *) input_items[0];
 
-    unique_lock<std::mutex> lk(_buf_mut);
-
-    // Wait until enough space is available
-    while(_buf_available_space < (unsigned int) noutput_items)
-    {
-        _buf_cond.wait(lk);
-    }
+    int processed = 0;
 
-    for(int i = 0; i < noutput_items; ++i)
+    while(processed < noutput_items)
     {
-        sample s;
-        s.i = (int16_t) (real(in[i]) * 2047.0f);
-        s.q = (int16_t) (imag(in[i]) * 2047.0f);
+        short *dest;
 
-        if(!_buf_queue.try_enqueue(s))
-        {
-            throw runtime_error("Failed to add sample to buffer. This should never happen. Available space reported to be " + to_string(_buf_available_space) + " samples, noutput_items=" + to_string(noutput_items) + ", i=" + to_string(i));
-        }
-        else
+        // wait for a free transfer-sized buffer instead of blocking on
+        // per-sample queue space
+        while((dest = (short *)_ring.write_head()) == nullptr)
         {
-            _buf_available_space--;
+            if(!_ring.wait_room())
+            {
+                return WORK_DONE; // ring was shut down
+            }
         }
+
+        size_t chunk = min(size_t(noutput_items - processed),
+                           _ring.buf_len() / FREESRP_BYTES_PER_SAMPLE);
+
+        osmosdr::convert::fc32_s16((const float *)(in + processed), dest,
+                                   chunk * 2, 2047.0f);
+
+        _ring.commit(chunk * FREESRP_BYTES_PER_SAMPLE);
+        processed += chunk;
     }
 
     return noutput_items;
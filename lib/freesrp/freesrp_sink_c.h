@@ -26,13 +26,10 @@
 #include <gnuradio/sync_block.h>
 
 #include "osmosdr/ranges.h"
+#include "buffer_ring.h"
 #include "sink_iface.h"
 
 #include "freesrp_common.h"
-#include "readerwriterqueue/readerwriterqueue.h"
-
-#include <mutex>
-#include <condition_variable>
 
 #include <freesrp.hpp>
 
@@ -121,10 +118,10 @@ private:
 
     bool _running = false;
 
-    std::mutex _buf_mut{};
-    std::condition_variable _buf_cond{};
-    size_t _buf_available_space = FREESRP_RX_TX_QUEUE_SIZE;
-    moodycamel::ReaderWriterQueue<::FreeSRP::sample> _buf_queue{FREESRP_RX_TX_QUEUE_SIZE};
+    /* whole transfers travel through the ring, work() packs them as
+     * interleaved int16 I/Q and the callback unpacks block-wise */
+    osmosdr::buffer_ring _ring;
+    size_t _buf_offset = 0;
 };
 
 #endif /* INCLUDED_FREESRP_SINK_C_H */
@@ -1,8 +1,15 @@
 #include "freesrp_source_c.h"
 
+#include "convert/convert.h"
+
 using namespace FreeSRP;
 using namespace std;
 
+#define FREESRP_RX_BUF_NUM  32
+#define FREESRP_RX_BUF_LEN  (64 * 1024) /* bytes, 16384 samples */
+
+#define FREESRP_BYTES_PER_SAMPLE  4 /* 12 bit I and Q in int16 containers */
+
 freesrp_source_c_sptr make_freesrp_source_c (const string &args)
 {
     return gnuradio::get_initial_sptr(new freesrp_source_c (args));
@@ -40,6 +47,12 @@ bool freesrp_source_c::start()
     {
         return false;
     }
+
+    _ring.resize(FREESRP_RX_BUF_NUM, FREESRP_RX_BUF_LEN);
+    _buf_offset = 0;
+
+    _tagger.start(get_sample_rate());
+
     _srp->start_rx(std::bind(&freesrp_source_c::freesrp_rx_callback, this, std::placeholders::_1));
 
     _running = true;
@@ -54,65 +67,87 @@ bool freesrp_source_c::stop()
 
     _running = false;
 
+    _ring.shutdown(); // unblock a scheduler thread stuck in work()
+
     return true;
 }
 
 void freesrp_source_c::freesrp_rx_callback(const vector<sample> &samples)
 {
-    unique_lock<std::mutex> lk(_buf_mut);
+    // pack the whole transfer into ring buffers instead of queueing
+    // sample by sample - one atomic publish per block
+    size_t pos = 0;
 
-    for(const sample &s : samples)
+    while(pos < samples.size())
     {
-        if(!_buf_queue.try_enqueue(s))
+        short *dest = (short *)_ring.write_head();
+
+        if(!dest)
         {
-	    if(!_ignore_overflow)
-	    {
-		throw runtime_error("RX buffer overflow");
-	    }
+            _ring.count_drop((samples.size() - pos) * FREESRP_BYTES_PER_SAMPLE);
+            _tagger.discontinuity();
+
+            if(!_ignore_overflow)
+            {
+                throw runtime_error("RX buffer overflow");
+            }
+
+            return;
         }
-        else
+
+        size_t chunk = min(samples.size() - pos,
+                           _ring.buf_len() / FREESRP_BYTES_PER_SAMPLE);
+
+        for(size_t i = 0; i < chunk; ++i)
         {
-            _buf_num_samples++;
+            dest[i * 2] = samples[pos + i].i;
+            dest[i * 2 + 1] = samples[pos + i].q;
         }
-    }
 
-    _buf_cond.notify_one();
+        _ring.commit(chunk * FREESRP_BYTES_PER_SAMPLE);
+        pos += chunk;
+    }
 }
 
 int freesrp_source_c::work(int noutput_items, gr_vector_const_void_star& input_items, gr_vector_void_star& output_items)
 {
     gr_complex *out = static_cast<gr_complex *>(output_items[0]);
 
-    unique_lock<std::mutex> lk(_buf_mut);
-
     if(!_running)
     {
 	return WORK_DONE;
     }
 
-    // Wait until enough samples collected
-    while(_buf_num_samples < (unsigned int) noutput_items)
+    if(!_ring.wait(1))
     {
-        _buf_cond.wait(lk);
+        return WORK_DONE;
     }
 
-    for(int i = 0; i < noutput_items; ++i)
+    int processed = 0;
+
+    while(processed < noutput_items && _ring.used())
     {
-        sample s;
-        if(!_buf_queue.try_dequeue(s))
-        {
-            // This should not be happening
-            throw runtime_error("Failed to get sample from buffer. This should never happen. Number of available samples reported to be " + to_string(_buf_num_samples) + ", noutput_items=" + to_string(noutput_items) + ", i=" + to_string(i));
-        }
-        else
+        size_t avail = _ring.head_len() / FREESRP_BYTES_PER_SAMPLE - _buf_offset;
+        size_t chunk = min(avail, size_t(noutput_items - processed));
+
+        const short *in = (const short *)_ring.head() + _buf_offset * 2;
+
+        osmosdr::convert::s16_fc32(in, (float *)(out + processed), chunk * 2,
+                                   2048.0f);
+
+        processed += chunk;
+        _buf_offset += chunk;
+
+        if(_buf_offset * FREESRP_BYTES_PER_SAMPLE == _ring.head_len())
         {
-            _buf_num_samples--;
+            _ring.pop();
+            _buf_offset = 0;
         }
-
-        out[i] = gr_complex(((float) s.i) / 2048.0f, ((float) s.q) / 2048.0f);
     }
 
-    return noutput_items;
+    _tagger.tag_work(this, 0, processed);
+
+    return processed;
 }
 
 double freesrp_source_c::set_sample_rate( double rate )
@@ -126,6 +161,8 @@ double freesrp_source_c::set_sample_rate( double rate )
     }
     else
     {
+        _tagger.set_rate(static_cast<double>(r.param));
+
         return static_cast<double>(r.param);
     }
 }
@@ -339,3 +376,8 @@ double freesrp_source_c::get_bandwidth(size_t chan)
         return static_cast<double>(r.param);
     }
 }
+
+osmosdr::stream_stats_t freesrp_source_c::get_stream_stats(size_t chan)
+{
+    return _ring.stats(FREESRP_BYTES_PER_SAMPLE);
+}
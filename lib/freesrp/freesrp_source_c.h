@@ -26,17 +26,14 @@
 #include <gnuradio/sync_block.h>
 
 #include "osmosdr/ranges.h"
+#include "buffer_ring.h"
 #include "source_iface.h"
+#include "stream_tagger.h"
 
 #include "freesrp_common.h"
 
-#include "readerwriterqueue/readerwriterqueue.h"
-
 #include <freesrp.hpp>
 
-#include <mutex>
-#include <condition_variable>
-
 class freesrp_source_c;
 
 /*
@@ -116,16 +113,19 @@ public:
     double set_bandwidth( double bandwidth, size_t chan = 0 );
     double get_bandwidth( size_t chan = 0 );
 
+    osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
 
     void freesrp_rx_callback(const std::vector<FreeSRP::sample> &samples);
 
     bool _running = false;
 
-    std::mutex _buf_mut{};
-    std::condition_variable _buf_cond{};
-    size_t _buf_num_samples = 0;
-    moodycamel::ReaderWriterQueue<FreeSRP::sample> _buf_queue{FREESRP_RX_TX_QUEUE_SIZE};
+    /* whole transfers travel through the ring, the callback packs them
+     * as interleaved int16 I/Q and work() converts block-wise */
+    osmosdr::buffer_ring _ring;
+    size_t _buf_offset = 0;
+    osmosdr::stream_tagger _tagger;
 };
 
 #endif /* INCLUDED_FREESRP_SOURCE_C_H */
@@ -0,0 +1,120 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_FREQ_SCANNER_H
+#define OSMOSDR_FREQ_SCANNER_H
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <gnuradio/thread/thread.h>
+
+namespace osmosdr {
+
+/*!
+ * Driver side frequency scan execution for source blocks.
+ *
+ * Cycles through a list of frequencies with a fixed dwell time per
+ * hop from a dedicated thread, so a scan application pays the retune
+ * latency once per plan instead of once per hop through the Python
+ * control path. The backend supplies the tune callback, which runs in
+ * the scanner thread and is expected to retune the hardware and mark
+ * the hop in the sample stream (see stream_tagger::retune).
+ */
+class freq_scanner
+{
+public:
+  typedef boost::function<void (double)> tune_fn;
+
+  freq_scanner()
+    : _active(false)
+  {
+  }
+
+  ~freq_scanner()
+  {
+    stop();
+  }
+
+  /*! Start executing a scan plan, replacing a running one.
+   * \param freqs the frequencies to visit, in order, repeated forever
+   * \param dwell seconds to stay on each frequency
+   * \param tune called with the next frequency at each hop
+   * \return false when the plan is invalid */
+  bool start( const std::vector<double> &freqs, double dwell, tune_fn tune )
+  {
+    if ( freqs.empty() || dwell <= 0.0 )
+      return false;
+
+    stop();
+
+    _freqs = freqs;
+    _dwell = dwell;
+    _tune = tune;
+    _active = true;
+    _thread = gr::thread::thread(
+          boost::bind( &freq_scanner::scan_task, this ) );
+
+    return true;
+  }
+
+  /*! Stop a running scan plan. The hardware stays on the last hop. */
+  void stop()
+  {
+    if ( ! _active )
+      return;
+
+    _active = false;
+    _thread.interrupt();
+    _thread.join();
+  }
+
+  bool active() const { return _active; }
+
+private:
+  void scan_task()
+  {
+    const long dwell_us = long( _dwell * 1e6 );
+
+    try {
+      while ( _active ) {
+        for ( size_t i = 0; i < _freqs.size(); i++ ) {
+          _tune( _freqs[i] );
+          boost::this_thread::sleep(
+                boost::posix_time::microseconds( dwell_us ) );
+        }
+      }
+    } catch ( boost::thread_interrupted ) {
+      /* stop() aborts a hop in progress */
+    }
+  }
+
+  std::vector<double> _freqs;
+  double _dwell;
+  tune_fn _tune;
+  gr::thread::thread _thread;
+  bool _active;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_FREQ_SCANNER_H */
@@ -31,11 +31,6 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
-#ifdef USE_AVX
-#include <immintrin.h>
-#elif USE_SSE2
-#include <emmintrin.h>
-#endif
 
 #include <boost/assign.hpp>
 #include <boost/format.hpp>
@@ -48,6 +43,7 @@
 #include "hackrf_sink_c.h"
 
 #include "arg_helpers.h"
+#include "convert/convert.h"
 
 using namespace boost::assign;
 
@@ -69,64 +65,6 @@ using namespace boost::assign;
 #define HACKRF_FUNC_STR(func, arg) \
   boost::str(boost::format(func "(%1%)") % arg) + " has failed"
 
-static inline bool cb_init(circular_buffer_t *cb, size_t capacity, size_t sz)
-{
-  cb->buffer = malloc(capacity * sz);
-  if(cb->buffer == NULL)
-    return false; // handle error
-  cb->buffer_end = (int8_t *)cb->buffer + capacity * sz;
-  cb->capacity = capacity;
-  cb->count = 0;
-  cb->sz = sz;
-  cb->head = cb->buffer;
-  cb->tail = cb->buffer;
-  return true;
-}
-
-static inline void cb_free(circular_buffer_t *cb)
-{
-  free(cb->buffer);
-  cb->buffer = NULL;
-  // clear out other fields too, just to be safe
-  cb->buffer_end = 0;
-  cb->capacity = 0;
-  cb->count = 0;
-  cb->sz = 0;
-  cb->head = 0;
-  cb->tail = 0;
-}
-
-static inline bool cb_has_room(circular_buffer_t *cb)
-{
-  if(cb->count == cb->capacity)
-    return false;
-  return true;
-}
-
-static inline bool cb_push_back(circular_buffer_t *cb, const void *item)
-{
-  if(cb->count == cb->capacity)
-    return false; // handle error
-  memcpy(cb->head, item, cb->sz);
-  cb->head = (int8_t *)cb->head + cb->sz;
-  if(cb->head == cb->buffer_end)
-    cb->head = cb->buffer;
-  cb->count++;
-  return true;
-}
-
-static inline bool cb_pop_front(circular_buffer_t *cb, void *item)
-{
-  if(cb->count == 0)
-    return false; // handle error
-  memcpy(item, cb->tail, cb->sz);
-  cb->tail = (int8_t *)cb->tail + cb->sz;
-  if(cb->tail == cb->buffer_end)
-    cb->tail = cb->buffer;
-  cb->count--;
-  return true;
-}
-
 int hackrf_sink_c::_usage = 0;
 boost::mutex hackrf_sink_c::_usage_mutex;
 
@@ -157,7 +95,8 @@ hackrf_sink_c::hackrf_sink_c (const std::string &args)
         gr::io_signature::make(MIN_IN, MAX_IN, sizeof (gr_complex)),
         gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof (gr_complex))),
     _dev(NULL),
-    _buf(NULL),
+    _buf_used(0),
+    _tx_started(false),
     _sample_rate(0),
     _center_freq(0),
     _freq_corr(0),
@@ -182,6 +121,17 @@ hackrf_sink_c::hackrf_sink_c (const std::string &args)
   if (0 == _buf_num)
     _buf_num = BUF_NUM;
 
+  /* number of buffers to accumulate before transmission starts, so a
+   * slowly starting flowgraph does not underrun right away. prefill=0
+   * starts the transmitter immediately like older versions did. */
+  _prefill = _buf_num / 2;
+
+  if (dict.count("prefill"))
+    _prefill = boost::lexical_cast< unsigned int >( dict["prefill"] );
+
+  if (_prefill > _buf_num)
+    _prefill = _buf_num;
+
   {
     boost::mutex::scoped_lock lock( _usage_mutex );
 
@@ -244,14 +194,12 @@ hackrf_sink_c::hackrf_sink_c (const std::string &args)
     }
   }
 
-  _buf = (int8_t *) malloc( BUF_LEN );
-
-  cb_init( &_cbuf, _buf_num, BUF_LEN );
+  _ring.resize( _buf_num, BUF_LEN );
 
 //  _thread = gr::thread::thread(_hackrf_wait, this);
 
-  ret = hackrf_start_tx( _dev, _hackrf_tx_callback, (void *)this );
-  HACKRF_THROW_ON_ERROR(ret, "Failed to start TX streaming")
+  if (0 == _prefill)
+    tx_start(); /* otherwise work() starts us once the ring is primed */
 }
 
 /*
@@ -259,9 +207,13 @@ hackrf_sink_c::hackrf_sink_c (const std::string &args)
  */
 hackrf_sink_c::~hackrf_sink_c ()
 {
+  _ring.shutdown(); /* unblock a scheduler thread stuck in work() */
+
   if (_dev) {
 //    _thread.join();
-    int ret = hackrf_stop_tx( _dev );
+    int ret = HACKRF_SUCCESS;
+    if (_tx_started)
+      ret = hackrf_stop_tx( _dev );
     if ( ret != HACKRF_SUCCESS )
     {
       std::cerr << HACKRF_FORMAT_ERROR(ret, "Failed to stop TX streaming") << std::endl;
@@ -282,11 +234,6 @@ hackrf_sink_c::~hackrf_sink_c ()
         hackrf_exit(); /* call only once after last close */
     }
   }
-
-  free(_buf);
-  _buf = NULL;
-
-  cb_free( &_cbuf );
 }
 
 int hackrf_sink_c::_hackrf_tx_callback(hackrf_transfer *transfer)
@@ -297,22 +244,24 @@ int hackrf_sink_c::_hackrf_tx_callback(hackrf_transfer *transfer)
 
 int hackrf_sink_c::hackrf_tx_callback(unsigned char *buffer, uint32_t length)
 {
-#if 0
-  for (unsigned int i = 0; i < length; ++i) /* simulate noise */
-    *buffer++ = rand() % 255;
-#else
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
-
-    if ( ! cb_pop_front( &_cbuf, buffer ) ) {
-      memset(buffer, 0, length);
-      std::cerr << "U" << std::flush;
-    } else {
-//      std::cerr << "-" << std::flush;
-      _buf_cond.notify_one();
-    }
+  if (0 == _ring.used()) {
+    /* underrun: the transfer must be fed no matter what, so send
+     * silence and account for it in the ring's drop counters */
+    memset(buffer, 0, length);
+    _ring.count_drop(length);
+    std::cerr << "U" << std::flush;
+    return 0; // TODO: return -1 on error/stop
   }
-#endif
+
+  const size_t avail = std::min((size_t)length, _ring.head_len());
+
+  memcpy(buffer, _ring.head(), avail);
+
+  if (avail < length) /* short buffer, e.g. after a flush */
+    memset(buffer + avail, 0, length - avail);
+
+  _ring.pop();
+
   return 0; // TODO: return -1 on error/stop
 }
 
@@ -355,66 +304,12 @@ bool hackrf_sink_c::stop()
   return true;
 }
 
-#ifdef USE_AVX
-void convert_avx(const float* inbuf, int8_t* outbuf,const unsigned int count)
-{
-  __m256 mulme = _mm256_set_ps(127.0f, 127.0f, 127.0f, 127.0f, 127.0f, 127.0f, 127.0f, 127.0f);
-  for(unsigned int i=0; i<count;i++){
-
-  __m256i itmp3 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&inbuf[i*16+0]), mulme));
-  __m256i itmp4 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&inbuf[i*16+8]), mulme));
-
-  __m128i a1 = _mm256_extractf128_si256(itmp3, 1);
-  __m128i a0 = _mm256_castsi256_si128(itmp3);
-  __m128i a3 = _mm256_extractf128_si256(itmp4, 1);
-  __m128i a2 = _mm256_castsi256_si128(itmp4);
-
-  __m128i outshorts1 = _mm_packs_epi32(a0, a1);
-  __m128i outshorts2 = _mm_packs_epi32(a2, a3);
-
-  __m128i outbytes = _mm_packs_epi16(outshorts1, outshorts2);
-
-  _mm_storeu_si128 ((__m128i*)&outbuf[i*16], outbytes);
-  }
-}
-
-#elif USE_SSE2
-void convert_sse2(const float* inbuf, int8_t* outbuf,const unsigned int count)
+void hackrf_sink_c::tx_start()
 {
-  const register __m128 mulme = _mm_set_ps( 127.0f, 127.0f, 127.0f, 127.0f );
-  __m128 itmp1,itmp2,itmp3,itmp4;
-  __m128i otmp1,otmp2,otmp3,otmp4;
-
-  __m128i outshorts1,outshorts2;
-  __m128i outbytes;
-
-  for(unsigned int i=0; i<count;i++){
-
-  itmp1 = _mm_mul_ps(_mm_loadu_ps(&inbuf[i*16+0]), mulme);
-  itmp2 = _mm_mul_ps(_mm_loadu_ps(&inbuf[i*16+4]), mulme);
-  itmp3 = _mm_mul_ps(_mm_loadu_ps(&inbuf[i*16+8]), mulme);
-  itmp4 = _mm_mul_ps(_mm_loadu_ps(&inbuf[i*16+12]), mulme);
-
-  otmp1 = _mm_cvtps_epi32(itmp1);
-  otmp2 = _mm_cvtps_epi32(itmp2);
-  otmp3 = _mm_cvtps_epi32(itmp3);
-  otmp4 = _mm_cvtps_epi32(itmp4);
-
-  outshorts1 = _mm_packs_epi32(otmp1, otmp2);
-  outshorts2 = _mm_packs_epi32(otmp3, otmp4);
-
-  outbytes = _mm_packs_epi16(outshorts1, outshorts2);
+  int ret = hackrf_start_tx( _dev, _hackrf_tx_callback, (void *)this );
+  HACKRF_THROW_ON_ERROR(ret, "Failed to start TX streaming")
 
-  _mm_storeu_si128 ((__m128i*)&outbuf[i*16], outbytes);
-  }
-}
-#endif
-
-void convert_default(float* inbuf, int8_t* outbuf,const unsigned int count)
-{
-  for(unsigned int i=0; i<count;i++){
-    outbuf[i]= inbuf[i]*127;
-  }
+  _tx_started = true;
 }
 
 int hackrf_sink_c::work( int noutput_items,
@@ -423,53 +318,31 @@ int hackrf_sink_c::work( int noutput_items,
 {
   const gr_complex *in = (const gr_complex *) input_items[0];
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
-
-    while ( ! cb_has_room(&_cbuf) )
-      _buf_cond.wait( lock );
-  }
+  if ( ! _ring.wait_room() ) /* block until the callback freed a buffer */
+    return WORK_DONE;
 
-  int8_t *buf = _buf + _buf_used;
-  unsigned int prev_buf_used = _buf_used;
+  int8_t *buf = (int8_t *)_ring.write_head() + _buf_used;
 
-  unsigned int remaining = (BUF_LEN-_buf_used)/2; //complex
+  unsigned int remaining = (BUF_LEN - _buf_used) / BYTES_PER_SAMPLE;
+  unsigned int count = std::min((unsigned int)noutput_items, remaining);
 
-  unsigned int count = std::min((unsigned int)noutput_items,remaining);
-  unsigned int sse_rem = count/8; // 8 complex = 16f==512bit for avx
-  unsigned int nosse_rem = count%8; // remainder
+  /* convert straight into the ring buffer the callback will hand to
+   * the transfer, no intermediate staging buffer involved */
+  osmosdr::convert::fc32_s8((const float *)in, buf, count * 2);
 
-#ifdef USE_AVX
-  convert_avx((float*)in, buf, sse_rem);
-  convert_default((float*)(in+sse_rem*8), buf+(sse_rem*8*2), nosse_rem*2);
-#elif USE_SSE2
-  convert_sse2((float*)in, buf, sse_rem);
-  convert_default((float*)(in+sse_rem*8), buf+(sse_rem*8*2), nosse_rem*2);
-#else
-  convert_default((float*)in, buf, count*2);
-#endif
+  _buf_used += count * BYTES_PER_SAMPLE;
 
-  _buf_used += (sse_rem*8+nosse_rem)*2;
-  int items_consumed = sse_rem*8+nosse_rem;
+  if (BUF_LEN == _buf_used) {
+    _ring.commit( BUF_LEN );
+    _buf_used = 0;
 
-  if((unsigned int)noutput_items >= remaining) {
-    {
-      boost::mutex::scoped_lock lock( _buf_mutex );
-
-      if ( ! cb_push_back( &_cbuf, _buf ) ) {
-        _buf_used = prev_buf_used;
-        items_consumed = 0;
-        std::cerr << "O" << std::flush;
-      } else {
-//        std::cerr << "+" << std::flush;
-        _buf_used = 0;
-      }
-    }
+    if ( ! _tx_started && _ring.used() >= _prefill )
+      tx_start(); /* the ring is primed, let the transfers rip */
   }
 
   // Tell runtime system how many input items we consumed on
   // each input stream.
-  consume_each(items_consumed);
+  consume_each(count);
 
   // Tell runtime system how many output items we produced.
   return 0;
@@ -556,7 +429,7 @@ size_t hackrf_sink_c::get_num_channels()
   return 1;
 }
 
-osmosdr::meta_range_t hackrf_sink_c::get_sample_rates()
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -573,6 +446,14 @@ osmosdr::meta_range_t hackrf_sink_c::get_sample_rates()
   return range;
 }
 
+osmosdr::meta_range_t hackrf_sink_c::get_sample_rates()
+{
+  /* built once - UIs poll this during interactive tuning */
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 double hackrf_sink_c::set_sample_rate( double rate )
 {
   int ret;
@@ -659,12 +540,15 @@ osmosdr::gain_range_t hackrf_sink_c::get_gain_range( size_t chan )
 
 osmosdr::gain_range_t hackrf_sink_c::get_gain_range( const std::string & name, size_t chan )
 {
+  static const osmosdr::gain_range_t rf_range( 0, 14, 14 );
+  static const osmosdr::gain_range_t if_range( 0, 47, 1 );
+
   if ( "RF" == name ) {
-    return osmosdr::gain_range_t( 0, 14, 14 );
+    return rf_range;
   }
 
   if ( "IF" == name ) {
-    return osmosdr::gain_range_t( 0, 47, 1 );
+    return if_range;
   }
 
   return osmosdr::gain_range_t();
@@ -803,7 +687,7 @@ double hackrf_sink_c::get_bandwidth( size_t chan )
   return _bandwidth;
 }
 
-osmosdr::freq_range_t hackrf_sink_c::get_bandwidth_range( size_t chan )
+static osmosdr::freq_range_t make_bandwidth_range()
 {
   osmosdr::freq_range_t bandwidths;
 
@@ -828,3 +712,16 @@ osmosdr::freq_range_t hackrf_sink_c::get_bandwidth_range( size_t chan )
 
   return bandwidths;
 }
+
+osmosdr::freq_range_t hackrf_sink_c::get_bandwidth_range( size_t chan )
+{
+  static const osmosdr::freq_range_t bandwidths = make_bandwidth_range();
+
+  return bandwidths;
+}
+
+osmosdr::stream_stats_t hackrf_sink_c::get_stream_stats( size_t chan )
+{
+  /* underruns in the TX callback are recorded as drops in the ring */
+  return _ring.stats( BYTES_PER_SAMPLE );
+}
@@ -24,25 +24,14 @@
 #include <gnuradio/sync_block.h>
 
 #include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
 #include <libhackrf/hackrf.h>
 
+#include "buffer_ring.h"
 #include "sink_iface.h"
 
 class hackrf_sink_c;
 
-typedef struct circular_buffer
-{
-  void *buffer;     // data buffer
-  void *buffer_end; // end of data buffer
-  size_t capacity;  // maximum number of items in the buffer
-  size_t count;     // number of items in the buffer
-  size_t sz;        // size of each item in the buffer
-  void *head;       // pointer to head
-  void *tail;       // pointer to tail
-} circular_buffer_t;
-
 /*
  * We use boost::shared_ptr's instead of raw pointers for all access
  * to gr::blocks (and many other data structures).  The shared_ptr gets
@@ -121,11 +110,14 @@ public:
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
   static int _hackrf_tx_callback(hackrf_transfer* transfer);
   int hackrf_tx_callback(unsigned char *buffer, uint32_t length);
   static void _hackrf_wait(hackrf_sink_c *obj);
   void hackrf_wait();
+  void tx_start();
 
   static int _usage;
   static boost::mutex _usage_mutex;
@@ -133,12 +125,11 @@ private:
   hackrf_device *_dev;
 //  gr::thread::thread _thread;
 
-  circular_buffer_t _cbuf;
-  int8_t *_buf;
+  osmosdr::buffer_ring _ring;
   unsigned int _buf_num;
   unsigned int _buf_used;
-  boost::mutex _buf_mutex;
-  boost::condition_variable _buf_cond;
+  unsigned int _prefill;
+  bool _tx_started;
 
   double _sample_rate;
   double _center_freq;
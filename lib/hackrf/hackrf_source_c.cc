@@ -31,6 +31,7 @@
 #include <iostream>
 
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/detail/endian.hpp>
 #include <boost/algorithm/string.hpp>
@@ -38,9 +39,15 @@
 
 #include <gnuradio/io_signature.h>
 
+#include <osmosdr/source.h>
+
 #include "hackrf_source_c.h"
 
 #include "arg_helpers.h"
+#include "buffer_pool.h"
+#include "convert/convert.h"
+#include "handle_cache.h"
+#include "trace.h"
 
 using namespace boost::assign;
 
@@ -49,6 +56,13 @@ using namespace boost::assign;
 
 #define BYTES_PER_SAMPLE  2 /* HackRF device produces 8 bit unsigned IQ data */
 
+/* the firmware sweep engine delivers fixed size blocks, each starting with
+ * a ten byte header: 0x7f 0x7f magic plus the tuning frequency in Hz as a
+ * little endian uint64_t, followed by the samples taken at that frequency */
+#define BYTES_PER_SWEEP_BLOCK  16384
+#define SWEEP_HEADER_LEN       10
+#define SWEEP_PAYLOAD_LEN      (BYTES_PER_SWEEP_BLOCK - SWEEP_HEADER_LEN)
+
 #define HACKRF_FORMAT_ERROR(ret, msg) \
   boost::str( boost::format(msg " (%1%) %2%") \
     % ret % hackrf_error_name((enum hackrf_error)ret) )
@@ -65,6 +79,45 @@ using namespace boost::assign;
 int hackrf_source_c::_usage = 0;
 boost::mutex hackrf_source_c::_usage_mutex;
 
+#ifdef LIBHACKRF_HAVE_SWEEP
+/* parse "start:stop" ranges in MHz, several of them joined with '+'
+ * (e.g. sweep=2400:2500+5725:5875), into the start/stop pair list
+ * expected by hackrf_init_sweep(). returns the number of ranges. */
+static int parse_sweep_ranges( const std::string &spec, uint16_t *freqs )
+{
+  std::vector< std::string > ranges;
+  boost::algorithm::split( ranges, spec, boost::is_any_of( "+" ) );
+
+  if ( ranges.size() > MAX_SWEEP_RANGES )
+    throw std::runtime_error(
+          "Too many sweep ranges given, libhackrf supports up to " +
+          boost::lexical_cast< std::string >( MAX_SWEEP_RANGES ) );
+
+  for ( size_t i = 0; i < ranges.size(); i++ )
+  {
+    size_t colon = ranges[i].find( ':' );
+
+    if ( colon == std::string::npos )
+      throw std::runtime_error(
+            "Malformed sweep range '" + ranges[i] + "', expected <start>:<stop> in MHz" );
+
+    try {
+      freqs[i * 2] = boost::lexical_cast< uint16_t >( ranges[i].substr( 0, colon ) );
+      freqs[i * 2 + 1] = boost::lexical_cast< uint16_t >( ranges[i].substr( colon + 1 ) );
+    } catch ( std::exception &ex ) {
+      throw std::runtime_error(
+            "Malformed sweep range '" + ranges[i] + "': " + ex.what() );
+    }
+
+    if ( freqs[i * 2 + 1] <= freqs[i * 2] )
+      throw std::runtime_error(
+            "Sweep range '" + ranges[i] + "' is empty, stop must be above start" );
+  }
+
+  return int(ranges.size());
+}
+#endif
+
 hackrf_source_c_sptr make_hackrf_source_c (const std::string & args)
 {
   return gnuradio::get_initial_sptr(new hackrf_source_c (args));
@@ -92,7 +145,9 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
         gr::io_signature::make(MIN_IN, MAX_IN, sizeof (gr_complex)),
         gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof (gr_complex))),
     _dev(NULL),
-    _buf(NULL),
+    _zero_copy(false),
+    _prio_applied(false),
+    _sweep_mode(false),
     _sample_rate(0),
     _center_freq(0),
     _freq_corr(0),
@@ -104,10 +159,14 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
 {
   int ret;
   std::string hackrf_serial;
+#ifdef LIBHACKRF_HAVE_SWEEP
+  uint16_t sweep_freqs[MAX_SWEEP_RANGES * 2];
+  int sweep_ranges = 0;
+#endif
 
   dict_t dict = params_to_dict(args);
 
-  _buf_num = _buf_len = _buf_head = _buf_used = _buf_offset = 0;
+  _buf_num = _buf_len = _buf_offset = 0;
 
   if (dict.count("buffers"))
     _buf_num = boost::lexical_cast< unsigned int >( dict["buffers"] );
@@ -121,19 +180,46 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
   if (0 == _buf_len || _buf_len % 512 != 0) /* len must be multiple of 512 */
     _buf_len = BUF_LEN;
 
-  _samp_avail = _buf_len / BYTES_PER_SAMPLE;
-
-  // create a lookup table for gr_complex values
-  for (unsigned int i = 0; i <= 0xffff; i++) {
-#ifdef BOOST_LITTLE_ENDIAN
-    _lut.push_back( gr_complex( (float(int8_t(i & 0xff))) * (1.0f/128.0f),
-                                (float(int8_t(i >> 8))) * (1.0f/128.0f) ) );
-#else // BOOST_BIG_ENDIAN
-    _lut.push_back( gr_complex( (float(int8_t(i >> 8))) * (1.0f/128.0f),
-                                (float(int8_t(i & 0xff))) * (1.0f/128.0f) ) );
+  if (dict.count("zerocopy"))
+    _zero_copy = boost::lexical_cast<bool>( dict["zerocopy"] );
+
+  _prio.parse(dict);
+  if (_prio.numa_node() >= 0)
+    osmosdr::buffer_pool::instance().set_numa_node(_prio.numa_node());
+  _ring.parse_overflow_policy(dict);
+  _ring.parse_watermark(dict);
+  _recorder.parse(dict);
+  _decim.parse(dict);
+
+  if (dict.count("sweep") && dict["sweep"].length() > 0) {
+    if (_decim.active()) /* segments are retuned blocks, not a stream */
+      throw std::runtime_error("decim is not supported in sweep mode");
+#ifdef LIBHACKRF_HAVE_SWEEP
+    sweep_ranges = parse_sweep_ranges( dict["sweep"], sweep_freqs );
+    _sweep_mode = true;
+    _zero_copy = false; /* sweep blocks carry headers, convert in work() */
+#else
+    throw std::runtime_error(
+          "Sweep mode requires a libhackrf with hackrf_init_sweep support" );
 #endif
   }
 
+  _samp_avail = _buf_len / BYTES_PER_SAMPLE;
+
+  if ( osmosdr::handle_cache::wanted(dict) )
+    _cache_key = "hackrf_source," + args;
+
+  _dev = NULL;
+
+  if ( _cache_key.length() )
+    _dev = (hackrf_device *)
+        osmosdr::handle_cache::instance().acquire( _cache_key );
+
+  if ( _dev ) {
+    /* the parked handle kept its _usage count, see the destructor */
+    std::cerr << "Reattached to cached HackRF handle." << std::endl;
+  } else {
+
   {
     boost::mutex::scoped_lock lock( _usage_mutex );
 
@@ -143,8 +229,6 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
     _usage++;
   }
 
-  _dev = NULL;
-  
 #ifdef LIBHACKRF_HAVE_DEVICE_LIST
   if (dict.count("hackrf") && dict["hackrf"].length() > 0) {
     hackrf_serial = dict["hackrf"];
@@ -173,9 +257,11 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
   } else
 #endif
     ret = hackrf_open( &_dev );
-    
+
   HACKRF_THROW_ON_ERROR(ret, "Failed to open HackRF device")
 
+  } /* cache miss */
+
   uint8_t board_id;
   ret = hackrf_board_id_read( _dev, &board_id );
   HACKRF_THROW_ON_ERROR(ret, "Failed to get HackRF board id")
@@ -223,17 +309,36 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
     }
   }
 
-  _buf = (unsigned short **) malloc(_buf_num * sizeof(unsigned short *));
-
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i)
-      _buf[i] = (unsigned short *) malloc(_buf_len);
-  }
+  if (_sweep_mode) /* one ring buffer per sweep segment */
+    _ring.resize(_buf_num * (_buf_len / BYTES_PER_SWEEP_BLOCK), SWEEP_PAYLOAD_LEN);
+  else if (_zero_copy) /* ring carries converted gr_complex samples */
+    _ring.resize(_buf_num, (_buf_len / BYTES_PER_SAMPLE) * sizeof(gr_complex));
+  else
+    _ring.resize(_buf_num, _buf_len);
 
 //  _thread = gr::thread::thread(_hackrf_wait, this);
 
-  ret = hackrf_start_rx( _dev, _hackrf_rx_callback, (void *)this );
-  HACKRF_THROW_ON_ERROR(ret, "Failed to start RX streaming")
+#ifdef LIBHACKRF_HAVE_SWEEP
+  if (_sweep_mode) {
+    _samp_avail = SWEEP_PAYLOAD_LEN / BYTES_PER_SAMPLE;
+
+    /* retune in steps of one sample rate so consecutive segments tile the
+     * requested ranges without gaps */
+    ret = hackrf_init_sweep( _dev, sweep_freqs, sweep_ranges,
+                             BYTES_PER_SWEEP_BLOCK, uint32_t(_sample_rate),
+                             0, LINEAR );
+    HACKRF_THROW_ON_ERROR(ret, "Failed to configure sweep")
+
+    ret = hackrf_start_rx_sweep( _dev, _hackrf_rx_callback, (void *)this );
+    HACKRF_THROW_ON_ERROR(ret, "Failed to start sweep RX streaming")
+  } else
+#endif
+  {
+    _tagger.start(_sample_rate / _decim.decim());
+
+    ret = hackrf_start_rx( _dev, _hackrf_rx_callback, (void *)this );
+    HACKRF_THROW_ON_ERROR(ret, "Failed to start RX streaming")
+  }
 }
 
 /*
@@ -241,6 +346,8 @@ hackrf_source_c::hackrf_source_c (const std::string &args)
  */
 hackrf_source_c::~hackrf_source_c ()
 {
+  _ring.shutdown(); /* unblock a scheduler thread stuck in work() */
+
   if (_dev) {
 //    _thread.join();
     int ret = hackrf_stop_rx( _dev );
@@ -248,6 +355,15 @@ hackrf_source_c::~hackrf_source_c ()
     {
       std::cerr << HACKRF_FORMAT_ERROR(ret, "Failed to stop RX streaming") << std::endl;
     }
+    if ( _cache_key.length() ) {
+      /* park the open handle for the next instance instead of closing;
+       * it keeps holding one _usage count so libhackrf stays alive */
+      osmosdr::handle_cache::instance().park( _cache_key, _dev,
+                                              _cache_close );
+      _dev = NULL;
+      return;
+    }
+
     ret = hackrf_close( _dev );
     if ( ret != HACKRF_SUCCESS )
     {
@@ -264,14 +380,19 @@ hackrf_source_c::~hackrf_source_c ()
         hackrf_exit(); /* call only once after last close */
     }
   }
+}
 
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i) {
-      free(_buf[i]);
-    }
+void hackrf_source_c::_cache_close( void *dev )
+{
+  hackrf_close( (hackrf_device *)dev );
 
-    free(_buf);
-    _buf = NULL;
+  {
+    boost::mutex::scoped_lock lock( _usage_mutex );
+
+     _usage--;
+
+    if ( _usage == 0 )
+      hackrf_exit(); /* call only once after last close */
   }
 }
 
@@ -283,25 +404,96 @@ int hackrf_source_c::_hackrf_rx_callback(hackrf_transfer *transfer)
 
 int hackrf_source_c::hackrf_rx_callback(unsigned char *buf, uint32_t len)
 {
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+  OSMOSDR_TRACE1(hackrf_transfer, len);
 
-    int buf_tail = (_buf_head + _buf_used) % _buf_num;
-    memcpy(_buf[buf_tail], buf, len);
+  if (!_prio_applied) {
+    _prio.apply();
+    _prio_applied = true;
+  }
 
-    if (_buf_used == _buf_num) {
-      std::cerr << "O" << std::flush;
-      _buf_head = (_buf_head + 1) % _buf_num;
-    } else {
-      _buf_used++;
+  /* log the exact bytes the hardware delivered, before any conversion */
+  _recorder.record(buf, len);
+
+  if (_sweep_mode) {
+    return sweep_rx_callback(buf, len);
+  } else if (_zero_copy) {
+    /* libhackrf recycles the transfer buffer as soon as we return, so
+     * instead of retaining it we convert straight out of it into the
+     * ring slot - each received byte is then read exactly once */
+    gr_complex *conv = (gr_complex *)_ring.write_head();
+
+    if (!conv) {
+      if (_ring.overflow((len / BYTES_PER_SAMPLE) * sizeof(gr_complex)))
+        conv = (gr_complex *)_ring.write_head();
+
+      if (!conv) {
+        _tagger.discontinuity();
+        std::cerr << "O" << std::flush;
+        return 0;
+      }
     }
-  }
 
-  _buf_cond.notify_one();
+    const uint32_t samples = len / BYTES_PER_SAMPLE;
+
+    osmosdr::convert::s8_fc32((const signed char *)buf, (float *)conv,
+                              samples * 2);
+
+    _ring.commit(samples * sizeof(gr_complex));
+  } else if (!_ring.write(buf, len)) {
+    _tagger.discontinuity();
+    std::cerr << "O" << std::flush;
+  }
 
   return 0; // TODO: return -1 on error/stop
 }
 
+int hackrf_source_c::sweep_rx_callback(unsigned char *buf, uint32_t len)
+{
+  /* a sweep transfer is a sequence of fixed size blocks, each taken at a
+   * different tuning frequency. every block gets a ring buffer of its own
+   * so the consumer can recover the segment boundaries. */
+  for (uint32_t pos = 0; pos + BYTES_PER_SWEEP_BLOCK <= len;
+       pos += BYTES_PER_SWEEP_BLOCK) {
+    unsigned char *block = buf + pos;
+
+    if (block[0] != 0x7f || block[1] != 0x7f) /* lost block sync, resync */
+      continue;
+
+    uint64_t freq = 0;
+    for (int i = 0; i < 8; i++)
+      freq |= uint64_t(block[2 + i]) << (8 * i);
+
+    unsigned char *slot = _ring.write_head();
+
+    if (!slot) {
+      /* shedding backlog here would desynchronize the ring from the
+       * queued segment frequencies, so only block-producer applies */
+      if (osmosdr::buffer_ring::OVERFLOW_BLOCK == _ring.overflow_policy() &&
+          _ring.wait_room())
+        slot = _ring.write_head();
+
+      if (!slot) {
+        _ring.count_drop(SWEEP_PAYLOAD_LEN);
+        std::cerr << "O" << std::flush;
+        continue;
+      }
+    }
+
+    memcpy(slot, block + SWEEP_HEADER_LEN, SWEEP_PAYLOAD_LEN);
+
+    {
+      /* queue the frequency before commit() so a buffer visible to the
+       * consumer always has its tag value available */
+      boost::mutex::scoped_lock lock( _sweep_mutex );
+      _sweep_freqs.push_back( freq );
+    }
+
+    _ring.commit(SWEEP_PAYLOAD_LEN);
+  }
+
+  return 0;
+}
+
 void hackrf_source_c::_hackrf_wait(hackrf_source_c *obj)
 {
   obj->hackrf_wait();
@@ -343,6 +535,8 @@ int hackrf_source_c::work( int noutput_items,
                         gr_vector_const_void_star &input_items,
                         gr_vector_void_star &output_items )
 {
+  OSMOSDR_TRACE1(work_entry, noutput_items);
+
   gr_complex *out = (gr_complex *)output_items[0];
 
   bool running = false;
@@ -350,49 +544,179 @@ int hackrf_source_c::work( int noutput_items,
   if ( _dev )
     running = (hackrf_is_streaming( _dev ) == HACKRF_TRUE);
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
-
-    while (_buf_used < 3 && running) // collect at least 3 buffers
-      _buf_cond.wait( lock );
-  }
+  if ( running ) /* sweep segments are tagged one by one, no batching */
+    running = _ring.wait(_sweep_mode ? 1 : _ring.watermark(3));
 
   if ( ! running )
     return WORK_DONE;
 
-  unsigned short *buf = _buf[_buf_head] + _buf_offset;
+  if (_sweep_mode)
+    return work_sweep( noutput_items, output_items );
+
+  if (_decim.active())
+    return work_decim( noutput_items, output_items );
+
+  if (_ring.overflow_pending() && 0 == _buf_offset) {
+    /* drop-oldest: shed the stale half of the backlog at a buffer
+     * boundary, where no partially consumed data is tracked */
+    _ring.discard_backlog(_ring.capacity() / 2);
+    _samp_avail = _ring.head_len() /
+        (_zero_copy ? sizeof(gr_complex) : BYTES_PER_SAMPLE);
+    _tagger.discontinuity();
+  }
+
+  if (0 == _samp_avail) {
+    /* the previous call drained the head exactly; drop it now so the
+     * availability math below never counts an empty buffer */
+    _ring.pop();
+    _buf_offset = 0;
+
+    if (!_ring.wait(1))
+      return WORK_DONE;
+
+    _samp_avail = _ring.head_len() /
+        (_zero_copy ? sizeof(gr_complex) : BYTES_PER_SAMPLE);
+  }
+
+  /* a low watermark (watermark=1 or auto) can wake us with a single
+   * committed buffer; never unpack past the committed tail into the
+   * slot the transfer callback is still filling */
+  noutput_items = std::min(noutput_items,
+      _samp_avail + (int)(_ring.used() - 1) * (int)(_buf_len / BYTES_PER_SAMPLE));
 
   if (noutput_items <= _samp_avail) {
-    for (int i = 0; i < noutput_items; ++i)
-      *out++ = _lut[ *(buf + i) ];
+    unpack(out, _buf_offset, noutput_items);
 
     _buf_offset += noutput_items;
     _samp_avail -= noutput_items;
   } else {
-    for (int i = 0; i < _samp_avail; ++i)
-      *out++ = _lut[ *(buf + i) ];
+    unpack(out, _buf_offset, _samp_avail);
+    out += _samp_avail;
 
-    {
-      boost::mutex::scoped_lock lock( _buf_mutex );
-
-      _buf_head = (_buf_head + 1) % _buf_num;
-      _buf_used--;
-    }
-
-    buf = _buf[_buf_head];
+    _ring.pop();
 
     int remaining = noutput_items - _samp_avail;
 
-    for (int i = 0; i < remaining; ++i)
-      *out++ = _lut[ *(buf + i) ];
+    unpack(out, 0, remaining);
 
     _buf_offset = remaining;
     _samp_avail = (_buf_len / BYTES_PER_SAMPLE) - remaining;
   }
 
+  _iq_corr.process( (gr_complex *)output_items[0], noutput_items );
+  _tagger.tag_work( this, 0, noutput_items );
+
+  OSMOSDR_TRACE1(work_exit, noutput_items);
+
   return noutput_items;
 }
 
+int hackrf_source_c::work_sweep( int noutput_items,
+                                 gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+
+  int processed = 0;
+
+  while (processed < noutput_items) {
+    if (0 == _ring.used()) /* deliver what we have, don't block again */
+      break;
+
+    if (0 == _buf_offset) { /* a new sweep segment starts here */
+      uint64_t freq;
+
+      {
+        boost::mutex::scoped_lock lock( _sweep_mutex );
+        freq = _sweep_freqs.front();
+        _sweep_freqs.pop_front();
+      }
+
+      add_item_tag( 0, nitems_written(0) + processed,
+                    pmt::mp("freq"), pmt::from_double( double(freq) ) );
+    }
+
+    int count = std::min(noutput_items - processed, _samp_avail);
+
+    unpack(out + processed, _buf_offset, count);
+
+    processed += count;
+    _buf_offset += count;
+    _samp_avail -= count;
+
+    if (0 == _samp_avail) {
+      _ring.pop();
+      _buf_offset = 0;
+      _samp_avail = SWEEP_PAYLOAD_LEN / BYTES_PER_SAMPLE;
+    }
+  }
+
+  _iq_corr.process( out, processed );
+
+  return processed;
+}
+
+int hackrf_source_c::work_decim( int noutput_items,
+                                 gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+  int processed = 0;
+
+  if (_ring.overflow_pending()) {
+    /* drop-oldest: whole buffers are consumed below, so any point
+     * between them is a safe place to shed the stale backlog */
+    _ring.discard_backlog(_ring.capacity() / 2);
+    _tagger.discontinuity();
+  }
+
+  while (processed < noutput_items) {
+    if (!_pending.empty()) {
+      const int ncopy = std::min((int)_pending.size(),
+                                 noutput_items - processed);
+
+      memcpy(out + processed, &_pending[0], ncopy * sizeof(gr_complex));
+      processed += ncopy;
+
+      _pending.erase(_pending.begin(), _pending.begin() + ncopy);
+      continue;
+    }
+
+    if (!_ring.used())
+      break;
+
+    /* convert the whole head buffer in one go, then run it through the
+     * half-band cascade while it is still cache-hot */
+    const int samp_avail = _ring.head_len() /
+        (_zero_copy ? sizeof(gr_complex) : BYTES_PER_SAMPLE);
+
+    _conv_buf.resize(samp_avail);
+
+    unpack(&_conv_buf[0], 0, samp_avail);
+
+    _ring.pop();
+
+    int n = _decim.process(&_conv_buf[0], samp_avail, &_conv_buf[0]);
+
+    _pending.insert(_pending.end(), _conv_buf.begin(), _conv_buf.begin() + n);
+  }
+
+  _iq_corr.process( out, processed );
+  _tagger.tag_work( this, 0, processed );
+
+  return processed;
+}
+
+void hackrf_source_c::unpack(gr_complex *out, unsigned int offset, int count)
+{
+  if (_zero_copy) { /* samples arrive converted, plain streaming copy */
+    memcpy(out, (const gr_complex *)_ring.head() + offset,
+           count * sizeof(gr_complex));
+  } else {
+    const signed char *buf = (const signed char *)_ring.head() + offset * 2;
+
+    osmosdr::convert::s8_fc32(buf, (float *)out, count * 2);
+  }
+}
+
 std::vector<std::string> hackrf_source_c::get_devices()
 {
   std::vector<std::string> devices;
@@ -474,7 +798,7 @@ size_t hackrf_source_c::get_num_channels()
   return 1;
 }
 
-osmosdr::meta_range_t hackrf_source_c::get_sample_rates()
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -491,6 +815,14 @@ osmosdr::meta_range_t hackrf_source_c::get_sample_rates()
   return range;
 }
 
+osmosdr::meta_range_t hackrf_source_c::get_sample_rates()
+{
+  /* built once - UIs poll this during interactive tuning */
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 double hackrf_source_c::set_sample_rate( double rate )
 {
   int ret;
@@ -499,6 +831,7 @@ double hackrf_source_c::set_sample_rate( double rate )
     ret = hackrf_set_sample_rate( _dev, rate );
     if ( HACKRF_SUCCESS == ret ) {
       _sample_rate = rate;
+      _tagger.set_rate( rate / _decim.decim() );
       //set_bandwidth( 0.0 ); /* bandwidth of 0 means automatic filter selection */
     } else {
       HACKRF_THROW_ON_ERROR( ret, HACKRF_FUNC_STR( "hackrf_set_sample_rate", rate ) )
@@ -510,7 +843,7 @@ double hackrf_source_c::set_sample_rate( double rate )
 
 double hackrf_source_c::get_sample_rate()
 {
-  return _sample_rate;
+  return _sample_rate / _decim.decim();
 }
 
 osmosdr::freq_range_t hackrf_source_c::get_freq_range( size_t chan )
@@ -528,6 +861,9 @@ double hackrf_source_c::set_center_freq( double freq, size_t chan )
 
   #define APPLY_PPM_CORR(val, ppm) ((val) * (1.0 + (ppm) * 0.000001))
 
+  if (_sweep_mode) /* the firmware owns the tuner, see the "freq" tags */
+    return get_center_freq( chan );
+
   if (_dev) {
     double corr_freq = APPLY_PPM_CORR( freq, _freq_corr );
     ret = hackrf_set_freq( _dev, uint64_t(corr_freq) );
@@ -578,16 +914,20 @@ osmosdr::gain_range_t hackrf_source_c::get_gain_range( size_t chan )
 
 osmosdr::gain_range_t hackrf_source_c::get_gain_range( const std::string & name, size_t chan )
 {
+  static const osmosdr::gain_range_t rf_range( 0, 14, 14 );
+  static const osmosdr::gain_range_t if_range( 0, 40, 8 );
+  static const osmosdr::gain_range_t bb_range( 0, 62, 2 );
+
   if ( "RF" == name ) {
-    return osmosdr::gain_range_t( 0, 14, 14 );
+    return rf_range;
   }
 
   if ( "IF" == name ) {
-    return osmosdr::gain_range_t( 0, 40, 8 );
+    return if_range;
   }
 
   if ( "BB" == name ) {
-    return osmosdr::gain_range_t( 0, 62, 2 );
+    return bb_range;
   }
 
   return osmosdr::gain_range_t();
@@ -721,6 +1061,34 @@ std::string hackrf_source_c::get_antenna( size_t chan )
   return "TX/RX";
 }
 
+/* the hardware has no correction stages, apply them in software on the
+ * converted samples (see osmosdr::iq_correction) */
+
+void hackrf_source_c::set_dc_offset_mode( int mode, size_t chan )
+{
+  _iq_corr.set_dc_auto( osmosdr::source::DCOffsetAutomatic == mode );
+
+  if ( osmosdr::source::DCOffsetOff == mode )
+    _iq_corr.set_dc_offset( std::complex<float>(0.0f, 0.0f) );
+}
+
+void hackrf_source_c::set_dc_offset( const std::complex<double> &offset, size_t chan )
+{
+  _iq_corr.set_dc_offset( std::complex<float>( offset.real(), offset.imag() ) );
+}
+
+void hackrf_source_c::set_iq_balance_mode( int mode, size_t chan )
+{
+  if ( osmosdr::source::IQBalanceOff == mode )
+    _iq_corr.set_mag_phase( 0.0f, 0.0f );
+}
+
+void hackrf_source_c::set_iq_balance( const std::complex<double> &balance, size_t chan )
+{
+  /* fix_cc conventions: real part is mag, imaginary part is phase */
+  _iq_corr.set_mag_phase( balance.real(), balance.imag() );
+}
+
 double hackrf_source_c::set_bandwidth( double bandwidth, size_t chan )
 {
   int ret;
@@ -748,7 +1116,7 @@ double hackrf_source_c::get_bandwidth( size_t chan )
   return _bandwidth;
 }
 
-osmosdr::freq_range_t hackrf_source_c::get_bandwidth_range( size_t chan )
+static osmosdr::freq_range_t make_bandwidth_range()
 {
   osmosdr::freq_range_t bandwidths;
 
@@ -773,3 +1141,42 @@ osmosdr::freq_range_t hackrf_source_c::get_bandwidth_range( size_t chan )
 
   return bandwidths;
 }
+
+osmosdr::freq_range_t hackrf_source_c::get_bandwidth_range( size_t chan )
+{
+  static const osmosdr::freq_range_t bandwidths = make_bandwidth_range();
+
+  return bandwidths;
+}
+
+osmosdr::stream_stats_t hackrf_source_c::get_stream_stats( size_t chan )
+{
+  /* in zero copy mode the ring holds converted complex samples */
+  return _ring.stats( _zero_copy ? sizeof(gr_complex) : BYTES_PER_SAMPLE );
+}
+
+void hackrf_source_c::scan_tune( double freq )
+{
+  hackrf_set_freq( _dev, uint64_t( APPLY_PPM_CORR( freq, _freq_corr ) ) );
+
+  _center_freq = freq;
+  _tagger.retune( freq );
+}
+
+bool hackrf_source_c::set_scan_plan( const std::vector<double> &freqs,
+                                     double dwell, size_t chan )
+{
+  if ( ! _dev )
+    return false;
+
+  if ( _sweep_mode ) /* the firmware owns the tuner, see the "freq" tags */
+    return false;
+
+  return _scanner.start( freqs, dwell,
+      boost::bind( &hackrf_source_c::scan_tune, this, _1 ) );
+}
+
+void hackrf_source_c::clear_scan_plan( size_t chan )
+{
+  _scanner.stop();
+}
@@ -26,11 +26,19 @@
 #include <gnuradio/sync_block.h>
 
 #include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
 
 #include <libhackrf/hackrf.h>
 
+#include "buffer_ring.h"
+#include "callback_capture.h"
+#include "freq_scanner.h"
+#include "halfband_decim.h"
+#include "iq_correction.h"
 #include "source_iface.h"
+#include "stream_tagger.h"
+#include "thread_prio.h"
 
 class hackrf_source_c;
 
@@ -58,6 +66,12 @@ hackrf_source_c_sptr make_hackrf_source_c (const std::string & args = "");
 
 /*!
  * \brief Provides a stream of complex samples.
+ *
+ * With sweep=<start>:<stop> (MHz, several ranges joined with '+') the
+ * firmware sweep engine is used instead of fixed-frequency streaming:
+ * the device retunes itself through the given ranges in steps of one
+ * sample rate and every sweep segment is marked with a "freq" stream
+ * tag carrying the tuning frequency of the following samples.
  * \ingroup block
  */
 class hackrf_source_c :
@@ -116,34 +130,65 @@ public:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  void set_dc_offset_mode( int mode, size_t chan = 0 );
+  void set_dc_offset( const std::complex<double> &offset, size_t chan = 0 );
+  void set_iq_balance_mode( int mode, size_t chan = 0 );
+  void set_iq_balance( const std::complex<double> &balance, size_t chan = 0 );
+
   double set_bandwidth( double bandwidth, size_t chan = 0 );
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
+  bool set_scan_plan( const std::vector<double> &freqs,
+                      double dwell, size_t chan = 0 );
+  void clear_scan_plan( size_t chan = 0 );
+
 private:
   static int _hackrf_rx_callback(hackrf_transfer* transfer);
+  static void _cache_close(void *dev);
   int hackrf_rx_callback(unsigned char *buf, uint32_t len);
+  int sweep_rx_callback(unsigned char *buf, uint32_t len);
+  int work_sweep( int noutput_items, gr_vector_void_star &output_items );
+  int work_decim( int noutput_items, gr_vector_void_star &output_items );
+  void scan_tune( double freq );
+  void unpack(gr_complex *out, unsigned int offset, int count);
   static void _hackrf_wait(hackrf_source_c *obj);
   void hackrf_wait();
 
   static int _usage;
   static boost::mutex _usage_mutex;
 
-  std::vector<gr_complex> _lut;
 
   hackrf_device *_dev;
   gr::thread::thread _thread;
-  unsigned short **_buf;
+  osmosdr::buffer_ring _ring;
+
+  osmosdr::callback_recorder _recorder;
+  osmosdr::iq_correction _iq_corr;
+  osmosdr::stream_tagger _tagger;
+  osmosdr::freq_scanner _scanner;
+  osmosdr::halfband_decimator _decim;
+  std::vector<gr_complex> _conv_buf;
+  std::vector<gr_complex> _pending;
   unsigned int _buf_num;
   unsigned int _buf_len;
-  unsigned int _buf_head;
-  unsigned int _buf_used;
-  boost::mutex _buf_mutex;
-  boost::condition_variable _buf_cond;
+  bool _zero_copy;
 
   unsigned int _buf_offset;
   int _samp_avail;
 
+  /* the USB thread belongs to libhackrf, so the scheduling setup is
+   * applied from the first callback it delivers */
+  osmosdr::thread_prio _prio;
+  bool _prio_applied;
+
+  bool _sweep_mode;
+  /* tuning frequency of each committed ring buffer, oldest first */
+  std::deque<uint64_t> _sweep_freqs;
+  boost::mutex _sweep_mutex;
+
   double _sample_rate;
   double _center_freq;
   double _freq_corr;
@@ -152,6 +197,9 @@ private:
   double _lna_gain;
   double _vga_gain;
   double _bandwidth;
+
+  /* non-empty when this instance parks its handle on destruction */
+  std::string _cache_key;
 };
 
 #endif /* INCLUDED_HACKRF_SOURCE_C_H */
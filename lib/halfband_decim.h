@@ -0,0 +1,265 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_HALFBAND_DECIM_H
+#define OSMOSDR_HALFBAND_DECIM_H
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include <gnuradio/gr_complex.h>
+
+#ifdef HAVE_VOLK
+#include <volk/volk.h>
+#endif
+
+namespace osmosdr {
+
+#define KERNEL_16_110_LEN   7
+const float KERNEL_16_110[] =
+{
+    -0.031835079193115234f,
+     0.000000000000000000f,
+     0.281831502914428710f,
+     0.500007271766662600f,
+     0.281831502914428710f,
+     0.000000000000000000f,
+    -0.031835079193115234f
+};
+
+#define KERNEL_8_100_LEN    11
+const float KERNEL_8_100[] =
+{
+     0.006633400917053223f,
+     0.000000000000000000f,
+    -0.051035523414611816f,
+     0.000000000000000000f,
+     0.294403314590454100f,
+     0.499997496604919430f,
+     0.294403314590454100f,
+     0.000000000000000000f,
+    -0.051035523414611816f,
+     0.000000000000000000f,
+     0.006633400917053223f
+};
+
+#define KERNEL_4_90_LEN     15
+const float KERNEL_4_90[] =
+{
+    -0.002474188804626465f,
+     0.000000000000000000f,
+     0.016965746879577637f,
+     0.000000000000000000f,
+    -0.067680597305297852f,
+     0.000000000000000000f,
+     0.303180575370788570f,
+     0.500017046928405760f,
+     0.303180575370788570f,
+     0.000000000000000000f,
+    -0.067680597305297852f,
+     0.000000000000000000f,
+     0.016965746879577637f,
+     0.000000000000000000f,
+    -0.002474188804626465f
+};
+
+#define KERNEL_2_80_LEN     47
+const float KERNEL_2_80[KERNEL_2_80_LEN] =
+{
+    -0.000198006629943848f,
+     0.000000000000000000f,
+     0.000576853752136230f,
+     0.000000000000000000f,
+    -0.001352190971374512f,
+     0.000000000000000000f,
+     0.002729177474975586f,
+     0.000000000000000000f,
+    -0.004988193511962891f,
+     0.000000000000000000f,
+     0.008499503135681152f,
+     0.000000000000000000f,
+    -0.013788580894470215f,
+     0.000000000000000000f,
+     0.021713137626647949f,
+     0.000000000000000000f,
+    -0.033980011940002441f,
+     0.000000000000000000f,
+     0.054944872856140137f,
+     0.000000000000000000f,
+    -0.100657463073730470f,
+     0.000000000000000000f,
+     0.316457390785217290f,
+     0.500000000000000000f,
+     0.316457390785217290f,
+     0.000000000000000000f,
+    -0.100657463073730470f,
+     0.000000000000000000f,
+     0.054944872856140137f,
+     0.000000000000000000f,
+    -0.033980011940002441f,
+     0.000000000000000000f,
+     0.021713137626647949f,
+     0.000000000000000000f,
+    -0.013788580894470215f,
+     0.000000000000000000f,
+     0.008499503135681152f,
+     0.000000000000000000f,
+    -0.004988193511962891f,
+     0.000000000000000000f,
+     0.002729177474975586f,
+     0.000000000000000000f,
+    -0.001352190971374512f,
+     0.000000000000000000f,
+     0.000576853752136230f,
+     0.000000000000000000f,
+    -0.000198006629943848f
+};
+
+/*
+ * Streaming half-band decimate-by-2 stage for complex float samples.
+ *
+ * Arbitrary chunk sizes may be fed in; filter history (and an odd
+ * trailing sample, if any) is carried across calls. The dot products
+ * run through VOLK when available, which dispatches to the widest
+ * kernel the running CPU supports, and fall back to a scalar loop
+ * otherwise. The output may alias the input.
+ */
+class halfband_decim_stage
+{
+public:
+    halfband_decim_stage(const float *taps, int len) :
+        _taps(taps, taps + len)
+    {
+    }
+
+    /* feed nin samples, out must hold (pending + nin) / 2 samples
+     * \return the number of samples placed in out */
+    int process(const gr_complex *in, int nin, gr_complex *out)
+    {
+        const int ntaps = _taps.size();
+
+        _buf.insert(_buf.end(), in, in + nin);
+
+        int navail = (int)_buf.size() - (ntaps - 1);
+        int nout = navail > 0 ? navail / 2 : 0;
+
+        for (int k = 0; k < nout; k++) {
+#ifdef HAVE_VOLK
+            volk_32fc_32f_dot_prod_32fc((lv_32fc_t *)&out[k],
+                                        (const lv_32fc_t *)&_buf[k * 2],
+                                        &_taps[0], ntaps);
+#else
+            gr_complex acc = 0;
+            for (int t = 0; t < ntaps; t++)
+                acc += _buf[k * 2 + t] * _taps[t];
+            out[k] = acc;
+#endif
+        }
+
+        _buf.erase(_buf.begin(), _buf.begin() + nout * 2);
+
+        return nout;
+    }
+
+private:
+    std::vector<float> _taps;
+    std::vector<gr_complex> _buf;
+};
+
+/*!
+ * Cascade of half-band stages for power-of-two software decimation.
+ *
+ * Shared by the backends offering a decim=<N> device argument: the
+ * decimation runs in the backend's work() right after the sample
+ * format conversion, while the data is still cache-hot, instead of
+ * pushing the full-rate stream through the scheduler into a GR
+ * decimator.
+ */
+class halfband_decimator
+{
+public:
+    halfband_decimator() : _decim(1) {}
+
+    /*! Configure from the decim=<N> device argument, e.g. decim=4 to
+     * get 2.5 Msps out of a device running at 10 Msps. Throws when N
+     * is not a power of two. */
+    void parse(const std::map<std::string, std::string> &dict)
+    {
+        std::map<std::string, std::string>::const_iterator it =
+            dict.find("decim");
+
+        if (it == dict.end())
+            return;
+
+        _decim = boost::lexical_cast<unsigned int>(it->second);
+
+        if (0 == _decim || (_decim & (_decim - 1)))
+            throw std::runtime_error("decim must be a power of two");
+
+        for (unsigned int d = _decim; d > 1; d /= 2) {
+            /* earlier stages run the most oversampled and get away with
+             * the shortest kernels, the last octave needs the sharp one */
+            if (d >= 16)
+                _stages.push_back(halfband_decim_stage(KERNEL_16_110, KERNEL_16_110_LEN));
+            else if (d >= 8)
+                _stages.push_back(halfband_decim_stage(KERNEL_8_100, KERNEL_8_100_LEN));
+            else if (d >= 4)
+                _stages.push_back(halfband_decim_stage(KERNEL_4_90, KERNEL_4_90_LEN));
+            else
+                _stages.push_back(halfband_decim_stage(KERNEL_2_80, KERNEL_2_80_LEN));
+        }
+
+        if (_decim > 1)
+            std::cerr << "Software decimation by " << _decim << " enabled"
+                      << std::endl;
+    }
+
+    bool active() const { return _decim > 1; }
+
+    /*! The configured decimation factor, 1 when inactive. */
+    unsigned int decim() const { return _decim; }
+
+    /*! Run \p nin samples through the cascade. The output may alias
+     * the input. \return the number of samples placed in out */
+    int process(const gr_complex *in, int nin, gr_complex *out)
+    {
+        int n = nin;
+
+        for (size_t s = 0; s < _stages.size(); s++) {
+            n = _stages[s].process(in, n, out);
+            in = out; /* later stages filter in place */
+        }
+
+        return n;
+    }
+
+private:
+    unsigned int _decim;
+    std::vector<halfband_decim_stage> _stages;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_HALFBAND_DECIM_H */
@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_HANDLE_CACHE_H
+#define OSMOSDR_HANDLE_CACHE_H
+
+#include <map>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+namespace osmosdr {
+
+/*!
+ * Opt-in process-level cache of open device handles.
+ *
+ * Tearing a flowgraph down and building it up again normally closes
+ * and reopens the device, paying USB re-enumeration and firmware init
+ * each time. With the persist=1 device argument a backend parks its
+ * handle here on destruction instead of closing it; a block recreated
+ * with the same key reattaches to the open handle and only has to
+ * reapply its settings, which are plain control transfers.
+ *
+ * A parked handle keeps the device claimed until it is reacquired,
+ * replaced (which closes the previous one) or the process exits, so
+ * other programs cannot open it in the meantime - that is the price of
+ * the fast restart and the reason the cache is opt-in.
+ */
+class handle_cache
+{
+public:
+  typedef void (*close_fn)(void *);
+
+  static handle_cache &instance()
+  {
+    static handle_cache cache;
+    return cache;
+  }
+
+  /*! Whether the persist=1 device argument was given. */
+  static bool wanted( const std::map< std::string, std::string > &dict )
+  {
+    std::map< std::string, std::string >::const_iterator it =
+        dict.find( "persist" );
+
+    if ( it == dict.end() )
+      return false;
+
+    return ( "0" != it->second ) && ( "false" != it->second );
+  }
+
+  /*! Detach and return the handle parked under \p key, or NULL.
+   * Ownership passes back to the caller. */
+  void *acquire( const std::string &key )
+  {
+    boost::mutex::scoped_lock lock( _mutex );
+
+    std::map< std::string, entry_t >::iterator it = _entries.find( key );
+    if ( it == _entries.end() )
+      return NULL;
+
+    void *handle = it->second.handle;
+    _entries.erase( it );
+
+    return handle;
+  }
+
+  /*! Park \p handle under \p key instead of closing it. A handle
+   * already parked under the same key is closed via its \p close
+   * callback, which also runs should the entry ever be evicted. */
+  void park( const std::string &key, void *handle, close_fn close )
+  {
+    boost::mutex::scoped_lock lock( _mutex );
+
+    std::map< std::string, entry_t >::iterator it = _entries.find( key );
+    if ( it != _entries.end() )
+      it->second.close( it->second.handle );
+
+    entry_t entry = { handle, close };
+    _entries[ key ] = entry;
+  }
+
+private:
+  struct entry_t
+  {
+    void *handle;
+    close_fn close;
+  };
+
+  std::map< std::string, entry_t > _entries;
+  boost::mutex _mutex;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_HANDLE_CACHE_H */
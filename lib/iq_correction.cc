@@ -0,0 +1,157 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "iq_correction.h"
+
+#include <algorithm>
+
+#ifdef HAVE_VOLK
+#include <volk/volk.h>
+#endif
+
+namespace osmosdr {
+
+iq_correction::iq_correction()
+  : _mag(0.0f),
+    _phase(0.0f),
+    _dc(0.0f, 0.0f),
+    _dc_auto(false),
+    _bypass(true),
+    _a(1.0f, 0.0f),
+    _b(0.0f, 0.0f)
+{
+}
+
+void iq_correction::set_mag_phase( float mag, float phase )
+{
+  boost::mutex::scoped_lock lock( _mutex );
+
+  _mag = mag;
+  _phase = phase;
+
+  update_coeffs();
+}
+
+void iq_correction::set_dc_offset( const std::complex<float> &offset )
+{
+  boost::mutex::scoped_lock lock( _mutex );
+
+  _dc = offset;
+
+  update_coeffs();
+}
+
+void iq_correction::set_dc_auto( bool automatic )
+{
+  boost::mutex::scoped_lock lock( _mutex );
+
+  _dc_auto = automatic;
+
+  if ( ! automatic ) /* forget the tracked estimate */
+    _dc = std::complex<float>(0.0f, 0.0f);
+
+  update_coeffs();
+}
+
+void iq_correction::update_coeffs( void )
+{
+  /* I' = I, Q' = phase * I + (1 + mag) * Q written as a * x + b * conj(x) */
+  _a = std::complex<float>(1.0f + _mag / 2, _phase / 2);
+  _b = std::complex<float>(-_mag / 2, _phase / 2);
+
+  _bypass = (0.0f == _mag) && (0.0f == _phase) && ( ! _dc_auto ) &&
+            (std::complex<float>(0.0f, 0.0f) == _dc);
+}
+
+void iq_correction::process( std::complex<float> *samples, int count )
+{
+  std::complex<float> a, b, dc;
+  bool dc_auto;
+
+  if ( count <= 0 )
+    return;
+
+  {
+    boost::mutex::scoped_lock lock( _mutex );
+
+    if ( _bypass )
+      return;
+
+    a = _a;
+    b = _b;
+    dc = _dc;
+    dc_auto = _dc_auto;
+  }
+
+  if ( dc_auto ) {
+    /* a one-pole average of the block means tracks slow offset drift */
+    std::complex<float> sum(0.0f, 0.0f);
+
+    for ( int i = 0; i < count; i++ )
+      sum += samples[i];
+
+    boost::mutex::scoped_lock lock( _mutex );
+
+    _dc += 0.05f * (sum / float(count) - _dc);
+    dc = _dc;
+  }
+
+  /* fold the offset into the constant term: a * (x - dc) + b * conj(x - dc) */
+  const std::complex<float> c = -(a * dc + b * std::conj(dc));
+
+#ifdef HAVE_VOLK
+  std::complex<float> tmp_a[1024];
+  std::complex<float> tmp_b[1024];
+
+  const lv_32fc_t sa = lv_cmake(a.real(), a.imag());
+  const lv_32fc_t sb = lv_cmake(b.real(), b.imag());
+
+  while (count) {
+    const int chunk = std::min(count, 1024);
+
+    volk_32fc_conjugate_32fc((lv_32fc_t *)tmp_b, (const lv_32fc_t *)samples,
+                             chunk);
+    volk_32fc_s32fc_multiply_32fc((lv_32fc_t *)tmp_a,
+                                  (const lv_32fc_t *)samples, sa, chunk);
+    volk_32fc_s32fc_multiply_32fc((lv_32fc_t *)tmp_b,
+                                  (const lv_32fc_t *)tmp_b, sb, chunk);
+    volk_32f_x2_add_32f((float *)samples, (const float *)tmp_a,
+                        (const float *)tmp_b, 2 * chunk);
+
+    for ( int i = 0; i < chunk; i++ )
+      samples[i] += c;
+
+    samples += chunk;
+    count -= chunk;
+  }
+#else
+  for ( int i = 0; i < count; i++ ) {
+    const std::complex<float> x = samples[i];
+
+    samples[i] = a * x + b * std::conj(x) + c;
+  }
+#endif
+}
+
+} /* namespace osmosdr */
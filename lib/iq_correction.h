@@ -0,0 +1,79 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_IQ_CORRECTION_H
+#define OSMOSDR_IQ_CORRECTION_H
+
+#include <boost/thread/mutex.hpp>
+
+#include <complex>
+
+namespace osmosdr {
+
+/*!
+ * Fused DC offset and IQ imbalance correction.
+ *
+ * Applies the same correction as gr-iqbalance's fix_cc block
+ * (I' = I, Q' = phase * I + (1 + mag) * Q) plus a DC offset removal in
+ * a single in-place pass over the samples, so a backend can run it at
+ * the end of its work() instead of dragging the stream through extra
+ * scheduler hops. Both terms are folded into one widely linear
+ * expression a * x + b * conj(x) + c which maps onto VOLK kernels.
+ *
+ * Coefficient updates may come from any thread; the streaming thread
+ * only takes a snapshot under the lock. With no correction configured
+ * process() returns immediately.
+ */
+class iq_correction
+{
+public:
+  iq_correction();
+
+  /*! Set the IQ imbalance correction, fix_cc conventions. */
+  void set_mag_phase( float mag, float phase );
+
+  /*! Set a fixed DC offset to subtract from every sample. */
+  void set_dc_offset( const std::complex<float> &offset );
+
+  /*! Enable tracking of the DC offset with a slow running average of
+   * the incoming samples instead of using a fixed value. */
+  void set_dc_auto( bool automatic );
+
+  /*! Correct \p count complex samples in place. */
+  void process( std::complex<float> *samples, int count );
+
+private:
+  void update_coeffs( void ); /* call with _mutex held */
+
+  boost::mutex _mutex;
+
+  float _mag;
+  float _phase;
+  std::complex<float> _dc;
+  bool _dc_auto;
+
+  bool _bypass;
+  std::complex<float> _a;
+  std::complex<float> _b;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_IQ_CORRECTION_H */
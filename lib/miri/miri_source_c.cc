@@ -41,6 +41,7 @@
 #include <mirisdr.h>
 
 #include "arg_helpers.h"
+#include "buffer_pool.h"
 
 using namespace boost::assign;
 
@@ -94,12 +95,17 @@ miri_source_c::miri_source_c (const std::string &args)
   if (dict.count("miri"))
     dev_index = boost::lexical_cast< unsigned int >( dict["miri"] );
 
-  _buf_num = _buf_head = _buf_used = _buf_offset = 0;
+  _buf_num = _buf_offset = 0;
   _samp_avail = BUF_SIZE / BYTES_PER_SAMPLE;
 
   if (dict.count("buffers"))
     _buf_num = boost::lexical_cast< unsigned int >( dict["buffers"] );
 
+  _prio.parse(dict);
+  if (_prio.numa_node() >= 0)
+    osmosdr::buffer_pool::instance().set_numa_node(_prio.numa_node());
+  _ring.parse_overflow_policy(dict);
+
   if (0 == _buf_num)
     _buf_num = BUF_NUM;
 
@@ -132,13 +138,9 @@ miri_source_c::miri_source_c (const std::string &args)
   if (ret < 0)
     throw std::runtime_error("Failed to reset usb buffers.");
 
-  _buf = (unsigned short **) malloc(_buf_num * sizeof(unsigned short *));
-  _buf_lens = (unsigned int *) malloc(_buf_num * sizeof(unsigned int));
+  _ring.resize(_buf_num, BUF_SIZE);
 
-  if (_buf && _buf_lens) {
-    for(unsigned int i = 0; i < _buf_num; ++i)
-      _buf[i] = (unsigned short *) malloc(BUF_SIZE);
-  }
+  _tagger.start(get_sample_rate());
 
   _thread = gr::thread::thread(_mirisdr_wait, this);
 }
@@ -155,17 +157,6 @@ miri_source_c::~miri_source_c ()
     mirisdr_close( _dev );
     _dev = NULL;
   }
-
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i) {
-      free(_buf[i]);
-    }
-
-    free(_buf);
-    _buf = NULL;
-    free(_buf_lens);
-    _buf_lens = NULL;
-  }
 }
 
 void miri_source_c::_mirisdr_callback(unsigned char *buf, uint32_t len, void *ctx)
@@ -181,25 +172,13 @@ void miri_source_c::mirisdr_callback(unsigned char *buf, uint32_t len)
     return;
   }
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+  if (len > BUF_SIZE)
+    throw std::runtime_error("Buffer too small.");
 
-    if (len > BUF_SIZE)
-      throw std::runtime_error("Buffer too small.");
-
-    int buf_tail = (_buf_head + _buf_used) % _buf_num;
-    memcpy(_buf[buf_tail], buf, len);
-    _buf_lens[buf_tail] = len;
-
-    if (_buf_used == _buf_num) {
-      std::cerr << "O" << std::flush;
-      _buf_head = (_buf_head + 1) % _buf_num;
-    } else {
-      _buf_used++;
-    }
+  if (!_ring.write(buf, len)) {
+    _tagger.discontinuity();
+    std::cerr << "O" << std::flush;
   }
-
-  _buf_cond.notify_one();
 }
 
 void miri_source_c::_mirisdr_wait(miri_source_c *obj)
@@ -209,6 +188,8 @@ void miri_source_c::_mirisdr_wait(miri_source_c *obj)
 
 void miri_source_c::mirisdr_wait()
 {
+  _prio.apply();
+
   int ret = mirisdr_read_async( _dev, _mirisdr_callback, (void *)this, _buf_num, BUF_SIZE );
 
   _running = false;
@@ -216,7 +197,7 @@ void miri_source_c::mirisdr_wait()
   if ( ret != 0 )
     std::cerr << "mirisdr_read_async returned with " << ret << std::endl;
 
-  _buf_cond.notify_one();
+  _ring.shutdown();
 }
 
 int miri_source_c::work( int noutput_items,
@@ -225,17 +206,18 @@ int miri_source_c::work( int noutput_items,
 {
   gr_complex *out = (gr_complex *)output_items[0];
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+  if (!_ring.wait(3)) // collect at least 3 buffers
+    return WORK_DONE;
 
-    while (_buf_used < 3 && _running) // collect at least 3 buffers
-      _buf_cond.wait( lock );
+  if (_ring.overflow_pending() && 0 == _buf_offset) {
+    /* drop-oldest: shed the stale half of the backlog at a buffer
+     * boundary, where no partially consumed data is tracked */
+    _ring.discard_backlog(_ring.capacity() / 2);
+    _samp_avail = _ring.head_len() / BYTES_PER_SAMPLE;
+    _tagger.discontinuity();
   }
 
-  if (!_running)
-    return WORK_DONE;
-
-  short *buf = (short *)_buf[_buf_head] + _buf_offset;
+  short *buf = (short *)_ring.head() + _buf_offset;
 
   if (noutput_items <= _samp_avail) {
     for (int i = 0; i < noutput_items; i++)
@@ -249,14 +231,9 @@ int miri_source_c::work( int noutput_items,
       *out++ = gr_complex( float(*(buf + i * 2 + 0)) * (1.0f/4096.0f),
                            float(*(buf + i * 2 + 1)) * (1.0f/4096.0f) );
 
-    {
-      boost::mutex::scoped_lock lock( _buf_mutex );
+    _ring.pop();
 
-      _buf_head = (_buf_head + 1) % _buf_num;
-      _buf_used--;
-    }
-
-    buf = (short *)_buf[_buf_head];
+    buf = (short *)_ring.head();
 
     int remaining = noutput_items - _samp_avail;
 
@@ -265,9 +242,11 @@ int miri_source_c::work( int noutput_items,
                            float(*(buf + i * 2 + 1)) * (1.0f/4096.0f) );
 
     _buf_offset = remaining * 2;
-    _samp_avail = (_buf_lens[_buf_head] / BYTES_PER_SAMPLE) - remaining;
+    _samp_avail = (_ring.head_len() / BYTES_PER_SAMPLE) - remaining;
   }
 
+  _tagger.tag_work( this, 0, noutput_items );
+
   return noutput_items;
 }
 
@@ -304,7 +283,11 @@ double miri_source_c::set_sample_rate(double rate)
     mirisdr_set_sample_rate( _dev, (uint32_t)rate );
   }
 
-  return get_sample_rate();
+  double actual = get_sample_rate();
+
+  _tagger.set_rate(actual);
+
+  return actual;
 }
 
 double miri_source_c::get_sample_rate()
@@ -449,3 +432,8 @@ std::string miri_source_c::get_antenna( size_t chan )
 {
   return "RX";
 }
+
+osmosdr::stream_stats_t miri_source_c::get_stream_stats( size_t chan )
+{
+  return _ring.stats( BYTES_PER_SAMPLE );
+}
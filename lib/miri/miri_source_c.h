@@ -23,10 +23,11 @@
 #include <gnuradio/sync_block.h>
 
 #include <gnuradio/thread/thread.h>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
+#include "buffer_ring.h"
 #include "source_iface.h"
+#include "stream_tagger.h"
+#include "thread_prio.h"
 
 class miri_source_c;
 typedef struct mirisdr_dev mirisdr_dev_t;
@@ -107,6 +108,8 @@ private:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
   static void _mirisdr_callback(unsigned char *buf, uint32_t len, void *ctx);
   void mirisdr_callback(unsigned char *buf, uint32_t len);
@@ -115,14 +118,11 @@ private:
 
   mirisdr_dev_t *_dev;
   gr::thread::thread _thread;
-  unsigned short **_buf;
-  unsigned int *_buf_lens;
+  osmosdr::buffer_ring _ring;
   unsigned int _buf_num;
-  unsigned int _buf_head;
-  unsigned int _buf_used;
-  boost::mutex _buf_mutex;
-  boost::condition_variable _buf_cond;
   bool _running;
+  osmosdr::thread_prio _prio;
+  osmosdr::stream_tagger _tagger;
 
   unsigned int _buf_offset;
   int _samp_avail;
@@ -0,0 +1,257 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <gnuradio/io_signature.h>
+
+#include "null_source_c.h"
+
+#include "arg_helpers.h"
+
+/* table length and tone bin; coprime so every table entry differs and
+ * conversion bugs downstream cannot hide behind a short inner period */
+#define TABLE_LEN  4096
+#define TONE_BIN   401
+
+null_source_c_sptr make_null_source_c(const std::string &args)
+{
+  return gnuradio::get_initial_sptr(new null_source_c(args));
+}
+
+null_source_c::null_source_c(const std::string &args) :
+  gr::sync_block("null_source_c",
+                 gr::io_signature::make(0, 0, 0),
+                 gr::io_signature::make(1, 1, sizeof (gr_complex))),
+  _table_pos(0),
+  _pace_samples(0)
+{
+  _throttle = false;
+  _freq = 100e6;
+  _rate = 8e6;
+  _corr = 0;
+  _gain = 0;
+
+  dict_t dict = params_to_dict(args);
+
+  if (dict.count("freq"))
+    _freq = boost::lexical_cast< double >( dict["freq"] );
+
+  if (dict.count("rate"))
+    _rate = boost::lexical_cast< double >( dict["rate"] );
+
+  if (dict.count("throttle"))
+    _throttle = ("true" == dict["throttle"] ? true : false);
+
+  if (_rate <= 0)
+    throw std::runtime_error("Parameter 'rate' must be positive.");
+
+  _table.resize(TABLE_LEN);
+  for (size_t i = 0; i < TABLE_LEN; i++) {
+    double phase = 2.0 * M_PI * TONE_BIN * i / TABLE_LEN;
+    _table[i] = gr_complex( 0.5f * cosf(phase), 0.5f * sinf(phase) );
+  }
+}
+
+void null_source_c::reset_pacing()
+{
+  _pace_epoch = std::chrono::steady_clock::now();
+  _pace_samples = 0;
+}
+
+bool null_source_c::start()
+{
+  reset_pacing();
+
+  return true;
+}
+
+int null_source_c::work( int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+  int processed = 0;
+
+  while (processed < noutput_items) {
+    const size_t chunk = std::min( (size_t)(noutput_items - processed),
+                                   TABLE_LEN - _table_pos );
+
+    memcpy( &out[processed], &_table[_table_pos],
+            chunk * sizeof(gr_complex) );
+
+    _table_pos = (_table_pos + chunk) % TABLE_LEN;
+    processed += chunk;
+  }
+
+  if (_throttle) {
+    _pace_samples += processed;
+
+    /* sleep until the wall clock catches up with the sample clock */
+    std::chrono::steady_clock::time_point deadline = _pace_epoch +
+      std::chrono::microseconds( (uint64_t)(_pace_samples * 1e6 / _rate) );
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (deadline > now)
+      std::this_thread::sleep_for( deadline - now );
+    else if (now - deadline > std::chrono::milliseconds(250))
+      reset_pacing(); /* fell far behind (e.g. paused in a debugger) */
+  }
+
+  return processed;
+}
+
+std::string null_source_c::name()
+{
+  return "Null Benchmark Source";
+}
+
+std::vector<std::string> null_source_c::get_devices( bool fake )
+{
+  std::vector<std::string> devices;
+
+  if ( fake )
+  {
+    std::string args = "null=0";
+    args += ",rate=8e6,throttle=false";
+    args += ",label='Null Benchmark Source'";
+    devices.push_back( args );
+  }
+
+  return devices;
+}
+
+size_t null_source_c::get_num_channels( void )
+{
+  return 1;
+}
+
+osmosdr::meta_range_t null_source_c::get_sample_rates( void )
+{
+  /* any rate works, the samples come out of memory */
+  return osmosdr::meta_range_t( 1e3, 250e6 );
+}
+
+double null_source_c::set_sample_rate( double rate )
+{
+  if (rate > 0) {
+    _rate = rate;
+    reset_pacing();
+  }
+
+  return get_sample_rate();
+}
+
+double null_source_c::get_sample_rate( void )
+{
+  return _rate;
+}
+
+osmosdr::freq_range_t null_source_c::get_freq_range( size_t chan )
+{
+  return osmosdr::freq_range_t( 0, 1e10 );
+}
+
+double null_source_c::set_center_freq( double freq, size_t chan )
+{
+  _freq = freq;
+
+  return get_center_freq( chan );
+}
+
+double null_source_c::get_center_freq( size_t chan )
+{
+  return _freq;
+}
+
+double null_source_c::set_freq_corr( double ppm, size_t chan )
+{
+  _corr = ppm;
+
+  return get_freq_corr( chan );
+}
+
+double null_source_c::get_freq_corr( size_t chan )
+{
+  return _corr;
+}
+
+std::vector<std::string> null_source_c::get_gain_names( size_t chan )
+{
+  std::vector< std::string > names;
+
+  names.push_back( "RF" );
+
+  return names;
+}
+
+osmosdr::gain_range_t null_source_c::get_gain_range( size_t chan )
+{
+  return osmosdr::gain_range_t( 0, 100, 1 );
+}
+
+osmosdr::gain_range_t null_source_c::get_gain_range( const std::string & name, size_t chan )
+{
+  return get_gain_range( chan );
+}
+
+double null_source_c::set_gain( double gain, size_t chan )
+{
+  _gain = get_gain_range( chan ).clip( gain );
+
+  return get_gain( chan );
+}
+
+double null_source_c::set_gain( double gain, const std::string & name, size_t chan )
+{
+  return set_gain( gain, chan );
+}
+
+double null_source_c::get_gain( size_t chan )
+{
+  return _gain;
+}
+
+double null_source_c::get_gain( const std::string & name, size_t chan )
+{
+  return get_gain( chan );
+}
+
+std::vector< std::string > null_source_c::get_antennas( size_t chan )
+{
+  std::vector< std::string > antennas;
+
+  antennas.push_back( get_antenna( chan ) );
+
+  return antennas;
+}
+
+std::string null_source_c::set_antenna( const std::string & antenna, size_t chan )
+{
+  return get_antenna( chan );
+}
+
+std::string null_source_c::get_antenna( size_t chan )
+{
+  return "RX";
+}
@@ -0,0 +1,108 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef NULL_SOURCE_C_H
+#define NULL_SOURCE_C_H
+
+#include <gnuradio/sync_block.h>
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+#include "source_iface.h"
+
+class null_source_c;
+
+typedef boost::shared_ptr< null_source_c > null_source_c_sptr;
+
+null_source_c_sptr make_null_source_c( const std::string & args = "" );
+
+/*!
+ * \brief Deterministic benchmark source without any hardware I/O.
+ *
+ * Replays a precomputed complex tone from memory, so it measures
+ * gr-osmosdr's own overhead (block machinery, scheduler hops, the
+ * source_impl hier block) separately from device I/O. Selected with
+ * null=0 or loopback=0; by default it runs as fast as the scheduler
+ * can take samples, throttle=true paces it to the configured sample
+ * rate instead. All settings are accepted and stored so existing
+ * applications run against it unchanged.
+ */
+class null_source_c :
+    public gr::sync_block,
+    public source_iface
+{
+private:
+  friend null_source_c_sptr make_null_source_c(const std::string &args);
+
+  null_source_c(const std::string &args);
+
+public:
+  std::string name();
+
+  static std::vector< std::string > get_devices( bool fake = false );
+
+  bool start( void );
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
+  size_t get_num_channels( void );
+
+  osmosdr::meta_range_t get_sample_rates( void );
+  double set_sample_rate( double rate );
+  double get_sample_rate( void );
+
+  osmosdr::freq_range_t get_freq_range( size_t chan = 0 );
+  double set_center_freq( double freq, size_t chan = 0 );
+  double get_center_freq( size_t chan = 0 );
+  double set_freq_corr( double ppm, size_t chan = 0 );
+  double get_freq_corr( size_t chan = 0 );
+
+  std::vector<std::string> get_gain_names( size_t chan = 0 );
+  osmosdr::gain_range_t get_gain_range( size_t chan = 0 );
+  osmosdr::gain_range_t get_gain_range( const std::string & name, size_t chan = 0 );
+  double set_gain( double gain, size_t chan = 0 );
+  double set_gain( double gain, const std::string & name, size_t chan = 0 );
+  double get_gain( size_t chan = 0 );
+  double get_gain( const std::string & name, size_t chan = 0 );
+
+  std::vector< std::string > get_antennas( size_t chan = 0 );
+  std::string set_antenna( const std::string & antenna, size_t chan = 0 );
+  std::string get_antenna( size_t chan = 0 );
+
+private:
+  void reset_pacing( void );
+
+  /* one period of the generated tone, copied out with wraparound */
+  std::vector<gr_complex> _table;
+  size_t _table_pos;
+
+  bool _throttle;
+
+  /* pacing state: samples emitted since the epoch was last reset */
+  std::chrono::steady_clock::time_point _pace_epoch;
+  uint64_t _pace_samples;
+
+  double _freq, _rate, _corr, _gain;
+};
+
+#endif // NULL_SOURCE_C_H
@@ -67,7 +67,6 @@ osmosdr_src_c::osmosdr_src_c (const std::string &args)
         gr::io_signature::make(0, 0, sizeof (gr_complex)),
         gr::io_signature::make(1, 1, sizeof (gr_complex)) ),
     _dev(NULL),
-    _buf(NULL),
     _running(true),
     _auto_gain(false),
     _if_gain(0),
@@ -81,7 +80,7 @@ osmosdr_src_c::osmosdr_src_c (const std::string &args)
   if (dict.count("osmosdr"))
     dev_index = boost::lexical_cast< unsigned int >( dict["osmosdr"] );
 
-  _buf_num = _buf_len = _buf_head = _buf_used = _buf_offset = 0;
+  _buf_num = _buf_len = _buf_offset = 0;
 
   if (dict.count("buffers"))
     _buf_num = boost::lexical_cast< unsigned int >( dict["buffers"] );
@@ -89,6 +88,8 @@ osmosdr_src_c::osmosdr_src_c (const std::string &args)
   if (dict.count("buflen"))
     _buf_len = boost::lexical_cast< unsigned int >( dict["buflen"] );
 
+  _ring.parse_overflow_policy(dict);
+
   if (0 == _buf_num)
     _buf_num = BUF_NUM;
 
@@ -132,12 +133,7 @@ osmosdr_src_c::osmosdr_src_c (const std::string &args)
 
   set_if_gain( 24 ); /* preset to a reasonable default (non-GRC use case) */
 
-  _buf = (unsigned short **) malloc(_buf_num * sizeof(unsigned short *));
-
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i)
-      _buf[i] = (unsigned short *) malloc(_buf_len);
-  }
+  _ring.resize(_buf_num, _buf_len);
 
   _thread = gr::thread::thread(_osmosdr_wait, this);
 }
@@ -154,15 +150,6 @@ osmosdr_src_c::~osmosdr_src_c ()
     osmosdr_close( _dev );
     _dev = NULL;
   }
-
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i) {
-      free(_buf[i]);
-    }
-
-    free(_buf);
-    _buf = NULL;
-  }
 }
 
 void osmosdr_src_c::_osmosdr_callback(unsigned char *buf, uint32_t len, void *ctx)
@@ -178,21 +165,8 @@ void osmosdr_src_c::osmosdr_callback(unsigned char *buf, uint32_t len)
     return;
   }
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
-
-    int buf_tail = (_buf_head + _buf_used) % _buf_num;
-    memcpy(_buf[buf_tail], buf, len);
-
-    if (_buf_used == _buf_num) {
-      std::cerr << "O" << std::flush;
-      _buf_head = (_buf_head + 1) % _buf_num;
-    } else {
-      _buf_used++;
-    }
-  }
-
-  _buf_cond.notify_one();
+  if (!_ring.write(buf, len))
+    std::cerr << "O" << std::flush;
 }
 
 void osmosdr_src_c::_osmosdr_wait(osmosdr_src_c *obj)
@@ -209,7 +183,7 @@ void osmosdr_src_c::osmosdr_wait()
   if ( ret != 0 )
     std::cerr << "osmosdr_read_async returned with " << ret << std::endl;
 
-  _buf_cond.notify_one();
+  _ring.shutdown();
 }
 
 int osmosdr_src_c::work( int noutput_items,
@@ -218,17 +192,17 @@ int osmosdr_src_c::work( int noutput_items,
 {
   gr_complex *out = (gr_complex *)output_items[0];
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+  if (!_ring.wait(3)) // collect at least 3 buffers
+    return WORK_DONE;
 
-    while (_buf_used < 3 && _running) // collect at least 3 buffers
-      _buf_cond.wait( lock );
+  if (_ring.overflow_pending() && 0 == _buf_offset) {
+    /* drop-oldest: shed the stale half of the backlog at a buffer
+     * boundary, where no partially consumed data is tracked */
+    _ring.discard_backlog(_ring.capacity() / 2);
+    _samp_avail = _buf_len / BYTES_PER_SAMPLE;
   }
 
-  if (!_running)
-    return WORK_DONE;
-
-  short *buf = (short *)_buf[_buf_head] + _buf_offset;
+  short *buf = (short *)_ring.head() + _buf_offset;
 
   if (noutput_items <= _samp_avail) {
     for (int i = 0; i < noutput_items; i++)
@@ -242,14 +216,9 @@ int osmosdr_src_c::work( int noutput_items,
       *out++ = gr_complex( float(*(buf + i * 2 + 0)) * (1.0f/32767.5f),
                            float(*(buf + i * 2 + 1)) * (1.0f/32767.5f) );
 
-    {
-      boost::mutex::scoped_lock lock( _buf_mutex );
+    _ring.pop();
 
-      _buf_head = (_buf_head + 1) % _buf_num;
-      _buf_used--;
-    }
-
-    buf = (short *)_buf[_buf_head];
+    buf = (short *)_ring.head();
 
     int remaining = noutput_items - _samp_avail;
 
@@ -531,3 +500,8 @@ std::string osmosdr_src_c::get_antenna( size_t chan )
 {
   return "RX";
 }
+
+osmosdr::stream_stats_t osmosdr_src_c::get_stream_stats( size_t chan )
+{
+  return _ring.stats( BYTES_PER_SAMPLE );
+}
@@ -23,9 +23,8 @@
 #include <gnuradio/sync_block.h>
 
 #include <gnuradio/thread/thread.h>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
+#include "buffer_ring.h"
 #include "source_iface.h"
 
 class osmosdr_src_c;
@@ -111,6 +110,8 @@ private:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
   static void _osmosdr_callback(unsigned char *buf, uint32_t len, void *ctx);
   void osmosdr_callback(unsigned char *buf, uint32_t len);
@@ -119,13 +120,9 @@ private:
 
   osmosdr_dev_t *_dev;
   gr::thread::thread _thread;
-  unsigned short **_buf;
+  osmosdr::buffer_ring _ring;
   unsigned int _buf_num;
   unsigned int _buf_len;
-  unsigned int _buf_head;
-  unsigned int _buf_used;
-  boost::mutex _buf_mutex;
-  boost::condition_variable _buf_cond;
   bool _running;
 
   unsigned int _buf_offset;
@@ -0,0 +1,84 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "plugin_loader.h"
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include <boost/thread/mutex.hpp>
+
+#include <iostream>
+#include <map>
+
+using namespace osmosdr;
+
+std::vector< std::string > plugin_loader::candidates( void )
+{
+  std::vector< std::string > names;
+
+  /* the backends whose vendor libraries are expensive to load */
+  names.push_back( "uhd" );
+  names.push_back( "bladerf" );
+  names.push_back( "soapy" );
+
+  return names;
+}
+
+void *plugin_loader::entry( const std::string &name, const char *symbol )
+{
+#ifdef _WIN32
+  /* plugins are not supported on windows, everything is built in */
+  (void) name;
+  (void) symbol;
+  return NULL;
+#else
+  static std::map< std::string, void * > handles;
+  static boost::mutex mutex;
+
+  boost::mutex::scoped_lock lock( mutex );
+
+  std::map< std::string, void * >::iterator it = handles.find( name );
+  if ( it == handles.end() ) {
+    const std::string soname = "libgnuradio-osmosdr-" + name + ".so";
+
+    /* RTLD_LOCAL keeps the identically named entry points of several
+     * plugins apart, we always resolve them through dlsym() */
+    void *handle = dlopen( soname.c_str(), RTLD_NOW | RTLD_LOCAL );
+    if ( handle )
+      std::cerr << "loaded backend plugin " << soname << std::endl;
+
+    /* a NULL handle is cached as well: not installed */
+    it = handles.insert( std::make_pair( name, handle ) ).first;
+  }
+
+  if ( ! it->second )
+    return NULL;
+
+  return dlsym( it->second, symbol );
+#endif
+}
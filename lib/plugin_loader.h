@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_PLUGIN_LOADER_H
+#define INCLUDED_OSMOSDR_PLUGIN_LOADER_H
+
+#include <gnuradio/basic_block.h>
+
+#include <string>
+#include <vector>
+
+class source_iface;
+class sink_iface;
+
+/*
+ * With ENABLE_PLUGINS the heavy vendor backends are built into
+ * libgnuradio-osmosdr-<name>.so modules instead of the core library,
+ * so loading the module (e.g. importing it from python) no longer pays
+ * for the static initializers of every vendor library. A plugin is
+ * dlopen'd only when its device type key appears in the args or when a
+ * full device enumeration runs.
+ *
+ * The entry points below are exported with C linkage so dlsym() finds
+ * them without name mangling getting in the way. Plugin and core
+ * library are always built from the same tree with the same compiler,
+ * passing C++ types across the boundary is therefore safe.
+ */
+
+namespace osmosdr {
+
+typedef gr::basic_block_sptr (*plugin_make_source_fn)
+    ( const std::string &args, source_iface **iface );
+typedef gr::basic_block_sptr (*plugin_make_sink_fn)
+    ( const std::string &args, sink_iface **iface );
+typedef void (*plugin_get_devices_fn)
+    ( std::vector< std::string > &devices );
+
+class plugin_loader
+{
+public:
+  /*!
+   * Names of the backends that may be built as plugins. Listing a name
+   * costs nothing, the plugin library is searched for only on use.
+   */
+  static std::vector< std::string > candidates( void );
+
+  /*!
+   * Resolve \p symbol from the plugin for backend \p name, loading the
+   * plugin on first use. Handles (and load failures) are cached, so a
+   * missing plugin is probed for at most once per process.
+   * \return the symbol address or NULL when the plugin is not installed
+   */
+  static void *entry( const std::string &name, const char *symbol );
+};
+
+} /* namespace osmosdr */
+
+#define OSMOSDR_PLUGIN_MAKE_SOURCE    "osmosdr_plugin_make_source"
+#define OSMOSDR_PLUGIN_MAKE_SINK      "osmosdr_plugin_make_sink"
+#define OSMOSDR_PLUGIN_SOURCE_DEVICES "osmosdr_plugin_get_source_devices"
+#define OSMOSDR_PLUGIN_SINK_DEVICES   "osmosdr_plugin_get_sink_devices"
+
+#endif /* INCLUDED_OSMOSDR_PLUGIN_LOADER_H */
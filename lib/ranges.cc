@@ -135,23 +135,40 @@ double meta_range_t::step(void) const{
 }
 
 double meta_range_t::clip(double value, bool clip_step) const{
-    check_meta_range_monotonic(*this);
-    double last_stop = this->front().stop();
-    BOOST_FOREACH(const range_t &r, (*this)){
-        //in-between ranges, clip to nearest
-        if (value < r.start()){
-            return (std::abs(value - r.start()) < std::abs(value - last_stop))?
-                r.start() : last_stop;
-        }
-        //in this range, clip here
-        if (value <= r.stop()){
-            if (! clip_step || r.step() == 0) return value;
-            return boost::math::round((value - r.start())/r.step())*r.step() + r.start();
-        }
-        //continue on to the next range
-        last_stop = r.stop();
+    if (this->empty()){
+        throw std::runtime_error("meta-range cannot be empty");
+    }
+
+    //binary search for the first range starting beyond the value;
+    //monotonicity (checked by start/stop/step) means the result can
+    //only involve that range and its predecessor
+    size_t lo = 0, hi = this->size();
+    while (lo < hi){
+        const size_t mid = (lo + hi)/2;
+        if (this->at(mid).start() <= value) lo = mid + 1;
+        else hi = mid;
     }
-    return last_stop;
+
+    //below every range, clip to the overall start
+    if (lo == 0) return this->front().start();
+
+    const range_t &r = this->at(lo - 1);
+
+    //in this range, clip here
+    if (value <= r.stop()){
+        if (! clip_step || r.step() == 0) return value;
+        return boost::math::round((value - r.start())/r.step())*r.step() + r.start();
+    }
+
+    //in-between ranges, clip to nearest
+    if (lo < this->size()){
+        const double next_start = this->at(lo).start();
+        return (std::abs(value - next_start) < std::abs(value - r.stop()))?
+            next_start : r.stop();
+    }
+
+    //above every range, clip to the overall stop
+    return r.stop();
 }
 
 std::vector<double> meta_range_t::values() const {
@@ -34,8 +34,23 @@
 
 #include "redpitaya_sink_c.h"
 
+#if !defined(_WIN32)
+#include <netinet/tcp.h>
+#endif
+
 using namespace boost::assign;
 
+/* payload of one 9000 byte jumbo frame, batches are sized to a
+ * multiple of it so every segment on the wire leaves full */
+#define REDPITAYA_TX_JUMBO  8960
+
+/* how many jumbo frames one burst carries */
+#define REDPITAYA_TX_FRAMES 8
+
+/* how long a partial batch may sit in the staging buffer before it is
+ * flushed regardless of its size */
+#define REDPITAYA_TX_FLUSH_MS 10
+
 redpitaya_sink_c_sptr make_redpitaya_sink_c(const std::string &args)
 {
   return gnuradio::get_initial_sptr(new redpitaya_sink_c(args));
@@ -108,10 +123,21 @@ redpitaya_sink_c::redpitaya_sink_c(const std::string &args) :
 
   command = ptt ? 2<<28 : 3<<28;
   redpitaya_send_command( _sockets[0], command );
+
+  _txbuf.resize( REDPITAYA_TX_FRAMES * REDPITAYA_TX_JUMBO );
+  _txfill = 0;
 }
 
 redpitaya_sink_c::~redpitaya_sink_c()
 {
+  if ( _txfill )
+  {
+    try {
+      flush_txbuf(); /* drain the staged tail */
+    } catch (...) {
+    }
+  }
+
 #if defined(_WIN32)
   ::closesocket( _sockets[1] );
   ::closesocket( _sockets[0] );
@@ -122,24 +148,69 @@ redpitaya_sink_c::~redpitaya_sink_c()
 #endif
 }
 
-int redpitaya_sink_c::work( int noutput_items,
-                            gr_vector_const_void_star &input_items,
-                            gr_vector_void_star &output_items )
+void redpitaya_sink_c::flush_txbuf( void )
 {
-  const gr_complex *in = (const gr_complex *)input_items[0];
+  if ( 0 == _txfill )
+    return;
 
+#if defined(TCP_CORK)
+  int on = 1;
+  setsockopt( _sockets[1], IPPROTO_TCP, TCP_CORK, &on, sizeof(on) );
+#endif
+
+  size_t sent = 0;
+  while ( sent < _txfill )
+  {
 #if defined(_WIN32)
-  int size;
-  int total = sizeof(gr_complex) * noutput_items;
-  size = ::send( _sockets[1], (char *)in, total, 0 );
+    int size = ::send( _sockets[1], (char *)&_txbuf[sent],
+                       (int)(_txfill - sent), 0 );
 #else
-  ssize_t size;
-  ssize_t total = sizeof(gr_complex) * noutput_items;
-  size = ::send( _sockets[1], in, total, MSG_NOSIGNAL );
+    ssize_t size = ::send( _sockets[1], &_txbuf[sent],
+                           _txfill - sent, MSG_NOSIGNAL );
 #endif
 
-  if ( size != total )
-    throw std::runtime_error( "Sending samples failed." );
+    if ( size <= 0 )
+      throw std::runtime_error( "Sending samples failed." );
+
+    sent += size;
+  }
+
+#if defined(TCP_CORK)
+  /* uncorking pushes the trailing partial segment right away */
+  int off = 0;
+  setsockopt( _sockets[1], IPPROTO_TCP, TCP_CORK, &off, sizeof(off) );
+#endif
+
+  _txfill = 0;
+}
+
+int redpitaya_sink_c::work( int noutput_items,
+                            gr_vector_const_void_star &input_items,
+                            gr_vector_void_star &output_items )
+{
+  const unsigned char *in = (const unsigned char *)input_items[0];
+  size_t remaining = sizeof(gr_complex) * noutput_items;
+
+  while ( remaining )
+  {
+    size_t chunk = std::min( remaining, _txbuf.size() - _txfill );
+
+    if ( 0 == _txfill )
+      _txstamp = std::chrono::steady_clock::now();
+
+    memcpy( &_txbuf[_txfill], in, chunk );
+    _txfill += chunk;
+    in += chunk;
+    remaining -= chunk;
+
+    if ( _txfill == _txbuf.size() )
+      flush_txbuf();
+  }
+
+  if ( _txfill &&
+       std::chrono::steady_clock::now() - _txstamp >=
+       std::chrono::milliseconds( REDPITAYA_TX_FLUSH_MS ) )
+    flush_txbuf();
 
   consume(0, noutput_items);
 
@@ -170,7 +241,7 @@ size_t redpitaya_sink_c::get_num_channels( void )
   return 1;
 }
 
-osmosdr::meta_range_t redpitaya_sink_c::get_sample_rates( void )
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -184,6 +255,14 @@ osmosdr::meta_range_t redpitaya_sink_c::get_sample_rates( void )
   return range;
 }
 
+osmosdr::meta_range_t redpitaya_sink_c::get_sample_rates( void )
+{
+  /* built once - UIs poll this during interactive tuning */
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 double redpitaya_sink_c::set_sample_rate( double rate )
 {
   uint32_t command = 0;
@@ -23,6 +23,9 @@
 
 #include <gnuradio/sync_block.h>
 
+#include <chrono>
+#include <vector>
+
 #include "sink_iface.h"
 
 #include "redpitaya_common.h"
@@ -78,8 +81,18 @@ public:
   std::string get_antenna( size_t chan = 0 );
 
 private:
+  /* send the staged batch as one corked burst */
+  void flush_txbuf( void );
+
   double _freq, _rate, _corr;
   SOCKET _sockets[2];
+
+  /* work() stages samples here and sends jumbo-frame-aligned bursts
+   * under TCP_CORK; a partial batch is flushed once it has aged past
+   * the latency bound */
+  std::vector< unsigned char > _txbuf;
+  size_t _txfill;
+  std::chrono::steady_clock::time_point _txstamp;
 };
 
 #endif // REDPITAYA_SINK_C_H
@@ -20,6 +20,7 @@
  */
 
 #include <fstream>
+#include <iostream>
 #include <string>
 #include <sstream>
 #include <stdexcept>
@@ -31,11 +32,18 @@
 #include <gnuradio/io_signature.h>
 
 #include "arg_helpers.h"
+#include "buffer_pool.h"
+#include "uring_reader.h"
 
 #include "redpitaya_source_c.h"
 
 using namespace boost::assign;
 
+#define REDPITAYA_BUF_NUM  32
+#define REDPITAYA_BUF_LEN  (16 * 1024) /* bytes, 2048 samples */
+
+#define BYTES_PER_SAMPLE  sizeof(gr_complex)
+
 redpitaya_source_c_sptr make_redpitaya_source_c(const std::string &args)
 {
   return gnuradio::get_initial_sptr(new redpitaya_source_c(args));
@@ -61,8 +69,15 @@ redpitaya_source_c::redpitaya_source_c(const std::string &args) :
   _rate = 1.0e5;
   _corr = 0.0;
 
+  _run_read_task = false;
+  _buf_offset = 0;
+
   dict_t dict = params_to_dict( args );
 
+  _prio.parse( dict );
+  if ( _prio.numa_node() >= 0 )
+    osmosdr::buffer_pool::instance().set_numa_node( _prio.numa_node() );
+
   if ( dict.count( "redpitaya" ) )
   {
     std::vector< std::string > tokens;
@@ -100,10 +115,21 @@ redpitaya_source_c::redpitaya_source_c(const std::string &args) :
     command = i;
     redpitaya_send_command( _sockets[i], command );
   }
+
+  /* a generous receive buffer absorbs scheduling hiccups, may be
+   * tuned through the rcvbuf=<bytes> argument */
+  int sockoptval = 1024 * 1024;
+  if ( dict.count("rcvbuf") )
+    sockoptval = boost::lexical_cast< int >( dict["rcvbuf"] );
+  setsockopt( _sockets[1], SOL_SOCKET, SO_RCVBUF,
+              (const char *)&sockoptval, sizeof(int) );
 }
 
 redpitaya_source_c::~redpitaya_source_c()
 {
+  if ( _run_read_task )
+    stop();
+
 #if defined(_WIN32)
   ::closesocket( _sockets[1] );
   ::closesocket( _sockets[0] );
@@ -114,26 +140,214 @@ redpitaya_source_c::~redpitaya_source_c()
 #endif
 }
 
+bool redpitaya_source_c::start()
+{
+  _ring.resize( REDPITAYA_BUF_NUM, REDPITAYA_BUF_LEN );
+  _buf_offset = 0;
+
+  _tagger.start( _rate );
+
+  _run_read_task = true;
+  _thread = gr::thread::thread( boost::bind(&redpitaya_source_c::read_task, this) );
+
+  return true;
+}
+
+bool redpitaya_source_c::stop()
+{
+  _run_read_task = false;
+  _ring.shutdown();
+  _thread.join();
+
+  return true;
+}
+
+/* Publish the pending bytes on a receive timeout. TCP delivers
+ * arbitrary chunk sizes, so the pending fill may end mid-sample;
+ * committing that would leave work() facing a head buffer that is
+ * not a whole number of samples and desync the I/Q stream. Commit
+ * whole samples only and carry the partial tail into the next
+ * buffer, just like the MSG_WAITALL receive of old guaranteed. */
+void redpitaya_source_c::flush_whole_samples( size_t &fill )
+{
+  size_t tail = fill % BYTES_PER_SAMPLE;
+
+  if ( fill == tail ) /* not even one whole sample yet */
+    return;
+
+  unsigned char rem[BYTES_PER_SAMPLE];
+
+  if ( tail )
+    memcpy( rem, _ring.write_head() + fill - tail, tail );
+
+  _ring.commit( fill - tail );
+  fill = 0;
+
+  if ( !tail )
+    return;
+
+  unsigned char *dest = _ring.write_head();
+  if ( !dest && _ring.wait_room() )
+    dest = _ring.write_head();
+
+  if ( dest ) /* NULL only on shutdown, the tail is moot then */
+  {
+    memcpy( dest, rem, tail );
+    fill = tail;
+  }
+}
+
+/* runs apart from the scheduler so the network round trips overlap
+ * with the downstream DSP instead of serializing with it */
+void redpitaya_source_c::read_task()
+{
+  size_t fill = 0;
+
+  _prio.apply();
+
+  /* multishot receive reaps a whole batch of transfers per wakeup
+   * where the fallback below costs a select() plus a recv() syscall
+   * per buffer fill */
+  osmosdr::uring_reader uring;
+  const bool use_uring = uring.start( _sockets[1], false );
+  const unsigned char *chunk = NULL;
+  int chunk_len = 0;
+  int chunk_off = 0;
+
+  while ( _run_read_task )
+  {
+    if ( use_uring )
+    {
+      if ( chunk_off == chunk_len )
+      {
+        chunk_len = uring.next( &chunk, 100 );
+        chunk_off = 0;
+
+        if ( osmosdr::uring_reader::TIMEOUT == chunk_len )
+        {
+          chunk_len = 0;
+          /* nothing pending, publish what we have so the consumer is
+           * not starved at low sample rates */
+          flush_whole_samples( fill );
+          continue;
+        }
+
+        if ( chunk_len <= 0 )
+        {
+          std::cerr << "Receiving samples failed." << std::endl;
+          _run_read_task = false;
+          _ring.shutdown();
+          break;
+        }
+      }
+
+      unsigned char *dest = _ring.write_head();
+      if ( !dest )
+      {
+        /* the consumer fell behind, block instead of dropping */
+        if ( !_ring.wait_room() )
+          break;
+        continue;
+      }
+
+      size_t ncopy = std::min( (size_t)(chunk_len - chunk_off),
+                               REDPITAYA_BUF_LEN - fill );
+      memcpy( dest + fill, chunk + chunk_off, ncopy );
+      chunk_off += ncopy;
+      fill += ncopy;
+
+      if ( REDPITAYA_BUF_LEN == fill )
+      {
+        _ring.commit( fill );
+        fill = 0;
+      }
+
+      continue;
+    }
+
+    fd_set fds;
+    struct timeval tv;
+
+    FD_ZERO( &fds );
+    FD_SET( _sockets[1], &fds );
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+
+    if ( select( _sockets[1] + 1, &fds, NULL, NULL, &tv ) <= 0 )
+    {
+      /* nothing pending, publish what we have so the consumer is not
+       * starved at low sample rates */
+      flush_whole_samples( fill );
+      continue;
+    }
+
+    unsigned char *dest = _ring.write_head();
+    if ( !dest )
+    {
+      /* the consumer fell behind, block instead of dropping */
+      if ( !_ring.wait_room() )
+        break;
+      continue;
+    }
+
+#if defined(_WIN32)
+    int size = ::recv( _sockets[1], (char *)dest + fill,
+                       REDPITAYA_BUF_LEN - fill, 0 );
+#else
+    ssize_t size = ::recv( _sockets[1], dest + fill,
+                           REDPITAYA_BUF_LEN - fill, 0 );
+#endif
+
+    if ( size <= 0 )
+    {
+      std::cerr << "Receiving samples failed." << std::endl;
+      _run_read_task = false;
+      _ring.shutdown();
+      break;
+    }
+
+    fill += size;
+
+    if ( REDPITAYA_BUF_LEN == fill )
+    {
+      _ring.commit( fill );
+      fill = 0;
+    }
+  }
+}
+
 int redpitaya_source_c::work( int noutput_items,
                               gr_vector_const_void_star &input_items,
                               gr_vector_void_star &output_items )
 {
   gr_complex *out = (gr_complex *)output_items[0];
+  int processed = 0;
 
-#if defined(_WIN32)
-  int size;
-  int total = sizeof(gr_complex) * noutput_items;
-  size = ::recv( _sockets[1], (char *)out, total, MSG_WAITALL );
-#else
-  ssize_t size;
-  ssize_t total = sizeof(gr_complex) * noutput_items;
-  size = ::recv( _sockets[1], out, total, MSG_WAITALL );
-#endif
+  if ( !_ring.wait( 1 ) )
+    return WORK_DONE;
 
-  if ( size != total )
-    throw std::runtime_error( "Receiving samples failed." );
+  while ( processed < noutput_items && _ring.used() )
+  {
+    size_t avail = _ring.head_len() / BYTES_PER_SAMPLE - _buf_offset;
+    size_t chunk = std::min( avail, size_t(noutput_items - processed) );
+
+    memcpy( out + processed,
+            (const gr_complex *)_ring.head() + _buf_offset,
+            chunk * BYTES_PER_SAMPLE );
+
+    processed += chunk;
+    _buf_offset += chunk;
+
+    if ( _buf_offset * BYTES_PER_SAMPLE == _ring.head_len() )
+    {
+      _ring.pop();
+      _buf_offset = 0;
+    }
+  }
+
+  _tagger.tag_work( this, 0, processed );
 
-  return noutput_items;
+  return processed;
 }
 
 std::string redpitaya_source_c::name()
@@ -160,7 +374,7 @@ size_t redpitaya_source_c::get_num_channels( void )
   return 1;
 }
 
-osmosdr::meta_range_t redpitaya_source_c::get_sample_rates( void )
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -174,6 +388,14 @@ osmosdr::meta_range_t redpitaya_source_c::get_sample_rates( void )
   return range;
 }
 
+osmosdr::meta_range_t redpitaya_source_c::get_sample_rates( void )
+{
+  /* built once - UIs poll this during interactive tuning */
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 double redpitaya_source_c::set_sample_rate( double rate )
 {
   uint32_t command = 0;
@@ -191,6 +413,8 @@ double redpitaya_source_c::set_sample_rate( double rate )
 
   _rate = rate;
 
+  _tagger.set_rate( rate );
+
   return get_sample_rate();
 }
 
@@ -285,3 +509,8 @@ std::string redpitaya_source_c::get_antenna( size_t chan )
 {
   return "RX";
 }
+
+osmosdr::stream_stats_t redpitaya_source_c::get_stream_stats( size_t chan )
+{
+  return _ring.stats( BYTES_PER_SAMPLE );
+}
@@ -22,8 +22,12 @@
 #define REDPITAYA_SOURCE_C_H
 
 #include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
 
+#include "buffer_ring.h"
 #include "source_iface.h"
+#include "stream_tagger.h"
+#include "thread_prio.h"
 
 #include "redpitaya_common.h"
 
@@ -45,6 +49,9 @@ private:
 public:
   ~redpitaya_source_c();
 
+  bool start();
+  bool stop();
+
   int work( int noutput_items,
             gr_vector_const_void_star &input_items,
             gr_vector_void_star &output_items );
@@ -77,9 +84,23 @@ public:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
+  void read_task();
+  void flush_whole_samples( size_t &fill );
+
   double _freq, _rate, _corr;
   SOCKET _sockets[2];
+
+  /* the reader thread keeps the ring filled ahead of the scheduler so
+   * network round trips overlap with the downstream DSP */
+  gr::thread::thread _thread;
+  bool _run_read_task;
+  osmosdr::thread_prio _prio;
+  osmosdr::stream_tagger _tagger;
+  osmosdr::buffer_ring _ring;
+  size_t _buf_offset;
 };
 
 #endif // REDPITAYA_SOURCE_C_H
@@ -61,6 +61,8 @@
 #include <gnuradio/io_signature.h>
 
 #include "arg_helpers.h"
+#include "buffer_pool.h"
+#include "convert/convert.h"
 #include "rfspace_source_c.h"
 
 using namespace boost::assign;
@@ -110,14 +112,20 @@ rfspace_source_c::rfspace_source_c (const std::string &args)
 #else
     _tcp(-1),
     _udp(-1),
+#ifdef __linux__
+    _uring_ok(false),
+#endif
 #endif
     _usb(-1),
     _running(false),
     _keep_running(false),
     _sequence(0),
     _nchan(1),
+    _bits(16),
     _sample_rate(NAN),
     _bandwidth(0.0f),
+    _corked(false),
+    _cork_pending(0),
     _fifo(NULL)
 {
   std::string host = "";
@@ -125,6 +133,10 @@ rfspace_source_c::rfspace_source_c (const std::string &args)
 
   dict_t dict = params_to_dict(args);
 
+  _prio.parse(dict);
+  if (_prio.numa_node() >= 0)
+    osmosdr::buffer_pool::instance().set_numa_node(_prio.numa_node());
+
   if ( dict.count("sdr-iq") )
     dict["rfspace"] = dict["sdr-iq"];
 
@@ -182,6 +194,12 @@ rfspace_source_c::rfspace_source_c (const std::string &args)
   if ( _nchan < 1 || _nchan > 2 )
     throw std::runtime_error("Number of channels (nchan) must be 1 or 2");
 
+  if (dict.count("bits"))
+    _bits = boost::lexical_cast< size_t >( dict["bits"] );
+
+  if ( _bits != 16 && _bits != 24 )
+    throw std::runtime_error("Sample resolution (bits) must be 16 or 24");
+
   if ( ! host.length() )
     host = DEFAULT_HOST;
 
@@ -326,6 +344,13 @@ rfspace_source_c::rfspace_source_c (const std::string &args)
     sockoptval = 1;
     setsockopt(_udp, SOL_SOCKET, SO_REUSEADDR, &sockoptval, sizeof(int));
 
+    /* a generous receive buffer absorbs scheduling hiccups, may be
+     * tuned through the rcvbuf=<bytes> argument */
+    sockoptval = 1024 * 1024;
+    if ( dict.count("rcvbuf") )
+      sockoptval = boost::lexical_cast< int >( dict["rcvbuf"] );
+    setsockopt(_udp, SOL_SOCKET, SO_RCVBUF, &sockoptval, sizeof(int));
+
     /* fill in the hosts's address and data */
     memset(&host_sa, 0, sizeof(host_sa));
     host_sa.sin_family = AF_INET;
@@ -558,6 +583,17 @@ bool rfspace_source_c::transaction( const unsigned char *cmd, size_t size )
 {
   std::vector< unsigned char > response;
 
+  if ( _corked )
+  {
+    /* collected here, the whole batch leaves in cork_flush() */
+    boost::mutex::scoped_lock lock(_tcp_lock);
+
+    _cork_buf.insert( _cork_buf.end(), cmd, cmd + size );
+    _cork_pending++;
+
+    return true;
+  }
+
   if ( ! transaction( cmd, size, response ) )
     return false;
 
@@ -576,6 +612,11 @@ bool rfspace_source_c::transaction( const unsigned char *cmd, size_t size,
   size_t rx_bytes = 0;
   unsigned char data[1024*2];
 
+  /* a setter that needs the response cannot stay corked - push out
+   * what queued up so far, the device answers strictly in order */
+  if ( _cork_pending && ! cork_flush() )
+    return false;
+
   response.clear();
 
 #ifdef VERBOSE
@@ -640,6 +681,48 @@ bool rfspace_source_c::transaction( const unsigned char *cmd, size_t size,
   return true;
 }
 
+bool rfspace_source_c::cork_flush( void )
+{
+  boost::mutex::scoped_lock lock(_tcp_lock);
+
+  if ( ! _cork_pending )
+    return true;
+
+  std::vector< unsigned char > buf;
+  buf.swap( _cork_buf );
+
+  size_t pending = _cork_pending;
+  _cork_pending = 0;
+
+#ifndef USE_ASIO
+  if ( write(_tcp, buf.data(), buf.size()) != (int)buf.size() )
+    return false;
+
+  /* one response frame per set item, drained in command order */
+  while ( pending-- )
+  {
+    unsigned char data[1024*2];
+
+    int nbytes = read(_tcp, data, 2); /* read header */
+    if ( nbytes != 2 )
+      return false;
+
+    int length = (data[1] & 0x1f) | data[0];
+
+    if ( (length < 2) || (length > (int)sizeof(data)) )
+      return false;
+
+    length -= 2; /* subtract header size */
+
+    nbytes = read(_tcp, &data[2], length); /* read payload */
+    if ( nbytes != length )
+      return false;
+  }
+#endif
+
+  return true;
+}
+
 static size_t read_bytes( int fd, char *data, size_t size, bool &run )
 {
   size_t nbytes = 0;
@@ -668,6 +751,8 @@ void rfspace_source_c::usb_read_task()
   if ( -1 == _usb )
     return;
 
+  _prio.apply();
+
   while ( _run_usb_read_task )
   {
     size_t nbytes = read_bytes( _usb, data, 2, _run_usb_read_task );
@@ -782,7 +867,7 @@ bool rfspace_source_c::start()
 
   unsigned char mode = 0; /* 0 = 16 bit Contiguous Mode */
 
-  if ( 0 ) /* TODO: 24 bit Contiguous mode */
+  if ( 24 == _bits && RFSPACE_SDR_IQ != _radio ) /* 24 bit Contiguous mode */
     mode |= 0x80;
 
   if ( 0 ) /* TODO: Hardware Triggered Pulse mode */
@@ -852,9 +937,92 @@ int rfspace_source_c::work( int noutput_items,
     return noutput_items;
   }
 
+  gr_complex *out1 = (gr_complex *)output_items[0];
+  gr_complex *out2 = (2 == _nchan) ? (gr_complex *)output_items[1] : NULL;
+
 #ifdef USE_ASIO
   udp::endpoint ep;
   size_t rx_bytes = _u.receive_from( boost::asio::buffer(data, sizeof(data)), ep );
+
+  return parse_udp_packet( data, rx_bytes, out1, out2 );
+#elif defined(__linux__)
+  #define RX_BATCH 32
+
+  if ( _msgs.empty() ) /* set up the packet arena on first use */
+  {
+    _pkt_arena.resize( RX_BATCH * sizeof(data) );
+    _msgs.resize( RX_BATCH );
+    _iovs.resize( RX_BATCH );
+
+    for ( size_t i = 0; i < RX_BATCH; i++ )
+    {
+      memset( &_msgs[i], 0, sizeof(struct mmsghdr) );
+      _iovs[i].iov_base = &_pkt_arena[ i * sizeof(data) ];
+      _iovs[i].iov_len = sizeof(data);
+      _msgs[i].msg_hdr.msg_iov = &_iovs[i];
+      _msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* the multishot receive engine replaces recvmmsg() batching when
+     * the kernel supports it (see lib/uring_reader.h) */
+    _uring_ok = _uring.start( _udp, true );
+  }
+
+  /* a 1 KB datagram holds at most 255 samples, so this cap guarantees
+   * that a full batch still fits into the output buffer */
+  unsigned int max_pkts = std::min( (int)RX_BATCH,
+                                    std::max( 1, noutput_items / 256 ) );
+
+  if ( _uring_ok )
+  {
+    /* block for the first datagram, then drain the completion queue
+     * without another syscall - the kernel has already placed the
+     * packets into the registered buffers */
+    int produced = 0;
+
+    for ( unsigned int i = 0; i < max_pkts; i++ )
+    {
+      const unsigned char *pkt;
+      int n = _uring.next( &pkt, i ? 0 : -1 );
+
+      if ( osmosdr::uring_reader::TIMEOUT == n )
+        break;
+
+      if ( n <= 0 )
+      {
+        std::cerr << "uring receive returned " << n << std::endl;
+        return produced ? produced : WORK_DONE;
+      }
+
+      produced += parse_udp_packet( pkt, n,
+                                    out1 + produced,
+                                    out2 ? out2 + produced : NULL );
+    }
+
+    return produced;
+  }
+
+  /* block for the first datagram, then drain whatever else is queued
+   * without going back to sleep - one syscall for the whole batch */
+  int nrecv = recvmmsg( _udp, &_msgs[0], max_pkts, MSG_WAITFORONE, NULL );
+  if ( nrecv <= 0 )
+  {
+    std::cerr << "recvmmsg returned " << nrecv << std::endl;
+    return WORK_DONE;
+  }
+
+  int produced = 0;
+
+  for ( int i = 0; i < nrecv; i++ )
+  {
+    int n = parse_udp_packet( &_pkt_arena[ i * sizeof(data) ],
+                              _msgs[i].msg_len,
+                              out1 + produced,
+                              out2 ? out2 + produced : NULL );
+    produced += n;
+  }
+
+  return produced;
 #else
   struct sockaddr_in sa_in;           /* remote address */
   socklen_t addrlen = sizeof(sa_in);  /* length of addresses */
@@ -864,85 +1032,81 @@ int rfspace_source_c::work( int noutput_items,
     std::cerr << "recvfrom returned " << rx_bytes << std::endl;
     return WORK_DONE;
   }
+
+  return parse_udp_packet( data, rx_bytes, out1, out2 );
 #endif
+}
 
+int rfspace_source_c::parse_udp_packet( const unsigned char *data, size_t rx_bytes,
+                                        gr_complex *out1, gr_complex *out2 )
+{
   #define HEADER_SIZE 2
   #define SEQNUM_SIZE 2
 
-//  bool is_24_bit = false;   // TODO: implement 24 bit sample format
+  bool is_24_bit = false;
 
   /* check header */
   if ( (0x04 == data[0] && (0x84 == data[1] || 0x82 == data[1])) )
   {
-//    is_24_bit = false;
+    is_24_bit = false;
   }
   else if ( (0xA4 == data[0] && 0x85 == data[1]) ||
             (0x84 == data[0] && 0x81 == data[1]) )
   {
-//    is_24_bit = true;
-    return 0;
+    is_24_bit = true;
   }
   else
     return 0;
 
-  uint16_t sequence = *((uint16_t *)(data + HEADER_SIZE));
+  uint16_t sequence = *((const uint16_t *)(data + HEADER_SIZE));
 
   uint16_t diff = sequence - _sequence;
 
   if ( diff > 1 )
   {
-    std::cerr << "Lost " << diff << " packets from "
-#ifdef USE_ASIO
-              << ep
-#else
-              << inet_ntoa(sa_in.sin_addr) << ":" << ntohs(sa_in.sin_port)
-#endif
-              << std::endl;
+    std::cerr << "Lost " << diff << " packets" << std::endl;
   }
 
   _sequence = (0xffff == sequence) ? 0 : sequence;
 
   /* get pointer to samples */
-  int16_t *sample = (int16_t *)(data + HEADER_SIZE + SEQNUM_SIZE);
+  const unsigned char *payload = data + HEADER_SIZE + SEQNUM_SIZE;
+  size_t payload_bytes = rx_bytes - HEADER_SIZE - SEQNUM_SIZE;
 
-  size_t rx_samples = (rx_bytes - HEADER_SIZE - SEQNUM_SIZE) / (sizeof(int16_t) * 2);
-
-  #define SCALE_16  (1.0f/32768.0f)
+  size_t rx_samples = is_24_bit ? payload_bytes / (3 * 2)
+                                : payload_bytes / (sizeof(int16_t) * 2);
 
   if ( 1 == _nchan )
   {
-    gr_complex *out = (gr_complex *)output_items[0];
-    for ( size_t i = 0; i < rx_samples; i++ )
-    {
-      out[i] = gr_complex( *(sample+0) * SCALE_16,
-                           *(sample+1) * SCALE_16 );
-
-      sample += 2;
-    }
+    /* interleaved I/Q converts straight into the output buffer, the
+     * kernels dispatch to SIMD at runtime where VOLK is available */
+    if ( is_24_bit )
+      osmosdr::convert::s24_fc32( payload, (float *)out1, rx_samples * 2 );
+    else
+      osmosdr::convert::s16_fc32( (const int16_t *)payload, (float *)out1,
+                                  rx_samples * 2 );
   }
   else if ( 2 == _nchan )
   {
     rx_samples /= 2;
 
-    gr_complex *out1 = (gr_complex *)output_items[0];
-    gr_complex *out2 = (gr_complex *)output_items[1];
-    for ( size_t i = 0; i < rx_samples; i++ )
-    {
-      out1[i] = gr_complex( *(sample+0) * SCALE_16,
-                            *(sample+1) * SCALE_16 );
+    /* convert the whole packet in one vectorized pass, then split the
+     * channel interleave (I1 Q1 I2 Q2 ...) out of the float data */
+    float buf[1024];
 
-      out2[i] = gr_complex( *(sample+2) * SCALE_16,
-                            *(sample+3) * SCALE_16 );
+    if ( is_24_bit )
+      osmosdr::convert::s24_fc32( payload, buf, rx_samples * 4 );
+    else
+      osmosdr::convert::s16_fc32( (const int16_t *)payload, buf, rx_samples * 4 );
 
-      sample += 4;
+    for ( size_t i = 0; i < rx_samples; i++ )
+    {
+      out1[i] = gr_complex( buf[4*i+0], buf[4*i+1] );
+      out2[i] = gr_complex( buf[4*i+2], buf[4*i+3] );
     }
   }
 
-  #undef SCALE_16
-
-  noutput_items = rx_samples;
-
-  return noutput_items;
+  return rx_samples;
 }
 
 /* discovery protocol internals taken from CuteSDR project */
@@ -1746,3 +1910,38 @@ osmosdr::freq_range_t rfspace_source_c::get_bandwidth_range( size_t chan )
 
   return bandwidths;
 }
+
+void rfspace_source_c::apply( const std::map< std::string, std::string > &settings,
+                              size_t chan )
+{
+#ifndef USE_ASIO
+  /* the networked radios take the batch corked: the setters' control
+   * items collect in _cork_buf and leave the host in a single write,
+   * the responses are drained afterwards. Only setters that read the
+   * response back (e.g. the sample rate) still cost their own round
+   * trip, so a full reconfiguration is one or two RTTs. The SDR-IQ
+   * hangs off USB where the RTT concern does not apply. */
+  if ( RFSPACE_SDR_IQ != _radio )
+  {
+    _corked = true;
+
+    try
+    {
+      source_iface::apply( settings, chan );
+    }
+    catch (...)
+    {
+      _corked = false;
+      cork_flush();
+      throw;
+    }
+
+    _corked = false;
+    cork_flush();
+
+    return;
+  }
+#endif
+
+  source_iface::apply( settings, chan );
+}
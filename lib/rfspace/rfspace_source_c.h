@@ -33,8 +33,14 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
 
+#if defined(__linux__) && !defined(USE_ASIO)
+#include <sys/socket.h>
+#endif
+
 #include "osmosdr/ranges.h"
 #include "source_iface.h"
+#include "thread_prio.h"
+#include "uring_reader.h"
 #ifdef USE_ASIO
 using boost::asio::ip::tcp;
 using boost::asio::ip::udp;
@@ -120,6 +126,9 @@ public:
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
+  void apply( const std::map< std::string, std::string > &settings,
+              size_t chan = 0 );
+
 private: /* functions */
   void apply_channel( unsigned char *cmd, size_t chan = 0 );
 
@@ -128,9 +137,16 @@ private: /* functions */
   bool transaction( const unsigned char *cmd, size_t size,
                     std::vector< unsigned char > &response );
 
+  /*! Send all corked control items in one network write and drain one
+   * response frame per item. \return false on a control channel error */
+  bool cork_flush( void );
+
   void usb_read_task();
   void tcp_keepalive_task();
 
+  int parse_udp_packet( const unsigned char *data, size_t rx_bytes,
+                        gr_complex *out1, gr_complex *out2 );
+
 private: /* members */
   enum radio_type
   {
@@ -151,6 +167,15 @@ private: /* members */
 #else
   SOCKET _tcp;
   SOCKET _udp;
+#ifdef __linux__
+  /* preallocated arena for batched datagram reception via recvmmsg() */
+  std::vector< unsigned char > _pkt_arena;
+  std::vector< struct mmsghdr > _msgs;
+  std::vector< struct iovec > _iovs;
+  /* io_uring datagram reader, preferred over recvmmsg() when armed */
+  osmosdr::uring_reader _uring;
+  bool _uring_ok;
+#endif
 #endif
   int _usb;
   bool _running;
@@ -158,14 +183,22 @@ private: /* members */
   uint16_t _sequence;
 
   size_t _nchan;
+  size_t _bits; /* sample resolution on the wire, 16 or 24 */
   double _sample_rate;
   double _bandwidth;
 
   gr::thread::thread _thread;
   bool _run_usb_read_task;
+  osmosdr::thread_prio _prio;
   bool _run_tcp_keepalive_task;
   boost::mutex _tcp_lock;
 
+  /* apply() corks the control channel: set item commands queue up here
+   * and leave the host in a single write instead of one RTT each */
+  bool _corked;
+  size_t _cork_pending;
+  std::vector< unsigned char > _cork_buf;
+
   boost::circular_buffer<gr_complex> *_fifo;
   boost::mutex _fifo_lock;
   boost::condition_variable _samp_avail;
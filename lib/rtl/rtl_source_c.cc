@@ -29,19 +29,31 @@
 
 #include "rtl_source_c.h"
 #include <gnuradio/io_signature.h>
+#include <osmosdr/source.h>
 
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/detail/endian.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
+#include <thread>
 
 #include <rtl-sdr.h>
 
+
 #include "arg_helpers.h"
+#include "buffer_pool.h"
+#include "convert/convert.h"
+#include "handle_cache.h"
+#include "trace.h"
 
 using namespace boost::assign;
 
@@ -62,99 +74,77 @@ make_rtl_source_c (const std::string &args)
 }
 
 /*
- * Specify constraints on number of input and output streams.
- * This info is used to construct the input and output signatures
- * (2nd & 3rd args to gr::block's constructor).  The input and
- * output signatures are used by the runtime system to
- * check that a valid number and type of inputs and outputs
- * are connected to this block.  In this case, we accept
- * only 0 input and 1 output.
+ * The rtl= argument selects the dongle(s) to open: a single index or
+ * serial as before, or several joined with '+' for the coherent
+ * multi-channel mode. One output channel per dongle.
  */
-static const int MIN_IN = 0;	// mininum number of input streams
-static const int MAX_IN = 0;	// maximum number of input streams
-static const int MIN_OUT = 1;	// minimum number of output streams
-static const int MAX_OUT = 1;	// maximum number of output streams
+static std::vector< std::string > device_specs( const std::string &args )
+{
+  dict_t dict = params_to_dict(args);
+  std::vector< std::string > specs;
+
+  if (dict.count("rtl"))
+    boost::algorithm::split( specs, dict["rtl"], boost::is_any_of("+") );
+
+  if (specs.empty())
+    specs.push_back("");
+
+  return specs;
+}
 
 /*
  * The private constructor
  */
 rtl_source_c::rtl_source_c (const std::string &args)
   : gr::sync_block ("rtl_source_c",
-        gr::io_signature::make(MIN_IN, MAX_IN, sizeof (gr_complex)),
-        gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof (gr_complex))),
-    _dev(NULL),
-    _buf(NULL),
+        gr::io_signature::make(0, 0, sizeof (gr_complex)),
+        gr::io_signature::make(device_specs(args).size(),
+                               device_specs(args).size(),
+                               args_to_sc16_output(args) ?
+                                 2 * sizeof (short) : sizeof (gr_complex))),
     _running(false),
     _no_tuner(false),
     _auto_gain(false),
     _if_gain(0),
-    _skipped(0)
+    _sc16(args_to_sc16_output(args)),
+    _defer(false),
+    _opened(false),
+    _bias_tee(0),
+    _rtl_freq(0),
+    _tuner_freq(0),
+    _direct_samp(0),
+    _offset_tune(0),
+    _replay_pace(true)
 {
-  int ret;
   int index;
-  int bias_tee = 0;
-  unsigned int dev_index = 0, rtl_freq = 0, tuner_freq = 0, direct_samp = 0;
-  unsigned int offset_tune = 0;
   char manufact[256];
   char product[256];
   char serial[256];
 
   dict_t dict = params_to_dict(args);
-
-  if (dict.count("rtl")) {
-    std::string value = dict["rtl"];
-
-    if ( (index = rtlsdr_get_index_by_serial( value.c_str() )) >= 0 ) {
-      dev_index = index; /* use the resolved index value */
-    } else { /* use the numeric value of the argument */
-      if ( value.length() ) {
-        try {
-          dev_index = boost::lexical_cast< unsigned int >( value );
-        } catch ( std::exception &ex ) {
-          throw std::runtime_error(
-                "Failed to use '" + value + "' as index: " + ex.what());
-        }
-      }
-    }
-  }
-
-  if ( dev_index >= rtlsdr_get_device_count() )
-    throw std::runtime_error("Wrong rtlsdr device index given.");
-
-  std::cerr << "Using device #" << dev_index;
-
-  memset(manufact, 0, sizeof(manufact));
-  memset(product, 0, sizeof(product));
-  memset(serial, 0, sizeof(serial));
-  if ( !rtlsdr_get_device_usb_strings( dev_index, manufact, product, serial ) ) {
-    if (strlen(manufact))
-      std::cerr << " " << manufact;
-    if (strlen(product))
-      std::cerr << " " << product;
-    if (strlen(serial))
-      std::cerr << " SN: " << serial;
-  } else {
-    std::cerr << " " << rtlsdr_get_device_name(dev_index);
-  }
-
-  std::cerr << std::endl;
+  std::vector< std::string > specs = device_specs(args);
 
   if (dict.count("rtl_xtal"))
-    rtl_freq = (unsigned int)boost::lexical_cast< double >( dict["rtl_xtal"] );
+    _rtl_freq = (unsigned int)boost::lexical_cast< double >( dict["rtl_xtal"] );
 
   if (dict.count("tuner_xtal"))
-    tuner_freq = (unsigned int)boost::lexical_cast< double >( dict["tuner_xtal"] );
+    _tuner_freq = (unsigned int)boost::lexical_cast< double >( dict["tuner_xtal"] );
 
   if (dict.count("direct_samp"))
-    direct_samp = boost::lexical_cast< unsigned int >( dict["direct_samp"] );
+    _direct_samp = boost::lexical_cast< unsigned int >( dict["direct_samp"] );
 
   if (dict.count("offset_tune"))
-    offset_tune = boost::lexical_cast< unsigned int >( dict["offset_tune"] );
+    _offset_tune = boost::lexical_cast< unsigned int >( dict["offset_tune"] );
 
   if (dict.count("bias"))
-    bias_tee = boost::lexical_cast<bool>( dict["bias"] );
+    _bias_tee = boost::lexical_cast<bool>( dict["bias"] );
+
+  /* defer=1 leaves the dongles unopened: construction only enumerates,
+   * so range/serial queries do not block a concurrent real consumer */
+  if (dict.count("defer"))
+    _defer = boost::lexical_cast<bool>( dict["defer"] );
 
-  _buf_num = _buf_len = _buf_head = _buf_used = _buf_offset = 0;
+  _buf_num = _buf_len = 0;
 
   if (dict.count("buffers"))
     _buf_num = boost::lexical_cast< unsigned int >( dict["buffers"] );
@@ -162,6 +152,15 @@ rtl_source_c::rtl_source_c (const std::string &args)
   if (dict.count("buflen"))
     _buf_len = boost::lexical_cast< unsigned int >( dict["buflen"] );
 
+  _prio.parse(dict);
+  if (_prio.numa_node() >= 0)
+    osmosdr::buffer_pool::instance().set_numa_node(_prio.numa_node());
+
+  /* latency=<ms> sizes the geometry from the sample rate at start();
+   * explicit buffers= / buflen= settings take precedence */
+  if (0 == _buf_num && 0 == _buf_len)
+    _geometry.parse(dict);
+
   if (0 == _buf_num)
     _buf_num = BUF_NUM;
 
@@ -173,70 +172,179 @@ rtl_source_c::rtl_source_c (const std::string &args)
               << std::endl;
   }
 
-  _samp_avail = _buf_len / BYTES_PER_SAMPLE;
+  bool persist = osmosdr::handle_cache::wanted(dict);
 
-  // create a lookup table for gr_complex values
-  for (unsigned int i = 0; i < 0x100; i++)
-    _lut.push_back((i - 127.4f) / 128.0f);
+  if (dict.count("replay")) {
+    _replay_path = dict["replay"];
 
-  _dev = NULL;
-  ret = rtlsdr_open( &_dev, dev_index );
-  if (ret < 0)
-    throw std::runtime_error("Failed to open rtlsdr device.");
+    if (dict.count("replay_pace"))
+      _replay_pace = boost::lexical_cast<bool>( dict["replay_pace"] );
+  }
+
+  BOOST_FOREACH( std::string spec, specs ) {
+    /* a recording stands in for the dongle, no hardware is touched */
+    if ( ! _replay_path.empty() ) {
+      std::cerr << "Replaying " << _replay_path
+                << (_replay_pace ? " at the recorded pace" : " at full speed")
+                << std::endl;
+
+      rtl_dev_t *dev = new rtl_dev_t;
+      _devs.push_back( dev );
+
+      dev->ring.resize(_buf_num, _buf_len);
+      dev->ring.parse_overflow_policy(dict);
+      dev->ring.parse_watermark(dict);
+      dev->samp_avail = _buf_len / BYTES_PER_SAMPLE;
+      continue;
+    }
+
+    unsigned int dev_index = 0;
+
+    if ( (index = rtlsdr_get_index_by_serial( spec.c_str() )) >= 0 ) {
+      dev_index = index; /* use the resolved index value */
+    } else { /* use the numeric value of the argument */
+      if ( spec.length() ) {
+        try {
+          dev_index = boost::lexical_cast< unsigned int >( spec );
+        } catch ( std::exception &ex ) {
+          throw std::runtime_error(
+                "Failed to use '" + spec + "' as index: " + ex.what());
+        }
+      }
+    }
+
+    if ( dev_index >= rtlsdr_get_device_count() )
+      throw std::runtime_error("Wrong rtlsdr device index given.");
+
+    std::cerr << "Using device #" << dev_index;
+
+    memset(manufact, 0, sizeof(manufact));
+    memset(product, 0, sizeof(product));
+    memset(serial, 0, sizeof(serial));
+    if ( !rtlsdr_get_device_usb_strings( dev_index, manufact, product, serial ) ) {
+      if (strlen(manufact))
+        std::cerr << " " << manufact;
+      if (strlen(product))
+        std::cerr << " " << product;
+      if (strlen(serial))
+        std::cerr << " SN: " << serial;
+    } else {
+      std::cerr << " " << rtlsdr_get_device_name(dev_index);
+    }
+
+    std::cerr << std::endl;
+
+    rtl_dev_t *dev = new rtl_dev_t;
+    _devs.push_back( dev );
+
+    dev->index = dev_index;
+
+    if ( persist )
+      dev->cache_key = str(boost::format("rtl,%u") % dev_index);
 
-  if (rtl_freq > 0 || tuner_freq > 0) {
-    if (rtl_freq)
-      std::cerr << "Setting rtl clock to " << rtl_freq << " Hz." << std::endl;
-    if (tuner_freq)
-      std::cerr << "Setting tuner clock to " << tuner_freq << " Hz." << std::endl;
+    if ( !_defer )
+      open_device( dev );
 
-    ret = rtlsdr_set_xtal_freq( _dev, rtl_freq, tuner_freq );
+    dev->ring.resize(_buf_num, _buf_len);
+    dev->ring.parse_overflow_policy(dict);
+    dev->ring.parse_watermark(dict);
+    dev->samp_avail = _buf_len / BYTES_PER_SAMPLE;
+    dev->recorder.parse(dict, _devs.size() - 1, specs.size());
+  }
+
+  if ( !_defer )
+    for (size_t chan = 0; chan < _devs.size(); chan++)
+      set_if_gain( 24, chan ); /* preset to a reasonable default (non-GRC use case) */
+}
+
+/*
+ * Open one dongle and bring it into the defined post-construction
+ * state. With defer=1 this runs from ensure_opened() instead of the
+ * constructor, so enumeration-only consumers never claim the device.
+ */
+void rtl_source_c::open_device( rtl_dev_t *dev )
+{
+  int ret;
+
+  if ( dev->cache_key.length() )
+    dev->dev = (rtlsdr_dev_t *)
+        osmosdr::handle_cache::instance().acquire( dev->cache_key );
+
+  if ( dev->dev ) {
+    std::cerr << "Reattached to cached rtlsdr handle." << std::endl;
+  } else {
+    ret = rtlsdr_open( &dev->dev, dev->index );
+    if (ret < 0)
+      throw std::runtime_error("Failed to open rtlsdr device.");
+  }
+
+  if (_rtl_freq > 0 || _tuner_freq > 0) {
+    if (_rtl_freq)
+      std::cerr << "Setting rtl clock to " << _rtl_freq << " Hz." << std::endl;
+    if (_tuner_freq)
+      std::cerr << "Setting tuner clock to " << _tuner_freq << " Hz." << std::endl;
+
+    ret = rtlsdr_set_xtal_freq( dev->dev, _rtl_freq, _tuner_freq );
     if (ret < 0)
       throw std::runtime_error(
         str(boost::format("Failed to set xtal frequencies. Error %d.") % ret ));
   }
 
-  ret = rtlsdr_set_sample_rate( _dev, 1024000 );
+  ret = rtlsdr_set_sample_rate( dev->dev, 1024000 );
   if (ret < 0)
     throw std::runtime_error("Failed to set default samplerate.");
 
-  ret = rtlsdr_set_tuner_gain_mode(_dev, int(!_auto_gain));
+  ret = rtlsdr_set_tuner_gain_mode(dev->dev, int(!_auto_gain));
   if (ret < 0)
     throw std::runtime_error("Failed to set tuner gain mode.");
 
-  ret = rtlsdr_set_agc_mode(_dev, int(_auto_gain));
+  ret = rtlsdr_set_agc_mode(dev->dev, int(_auto_gain));
   if (ret < 0)
     throw std::runtime_error("Failed to set agc mode.");
 
-  if (direct_samp) {
-    ret = rtlsdr_set_direct_sampling(_dev, direct_samp);
+  if (_direct_samp) {
+    ret = rtlsdr_set_direct_sampling(dev->dev, _direct_samp);
     if (ret < 0)
       throw std::runtime_error("Failed to enable direct sampling.");
     _no_tuner = true;
   }
 
-  if (offset_tune) {
-    ret = rtlsdr_set_offset_tuning(_dev, offset_tune);
+  if (_offset_tune) {
+    ret = rtlsdr_set_offset_tuning(dev->dev, _offset_tune);
     if (ret < 0)
       throw std::runtime_error("Failed to enable offset tuning.");
   }
 
-  ret = rtlsdr_set_bias_tee(_dev, bias_tee);
+  ret = rtlsdr_set_bias_tee(dev->dev, _bias_tee);
   if (ret < 0)
     throw std::runtime_error("Failed to set bias tee.");
 
-  ret = rtlsdr_reset_buffer( _dev );
+  ret = rtlsdr_reset_buffer( dev->dev );
   if (ret < 0)
     throw std::runtime_error("Failed to reset usb buffers.");
+}
 
-  set_if_gain( 24 ); /* preset to a reasonable default (non-GRC use case) */
+void rtl_source_c::ensure_opened()
+{
+  if ( !_defer || _opened )
+    return;
 
-  _buf = (unsigned char **)malloc(_buf_num * sizeof(unsigned char *));
+  if ( ! _replay_path.empty() ) /* replay mode never touches hardware */
+    return;
 
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i)
-      _buf[i] = (unsigned char *)malloc(_buf_len);
-  }
+  _opened = true; /* set first, the gain preset below comes back through cdev() */
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    if ( ! dev->dev )
+      open_device( dev );
+
+  for (size_t chan = 0; chan < _devs.size(); chan++)
+    set_if_gain( 24, chan ); /* the preset the constructor would have applied */
+}
+
+static void _rtlsdr_cache_close( void *dev )
+{
+  rtlsdr_close( (rtlsdr_dev_t *)dev );
 }
 
 /*
@@ -244,32 +352,66 @@ rtl_source_c::rtl_source_c (const std::string &args)
  */
 rtl_source_c::~rtl_source_c ()
 {
-  if (_dev) {
-    if (_running)
-    {
-      _running = false;
-      rtlsdr_cancel_async( _dev );
-      _thread.join();
-    }
-
-    rtlsdr_close( _dev );
-    _dev = NULL;
+  if (_running) {
+    _running = false;
+    BOOST_FOREACH( rtl_dev_t *dev, _devs )
+      if (dev->dev)
+        rtlsdr_cancel_async( dev->dev );
+    BOOST_FOREACH( rtl_dev_t *dev, _devs )
+      dev->thread.join();
   }
 
-  if (_buf) {
-    for(unsigned int i = 0; i < _buf_num; ++i) {
-      free(_buf[i]);
+  BOOST_FOREACH( rtl_dev_t *dev, _devs ) {
+    if (dev->dev) {
+      if ( dev->cache_key.length() )
+        osmosdr::handle_cache::instance().park( dev->cache_key, dev->dev,
+                                                _rtlsdr_cache_close );
+      else
+        rtlsdr_close( dev->dev );
+      dev->dev = NULL;
     }
-
-    free(_buf);
-    _buf = NULL;
+    delete dev;
   }
+
+  _devs.clear();
 }
 
 bool rtl_source_c::start()
 {
+  ensure_opened();
+
+  if (_geometry.active()) {
+    _geometry.compute(get_sample_rate(), BYTES_PER_SAMPLE,
+                      _buf_num, _buf_len);
+
+    std::cerr << "Using " << _buf_num << " buffers of size " << _buf_len
+              << " for " << _geometry.budget_ms() << " ms of buffering."
+              << std::endl;
+  }
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs ) {
+    dev->ring.resize(_buf_num, _buf_len); /* drops stale buffers, clears shutdown */
+    dev->skipped = 0;
+    dev->buf_offset = 0;
+    dev->samp_avail = _buf_len / BYTES_PER_SAMPLE;
+    dev->zeros_pending = 0;
+    /* the drop counters are cumulative, remember the current state */
+    dev->dropped_seen = dev->ring.stats(BYTES_PER_SAMPLE).dropped_samples;
+    /* drops are padded with zeros below, so the time base stays
+     * continuous from here on */
+    dev->tagger.start(get_sample_rate());
+  }
+
   _running = true;
-  _thread = gr::thread::thread(_rtlsdr_wait, this);
+
+  /* the per-dongle usb buffer reset runs concurrently in the reader
+   * threads, which then rendezvous on this barrier - starting eight
+   * dongles costs as much as starting one and keeps them aligned */
+  _start_barrier.reset( new boost::barrier( _devs.size() ) );
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    dev->thread = gr::thread::thread(
+          _replay_path.empty() ? _rtlsdr_wait : _replay_wait, this, dev);
 
   return true;
 }
@@ -277,101 +419,284 @@ bool rtl_source_c::start()
 bool rtl_source_c::stop()
 {
   _running = false;
-  if (_dev)
-    rtlsdr_cancel_async( _dev );
-  _thread.join();
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    if (dev->dev)
+      rtlsdr_cancel_async( dev->dev );
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    dev->thread.join();
 
   return true;
 }
 
 void rtl_source_c::_rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
 {
-  rtl_source_c *obj = (rtl_source_c *)ctx;
-  obj->rtlsdr_callback(buf, len);
+  rtl_dev_t *dev = (rtl_dev_t *)ctx;
+
+  OSMOSDR_TRACE2(rtl_transfer, len, dev->index);
+
+  if (dev->skipped < BUF_SKIP) {
+    dev->skipped++;
+    return;
+  }
+
+  dev->recorder.record(buf, len);
+
+  if (!dev->ring.write(buf, len))
+    std::cerr << "O" << std::flush;
+}
+
+void rtl_source_c::_rtlsdr_wait(rtl_source_c *obj, rtl_dev_t *dev)
+{
+  obj->rtlsdr_wait(dev);
 }
 
-void rtl_source_c::rtlsdr_callback(unsigned char *buf, uint32_t len)
+void rtl_source_c::_replay_wait(rtl_source_c *obj, rtl_dev_t *dev)
 {
-  if (_skipped < BUF_SKIP) {
-    _skipped++;
+  obj->replay_wait(dev);
+}
+
+/*
+ * Stand-in for rtlsdr_wait in replay mode: pushes the recorded
+ * callback buffers through the very same ring the live callback
+ * would fill, so work() downstream cannot tell the difference.
+ */
+void rtl_source_c::replay_wait(rtl_dev_t *dev)
+{
+  osmosdr::callback_player player;
+
+  _prio.apply();
+
+  try {
+    player.open( _replay_path );
+  } catch ( const std::exception &ex ) {
+    std::cerr << ex.what() << std::endl;
+    _start_barrier->wait();
+    _running = false;
+    dev->ring.shutdown();
     return;
   }
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+  _start_barrier->wait();
 
-    int buf_tail = (_buf_head + _buf_used) % _buf_num;
-    memcpy(_buf[buf_tail], buf, len);
+  std::vector<unsigned char> buf;
+  uint32_t delay_us;
 
-    if (_buf_used == _buf_num) {
+  while ( _running && player.next(buf, delay_us) ) {
+    if ( _replay_pace && delay_us )
+      std::this_thread::sleep_for( std::chrono::microseconds(delay_us) );
+
+    if (!dev->ring.write(&buf[0], buf.size()))
       std::cerr << "O" << std::flush;
-      _buf_head = (_buf_head + 1) % _buf_num;
-    } else {
-      _buf_used++;
-    }
   }
 
-  _buf_cond.notify_one();
+  _running = false;
+
+  dev->ring.shutdown();
 }
 
-void rtl_source_c::_rtlsdr_wait(rtl_source_c *obj)
+/* consecutive failed recovery attempts before the reader gives up */
+#define MAX_RECOVERY_ATTEMPTS  5
+
+/*
+ * Try to get a stalled dongle streaming again. The first attempt just
+ * flushes the usb buffers, which covers a transient stall in tens of
+ * milliseconds; later attempts reopen the handle and restore the
+ * tuning state, which also recovers a device that fell off the bus
+ * and re-enumerated under the same index.
+ */
+bool rtl_source_c::recover_device(rtl_dev_t *dev, int attempt)
 {
-  obj->rtlsdr_wait();
+  if ( 1 == attempt )
+    return rtlsdr_reset_buffer( dev->dev ) == 0;
+
+  uint32_t rate = rtlsdr_get_sample_rate( dev->dev );
+  uint32_t freq = rtlsdr_get_center_freq( dev->dev );
+  int ppm = rtlsdr_get_freq_correction( dev->dev );
+  int gain = rtlsdr_get_tuner_gain( dev->dev );
+
+  rtlsdr_close( dev->dev );
+  dev->dev = NULL;
+
+  if ( rtlsdr_open( &dev->dev, dev->index ) < 0 )
+    return false;
+
+  rtlsdr_set_sample_rate( dev->dev, rate );
+  rtlsdr_set_center_freq( dev->dev, freq );
+  if ( ppm )
+    rtlsdr_set_freq_correction( dev->dev, ppm );
+  rtlsdr_set_tuner_gain_mode( dev->dev, int(!_auto_gain) );
+  rtlsdr_set_agc_mode( dev->dev, int(_auto_gain) );
+  if ( !_auto_gain )
+    rtlsdr_set_tuner_gain( dev->dev, gain );
+
+  return rtlsdr_reset_buffer( dev->dev ) == 0;
 }
 
-void rtl_source_c::rtlsdr_wait()
+void rtl_source_c::rtlsdr_wait(rtl_dev_t *dev)
 {
-  int ret = rtlsdr_read_async( _dev, _rtlsdr_callback, (void *)this, _buf_num, _buf_len );
+  int failures = 0;
 
-  _running = false;
+  _prio.apply();
+
+  if ( rtlsdr_reset_buffer( dev->dev ) < 0 )
+    std::cerr << "Failed to reset usb buffers." << std::endl;
+
+  /* wait until every dongle finished its reset, then arm the
+   * transfers on all of them back to back */
+  _start_barrier->wait();
+
+  while ( _running ) {
+    const std::chrono::steady_clock::time_point armed =
+        std::chrono::steady_clock::now();
+
+    int ret = rtlsdr_read_async( dev->dev, _rtlsdr_callback, (void *)dev,
+                                 _buf_num, _buf_len );
+
+    if ( ! _running )
+      break; /* ordinary stop via rtlsdr_cancel_async */
+
+    /* the reader died underneath a running flowgraph (usb stall or a
+     * device hiccup) - recover in place instead of forcing a teardown;
+     * downstream just sees retagged timestamps after the gap */
+    std::cerr << "rtlsdr_read_async returned with " << ret
+              << ", recovering" << std::endl;
 
-  if ( ret != 0 )
-    std::cerr << "rtlsdr_read_async returned with " << ret << std::endl;
+    /* a good long streaming stretch resets the failure budget */
+    if ( std::chrono::steady_clock::now() - armed > std::chrono::seconds(1) )
+      failures = 0;
 
-  _buf_cond.notify_one();
+    if ( ++failures > MAX_RECOVERY_ATTEMPTS ) {
+      std::cerr << "Device #" << dev->index
+                << " would not recover, shutting its channel down."
+                << std::endl;
+      break;
+    }
+
+    dev->tagger.discontinuity();
+    dev->skipped = 0; /* skip the post-reset garbage again */
+
+    if ( ! recover_device( dev, failures ) )
+      std::this_thread::sleep_for( std::chrono::milliseconds(100) );
+  }
+
+  dev->ring.shutdown();
 }
 
 int rtl_source_c::work( int noutput_items,
                         gr_vector_const_void_star &input_items,
                         gr_vector_void_star &output_items )
 {
-  gr_complex *out = (gr_complex *)output_items[0];
+  OSMOSDR_TRACE1(work_entry, noutput_items);
+
+  const int samp_per_buf = _buf_len / BYTES_PER_SAMPLE;
+
+  /* block until every channel has something to deliver. For a single
+   * dongle collect a few buffers per call like we always did (or what
+   * the watermark= argument asks for); with several dongles wake on
+   * the first buffer to keep the skew low. */
+  const size_t dflt_watermark = _devs.size() > 1 ? 1 : 3;
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs ) {
+    if (0 == dev->ring.used() && 0 == dev->zeros_pending)
+      if (!dev->ring.wait(dev->ring.watermark(dflt_watermark)))
+        return WORK_DONE;
+
+    if (dev->ring.overflow_pending() && 0 == dev->buf_offset) {
+      /* drop-oldest: shed the stale half of the backlog at a buffer
+       * boundary; the shed buffers are accounted as drops and thus
+       * turn into owed zeros below, keeping the channels aligned */
+      dev->ring.discard_backlog(dev->ring.capacity() / 2);
+      dev->samp_avail = samp_per_buf;
+    }
+
+    /* turn buffers the callback had to drop into owed zero samples so
+     * this channel does not fall behind the others */
+    uint64_t dropped = dev->ring.stats(BYTES_PER_SAMPLE).dropped_samples;
+    if (dropped > dev->dropped_seen) {
+      dev->zeros_pending += dropped - dev->dropped_seen;
+      dev->dropped_seen = dropped;
+    }
+  }
+
+  /* emit the same number of samples on every channel */
+  uint64_t nout = noutput_items;
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs ) {
+    uint64_t avail;
 
-  {
-    boost::mutex::scoped_lock lock( _buf_mutex );
+    if (dev->ring.used())
+      avail = dev->samp_avail +
+              (uint64_t)(dev->ring.used() - 1) * samp_per_buf;
+    else
+      avail = dev->zeros_pending;
 
-    while (_buf_used < 3 && _running) // collect at least 3 buffers
-      _buf_cond.wait( lock );
+    nout = std::min(nout, avail);
   }
 
-  if (!_running)
-    return WORK_DONE;
+  /* scheduled control changes: run whatever is due at the current
+   * position (tagging the first affected sample), then clamp the
+   * output so the next boundary lands exactly on a work() boundary */
+  for (size_t chan = 0; chan < _devs.size(); chan++) {
+    const uint64_t produced = nitems_written(chan);
 
-  while (noutput_items && _buf_used) {
-    const int nout = std::min(noutput_items, _samp_avail);
-    const unsigned char *buf = _buf[_buf_head] + _buf_offset * 2;
+    _devs[chan]->schedule.apply_due(this, chan, produced);
+    nout = _devs[chan]->schedule.clamp(produced, nout);
+  }
+
+  const size_t out_size = _sc16 ? 2 * sizeof(short) : sizeof(gr_complex);
 
-    for (int i = 0; i < nout; ++i)
-      *out++ = gr_complex(_lut[buf[i * 2]], _lut[buf[i * 2 + 1]]);
+  for (size_t chan = 0; chan < _devs.size(); chan++) {
+    rtl_dev_t *dev = _devs[chan];
+    unsigned char *out = (unsigned char *)output_items[chan];
+    uint64_t remaining = nout;
 
-    noutput_items -= nout;
-    _samp_avail -= nout;
+    while (remaining) {
+      if (dev->ring.used()) {
+        const int chunk = std::min((uint64_t)dev->samp_avail, remaining);
+        const unsigned char *buf = dev->ring.head() + dev->buf_offset * 2;
 
-    if (!_samp_avail) {
-      {
-        boost::mutex::scoped_lock lock( _buf_mutex );
+        if (_sc16)
+          osmosdr::convert::u8_s16(buf, (short *)out, chunk * 2);
+        else
+          osmosdr::convert::u8_fc32(buf, (float *)out, chunk * 2);
 
-        _buf_head = (_buf_head + 1) % _buf_num;
-        _buf_used--;
+        dev->samp_avail -= chunk;
+
+        if (!dev->samp_avail) {
+          dev->ring.pop();
+          dev->samp_avail = samp_per_buf;
+          dev->buf_offset = 0;
+        } else {
+          dev->buf_offset += chunk;
+        }
+
+        out += chunk * out_size;
+        remaining -= chunk;
+      } else if (dev->zeros_pending) {
+        /* drained past the overflow, pay off the owed padding */
+        const uint64_t chunk = std::min(dev->zeros_pending, remaining);
+
+        memset(out, 0, chunk * out_size);
+
+        dev->zeros_pending -= chunk;
+        out += chunk * out_size;
+        remaining -= chunk;
+      } else {
+        break; /* cannot happen, nout was clamped to availability */
       }
-      _samp_avail = _buf_len / BYTES_PER_SAMPLE;
-      _buf_offset = 0;
-    } else {
-      _buf_offset += nout;
     }
+
+    /* the IQ correction operates on floats only */
+    if (!_sc16)
+      dev->iq_corr.process( (gr_complex *)output_items[chan], nout );
+    dev->tagger.tag_work( this, chan, nout );
   }
 
-  return (out - ((gr_complex *)output_items[0]));
+  OSMOSDR_TRACE1(work_exit, nout);
+
+  return nout;
 }
 
 std::vector<std::string> rtl_source_c::get_devices()
@@ -412,10 +737,10 @@ std::vector<std::string> rtl_source_c::get_devices()
 
 size_t rtl_source_c::get_num_channels()
 {
-  return 1;
+  return _devs.size();
 }
 
-osmosdr::meta_range_t rtl_source_c::get_sample_rates()
+static osmosdr::meta_range_t make_sample_rates()
 {
   osmosdr::meta_range_t range;
 
@@ -436,19 +761,37 @@ osmosdr::meta_range_t rtl_source_c::get_sample_rates()
   return range;
 }
 
+osmosdr::meta_range_t rtl_source_c::get_sample_rates()
+{
+  /* built once - UIs poll this during interactive tuning */
+  static const osmosdr::meta_range_t range = make_sample_rates();
+
+  return range;
+}
+
 double rtl_source_c::set_sample_rate(double rate)
 {
-  if (_dev) {
-    rtlsdr_set_sample_rate( _dev, (uint32_t)rate );
-  }
+  ensure_opened();
+
+  /* aligned channels only make sense at one common rate */
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    if (dev->dev)
+      rtlsdr_set_sample_rate( dev->dev, (uint32_t)rate );
 
-  return get_sample_rate();
+  double actual = get_sample_rate();
+
+  BOOST_FOREACH( rtl_dev_t *dev, _devs )
+    dev->tagger.set_rate(actual);
+
+  return actual;
 }
 
 double rtl_source_c::get_sample_rate()
 {
-  if (_dev)
-    return (double)rtlsdr_get_sample_rate( _dev );
+  rtlsdr_dev_t *dev = cdev(0);
+
+  if (dev)
+    return (double)rtlsdr_get_sample_rate( dev );
 
   return 0;
 }
@@ -456,16 +799,17 @@ double rtl_source_c::get_sample_rate()
 osmosdr::freq_range_t rtl_source_c::get_freq_range( size_t chan )
 {
   osmosdr::freq_range_t range;
+  rtlsdr_dev_t *dev = cdev(chan);
 
-  if (_dev) {
+  if (dev) {
     if (_no_tuner) {
       uint32_t rtl_freq;
-      if ( !rtlsdr_get_xtal_freq( _dev, &rtl_freq, NULL ) )
+      if ( !rtlsdr_get_xtal_freq( dev, &rtl_freq, NULL ) )
         range += osmosdr::range_t( 0, double(rtl_freq) );
       return range;
     }
 
-    enum rtlsdr_tuner tuner = rtlsdr_get_tuner_type(_dev);
+    enum rtlsdr_tuner tuner = rtlsdr_get_tuner_type(dev);
 
     if ( tuner == RTLSDR_TUNER_E4000 ) {
       /* there is a (temperature dependent) gap between 1100 to 1250 MHz */
@@ -489,32 +833,58 @@ osmosdr::freq_range_t rtl_source_c::get_freq_range( size_t chan )
 
 double rtl_source_c::set_center_freq( double freq, size_t chan )
 {
-  if (_dev)
-    rtlsdr_set_center_freq( _dev, (uint32_t)freq );
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if (dev)
+    rtlsdr_set_center_freq( dev, (uint32_t)freq );
 
   return get_center_freq( chan );
 }
 
+void rtl_source_c::apply_freq( double freq, size_t chan )
+{
+  set_center_freq( freq, chan );
+}
+
+bool rtl_source_c::set_center_freq_at( double freq, uint64_t sample,
+                                       size_t chan )
+{
+  if (chan >= _devs.size())
+    return false;
+
+  _devs[chan]->schedule.insert( sample,
+      boost::bind( &rtl_source_c::apply_freq, this, freq, chan ),
+      "freq", freq );
+
+  return true;
+}
+
 double rtl_source_c::get_center_freq( size_t chan )
 {
-  if (_dev)
-    return (double)rtlsdr_get_center_freq( _dev );
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if (dev)
+    return (double)rtlsdr_get_center_freq( dev );
 
   return 0;
 }
 
 double rtl_source_c::set_freq_corr( double ppm, size_t chan )
 {
-  if ( _dev )
-    rtlsdr_set_freq_correction( _dev, (int)ppm );
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if ( dev )
+    rtlsdr_set_freq_correction( dev, (int)ppm );
 
   return get_freq_corr( chan );
 }
 
 double rtl_source_c::get_freq_corr( size_t chan )
 {
-  if ( _dev )
-    return (double)rtlsdr_get_freq_correction( _dev );
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if ( dev )
+    return (double)rtlsdr_get_freq_correction( dev );
 
   return 0;
 }
@@ -522,11 +892,12 @@ double rtl_source_c::get_freq_corr( size_t chan )
 std::vector<std::string> rtl_source_c::get_gain_names( size_t chan )
 {
   std::vector< std::string > names;
+  rtlsdr_dev_t *dev = cdev(chan);
 
   names += "LNA";
 
-  if ( _dev ) {
-    if ( rtlsdr_get_tuner_type(_dev) == RTLSDR_TUNER_E4000 ) {
+  if ( dev ) {
+    if ( rtlsdr_get_tuner_type(dev) == RTLSDR_TUNER_E4000 ) {
       names += "IF";
     }
   }
@@ -537,12 +908,13 @@ std::vector<std::string> rtl_source_c::get_gain_names( size_t chan )
 osmosdr::gain_range_t rtl_source_c::get_gain_range( size_t chan )
 {
   osmosdr::gain_range_t range;
+  rtlsdr_dev_t *dev = cdev(chan);
 
-  if (_dev) {
-    int count = rtlsdr_get_tuner_gains(_dev, NULL);
+  if (dev) {
+    int count = rtlsdr_get_tuner_gains(dev, NULL);
     if (count > 0) {
       int* gains = new int[ count ];
-      count = rtlsdr_get_tuner_gains(_dev, gains);
+      count = rtlsdr_get_tuner_gains(dev, gains);
       for (int i = 0; i < count; i++)
         range += osmosdr::range_t( gains[i] / 10.0 );
       delete[] gains;
@@ -554,9 +926,11 @@ osmosdr::gain_range_t rtl_source_c::get_gain_range( size_t chan )
 
 osmosdr::gain_range_t rtl_source_c::get_gain_range( const std::string & name, size_t chan )
 {
+  rtlsdr_dev_t *dev = cdev(chan);
+
   if ( "IF" == name ) {
-    if ( _dev ) {
-      if ( rtlsdr_get_tuner_type(_dev) == RTLSDR_TUNER_E4000 ) {
+    if ( dev ) {
+      if ( rtlsdr_get_tuner_type(dev) == RTLSDR_TUNER_E4000 ) {
         return osmosdr::gain_range_t(3, 56, 1);
       } else {
         return osmosdr::gain_range_t();
@@ -569,12 +943,14 @@ osmosdr::gain_range_t rtl_source_c::get_gain_range( const std::string & name, si
 
 bool rtl_source_c::set_gain_mode( bool automatic, size_t chan )
 {
-  if (_dev) {
-    if (!rtlsdr_set_tuner_gain_mode(_dev, int(!automatic))) {
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if (dev) {
+    if (!rtlsdr_set_tuner_gain_mode(dev, int(!automatic))) {
       _auto_gain = automatic;
     }
 
-    rtlsdr_set_agc_mode(_dev, int(automatic));
+    rtlsdr_set_agc_mode(dev, int(automatic));
   }
 
   return get_gain_mode(chan);
@@ -588,9 +964,10 @@ bool rtl_source_c::get_gain_mode( size_t chan )
 double rtl_source_c::set_gain( double gain, size_t chan )
 {
   osmosdr::gain_range_t rf_gains = rtl_source_c::get_gain_range( chan );
+  rtlsdr_dev_t *dev = cdev(chan);
 
-  if (_dev) {
-    rtlsdr_set_tuner_gain( _dev, int(rf_gains.clip(gain) * 10.0) );
+  if (dev) {
+    rtlsdr_set_tuner_gain( dev, int(rf_gains.clip(gain) * 10.0) );
   }
 
   return get_gain( chan );
@@ -605,10 +982,29 @@ double rtl_source_c::set_gain( double gain, const std::string & name, size_t cha
   return set_gain( gain, chan );
 }
 
+void rtl_source_c::apply_gain( double gain, size_t chan )
+{
+  set_gain( gain, chan );
+}
+
+bool rtl_source_c::set_gain_at( double gain, uint64_t sample, size_t chan )
+{
+  if (chan >= _devs.size())
+    return false;
+
+  _devs[chan]->schedule.insert( sample,
+      boost::bind( &rtl_source_c::apply_gain, this, gain, chan ),
+      "gain", gain );
+
+  return true;
+}
+
 double rtl_source_c::get_gain( size_t chan )
 {
-  if ( _dev )
-    return ((double)rtlsdr_get_tuner_gain( _dev )) / 10.0;
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if ( dev )
+    return ((double)rtlsdr_get_tuner_gain( dev )) / 10.0;
 
   return 0;
 }
@@ -624,8 +1020,10 @@ double rtl_source_c::get_gain( const std::string & name, size_t chan )
 
 double rtl_source_c::set_if_gain(double gain, size_t chan)
 {
-  if ( _dev ) {
-    if ( rtlsdr_get_tuner_type(_dev) != RTLSDR_TUNER_E4000 ) {
+  rtlsdr_dev_t *dev = cdev(chan);
+
+  if ( dev ) {
+    if ( rtlsdr_get_tuner_type(dev) != RTLSDR_TUNER_E4000 ) {
       _if_gain = 0;
       return _if_gain;
     }
@@ -677,9 +1075,9 @@ double rtl_source_c::set_if_gain(double gain, size_t chan)
   }
   std::cerr << " = " << sum << std::endl;
 #endif
-  if (_dev) {
+  if (dev) {
     for (unsigned int stage = 1; stage <= gains.size(); stage++) {
-      rtlsdr_set_tuner_if_gain( _dev, stage, int(gains[ stage ] * 10.0));
+      rtlsdr_set_tuner_if_gain( dev, stage, int(gains[ stage ] * 10.0));
     }
   }
 
@@ -705,3 +1103,76 @@ std::string rtl_source_c::get_antenna( size_t chan )
 {
   return "RX";
 }
+
+/* the RTL2832 has no correction stages, apply them in software on the
+ * converted samples (see osmosdr::iq_correction) */
+
+void rtl_source_c::set_dc_offset_mode( int mode, size_t chan )
+{
+  if ( chan >= _devs.size() )
+    return;
+
+  _devs[chan]->iq_corr.set_dc_auto( osmosdr::source::DCOffsetAutomatic == mode );
+
+  if ( osmosdr::source::DCOffsetOff == mode )
+    _devs[chan]->iq_corr.set_dc_offset( std::complex<float>(0.0f, 0.0f) );
+}
+
+void rtl_source_c::set_dc_offset( const std::complex<double> &offset, size_t chan )
+{
+  if ( chan >= _devs.size() )
+    return;
+
+  _devs[chan]->iq_corr.set_dc_offset(
+        std::complex<float>( offset.real(), offset.imag() ) );
+}
+
+void rtl_source_c::set_iq_balance_mode( int mode, size_t chan )
+{
+  if ( chan >= _devs.size() )
+    return;
+
+  if ( osmosdr::source::IQBalanceOff == mode )
+    _devs[chan]->iq_corr.set_mag_phase( 0.0f, 0.0f );
+}
+
+void rtl_source_c::set_iq_balance( const std::complex<double> &balance, size_t chan )
+{
+  if ( chan >= _devs.size() )
+    return;
+
+  /* fix_cc conventions: real part is mag, imaginary part is phase */
+  _devs[chan]->iq_corr.set_mag_phase( balance.real(), balance.imag() );
+}
+
+osmosdr::stream_stats_t rtl_source_c::get_stream_stats( size_t chan )
+{
+  if ( chan < _devs.size() )
+    return _devs[chan]->ring.stats( BYTES_PER_SAMPLE );
+
+  return osmosdr::stream_stats_t();
+}
+
+void rtl_source_c::_scan_tune( rtl_dev_t *dev, double freq )
+{
+  rtlsdr_set_center_freq( dev->dev, (uint32_t)freq );
+  dev->tagger.retune( freq );
+}
+
+bool rtl_source_c::set_scan_plan( const std::vector<double> &freqs,
+                                  double dwell, size_t chan )
+{
+  if ( chan >= _devs.size() || NULL == cdev(chan) || _no_tuner )
+    return false;
+
+  rtl_dev_t *dev = _devs[chan];
+
+  return dev->scanner.start( freqs, dwell,
+                             boost::bind( _scan_tune, dev, _1 ) );
+}
+
+void rtl_source_c::clear_scan_plan( size_t chan )
+{
+  if ( chan < _devs.size() )
+    _devs[chan]->scanner.stop();
+}
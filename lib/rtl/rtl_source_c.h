@@ -25,10 +25,21 @@
 #include <gnuradio/sync_block.h>
 
 #include <gnuradio/thread/thread.h>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
+#include <boost/thread/barrier.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+#include "buffer_ring.h"
+#include "callback_capture.h"
+#include "cmd_schedule.h"
+#include "freq_scanner.h"
+#include "iq_correction.h"
 #include "source_iface.h"
+#include "stream_tagger.h"
+#include "thread_prio.h"
+#include "transfer_geometry.h"
 
 class rtl_source_c;
 typedef struct rtlsdr_dev rtlsdr_dev_t;
@@ -57,6 +68,13 @@ rtl_source_c_sptr make_rtl_source_c (const std::string & args = "");
 
 /*!
  * \brief Provides a stream of complex samples.
+ *
+ * rtl=<index or serial> opens a single dongle as before. Joining
+ * several indices/serials with '+' (rtl=0+1+2) opens them all in one
+ * block, which then emits one output channel per dongle with
+ * sample-count alignment: every work() call delivers the same number
+ * of samples on all channels, and a channel whose ring overflowed is
+ * padded with zeros once drained so the channels never drift apart.
  * \ingroup block
  *
  */
@@ -92,6 +110,7 @@ public:
 
   osmosdr::freq_range_t get_freq_range( size_t chan = 0 );
   double set_center_freq( double freq, size_t chan = 0 );
+  bool set_center_freq_at( double freq, uint64_t sample, size_t chan = 0 );
   double get_center_freq( size_t chan = 0 );
   double set_freq_corr( double ppm, size_t chan = 0 );
   double get_freq_corr( size_t chan = 0 );
@@ -103,6 +122,7 @@ public:
   bool get_gain_mode( size_t chan = 0 );
   double set_gain( double gain, size_t chan = 0 );
   double set_gain( double gain, const std::string & name, size_t chan = 0 );
+  bool set_gain_at( double gain, uint64_t sample, size_t chan = 0 );
   double get_gain( size_t chan = 0 );
   double get_gain( const std::string & name, size_t chan = 0 );
 
@@ -112,36 +132,100 @@ public:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  void set_dc_offset_mode( int mode, size_t chan = 0 );
+  void set_dc_offset( const std::complex<double> &offset, size_t chan = 0 );
+  void set_iq_balance_mode( int mode, size_t chan = 0 );
+  void set_iq_balance( const std::complex<double> &balance, size_t chan = 0 );
+
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
+  bool set_scan_plan( const std::vector<double> &freqs,
+                      double dwell, size_t chan = 0 );
+  void clear_scan_plan( size_t chan = 0 );
+
 protected:
   bool start();
   bool stop();
 
 private:
-  static void _rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx);
-  void rtlsdr_callback(unsigned char *buf, uint32_t len);
-  static void _rtlsdr_wait(rtl_source_c *obj);
-  void rtlsdr_wait();
-
-  std::vector<float> _lut;
+  /*! Per-dongle streaming state. One instance per output channel. */
+  struct rtl_dev_t
+  {
+    rtl_dev_t()
+      : dev(NULL), index(0), skipped(0), buf_offset(0), samp_avail(0),
+        dropped_seen(0), zeros_pending(0) {}
+
+    rtlsdr_dev_t *dev;
+    unsigned int index;      /* librtlsdr device index, for reopening */
+    osmosdr::buffer_ring ring;
+    osmosdr::callback_recorder recorder;
+    osmosdr::cmd_schedule schedule;
+    osmosdr::iq_correction iq_corr;
+    osmosdr::stream_tagger tagger;
+    osmosdr::freq_scanner scanner;
+    gr::thread::thread thread;
+    unsigned int skipped;
+
+    unsigned int buf_offset; /* consumer position in the head buffer */
+    int samp_avail;          /* samples left in the head buffer */
+
+    uint64_t dropped_seen;   /* dropped samples already compensated */
+    uint64_t zeros_pending;  /* zero samples owed to stay aligned */
+
+    /* non-empty when the handle is parked on destruction (persist=1) */
+    std::string cache_key;
+  };
 
-  rtlsdr_dev_t *_dev;
-  gr::thread::thread _thread;
-  unsigned char **_buf;
+  static void _rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx);
+  static void _scan_tune(rtl_dev_t *dev, double freq);
+  static void _rtlsdr_wait(rtl_source_c *obj, rtl_dev_t *dev);
+  void rtlsdr_wait(rtl_dev_t *dev);
+  bool recover_device(rtl_dev_t *dev, int attempt);
+  /* open and configure one dongle; split out so defer=1 can postpone it */
+  void open_device(rtl_dev_t *dev);
+  /* with defer=1 the hardware stays untouched until the first call that
+   * needs it; cdev() funnels nearly every such call through here */
+  void ensure_opened();
+  /* uniquely named targets for the scheduled setters to bind to */
+  void apply_freq(double freq, size_t chan);
+  void apply_gain(double gain, size_t chan);
+  static void _replay_wait(rtl_source_c *obj, rtl_dev_t *dev);
+  void replay_wait(rtl_dev_t *dev);
+
+  rtlsdr_dev_t *cdev( size_t chan )
+  {
+    ensure_opened();
+    return chan < _devs.size() ? _devs[chan]->dev : NULL;
+  }
+
+  std::vector<rtl_dev_t *> _devs;
+  /* the reader threads rendezvous here before arming the transfers,
+   * so all dongles begin streaming at (nearly) the same time */
+  boost::shared_ptr<boost::barrier> _start_barrier;
   unsigned int _buf_num;
   unsigned int _buf_len;
-  unsigned int _buf_head;
-  unsigned int _buf_used;
-  boost::mutex _buf_mutex;
-  boost::condition_variable _buf_cond;
   bool _running;
-
-  unsigned int _buf_offset;
-  int _samp_avail;
+  osmosdr::thread_prio _prio;
+  osmosdr::transfer_geometry _geometry;
 
   bool _no_tuner;
   bool _auto_gain;
   double _if_gain;
-  unsigned int _skipped;
+  bool _sc16; /* output interleaved shorts instead of gr_complex */
+
+  /* defer=1: construction only enumerates, open_device() runs at
+   * start() or the first hardware-touching call */
+  bool _defer;
+  bool _opened;
+  int _bias_tee;
+  unsigned int _rtl_freq;   /* rtl_xtal=, 0 keeps the default */
+  unsigned int _tuner_freq; /* tuner_xtal=, 0 keeps the default */
+  unsigned int _direct_samp;
+  unsigned int _offset_tune;
+
+  /* hardware-free mode: feed a callback recording instead of a dongle */
+  std::string _replay_path;
+  bool _replay_pace;
 };
 
 #endif /* INCLUDED_RTLSDR_SOURCE_C_H */
@@ -0,0 +1,521 @@
+/* -*- mode: c++; c-basic-offset: 2 -*- */
+/*
+ * Copyright 2012 Hoernchen <la@tfc-server.de>
+ * Copyright 2012 Dimitri Stolnikov <horiz0n@gmx.net>
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RTL_TCP_CLIENT_H
+#define RTL_TCP_CLIENT_H
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "buffer_ring.h"
+#include "convert/convert.h"
+#include "stream_tagger.h"
+#include "uring_reader.h"
+
+#if defined(_WIN32)
+// if not posix, assume winsock
+#pragma comment(lib, "ws2_32.lib")
+#define USING_WINSOCK
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define SHUT_RDWR 2
+typedef char* optval_t;
+#else
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+typedef void* optval_t;
+#endif
+
+#ifdef _MSC_VER
+#include <cstddef>
+typedef ptrdiff_t ssize_t;
+#endif //_MSC_VER
+
+/* copied from rtl sdr */
+enum rtlsdr_tuner {
+  RTLSDR_TUNER_UNKNOWN = 0,
+  RTLSDR_TUNER_E4000,
+  RTLSDR_TUNER_FC0012,
+  RTLSDR_TUNER_FC0013,
+  RTLSDR_TUNER_FC2580,
+  RTLSDR_TUNER_R820T,
+  RTLSDR_TUNER_R828D
+};
+
+/* copied from rtl sdr code */
+typedef struct { /* structure size must be multiple of 2 bytes */
+  char magic[4];
+  uint32_t tuner_type;
+  uint32_t tuner_gain_count;
+} dongle_info_t;
+
+#ifdef _WIN32
+#define __attribute__(x)
+#pragma pack(push, 1)
+#endif
+struct rtl_tcp_command {
+  unsigned char cmd;
+  unsigned int param;
+} __attribute__((packed));
+#ifdef _WIN32
+#pragma pack(pop)
+#endif
+
+static inline int is_error( int perr )
+{
+  // Compare error to posix error code; return nonzero if match.
+#if defined(USING_WINSOCK)
+#define ENOPROTOOPT 109
+  // All codes to be checked for must be defined below
+  int werr = WSAGetLastError();
+  switch( werr ) {
+  case WSAETIMEDOUT:
+    return( perr == EAGAIN );
+  case WSAENOPROTOOPT:
+    return( perr == ENOPROTOOPT );
+  default:
+    fprintf(stderr,"rtl_tcp_client: unknown error %d WS err %d \n", perr, werr );
+    throw std::runtime_error("internal error");
+  }
+  return 0;
+#else
+  return( perr == errno );
+#endif
+}
+
+static inline void report_error( const char *msg1, const char *msg2 )
+{
+  // Deal with errors, both posix and winsock
+#if defined(USING_WINSOCK)
+  int werr = WSAGetLastError();
+  fprintf(stderr, "%s: winsock error %d\n", msg1, werr );
+#else
+  perror(msg1);
+#endif
+  if( msg2 != NULL )
+    throw std::runtime_error(msg2);
+  return;
+}
+
+/*!
+ * Output format traits for rtl_tcp_client. Each trait names the GR
+ * item type, the number of wire bytes per item and the conversion
+ * from the unsigned 8 bit wire format. The trait is a template
+ * parameter, so the conversion call is resolved at compile time and
+ * the inner loop carries no per-sample branching.
+ */
+struct rtl_tcp_format_fc32
+{
+  typedef gr_complex item_type;
+
+  static const int wire_bytes = 2; /* one I/Q byte pair per item */
+
+  static void convert(const unsigned char *in, item_type *out, int nitems)
+  {
+    osmosdr::convert::u8_fc32(in, (float *)out, nitems * 2);
+  }
+};
+
+struct rtl_tcp_format_f32
+{
+  typedef float item_type;
+
+  static const int wire_bytes = 1; /* interleaved I/Q, one byte per item */
+
+  static void convert(const unsigned char *in, item_type *out, int nitems)
+  {
+    osmosdr::convert::u8_fc32(in, out, nitems);
+  }
+};
+
+/*!
+ * Common rtl_tcp client machinery: socket setup, the dongle info
+ * handshake, the control command protocol and the read-ahead reader
+ * thread. rtl_tcp_source_c and the legacy rtl_tcp_source_f used to
+ * duplicate all of this with separate scalar conversion loops; both
+ * are now thin instantiations of this template and share the same
+ * hot path.
+ */
+template <typename format>
+class rtl_tcp_client : public gr::sync_block
+{
+protected:
+  rtl_tcp_client(const char *name) :
+    gr::sync_block(name,
+                   gr::io_signature::make(0, 0, 0),
+                   gr::io_signature::make(1, 1, sizeof(typename format::item_type))),
+    d_socket(-1),
+    d_tuner_type(RTLSDR_TUNER_UNKNOWN),
+    d_tuner_gain_count(0),
+    d_tuner_if_gain_count(0),
+    _buf_offset(0),
+    _run_reader(false),
+    _reconnect(false)
+  {
+  }
+
+  /* connect to the server and read the dongle info header */
+  void connect_server(const std::string &host, unsigned short port,
+                      int payload_size, int num_buffers)
+  {
+#if defined(USING_WINSOCK) // for Windows (with MinGW)
+    // initialize winsock DLL
+    WSADATA wsaData;
+    int iResult = WSAStartup( MAKEWORD(2,2), &wsaData );
+    if( iResult != NO_ERROR ) {
+      report_error( "rtl_tcp_client WSAStartup", "can't open socket" );
+    }
+#endif
+
+    // whole items per ring buffer
+    payload_size -= payload_size % format::wire_bytes;
+
+    _host = host;
+    _port = port;
+
+    /* fail construction loudly on an unresolvable host */
+    struct addrinfo *ip_src;
+    struct addrinfo hints;
+    memset( (void*)&hints, 0, sizeof(hints) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+    char port_str[12];
+    sprintf( port_str, "%d", port );
+
+    int ret = getaddrinfo(host.c_str(), port_str, &hints, &ip_src);
+    if (ret != 0)
+      report_error("rtl_tcp_client/getaddrinfo",
+                   "can't initialize source socket" );
+    freeaddrinfo(ip_src);
+
+    _ring.resize(num_buffers, payload_size);
+
+    while (!open_connection())
+      ; // FIXME handle errors?
+  }
+
+  /*
+   * Create the socket, connect and perform the dongle info handshake.
+   * Never throws so the reconnect path can retry from the reader
+   * thread. \return false when no session could be established
+   */
+  bool open_connection()
+  {
+    // Set up the address stucture for the source address and port numbers
+    // Get the source IP address from the host name
+    struct addrinfo *ip_src;      // store the source IP address to use
+    struct addrinfo hints;
+    memset( (void*)&hints, 0, sizeof(hints) );
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+    char port_str[12];
+    sprintf( port_str, "%d", _port );
+
+    /* re-resolve on every attempt, the server may have moved */
+    if (getaddrinfo(_host.c_str(), port_str, &hints, &ip_src) != 0)
+      return false;
+
+    // create socket
+    d_socket = socket(ip_src->ai_family, ip_src->ai_socktype,
+                      ip_src->ai_protocol);
+    if (d_socket == -1) {
+      freeaddrinfo(ip_src);
+      return false;
+    }
+
+    // Turn on reuse address
+    int opt_val = 1;
+    if (setsockopt(d_socket, SOL_SOCKET, SO_REUSEADDR, (optval_t)&opt_val, sizeof(int)) == -1)
+      fprintf(stderr, "can't set socket option SO_REUSEADDR\n");
+
+    // Don't wait when shutting down
+    linger lngr;
+    lngr.l_onoff  = 1;
+    lngr.l_linger = 0;
+    if (setsockopt(d_socket, SOL_SOCKET, SO_LINGER, (optval_t)&lngr, sizeof(linger)) == -1)
+      if (!is_error(ENOPROTOOPT)) // no SO_LINGER for SOCK_DGRAM on Windows
+        fprintf(stderr, "can't set socket option SO_LINGER\n");
+
+    if (::connect(d_socket, ip_src->ai_addr, ip_src->ai_addrlen) != 0) {
+      freeaddrinfo(ip_src);
+      close_socket();
+      return false;
+    }
+    freeaddrinfo(ip_src);
+
+    int flag = 1;
+    setsockopt(d_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&flag,sizeof(flag));
+
+    dongle_info_t dongle_info;
+    int ret = recv(d_socket, (char*)&dongle_info, sizeof(dongle_info), 0);
+    if (sizeof(dongle_info) != ret)
+      fprintf(stderr,"failed to read dongle info\n");
+
+    if (memcmp(dongle_info.magic, "RTL0", 4) == 0) {
+      d_tuner_type = rtlsdr_tuner(ntohl(dongle_info.tuner_type));
+      d_tuner_gain_count = ntohl(dongle_info.tuner_gain_count);
+      if (RTLSDR_TUNER_E4000 == d_tuner_type)
+        d_tuner_if_gain_count = 53;
+    }
+
+    return true;
+  }
+
+  void close_socket()
+  {
+    if (d_socket != -1) {
+#if defined(USING_WINSOCK)
+      closesocket(d_socket);
+#else
+      ::close(d_socket);
+#endif
+      d_socket = -1;
+    }
+  }
+
+  /*! Called from the reader thread after a session was re-established
+   * so the derived block can replay its cached tuner settings. */
+  virtual void on_reconnect() { }
+
+  /* rtl_tcp control protocol: one byte opcode, one network order dword */
+  void send_cmd(unsigned char cmd, unsigned int param)
+  {
+    struct rtl_tcp_command c = { cmd, htonl(param) };
+    send(d_socket, (const char*)&c, sizeof(c), 0);
+  }
+
+  void start_reader()
+  {
+    _run_reader = true;
+    _reader_thread = gr::thread::thread(
+        boost::bind(&rtl_tcp_client::reader_task, this) );
+  }
+
+public:
+  ~rtl_tcp_client()
+  {
+    if (_run_reader) {
+      _run_reader = false;
+      shutdown(d_socket, SHUT_RDWR); // unblock recv() in the reader
+      _reader_thread.join();
+    }
+    _ring.shutdown();
+
+    close_socket();
+
+#if defined(USING_WINSOCK) // for Windows (with MinGW)
+    // free winsock resources
+    WSACleanup();
+#endif
+  }
+
+  int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items)
+  {
+    typename format::item_type *out =
+        (typename format::item_type *)output_items[0];
+    int processed = 0;
+
+    if (!_ring.wait(1))
+      return WORK_DONE;
+
+    while (processed < noutput_items && _ring.used()) {
+      const unsigned char *buf = _ring.head() + _buf_offset * format::wire_bytes;
+      int avail = _ring.head_len() / format::wire_bytes - _buf_offset;
+      int cnt = std::min(avail, noutput_items - processed);
+
+      format::convert(buf, &out[processed], cnt);
+      processed += cnt;
+
+      if (cnt < avail) {
+        _buf_offset += cnt;
+      } else {
+        _buf_offset = 0;
+        _ring.pop();
+      }
+    }
+
+    _tagger.tag_work(this, 0, processed);
+
+    return processed;
+  }
+
+private:
+  /*
+   * Runs next to the GR scheduler and keeps the read-ahead ring filled, so
+   * a scheduler hiccup stalls neither the TCP stream nor the remote dongle.
+   * Each ring buffer is filled completely before it is published, which
+   * keeps buffer boundaries aligned to whole samples.
+   */
+  void reader_task()
+  {
+    /* multishot receive reaps a whole batch of transfers per wakeup,
+     * against one recv() syscall per buffer on the fallback path */
+    osmosdr::uring_reader uring;
+    bool use_uring = uring.start(d_socket, false);
+    const unsigned char *chunk = NULL;
+    int chunk_len = 0;
+    int chunk_off = 0;
+    bool lost = false;
+
+    while (_run_reader) {
+      if (lost) {
+        if (!_reconnect || !reestablish())
+          break;
+
+        /* rearm the reader on the fresh socket, stale chunk state
+         * belonged to the old connection */
+        if (use_uring) {
+          uring.stop();
+          use_uring = uring.start(d_socket, false);
+        }
+        chunk = NULL;
+        chunk_len = 0;
+        chunk_off = 0;
+        lost = false;
+      }
+
+      unsigned char *buf = (unsigned char *)_ring.write_head();
+      if (!buf) {
+        /* consumer is behind, TCP flow control holds the server off */
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+        continue;
+      }
+
+      int bytesleft = _ring.buf_len();
+      int index = 0;
+      while (bytesleft > 0 && _run_reader) {
+        int receivedbytes;
+
+        if (use_uring) {
+          if (chunk_off == chunk_len) {
+            chunk_len = uring.next(&chunk);
+            chunk_off = 0;
+
+            if (chunk_len <= 0) {
+              if (osmosdr::uring_reader::CLOSED != chunk_len)
+                fprintf(stderr, "socket error\n");
+              /* CLOSED: server closed the connection */
+              lost = true;
+              break;
+            }
+          }
+
+          receivedbytes = std::min(bytesleft, chunk_len - chunk_off);
+          memcpy(&buf[index], chunk + chunk_off, receivedbytes);
+          chunk_off += receivedbytes;
+        } else {
+          receivedbytes = recv(d_socket, (char*)&buf[index], bytesleft, 0);
+
+          if (receivedbytes == -1 && !is_error(EAGAIN)) {
+            fprintf(stderr, "socket error\n");
+            lost = true;
+            break;
+          }
+          if (receivedbytes == 0) { /* server closed the connection */
+            lost = true;
+            break;
+          }
+        }
+
+        bytesleft -= receivedbytes;
+        index += receivedbytes;
+      }
+
+      if (bytesleft == 0)
+        _ring.commit(index);
+    }
+
+    _ring.shutdown();
+  }
+
+  /*
+   * Reconnect state machine: drops the dead socket, retries with a
+   * growing backoff until the server answers again, then lets the
+   * derived block replay its session and marks the discontinuity.
+   * \return false once the block is shutting down instead
+   */
+  bool reestablish()
+  {
+    close_socket();
+
+    fprintf(stderr, "rtl_tcp_client: connection lost, reconnecting...\n");
+
+    int backoff_ms = 500;
+
+    while (_run_reader) {
+      /* sleep in short slices so a shutdown is not held up */
+      for (int slept = 0; slept < backoff_ms && _run_reader; slept += 100)
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+      backoff_ms = std::min(backoff_ms * 2, 5000);
+
+      if (open_connection()) {
+        fprintf(stderr, "rtl_tcp_client: reconnected\n");
+        on_reconnect(); /* replay the cached tuner settings */
+        _tagger.discontinuity(); /* samples were lost meanwhile */
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+protected:
+  int d_socket;		  // handle to socket
+
+  enum rtlsdr_tuner d_tuner_type;
+  unsigned int d_tuner_gain_count;
+  unsigned int d_tuner_if_gain_count;
+
+  osmosdr::buffer_ring _ring; // read-ahead between reader thread and work()
+  int _buf_offset;            // items consumed from the ring head
+  gr::thread::thread _reader_thread;
+  std::atomic<bool> _run_reader;
+
+  std::string _host;          // for re-resolving on reconnect
+  unsigned short _port;
+  bool _reconnect;            // re-establish a lost session automatically
+
+  osmosdr::stream_tagger _tagger;
+};
+
+#endif // RTL_TCP_CLIENT_H
@@ -0,0 +1,488 @@
+/* -*- mode: c++; c-basic-offset: 2 -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <boost/assign.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <gnuradio/io_signature.h>
+
+/* for the socket portability glue and the dongle info header */
+#include "rtl_tcp_client.h"
+
+#include "rtl_tcp_sink_c.h"
+#include "arg_helpers.h"
+#include "convert/convert.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* a send() into a vanished client must not kill the process */
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+using namespace boost::assign;
+
+static void set_nonblocking( int fd )
+{
+#if defined(USING_WINSOCK)
+  u_long mode = 1;
+  ioctlsocket( fd, FIONBIO, &mode );
+#else
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+}
+
+static bool would_block( void )
+{
+#if defined(USING_WINSOCK)
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static bool interrupted( void )
+{
+#if defined(USING_WINSOCK)
+  return WSAGetLastError() == WSAEINTR;
+#else
+  return errno == EINTR;
+#endif
+}
+
+static void close_fd( int fd )
+{
+#if defined(USING_WINSOCK)
+  closesocket( fd );
+#else
+  ::close( fd );
+#endif
+}
+
+rtl_tcp_sink_c_sptr make_rtl_tcp_sink_c(const std::string &args)
+{
+  return gnuradio::get_initial_sptr(new rtl_tcp_sink_c(args));
+}
+
+rtl_tcp_sink_c::rtl_tcp_sink_c(const std::string &args) :
+  gr::sync_block("rtl_tcp_sink_c",
+                 gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                 gr::io_signature::make(0, 0, 0)),
+  _listen_fd(-1),
+  _payload(16384),
+  _num_buffers(32),
+  _policy(osmosdr::buffer_ring::OVERFLOW_DROP_NEWEST),
+  _kick_slow(false),
+  _io_run(false),
+  _freq(0),
+  _rate(0),
+  _corr(0)
+{
+  std::string host = "0.0.0.0";
+  unsigned short port = 1234;
+
+#if defined(USING_WINSOCK)
+  WSADATA wsabuf;
+  int result = WSAStartup( MAKEWORD(2,2), &wsabuf );
+  if( result != NO_ERROR )
+    report_error( "rtl_tcp_sink", "Winsock init failed" );
+#endif
+
+  dict_t dict = params_to_dict(args);
+
+  if (dict.count("rtl_tcp")) {
+    std::vector< std::string > tokens;
+    boost::algorithm::split( tokens, dict["rtl_tcp"], boost::is_any_of(":") );
+
+    if ( tokens[0].length() && (tokens.size() == 1 || tokens.size() == 2 ) )
+      host = tokens[0];
+
+    if ( tokens.size() == 2 ) // port given
+      port = boost::lexical_cast< unsigned short >( tokens[1] );
+  }
+
+  int payload_size = 16384;
+  int num_buffers = 32;
+
+  if (dict.count("psize"))
+    payload_size = boost::lexical_cast< int >( dict["psize"] );
+
+  if (dict.count("buffers"))
+    num_buffers = boost::lexical_cast< int >( dict["buffers"] );
+
+  /* what happens to a client that cannot keep up: lose its freshest
+   * data (newest, the default), its oldest queued data (oldest), or
+   * the client itself (kick) */
+  if (dict.count("policy")) {
+    if ("oldest" == dict["policy"])
+      _policy = osmosdr::buffer_ring::OVERFLOW_DROP_OLDEST;
+    else if ("kick" == dict["policy"])
+      _kick_slow = true;
+    else if ("newest" != dict["policy"])
+      throw std::runtime_error("policy must be newest, oldest or kick");
+  }
+
+  if (!host.length())
+    host = "0.0.0.0";
+
+  if (0 == port)
+    port = 1234;
+
+  if (payload_size <= 0)
+    payload_size = 16384;
+
+  if (num_buffers <= 0)
+    num_buffers = 32;
+
+  _payload = payload_size;
+  _num_buffers = num_buffers;
+
+  if ((_listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0)
+    report_error("rtl_tcp_sink socket", "Could not create listening socket");
+
+  int opt = 1;
+  if (setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR,
+                 (optval_t)&opt, sizeof(opt)) < 0)
+    fprintf(stderr, "rtl_tcp_sink: setsockopt SO_REUSEADDR failed\n");
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+
+  if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) <= 0)
+    throw std::runtime_error("rtl_tcp_sink: invalid bind address " + host);
+
+  if (bind(_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    report_error("rtl_tcp_sink bind", "Could not bind listening socket");
+
+  if (listen(_listen_fd, 16) < 0)
+    report_error("rtl_tcp_sink listen", "Could not listen on socket");
+
+  set_nonblocking(_listen_fd);
+
+  fprintf(stderr, "rtl_tcp_sink: serving clients on %s:%u\n",
+          host.c_str(), (unsigned int)port);
+
+  _io_run = true;
+  _io_thread = gr::thread::thread(
+      boost::bind(&rtl_tcp_sink_c::io_task, this));
+}
+
+rtl_tcp_sink_c::~rtl_tcp_sink_c()
+{
+  _io_run = false;
+  _io_thread.join();
+
+  BOOST_FOREACH( client_sptr client, _clients )
+    close_fd(client->fd);
+
+  if (_listen_fd >= 0)
+    close_fd(_listen_fd);
+
+#if defined(USING_WINSOCK)
+  WSACleanup();
+#endif
+}
+
+void rtl_tcp_sink_c::accept_client( void )
+{
+  int fd = accept(_listen_fd, NULL, NULL);
+  if (fd < 0)
+    return;
+
+  set_nonblocking(fd);
+
+  /* the greeting every rtl_tcp client expects; we are no real dongle,
+   * so the tuner is reported as unknown with no gain steps */
+  dongle_info_t info;
+  memcpy(info.magic, "RTL0", 4);
+  info.tuner_type = htonl(RTLSDR_TUNER_UNKNOWN);
+  info.tuner_gain_count = htonl(0);
+
+  if (send(fd, (const char *)&info, sizeof(info), SEND_FLAGS)
+      != sizeof(info)) {
+    close_fd(fd);
+    return;
+  }
+
+  client_sptr client(new client_t);
+  client->fd = fd;
+  client->offset = 0;
+  client->kick = false;
+  client->ring.resize(_num_buffers, _payload);
+  client->ring.set_overflow_policy(_policy);
+
+  {
+    boost::mutex::scoped_lock lock(_clients_mutex);
+    _clients.push_back(client);
+    fprintf(stderr, "rtl_tcp_sink: client connected, %u subscribed\n",
+            (unsigned int)_clients.size());
+  }
+}
+
+void rtl_tcp_sink_c::io_task( void )
+{
+  while (_io_run) {
+    fd_set readfds, writefds;
+    int maxfd = _listen_fd;
+
+    FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
+    FD_SET(_listen_fd, &readfds);
+
+    {
+      boost::mutex::scoped_lock lock(_clients_mutex);
+      BOOST_FOREACH( client_sptr client, _clients ) {
+        FD_SET(client->fd, &readfds);
+        if (client->ring.used())
+          FD_SET(client->fd, &writefds);
+        maxfd = std::max(maxfd, client->fd);
+      }
+    }
+
+    /* the timeout bounds how long a fresh block may sit queued before
+     * an idle select notices there is data to push */
+    struct timeval timeout = { 0, 10000 };
+
+    int num = select(maxfd + 1, &readfds, &writefds, NULL, &timeout);
+    if (num < 0) {
+      if (interrupted())
+        continue;
+      break;
+    }
+
+    if (FD_ISSET(_listen_fd, &readfds))
+      accept_client();
+
+    boost::mutex::scoped_lock lock(_clients_mutex);
+
+    for (size_t i = 0; i < _clients.size(); ) {
+      client_sptr client = _clients[i];
+      bool dead = client->kick;
+
+      if (!dead && FD_ISSET(client->fd, &readfds)) {
+        /* clients may send tuning commands; we read them to drain the
+         * socket but control stays with the serving flowgraph */
+        char scratch[128];
+        ssize_t got = recv(client->fd, scratch, sizeof(scratch), 0);
+        if (0 == got)
+          dead = true;
+        else if (got < 0 && !would_block())
+          dead = true;
+      }
+
+      /* under the oldest policy the producer flags us to shed backlog;
+       * only act between blocks, a partially sent one must finish to
+       * keep the byte stream aligned on whole I/Q frames */
+      if (!dead && 0 == client->offset && client->ring.overflow_pending())
+        client->ring.discard_backlog(_num_buffers / 2);
+
+      while (!dead && FD_ISSET(client->fd, &writefds) &&
+             client->ring.used()) {
+        const unsigned char *data = client->ring.head();
+        size_t len = client->ring.head_len();
+
+        ssize_t sent = send(client->fd, (const char *)data + client->offset,
+                            len - client->offset, SEND_FLAGS);
+        if (sent < 0) {
+          if (!would_block())
+            dead = true;
+          break;
+        }
+
+        client->offset += sent;
+        if (client->offset < len)
+          break; /* the socket buffer is full, try again next round */
+
+        client->ring.pop();
+        client->offset = 0;
+      }
+
+      if (dead) {
+        close_fd(client->fd);
+        _clients.erase(_clients.begin() + i);
+        fprintf(stderr, "rtl_tcp_sink: client disconnected, %u subscribed\n",
+                (unsigned int)_clients.size());
+      } else {
+        i++;
+      }
+    }
+  }
+}
+
+int rtl_tcp_sink_c::work( int noutput_items,
+                          gr_vector_const_void_star &input_items,
+                          gr_vector_void_star &output_items )
+{
+  const gr_complex *in = (const gr_complex *)input_items[0];
+  size_t total = noutput_items * 2;
+
+  if (_conv_buf.size() < total)
+    _conv_buf.resize(total);
+
+  osmosdr::convert::fc32_u8((const float *)in, &_conv_buf[0], total);
+
+  boost::mutex::scoped_lock lock(_clients_mutex);
+
+  BOOST_FOREACH( client_sptr client, _clients ) {
+    for (size_t off = 0; off < total; off += _payload) {
+      size_t chunk = std::min(_payload, total - off);
+
+      if (!client->ring.write(&_conv_buf[off], chunk) && _kick_slow) {
+        /* the io thread closes the socket and reports the loss */
+        client->kick = true;
+        break;
+      }
+    }
+  }
+
+  return noutput_items;
+}
+
+std::string rtl_tcp_sink_c::name()
+{
+  return "RTL TCP Server";
+}
+
+std::vector<std::string> rtl_tcp_sink_c::get_devices( bool fake )
+{
+  std::vector<std::string> devices;
+
+  if (fake) {
+    std::string args = "rtl_tcp=0.0.0.0:1234";
+    args += ",label='RTL TCP Server'";
+    devices.push_back(args);
+  }
+
+  return devices;
+}
+
+size_t rtl_tcp_sink_c::get_num_channels( void )
+{
+  return 1;
+}
+
+osmosdr::meta_range_t rtl_tcp_sink_c::get_sample_rates( void )
+{
+  osmosdr::meta_range_t range;
+
+  /* whatever rate the serving flowgraph runs at is passed through */
+  range += osmosdr::range_t( _rate );
+
+  return range;
+}
+
+double rtl_tcp_sink_c::set_sample_rate( double rate )
+{
+  _rate = rate;
+
+  return get_sample_rate();
+}
+
+double rtl_tcp_sink_c::get_sample_rate( void )
+{
+  return _rate;
+}
+
+osmosdr::freq_range_t rtl_tcp_sink_c::get_freq_range( size_t chan )
+{
+  return osmosdr::freq_range_t(_freq, _freq);
+}
+
+double rtl_tcp_sink_c::set_center_freq( double freq, size_t chan )
+{
+  _freq = freq;
+
+  return get_center_freq(chan);
+}
+
+double rtl_tcp_sink_c::get_center_freq( size_t chan )
+{
+  return _freq;
+}
+
+double rtl_tcp_sink_c::set_freq_corr( double ppm, size_t chan )
+{
+  _corr = ppm;
+
+  return get_freq_corr(chan);
+}
+
+double rtl_tcp_sink_c::get_freq_corr( size_t chan )
+{
+  return _corr;
+}
+
+std::vector<std::string> rtl_tcp_sink_c::get_gain_names( size_t chan )
+{
+  return std::vector< std::string >();
+}
+
+osmosdr::gain_range_t rtl_tcp_sink_c::get_gain_range( size_t chan )
+{
+  return osmosdr::gain_range_t();
+}
+
+osmosdr::gain_range_t rtl_tcp_sink_c::get_gain_range( const std::string & name, size_t chan )
+{
+  return get_gain_range(chan);
+}
+
+double rtl_tcp_sink_c::set_gain( double gain, size_t chan )
+{
+  return get_gain(chan);
+}
+
+double rtl_tcp_sink_c::set_gain( double gain, const std::string & name, size_t chan )
+{
+  return set_gain(gain, chan);
+}
+
+double rtl_tcp_sink_c::get_gain( size_t chan )
+{
+  return 0;
+}
+
+double rtl_tcp_sink_c::get_gain( const std::string & name, size_t chan )
+{
+  return get_gain(chan);
+}
+
+std::vector<std::string> rtl_tcp_sink_c::get_antennas( size_t chan )
+{
+  return std::vector< std::string >(1, get_antenna(chan));
+}
+
+std::string rtl_tcp_sink_c::set_antenna( const std::string & antenna, size_t chan )
+{
+  return get_antenna(chan);
+}
+
+std::string rtl_tcp_sink_c::get_antenna( size_t chan )
+{
+  return "TX";
+}
@@ -0,0 +1,130 @@
+/* -*- mode: c++; c-basic-offset: 2 -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef RTL_TCP_SINK_C_H
+#define RTL_TCP_SINK_C_H
+
+#include <gnuradio/sync_block.h>
+#include <gnuradio/thread/thread.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "buffer_ring.h"
+#include "sink_iface.h"
+
+class rtl_tcp_sink_c;
+
+typedef boost::shared_ptr< rtl_tcp_sink_c > rtl_tcp_sink_c_sptr;
+
+rtl_tcp_sink_c_sptr make_rtl_tcp_sink_c( const std::string & args = "" );
+
+/*!
+ * \brief Serves the sample stream to rtl_tcp clients.
+ *
+ * One receiver feeds a whole cluster: the sink listens on a TCP port,
+ * greets every subscriber with the usual dongle info header and fans
+ * the stream out as 8 bit offset binary I/Q, so any rtl_tcp client -
+ * including this tree's own rtl_tcp source - can subscribe. Every
+ * client has its own bounded queue; a slow client only loses its own
+ * data (policy=newest/oldest) or gets disconnected (policy=kick), it
+ * never stalls the flowgraph or the other subscribers. Tuning
+ * commands sent by clients are read and discarded - control over the
+ * shared receiver stays at the antenna site.
+ */
+class rtl_tcp_sink_c :
+    public gr::sync_block,
+    public sink_iface
+{
+private:
+  friend rtl_tcp_sink_c_sptr make_rtl_tcp_sink_c(const std::string &args);
+
+  rtl_tcp_sink_c(const std::string &args);
+
+public:
+  ~rtl_tcp_sink_c();
+
+  std::string name();
+
+  static std::vector< std::string > get_devices( bool fake = false );
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
+  size_t get_num_channels( void );
+
+  osmosdr::meta_range_t get_sample_rates( void );
+  double set_sample_rate( double rate );
+  double get_sample_rate( void );
+
+  osmosdr::freq_range_t get_freq_range( size_t chan = 0 );
+  double set_center_freq( double freq, size_t chan = 0 );
+  double get_center_freq( size_t chan = 0 );
+  double set_freq_corr( double ppm, size_t chan = 0 );
+  double get_freq_corr( size_t chan = 0 );
+
+  std::vector<std::string> get_gain_names( size_t chan = 0 );
+  osmosdr::gain_range_t get_gain_range( size_t chan = 0 );
+  osmosdr::gain_range_t get_gain_range( const std::string & name, size_t chan = 0 );
+  double set_gain( double gain, size_t chan = 0 );
+  double set_gain( double gain, const std::string & name, size_t chan = 0 );
+  double get_gain( size_t chan = 0 );
+  double get_gain( const std::string & name, size_t chan = 0 );
+
+  std::vector< std::string > get_antennas( size_t chan = 0 );
+  std::string set_antenna( const std::string & antenna, size_t chan = 0 );
+  std::string get_antenna( size_t chan = 0 );
+
+private:
+  /* one subscriber: its socket and its private bounded queue */
+  struct client_t {
+    int fd;
+    osmosdr::buffer_ring ring;
+    size_t offset; /* send progress into the queue's head block */
+    bool kick;     /* slow client marked for disconnect */
+  };
+  typedef boost::shared_ptr< client_t > client_sptr;
+
+  void io_task( void );
+  void accept_client( void );
+
+  int _listen_fd;
+
+  size_t _payload;          /* bytes per queued block */
+  unsigned int _num_buffers; /* queue depth per client */
+  osmosdr::buffer_ring::overflow_policy_t _policy;
+  bool _kick_slow;
+
+  std::vector< client_sptr > _clients;
+  boost::mutex _clients_mutex;
+
+  gr::thread::thread _io_thread;
+  std::atomic<bool> _io_run;
+
+  std::vector<unsigned char> _conv_buf;
+
+  double _freq, _rate, _corr;
+};
+
+#endif // RTL_TCP_SINK_C_H
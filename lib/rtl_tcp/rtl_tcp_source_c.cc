@@ -18,109 +18,18 @@
  * Boston, MA 02110-1301, USA.
  */
 
-#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <map>
 #include <string>
-#include <sstream>
+#include <vector>
 
 #include <boost/assign.hpp>
 #include <boost/algorithm/string.hpp>
 
-#include <gnuradio/io_signature.h>
-
 #include "rtl_tcp_source_c.h"
 #include "arg_helpers.h"
 
-#if defined(_WIN32)
-// if not posix, assume winsock
-#pragma comment(lib, "ws2_32.lib")
-#define USING_WINSOCK
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#define SHUT_RDWR 2
-typedef char* optval_t;
-#else
-#include <netdb.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netinet/tcp.h>
-#include <arpa/inet.h>
-typedef void* optval_t;
-#endif
-
-#ifdef _MSC_VER
-#include <cstddef>
-typedef ptrdiff_t ssize_t;
-#endif //_MSC_VER
-
-#ifndef _WIN32
-#include <netinet/in.h>
-#else
-#include <WinSock2.h>
-#endif
-
-#define BYTES_PER_SAMPLE  2 // rtl_tcp device delivers 8 bit unsigned IQ data
-
-/* copied from rtl sdr code */
-typedef struct { /* structure size must be multiple of 2 bytes */
-  char magic[4];
-  uint32_t tuner_type;
-  uint32_t tuner_gain_count;
-} dongle_info_t;
-
-#ifdef _WIN32
-#define __attribute__(x)
-#pragma pack(push, 1)
-#endif
-struct command {
-  unsigned char cmd;
-  unsigned int param;
-} __attribute__((packed));
-#ifdef _WIN32
-#pragma pack(pop)
-#endif
-
-#define USE_SELECT    1  // non-blocking receive on all platforms
-#define USE_RCV_TIMEO 0  // non-blocking receive on all but Cygwin
-#define SRC_VERBOSE 0
-#define SNK_VERBOSE 0
-
-static int is_error( int perr )
-{
-  // Compare error to posix error code; return nonzero if match.
-#if defined(USING_WINSOCK)
-#define ENOPROTOOPT 109
-  // All codes to be checked for must be defined below
-  int werr = WSAGetLastError();
-  switch( werr ) {
-  case WSAETIMEDOUT:
-    return( perr == EAGAIN );
-  case WSAENOPROTOOPT:
-    return( perr == ENOPROTOOPT );
-  default:
-    fprintf(stderr,"rtl_tcp_source_f: unknown error %d WS err %d \n", perr, werr );
-    throw std::runtime_error("internal error");
-  }
-  return 0;
-#else
-  return( perr == errno );
-#endif
-}
-
-static void report_error( const char *msg1, const char *msg2 )
-{
-  // Deal with errors, both posix and winsock
-#if defined(USING_WINSOCK)
-  int werr = WSAGetLastError();
-  fprintf(stderr, "%s: winsock error %d\n", msg1, werr );
-#else
-  perror(msg1);
-#endif
-  if( msg2 != NULL )
-    throw std::runtime_error(msg2);
-  return;
-}
-
 using namespace boost::assign;
 
 const char * rtl_tcp_source_c::get_tuner_name(void)
@@ -142,19 +51,18 @@ rtl_tcp_source_c_sptr make_rtl_tcp_source_c(const std::string &args)
 }
 
 rtl_tcp_source_c::rtl_tcp_source_c(const std::string &args) :
-  gr::sync_block("rtl_tcp_source_c",
-                 gr::io_signature::make(0, 0, 0),
-                 gr::io_signature::make(1, 1, sizeof (gr_complex))),
-  d_socket(-1),
+  rtl_tcp_client<rtl_tcp_format_fc32>("rtl_tcp_source_c"),
   _no_tuner(false),
   _auto_gain(false),
-  _if_gain(0)
+  _if_gain(0),
+  _direct_samp(0),
+  _offset_tune(0),
+  _bias_tee(0)
 {
   std::string host = "127.0.0.1";
   unsigned short port = 1234;
   int payload_size = 16384;
-  unsigned int direct_samp = 0, offset_tune = 0;
-  int bias_tee = 0;
+  int num_buffers = 32;
 
   _freq = 0;
   _rate = 0;
@@ -177,14 +85,23 @@ rtl_tcp_source_c::rtl_tcp_source_c(const std::string &args) :
   if (dict.count("psize"))
     payload_size = boost::lexical_cast< int >( dict["psize"] );
 
+  if (dict.count("buffers"))
+    num_buffers = boost::lexical_cast< int >( dict["buffers"] );
+
   if (dict.count("direct_samp"))
-    direct_samp = boost::lexical_cast< unsigned int >( dict["direct_samp"] );
+    _direct_samp = boost::lexical_cast< unsigned int >( dict["direct_samp"] );
 
   if (dict.count("offset_tune"))
-    offset_tune = boost::lexical_cast< unsigned int >( dict["offset_tune"] );
+    _offset_tune = boost::lexical_cast< unsigned int >( dict["offset_tune"] );
 
   if (dict.count("bias"))
-    bias_tee = boost::lexical_cast<bool>( dict["bias"] );
+    _bias_tee = boost::lexical_cast<bool>( dict["bias"] );
+
+  /* re-establish a dropped session automatically, reconnect=0 restores
+   * the old fail-fast behavior */
+  _reconnect = true;
+  if (dict.count("reconnect"))
+    _reconnect = boost::lexical_cast<bool>( dict["reconnect"] );
 
   if (!host.length())
     host = "127.0.0.1";
@@ -195,94 +112,10 @@ rtl_tcp_source_c::rtl_tcp_source_c(const std::string &args) :
   if (payload_size <= 0)
     payload_size = 16384;
 
-#if defined(USING_WINSOCK) // for Windows (with MinGW)
-  // initialize winsock DLL
-  WSADATA wsaData;
-  int iResult = WSAStartup( MAKEWORD(2,2), &wsaData );
-  if( iResult != NO_ERROR ) {
-    report_error( "rtl_tcp_source_f WSAStartup", "can't open socket" );
-  }
-#endif
+  if (num_buffers <= 0)
+    num_buffers = 32;
 
-  // Set up the address stucture for the source address and port numbers
-  // Get the source IP address from the host name
-  struct addrinfo *ip_src;      // store the source IP address to use
-  struct addrinfo hints;
-  memset( (void*)&hints, 0, sizeof(hints) );
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_protocol = IPPROTO_TCP;
-  hints.ai_flags = AI_PASSIVE;
-  char port_str[12];
-  sprintf( port_str, "%d", port );
-
-  // FIXME leaks if report_error throws below
-  int ret = getaddrinfo(host.c_str(), port_str, &hints, &ip_src);
-  if (ret != 0)
-    report_error("rtl_tcp_source_f/getaddrinfo",
-                 "can't initialize source socket" );
-
-  d_temp_buff = new unsigned char[payload_size];   // allow it to hold up to payload_size bytes
-  d_LUT = new float[0x100];
-  for (int i = 0; i < 0x100; ++i)
-    d_LUT[i] = (((float)(i & 0xff)) - 127.4f) * (1.0f / 128.0f);
-
-  // create socket
-  d_socket = socket(ip_src->ai_family, ip_src->ai_socktype,
-                    ip_src->ai_protocol);
-  if (d_socket == -1)
-    report_error("socket open","can't open socket");
-
-  // Turn on reuse address
-  int opt_val = 1;
-  if (setsockopt(d_socket, SOL_SOCKET, SO_REUSEADDR, (optval_t)&opt_val, sizeof(int)) == -1)
-    report_error("SO_REUSEADDR","can't set socket option SO_REUSEADDR");
-
-  // Don't wait when shutting down
-  linger lngr;
-  lngr.l_onoff  = 1;
-  lngr.l_linger = 0;
-  if (setsockopt(d_socket, SOL_SOCKET, SO_LINGER, (optval_t)&lngr, sizeof(linger)) == -1)
-    if (!is_error(ENOPROTOOPT)) // no SO_LINGER for SOCK_DGRAM on Windows
-      report_error("SO_LINGER","can't set socket option SO_LINGER");
-
-#if USE_RCV_TIMEO
-  // Set a timeout on the receive function to not block indefinitely
-  // This value can (and probably should) be changed
-  // Ignored on Cygwin
-#if defined(USING_WINSOCK)
-  DWORD timeout = 1000;  // milliseconds
-#else
-  timeval timeout;
-  timeout.tv_sec = 1;
-  timeout.tv_usec = 0;
-#endif
-  if (setsockopt(d_socket, SOL_SOCKET, SO_RCVTIMEO, (optval_t)&timeout, sizeof(timeout)) == -1)
-    report_error("SO_RCVTIMEO","can't set socket option SO_RCVTIMEO");
-#endif // USE_RCV_TIMEO
-
-  while (::connect(d_socket, ip_src->ai_addr, ip_src->ai_addrlen) != 0)
-    ; // FIXME handle errors?
-  freeaddrinfo(ip_src);
-
-  int flag = 1;
-  setsockopt(d_socket, IPPROTO_TCP, TCP_NODELAY, (char *)&flag,sizeof(flag));
-
-  dongle_info_t dongle_info;
-  ret = recv(d_socket, (char*)&dongle_info, sizeof(dongle_info), 0);
-  if (sizeof(dongle_info) != ret)
-    fprintf(stderr,"failed to read dongle info\n");
-
-  d_tuner_type = RTLSDR_TUNER_UNKNOWN;
-  d_tuner_gain_count = 0;
-  d_tuner_if_gain_count = 0;
-
-  if (memcmp(dongle_info.magic, "RTL0", 4) == 0) {
-    d_tuner_type = rtlsdr_tuner(ntohl(dongle_info.tuner_type));
-    d_tuner_gain_count = ntohl(dongle_info.tuner_gain_count);
-    if (RTLSDR_TUNER_E4000 == d_tuner_type)
-      d_tuner_if_gain_count = 53;
-  }
+  connect_server(host, port, payload_size, num_buffers);
 
   if (d_tuner_type != RTLSDR_TUNER_UNKNOWN) {
     std::cerr << "The RTL TCP server reports a "
@@ -295,68 +128,42 @@ rtl_tcp_source_c::rtl_tcp_source_c(const std::string &args) :
 
   set_gain_mode(false); /* enable manual gain mode by default */
 
-  // set direct sampling
-  struct command cmd;
-
-  cmd = { 0x09, htonl(direct_samp) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
-  if (direct_samp)
+  send_cmd(0x09, _direct_samp); // set direct sampling
+  if (_direct_samp)
     _no_tuner = true;
 
-  // set offset tuning
-  cmd = { 0x0a, htonl(offset_tune) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x0a, _offset_tune); // set offset tuning
+
+  send_cmd(0x0e, _bias_tee); // set bias tee
 
-  // set bias tee
-  cmd = { 0x0e, htonl(bias_tee) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  /* keep the server drained even when the scheduler stalls */
+  start_reader();
 }
 
-rtl_tcp_source_c::~rtl_tcp_source_c()
+void rtl_tcp_source_c::on_reconnect()
 {
-  delete [] d_LUT;
-  delete [] d_temp_buff;
-
-  if (d_socket != -1) {
-    shutdown(d_socket, SHUT_RDWR);
-#if defined(USING_WINSOCK)
-    closesocket(d_socket);
-#else
-    ::close(d_socket);
-#endif
-    d_socket = -1;
-  }
+  /* the server side state died with the old session, bring the fresh
+   * one back to where the application left off */
+  set_gain_mode(_auto_gain);
 
-#if defined(USING_WINSOCK) // for Windows (with MinGW)
-  // free winsock resources
-  WSACleanup();
-#endif
-}
+  send_cmd(0x09, _direct_samp); // set direct sampling
+  send_cmd(0x0a, _offset_tune); // set offset tuning
+  send_cmd(0x0e, _bias_tee); // set bias tee
 
+  if (_rate > 0)
+    set_sample_rate(_rate);
 
-int rtl_tcp_source_c::work(int noutput_items,
-			   gr_vector_const_void_star &input_items,
-			   gr_vector_void_star &output_items)
-{
-  gr_complex *out = (gr_complex *)output_items[0];
-  int bytesleft = noutput_items * BYTES_PER_SAMPLE;
-  int index = 0;
-  int receivedbytes = 0;
-  while (bytesleft > 0) {
-    receivedbytes = recv(d_socket, (char*)&d_temp_buff[index], bytesleft, 0);
-
-    if (receivedbytes == -1 && !is_error(EAGAIN)) {
-      fprintf(stderr, "socket error\n");
-      return -1;
-    }
-    bytesleft -= receivedbytes;
-    index += receivedbytes;
-  }
+  if (_freq > 0)
+    set_center_freq(_freq);
 
-  for (int i = 0; i < noutput_items; i++)
-    out[i] = gr_complex(d_LUT[d_temp_buff[i * 2]], d_LUT[d_temp_buff[i * 2 + 1]]);
+  if (_corr != 0)
+    set_freq_corr(_corr);
 
-  return noutput_items;
+  if (!_auto_gain)
+    set_gain(_gain);
+
+  if (_if_gain != 0)
+    set_if_gain(_if_gain);
 }
 
 std::string rtl_tcp_source_c::name()
@@ -406,11 +213,12 @@ osmosdr::meta_range_t rtl_tcp_source_c::get_sample_rates( void )
 
 double rtl_tcp_source_c::set_sample_rate( double rate )
 {
-  struct command cmd = { 0x02, htonl(rate) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x02, rate);
 
   _rate = rate;
 
+  _tagger.set_rate(rate); /* keeps rx_time/rx_rate tags in sync */
+
   return get_sample_rate();
 }
 
@@ -455,8 +263,7 @@ osmosdr::freq_range_t rtl_tcp_source_c::get_freq_range( size_t chan )
 
 double rtl_tcp_source_c::set_center_freq( double freq, size_t chan )
 {
-  struct command cmd = { 0x01, htonl(freq) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x01, freq);
 
   _freq = freq;
 
@@ -470,8 +277,7 @@ double rtl_tcp_source_c::get_center_freq( size_t chan )
 
 double rtl_tcp_source_c::set_freq_corr( double ppm, size_t chan )
 {
-  struct command cmd = { 0x05, htonl(ppm) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x05, ppm);
 
   _corr = ppm;
 
@@ -562,13 +368,9 @@ osmosdr::gain_range_t rtl_tcp_source_c::get_gain_range( const std::string & name
 
 bool rtl_tcp_source_c::set_gain_mode( bool automatic, size_t chan )
 {
-  // gain mode
-  struct command cmd = { 0x03, htonl(!automatic) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x03, !automatic); // gain mode
 
-  // AGC mode
-  cmd = { 0x08, htonl(automatic) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x08, automatic); // AGC mode
 
   _auto_gain = automatic;
 
@@ -584,8 +386,7 @@ double rtl_tcp_source_c::set_gain( double gain, size_t chan )
 {
   osmosdr::gain_range_t gains = rtl_tcp_source_c::get_gain_range( chan );
 
-  struct command cmd = { 0x04, htonl(int(gains.clip(gain) * 10.0)) };
-  send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+  send_cmd(0x04, int(gains.clip(gain) * 10.0));
 
   _gain = gain;
 
@@ -671,8 +472,7 @@ double rtl_tcp_source_c::set_if_gain(double gain, size_t chan)
   for (unsigned int stage = 1; stage <= gains.size(); stage++) {
     int gain_i = int(gains[stage] * 10.0);
     uint32_t params = stage << 16 | (gain_i & 0xffff);
-    struct command cmd = { 0x06, htonl(params) };
-    send(d_socket, (const char*)&cmd, sizeof(cmd), 0);
+    send_cmd(0x06, params);
   }
 
   _if_gain = gain;
@@ -697,3 +497,8 @@ std::string rtl_tcp_source_c::get_antenna( size_t chan )
 {
   return "RX";
 }
+
+osmosdr::stream_stats_t rtl_tcp_source_c::get_stream_stats( size_t chan )
+{
+  return _ring.stats( rtl_tcp_format_fc32::wire_bytes );
+}
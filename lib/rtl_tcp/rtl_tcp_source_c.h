@@ -20,8 +20,7 @@
 #ifndef RTL_TCP_SOURCE_C_H
 #define RTL_TCP_SOURCE_C_H
 
-#include <gnuradio/sync_block.h>
-
+#include "rtl_tcp_client.h"
 #include "source_iface.h"
 
 class rtl_tcp_source_c;
@@ -31,33 +30,19 @@ typedef boost::shared_ptr< rtl_tcp_source_c > rtl_tcp_source_c_sptr;
 rtl_tcp_source_c_sptr make_rtl_tcp_source_c( const std::string & args = "" );
 
 class rtl_tcp_source_c :
-    public gr::sync_block,
+    public rtl_tcp_client< rtl_tcp_format_fc32 >,
     public source_iface
 {
 private:
-  /* copied from rtl sdr */
-  enum rtlsdr_tuner {
-    RTLSDR_TUNER_UNKNOWN = 0,
-    RTLSDR_TUNER_E4000,
-    RTLSDR_TUNER_FC0012,
-    RTLSDR_TUNER_FC0013,
-    RTLSDR_TUNER_FC2580,
-    RTLSDR_TUNER_R820T,
-    RTLSDR_TUNER_R828D
-  };
-
   friend rtl_tcp_source_c_sptr make_rtl_tcp_source_c(const std::string &args);
 
   rtl_tcp_source_c(const std::string &args);
   const char * get_tuner_name(void);
 
-public:
-  ~rtl_tcp_source_c();
-
-  int work(int noutput_items,
-	   gr_vector_const_void_star &input_items,
-	   gr_vector_void_star &output_items);
+  /* replay the cached session settings after an automatic reconnect */
+  void on_reconnect();
 
+public:
   std::string name();
 
   static std::vector< std::string > get_devices( bool fake = false );
@@ -90,18 +75,15 @@ public:
   std::string set_antenna( const std::string & antenna, size_t chan = 0 );
   std::string get_antenna( size_t chan = 0 );
 
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
-  int d_socket;		  // handle to socket
   double _freq, _rate, _gain, _corr;
   bool _no_tuner;
   bool _auto_gain;
   double _if_gain;
-
-  enum rtlsdr_tuner d_tuner_type;
-  unsigned int d_tuner_gain_count;
-  unsigned int d_tuner_if_gain_count;
-  unsigned char *d_temp_buff; // hold buffer between calls
-  float *d_LUT;
+  unsigned int _direct_samp, _offset_tune;
+  int _bias_tee;
 };
 
 #endif // RTL_TCP_SOURCE_C_H
@@ -34,16 +34,20 @@
 #include "osmosdr/source.h"
 
 #include <boost/assign.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <mirsdrapi-rsp.h>
 
 #include "arg_helpers.h"
+#include "convert/convert.h"
 
 #define MAX_SUPPORTED_DEVICES   4
 
@@ -78,6 +82,7 @@ using namespace boost::assign;
 #define SDRPLAY_L_MAX     1675e6
 
 #define SDRPLAY_MAX_BUF_SIZE 504
+#define SDRPLAY_NUM_BUFFERS   64
 
 /*
  * Create a new instance of sdrplay_source_c and return
@@ -110,6 +115,8 @@ sdrplay_source_c::sdrplay_source_c (const std::string &args)
   : gr::sync_block ("sdrplay_source_c",
         gr::io_signature::make(MIN_IN, MAX_IN, sizeof (gr_complex)),
         gr::io_signature::make(MIN_OUT, MAX_OUT, sizeof (gr_complex))),
+    _buf_offset(0),
+    _run_reader(false),
     _running(false),
     _uninit(false),
     _auto_gain(false)
@@ -128,13 +135,10 @@ sdrplay_source_c::sdrplay_source_c (const std::string &args)
    _dev->gRdB = 60;
    set_gain_limits(_dev->rfHz);
    _dev->gain_dB = _dev->maxGain - _dev->gRdB;
-   
-   _bufi.reserve(SDRPLAY_MAX_BUF_SIZE);
-   _bufq.reserve(SDRPLAY_MAX_BUF_SIZE);   
 
-   _buf_mutex.lock();
-   _buf_offset = 0;
-   _buf_mutex.unlock();
+   /* buffers are sized for the largest packet the API delivers, commit()
+    * records how much of each one the current sample rate actually fills */
+   _ring.resize(SDRPLAY_NUM_BUFFERS, SDRPLAY_MAX_BUF_SIZE * sizeof(gr_complex));
 }
 
 /*
@@ -142,40 +146,98 @@ sdrplay_source_c::sdrplay_source_c (const std::string &args)
  */
 sdrplay_source_c::~sdrplay_source_c ()
 {
-   free(_dev);
-   _dev = NULL;
-   _buf_mutex.lock();
+   _uninit = true;
+
+   if (_run_reader)
+   {
+      _run_reader = false;
+      _reader_thread.join();
+   }
+   _ring.shutdown();
+
    if (_running)
    {
       _running = false;
+      mir_sdr_Uninit();
    }
-   _uninit = true;
-   _buf_mutex.unlock();
+
+   free(_dev);
+   _dev = NULL;
 }
 
 void sdrplay_source_c::reinit_device()
 {
-   std::cerr << "reinit_device started" << std::endl;
-   _buf_mutex.lock();
-   std::cerr << "after mutex.lock" << std::endl;
+   boost::mutex::scoped_lock lock(_reinit_mutex);
+
+   /* the reader must not sit in mir_sdr_ReadPacket() across the reinit */
+   if (_run_reader)
+   {
+      _run_reader = false;
+      _reader_thread.join();
+   }
+
    if (_running)
    {
-      std::cerr << "mir_sdr_Uninit started" << std::endl;
       mir_sdr_Uninit();
    }
 
-   std::cerr << "mir_sdr_Init started" << std::endl;
    mir_sdr_Init(_dev->gRdB, _dev->fsHz / 1e6, _dev->rfHz / 1e6, _dev->bwType, _dev->ifType, &_dev->samplesPerPacket);
 
    if (_dev->dcMode)
    {
-      std::cerr << "mir_sdr_SetDcMode started" << std::endl;
       mir_sdr_SetDcMode(4, 1);
    }
 
-   _buf_offset = 0;
-   _buf_mutex.unlock();
-   std::cerr << "reinit_device end" << std::endl;
+   _run_reader = true;
+   _reader_thread = gr::thread::thread( boost::bind(&sdrplay_source_c::reader_task, this) );
+}
+
+/*
+ * Pulls packets out of the API and hands them to work() through the
+ * lock-free ring. Conversion to gr_complex happens here so the scheduler
+ * thread only has to memcpy. No logging on this thread while it streams;
+ * overflows are counted and reported once the reader winds down.
+ */
+void sdrplay_source_c::reader_task()
+{
+   std::vector< short > bufi(SDRPLAY_MAX_BUF_SIZE);
+   std::vector< short > bufq(SDRPLAY_MAX_BUF_SIZE);
+   std::vector< float > fi(SDRPLAY_MAX_BUF_SIZE);
+   std::vector< float > fq(SDRPLAY_MAX_BUF_SIZE);
+   unsigned int sampNum;
+   int grChanged;
+   int rfChanged;
+   int fsChanged;
+
+   while (_run_reader)
+   {
+      mir_sdr_ReadPacket(bufi.data(), bufq.data(), &sampNum, &grChanged, &rfChanged, &fsChanged);
+
+      gr_complex *buf = (gr_complex *)_ring.write_head();
+      if (!buf)
+      {
+         _ring.count_drop(_dev->samplesPerPacket * sizeof(gr_complex));
+         continue;
+      }
+
+      /* one vectorized scaling pass per rail (12 significant bits),
+       * only the I/Q zip into the ring slot stays scalar */
+      osmosdr::convert::s16_fc32(bufi.data(), fi.data(), _dev->samplesPerPacket, 2048.0f);
+      osmosdr::convert::s16_fc32(bufq.data(), fq.data(), _dev->samplesPerPacket, 2048.0f);
+
+      for (int i = 0; i < _dev->samplesPerPacket; i++)
+      {
+         buf[i] = gr_complex( fi[i], fq[i] );
+      }
+      _ring.commit(_dev->samplesPerPacket * sizeof(gr_complex));
+   }
+
+   uint64_t dropped = _ring.stats().dropped_buffers;
+   if (dropped)
+   {
+      std::cerr << "sdrplay: " << dropped
+                << " packets dropped on ring overflow so far" << std::endl;
+   }
 }
 
 void sdrplay_source_c::set_gain_limits(double freq)
@@ -212,11 +274,7 @@ int sdrplay_source_c::work( int noutput_items,
                             gr_vector_void_star &output_items )
 {
    gr_complex *out = (gr_complex *)output_items[0];
-   int cnt = noutput_items;
-   unsigned int sampNum;
-   int grChanged;
-   int rfChanged;
-   int fsChanged;
+   int processed = 0;
 
    if (_uninit)
    {
@@ -229,40 +287,32 @@ int sdrplay_source_c::work( int noutput_items,
       _running = true;
    }
 
-   _buf_mutex.lock();
-
-   if (_buf_offset)
+   if (!_ring.wait(1))
    {
-      for (int i = _buf_offset; i < _dev->samplesPerPacket; i++)
-      {
-         *out++ = gr_complex( float(_bufi[i]) * (1.0f/2048.0f), float(_bufq[i]) * (1.0f/2048.0f) );
-      }
-      cnt -= (_dev->samplesPerPacket - _buf_offset);
+      return WORK_DONE;
    }
 
-   while ((cnt - _dev->samplesPerPacket) >= 0)
+   while (processed < noutput_items && _ring.used())
    {
-      mir_sdr_ReadPacket(_bufi.data(), _bufq.data(), &sampNum, &grChanged, &rfChanged, &fsChanged);
-      for (int i = 0; i < _dev->samplesPerPacket; i++)
+      const gr_complex *buf = (const gr_complex *)_ring.head() + _buf_offset;
+      int avail = _ring.head_len() / sizeof(gr_complex) - _buf_offset;
+      int cnt = std::min(avail, noutput_items - processed);
+
+      memcpy(out + processed, buf, cnt * sizeof(gr_complex));
+      processed += cnt;
+
+      if (cnt < avail)
       {
-         *out++ = gr_complex( float(_bufi[i]) * (1.0f/2048.0f), float(_bufq[i]) * (1.0f/2048.0f) );
+         _buf_offset += cnt;
       }
-      cnt -= _dev->samplesPerPacket;
-   }
-
-   _buf_offset = 0;
-   if (cnt)
-   {
-      mir_sdr_ReadPacket(_bufi.data(), _bufq.data(), &sampNum, &grChanged, &rfChanged, &fsChanged);
-      for (int i = 0; i < cnt; i++)
+      else
       {
-         *out++ = gr_complex( float(_bufi[i]) * (1.0f/2048.0f), float(_bufq[i]) * (1.0f/2048.0f) );
+         _buf_offset = 0;
+         _ring.pop();
       }
-      _buf_offset = cnt;
    }
-   _buf_mutex.unlock();
 
-   return noutput_items;
+   return processed;
 }
 
 std::vector<std::string> sdrplay_source_c::get_devices()
@@ -598,3 +648,8 @@ osmosdr::freq_range_t sdrplay_source_c::get_bandwidth_range( size_t chan )
 
    return range;
 }
+
+osmosdr::stream_stats_t sdrplay_source_c::get_stream_stats( size_t chan )
+{
+   return _ring.stats( sizeof(gr_complex) );
+}
@@ -25,10 +25,12 @@
 
 #include <gnuradio/thread/thread.h>
 #include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
+
+#include <atomic>
 
 #include "osmosdr/ranges.h"
 
+#include "buffer_ring.h"
 #include "source_iface.h"
 
 class sdrplay_source_c;
@@ -117,16 +119,21 @@ public:
    double get_bandwidth( size_t chan = 0 );
    osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
+   osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+
 private:
    void reinit_device(void);
    void set_gain_limits(double freq);
+   void reader_task(void);
 
    sdrplay_dev_t *_dev;
 
-   std::vector< short > _bufi;
-   std::vector< short > _bufq;
+   osmosdr::buffer_ring _ring;
    int _buf_offset;
-   boost::mutex _buf_mutex;
+
+   gr::thread::thread _reader_thread;
+   std::atomic<bool> _run_reader;
+   boost::mutex _reinit_mutex;
 
    bool _running;
    bool _uninit;
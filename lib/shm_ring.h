@@ -0,0 +1,267 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_SHM_RING_H
+#define OSMOSDR_SHM_RING_H
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#include <stdint.h>
+
+namespace osmosdr {
+
+/*!
+ * One-writer many-reader sample ring in a POSIX shared memory
+ * segment. The writer overwrites the oldest data unconditionally and
+ * publishes its progress as a single monotonic byte counter; every
+ * reader keeps a private cursor in its own process and detects
+ * overruns - and accounts the loss - entirely on its side, so
+ * consumers never slow the writer or each other down.
+ *
+ * Segment layout: one shm_ring_hdr_t, then \p size payload bytes
+ * addressed modulo size. The head counter is the only shared state
+ * written after setup; release/acquire ordering on it makes the
+ * payload bytes it covers visible to the readers.
+ */
+
+#define SHM_RING_MAGIC   0x4f534d52  /* "OSMR" */
+#define SHM_RING_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;               /* payload bytes */
+  std::atomic<uint64_t> head;  /* payload bytes ever written */
+} shm_ring_hdr_t;
+
+class shm_ring_writer
+{
+public:
+  shm_ring_writer() : _hdr(NULL), _data(NULL), _size(0) { }
+
+  ~shm_ring_writer()
+  {
+    if (_hdr) {
+      munmap(_hdr, sizeof(shm_ring_hdr_t) + _size);
+      shm_unlink(_name.c_str());
+    }
+  }
+
+  /*! Create (or take over) segment \p name with \p size payload
+   * bytes. \p size is rounded up to a multiple of \p item so the
+   * head counter always sits on an item boundary.
+   * \return false with errno set when the segment cannot be set up */
+  bool create(const std::string &name, size_t size, size_t item)
+  {
+    size += (item - size % item) % item;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0)
+      return false;
+
+    if (ftruncate(fd, sizeof(shm_ring_hdr_t) + size) < 0) {
+      ::close(fd);
+      shm_unlink(name.c_str());
+      return false;
+    }
+
+    void *map = mmap(NULL, sizeof(shm_ring_hdr_t) + size,
+                     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (MAP_FAILED == map) {
+      shm_unlink(name.c_str());
+      return false;
+    }
+
+    _hdr = (shm_ring_hdr_t *)map;
+    _data = (unsigned char *)map + sizeof(shm_ring_hdr_t);
+    _size = size;
+    _name = name;
+
+    _hdr->size = size;
+    _hdr->head.store(0, std::memory_order_relaxed);
+    _hdr->version = SHM_RING_VERSION;
+
+    /* the magic goes in last, a reader probing the segment must not
+     * see it before the rest of the header is valid */
+    std::atomic_thread_fence(std::memory_order_release);
+    _hdr->magic = SHM_RING_MAGIC;
+
+    return true;
+  }
+
+  void write(const unsigned char *data, size_t len)
+  {
+    uint64_t head = _hdr->head.load(std::memory_order_relaxed);
+    size_t pos = head % _size;
+    size_t tail_room = _size - pos;
+
+    if (len <= tail_room) {
+      memcpy(_data + pos, data, len);
+    } else {
+      memcpy(_data + pos, data, tail_room);
+      memcpy(_data, data + tail_room, len - tail_room);
+    }
+
+    _hdr->head.store(head + len, std::memory_order_release);
+  }
+
+private:
+  shm_ring_hdr_t *_hdr;
+  unsigned char *_data;
+  size_t _size;
+  std::string _name;
+};
+
+class shm_ring_reader
+{
+public:
+  shm_ring_reader()
+    : _hdr(NULL), _data(NULL), _size(0), _tail(0),
+      _dropped_bytes(0), _overruns(0)
+  {
+  }
+
+  ~shm_ring_reader()
+  {
+    if (_hdr)
+      munmap((void *)_hdr, sizeof(shm_ring_hdr_t) + _size);
+  }
+
+  /*! Attach read-only to segment \p name. The cursor starts at the
+   * writer's current position.
+   * \return false when the segment is missing or not a sample ring */
+  bool attach(const std::string &name)
+  {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(shm_ring_hdr_t)) {
+      ::close(fd);
+      return false;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (MAP_FAILED == map)
+      return false;
+
+    const shm_ring_hdr_t *hdr = (const shm_ring_hdr_t *)map;
+
+    if (SHM_RING_MAGIC != hdr->magic ||
+        SHM_RING_VERSION != hdr->version ||
+        size_t(st.st_size) < sizeof(shm_ring_hdr_t) + hdr->size) {
+      munmap(map, st.st_size);
+      return false;
+    }
+
+    _hdr = hdr;
+    _data = (const unsigned char *)map + sizeof(shm_ring_hdr_t);
+    _size = hdr->size;
+    _tail = _hdr->head.load(std::memory_order_acquire);
+
+    return true;
+  }
+
+  /*! Copy up to \p max bytes of new data into \p dest.
+   * When the writer has lapped this reader the cursor jumps forward
+   * to half a ring behind the writer and the skipped bytes are
+   * accounted; data overwritten mid-copy is detected the same way
+   * and the spoiled copy is retried from the fresh cursor.
+   * \return the number of bytes delivered, 0 when nothing is new */
+  size_t read(unsigned char *dest, size_t max)
+  {
+    for (;;) {
+      uint64_t head = _hdr->head.load(std::memory_order_acquire);
+
+      if (head - _tail > _size) {
+        /* lapped; resync half a ring back so the next chunks are not
+         * immediately under the writer again */
+        uint64_t fresh = head - _size / 2;
+        fresh -= fresh % granularity(); /* keep sample alignment */
+        _dropped_bytes += fresh - _tail;
+        _overruns++;
+        _tail = fresh;
+      }
+
+      size_t avail = head - _tail;
+      if (0 == avail)
+        return 0;
+
+      size_t len = (avail < max) ? avail : max;
+      size_t pos = _tail % _size;
+      size_t tail_room = _size - pos;
+
+      if (len <= tail_room) {
+        memcpy(dest, _data + pos, len);
+      } else {
+        memcpy(dest, _data + pos, tail_room);
+        memcpy(dest + tail_room, _data, len - tail_room);
+      }
+
+      /* if the writer moved past our chunk while we copied it, the
+       * bytes are spoiled - drop them and go again. The fence keeps
+       * the payload loads above from being satisfied after the
+       * recheck on weakly ordered CPUs (seqlock read side); the
+       * recheck itself can then be relaxed. */
+      std::atomic_thread_fence(std::memory_order_acquire);
+      head = _hdr->head.load(std::memory_order_relaxed);
+      if (head - _tail <= _size) {
+        _tail += len;
+        return len;
+      }
+    }
+  }
+
+  uint64_t dropped_bytes() const { return _dropped_bytes; }
+  uint64_t overruns() const { return _overruns; }
+  size_t size() const { return _size; }
+
+private:
+  /* writers only publish whole samples, resync points must too */
+  size_t granularity() const { return 8; }
+
+  const shm_ring_hdr_t *_hdr;
+  const unsigned char *_data;
+  size_t _size;
+  uint64_t _tail;
+
+  uint64_t _dropped_bytes;
+  uint64_t _overruns;
+};
+
+} /* namespace osmosdr */
+
+#endif /* !_WIN32 */
+
+#endif /* OSMOSDR_SHM_RING_H */
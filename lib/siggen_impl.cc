@@ -0,0 +1,290 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gnuradio/io_signature.h>
+
+#include <boost/bind.hpp>
+
+#include <volk/volk.h>
+
+#include "siggen_impl.h"
+
+#define SIGGEN_LUT_BITS 12
+#define SIGGEN_LUT_SIZE (1 << SIGGEN_LUT_BITS)
+
+/* two's complement wraparound turns a signed frequency into the right
+ * unsigned accumulator increment */
+static uint32_t phase_increment( double freq, double rate )
+{
+  return (uint32_t)(int64_t)llround( freq / rate * 4294967296.0 );
+}
+
+static std::vector<gr_complex> build_phase_lut( void )
+{
+  std::vector<gr_complex> lut( SIGGEN_LUT_SIZE );
+
+  for ( size_t i = 0; i < SIGGEN_LUT_SIZE; i++ ) {
+    float phase = 2.0 * M_PI * i / SIGGEN_LUT_SIZE;
+    lut[i] = gr_complex( cosf(phase), sinf(phase) );
+  }
+
+  return lut;
+}
+
+/* the table is identical for every instance, so one process-wide copy
+ * is enough; the function local static is built exactly once even
+ * when several flowgraphs construct blocks concurrently */
+static const std::vector<gr_complex> &phase_lut( void )
+{
+  static const std::vector<gr_complex> lut = build_phase_lut();
+
+  return lut;
+}
+
+/*
+ * Create a new instance of siggen_impl and return
+ * a boost shared_ptr.  This is effectively the public constructor.
+ */
+osmosdr::siggen::sptr
+osmosdr::siggen::make( double sample_rate, double ampl )
+{
+  return gnuradio::get_initial_sptr( new siggen_impl(sample_rate, ampl) );
+}
+
+siggen_impl::siggen_impl( double sample_rate, double ampl )
+  : gr::sync_block( "siggen",
+                    gr::io_signature::make(0, 0, 0),
+                    gr::io_signature::make(1, 1, sizeof(gr_complex)) ),
+    _waveform(osmosdr::SIGGEN_CONST),
+    _rate(sample_rate),
+    _freq(0.0),
+    _freq2(0.0),
+    _ampl(ampl),
+    _lut(phase_lut()),
+    _acc(0),
+    _acc2(0),
+    _macc(0),
+    _rng(0x6d5a5a57)
+{
+  if ( sample_rate <= 0.0 )
+    throw std::invalid_argument("sample_rate must be > 0");
+
+  update_increments();
+
+  message_port_register_in( pmt::mp("cmd") );
+  set_msg_handler( pmt::mp("cmd"),
+                   boost::bind(&siggen_impl::handle_cmd, this, _1) );
+}
+
+void siggen_impl::update_increments( void )
+{
+  _inc = phase_increment( _freq, _rate );
+  _inc2 = phase_increment( _freq2, _rate );
+
+  /* the sweep ramps at freq2 over a width of freq around DC */
+  _minc = phase_increment( _freq2, _rate );
+  _winc = _freq / _rate * 4294967296.0;
+}
+
+void siggen_impl::set_sample_rate( double rate )
+{
+  if ( rate <= 0.0 )
+    throw std::invalid_argument("sample_rate must be > 0");
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _rate = rate;
+  update_increments();
+}
+
+void siggen_impl::set_waveform( osmosdr::siggen_waveform_t waveform )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _waveform = waveform;
+}
+
+void siggen_impl::set_freq( double freq )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _freq = freq;
+  update_increments();
+}
+
+void siggen_impl::set_freq2( double freq )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _freq2 = freq;
+  update_increments();
+}
+
+void siggen_impl::set_amplitude( double ampl )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _ampl = ampl;
+}
+
+static osmosdr::siggen_waveform_t waveform_by_name( const std::string &name )
+{
+  if ( "const" == name )
+    return osmosdr::SIGGEN_CONST;
+  else if ( "tone" == name )
+    return osmosdr::SIGGEN_TONE;
+  else if ( "two_tone" == name )
+    return osmosdr::SIGGEN_TWO_TONE;
+  else if ( "sweep" == name )
+    return osmosdr::SIGGEN_SWEEP;
+  else if ( "noise_uniform" == name )
+    return osmosdr::SIGGEN_NOISE_UNIFORM;
+  else if ( "noise_gaussian" == name )
+    return osmosdr::SIGGEN_NOISE_GAUSSIAN;
+
+  throw std::invalid_argument("unknown waveform: " + name);
+}
+
+void siggen_impl::handle_cmd( pmt::pmt_t msg )
+{
+  /* accept both a plain dict and the common (dict . data) pair */
+  if ( pmt::is_pair(msg) && !pmt::is_dict(msg) )
+    msg = pmt::car(msg);
+
+  if ( !pmt::is_dict(msg) )
+    return;
+
+  pmt::pmt_t keys = pmt::dict_keys(msg);
+
+  for ( size_t i = 0; i < pmt::length(keys); i++ ) {
+    pmt::pmt_t key = pmt::nth(i, keys);
+    pmt::pmt_t val = pmt::dict_ref(msg, key, pmt::PMT_NIL);
+    std::string name = pmt::symbol_to_string(key);
+
+    if ( "rate" == name )
+      set_sample_rate( pmt::to_double(val) );
+    else if ( "freq" == name )
+      set_freq( pmt::to_double(val) );
+    else if ( "freq2" == name )
+      set_freq2( pmt::to_double(val) );
+    else if ( "ampl" == name )
+      set_amplitude( pmt::to_double(val) );
+    else if ( "waveform" == name ) {
+      if ( pmt::is_symbol(val) )
+        set_waveform( waveform_by_name( pmt::symbol_to_string(val) ) );
+      else
+        set_waveform( (osmosdr::siggen_waveform_t)pmt::to_long(val) );
+    }
+    /* unknown keys are ignored, a dict may serve several blocks */
+  }
+}
+
+float siggen_impl::next_uniform( void )
+{
+  _rng ^= _rng << 13;
+  _rng ^= _rng >> 17;
+  _rng ^= _rng << 5;
+
+  return (int32_t)_rng * (1.0f / 2147483648.0f);
+}
+
+int siggen_impl::work( int noutput_items,
+                       gr_vector_const_void_star &input_items,
+                       gr_vector_void_star &output_items )
+{
+  gr_complex *out = (gr_complex *)output_items[0];
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  const lv_32fc_t scale = lv_32fc_t( _ampl, 0.0f );
+
+  switch ( _waveform )
+  {
+  case osmosdr::SIGGEN_CONST:
+    std::fill( out, out + noutput_items, gr_complex( _ampl, 0.0f ) );
+    break;
+
+  case osmosdr::SIGGEN_TONE:
+    for ( int i = 0; i < noutput_items; i++ ) {
+      out[i] = _lut[_acc >> (32 - SIGGEN_LUT_BITS)];
+      _acc += _inc;
+    }
+
+    volk_32fc_s32fc_multiply_32fc( (lv_32fc_t *)out, (const lv_32fc_t *)out,
+                                   scale, noutput_items );
+    break;
+
+  case osmosdr::SIGGEN_TWO_TONE:
+    for ( int i = 0; i < noutput_items; i++ ) {
+      out[i] = _lut[_acc >> (32 - SIGGEN_LUT_BITS)] +
+               _lut[_acc2 >> (32 - SIGGEN_LUT_BITS)];
+      _acc += _inc;
+      _acc2 += _inc2;
+    }
+
+    /* half amplitude per tone keeps the sum within the peak */
+    volk_32fc_s32fc_multiply_32fc( (lv_32fc_t *)out, (const lv_32fc_t *)out,
+                                   scale * lv_32fc_t( 0.5f, 0.0f ),
+                                   noutput_items );
+    break;
+
+  case osmosdr::SIGGEN_SWEEP:
+    for ( int i = 0; i < noutput_items; i++ ) {
+      /* triangle ramp in [-0.5, 0.5], same shape the Python chain fed
+       * into its frequency modulator */
+      float tri = ( _macc < 0x80000000u )
+                  ? (float)_macc * (1.0f / 2147483648.0f) - 0.5f
+                  : 1.5f - (float)_macc * (1.0f / 2147483648.0f);
+
+      out[i] = _lut[_acc >> (32 - SIGGEN_LUT_BITS)];
+      _acc += (uint32_t)(int32_t)( tri * _winc );
+      _macc += _minc;
+    }
+
+    volk_32fc_s32fc_multiply_32fc( (lv_32fc_t *)out, (const lv_32fc_t *)out,
+                                   scale, noutput_items );
+    break;
+
+  case osmosdr::SIGGEN_NOISE_UNIFORM:
+    for ( int i = 0; i < noutput_items; i++ )
+      out[i] = gr_complex( next_uniform() * (float)_ampl,
+                           next_uniform() * (float)_ampl );
+    break;
+
+  case osmosdr::SIGGEN_NOISE_GAUSSIAN:
+    for ( int i = 0; i < noutput_items; i++ ) {
+      /* sum of four uniforms, scaled to unit variance - plenty
+       * gaussian for a test signal and branch free */
+      float re = next_uniform() + next_uniform() +
+                 next_uniform() + next_uniform();
+      float im = next_uniform() + next_uniform() +
+                 next_uniform() + next_uniform();
+
+      out[i] = gr_complex( re * 0.8660254f * (float)_ampl,
+                           im * 0.8660254f * (float)_ampl );
+    }
+    break;
+  }
+
+  return noutput_items;
+}
@@ -0,0 +1,70 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_SIGGEN_IMPL_H
+#define INCLUDED_OSMOSDR_SIGGEN_IMPL_H
+
+#include <osmosdr/siggen.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+class siggen_impl : public osmosdr::siggen
+{
+public:
+  siggen_impl( double sample_rate, double ampl );
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
+  void set_sample_rate( double rate );
+  void set_waveform( osmosdr::siggen_waveform_t waveform );
+  void set_freq( double freq );
+  void set_freq2( double freq );
+  void set_amplitude( double ampl );
+
+private:
+  void handle_cmd( pmt::pmt_t msg );
+  void update_increments( void ); /* call with _mutex held */
+  float next_uniform( void );     /* in [-1.0, 1.0) */
+
+  boost::mutex _mutex; /* guards everything below */
+
+  osmosdr::siggen_waveform_t _waveform;
+  double _rate;
+  double _freq;
+  double _freq2;
+  double _ampl;
+
+  /* a full turn of e^(j*phi), indexed by the accumulators' top bits;
+   * the table is immutable and shared by every instance */
+  const std::vector<gr_complex> &_lut;
+
+  uint32_t _acc, _inc;   /* tone 1, also the sweep carrier */
+  uint32_t _acc2, _inc2; /* tone 2 */
+  uint32_t _macc, _minc; /* sweep modulation ramp */
+  float _winc;           /* sweep width as a phase increment */
+
+  uint32_t _rng; /* xorshift32 state for the noise waveforms */
+};
+
+#endif /* INCLUDED_OSMOSDR_SIGGEN_IMPL_H */
@@ -22,9 +22,14 @@
 #define OSMOSDR_SINK_IFACE_H
 
 #include <osmosdr/ranges.h>
+#include <osmosdr/stream_stats.h>
 #include <osmosdr/time_spec.h>
 #include <gnuradio/basic_block.h>
 
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+
 /*!
  * TODO: document
  *
@@ -363,6 +368,70 @@ public:
    * \param time_spec the new time
    */
   virtual void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec) { }
+
+  /*!
+   * Schedule a timed transmit burst. The next \p nsamps samples on the
+   * given channel form one burst transmitted at \p time. Ignored by
+   * hardware without timed TX support, which keeps streaming
+   * continuously.
+   * \param time the absolute device time the burst starts at
+   * \param nsamps the burst length in samples
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void queue_burst( const ::osmosdr::time_spec_t &time,
+                            size_t nsamps, size_t chan = 0 ) { }
+
+  /*!
+   * Get streaming health counters for the specified channel.
+   * \param chan the channel index 0 to N-1
+   * \return a snapshot, all zeros when the backend is not instrumented
+   */
+  virtual osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 )
+    { return osmosdr::stream_stats_t(); }
+
+  /*!
+   * Apply several settings as one batch. Supported keys are rate,
+   * corr, freq, gain_mode, gain, if_gain, bb_gain, antenna and
+   * bandwidth; unknown keys are ignored so one settings map can serve
+   * several backends. The default simply walks the individual setters
+   * in a sensible order (correction before tuning); backends talking
+   * to remote hardware override this to coalesce the batch into fewer
+   * device round-trips.
+   * \param settings the settings to apply, keyed as in device args
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void apply( const std::map< std::string, std::string > &settings,
+                      size_t chan = 0 )
+  {
+    std::map< std::string, std::string >::const_iterator it;
+
+    if ( (it = settings.find("rate")) != settings.end() )
+      set_sample_rate( boost::lexical_cast< double >( it->second ) );
+
+    if ( (it = settings.find("corr")) != settings.end() )
+      set_freq_corr( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("freq")) != settings.end() )
+      set_center_freq( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("gain_mode")) != settings.end() )
+      set_gain_mode( boost::lexical_cast< bool >( it->second ), chan );
+
+    if ( (it = settings.find("gain")) != settings.end() )
+      set_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("if_gain")) != settings.end() )
+      set_if_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("bb_gain")) != settings.end() )
+      set_bb_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("antenna")) != settings.end() )
+      set_antenna( it->second, chan );
+
+    if ( (it = settings.find("bandwidth")) != settings.end() )
+      set_bandwidth( boost::lexical_cast< double >( it->second ), chan );
+  }
 };
 
 #endif // OSMOSDR_SINK_IFACE_H
@@ -30,21 +30,28 @@
 #include <gnuradio/io_signature.h>
 #include <gnuradio/constants.h>
 
-#ifdef ENABLE_UHD
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
 #include "uhd_sink_c.h"
 #endif
 #ifdef ENABLE_HACKRF
 #include "hackrf_sink_c.h"
 #endif
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
 #include "bladerf_sink_c.h"
 #endif
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
 #include "soapy_sink_c.h"
 #endif
 #ifdef ENABLE_REDPITAYA
 #include "redpitaya_sink_c.h"
 #endif
+#ifdef ENABLE_RTL_TCP
+#include "rtl_tcp_sink_c.h"
+#endif
 #ifdef ENABLE_FREESRP
 #include <freesrp_sink_c.h>
 #endif
@@ -53,6 +60,8 @@
 #endif
 
 #include "arg_helpers.h"
+#include "cmd_msg_rx.h"
+#include "plugin_loader.h"
 #include "sink_impl.h"
 
 /*
@@ -72,30 +81,38 @@ sink_impl::sink_impl( const std::string &args )
   : gr::hier_block2 ("sink_impl",
         args_to_io_signature(args),
         gr::io_signature::make(0, 0, 0)),
+    _ctrl_thread_running(false),
+    _ctrl_shutdown(false),
     _sample_rate(NAN)
 {
   size_t channel = 0;
   bool device_specified = false;
 
+  if ( args_to_sc16_output(args) )
+    throw std::runtime_error("format=sc16 is only available on the source side.");
+
   std::vector< std::string > arg_list = args_to_vector(args);
 
   std::vector< std::string > dev_types;
 
-#ifdef ENABLE_UHD
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
   dev_types.push_back("uhd");
 #endif
 #ifdef ENABLE_HACKRF
   dev_types.push_back("hackrf");
 #endif
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
   dev_types.push_back("bladerf");
 #endif
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
   dev_types.push_back("soapy");
 #endif
 #ifdef ENABLE_REDPITAYA
   dev_types.push_back("redpitaya");
 #endif
+#ifdef ENABLE_RTL_TCP
+  dev_types.push_back("rtl_tcp");
+#endif
 #ifdef ENABLE_FREESRP
   dev_types.push_back("freesrp");
 #endif
@@ -111,6 +128,12 @@ sink_impl::sink_impl( const std::string &args )
     std::cerr << dev_type << " ";
   std::cerr << std::endl;
 
+  /* backends that may live in lazily loaded plugins announce their
+   * type key here without touching the plugin library itself */
+  BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() )
+    if ( std::find( dev_types.begin(), dev_types.end(), plugin ) == dev_types.end() )
+      dev_types.push_back( plugin );
+
   BOOST_FOREACH(std::string arg, arg_list) {
     dict_t dict = params_to_dict(arg);
     BOOST_FOREACH(std::string dev_type, dev_types) {
@@ -123,11 +146,11 @@ sink_impl::sink_impl( const std::string &args )
 
   if ( ! device_specified ) {
     std::vector< std::string > dev_list;
-#ifdef ENABLE_UHD
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
     BOOST_FOREACH( std::string dev, uhd_sink_c::get_devices() )
       dev_list.push_back( dev );
 #endif
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
     BOOST_FOREACH( std::string dev, bladerf_sink_c::get_devices() )
       dev_list.push_back( dev );
 #endif
@@ -135,7 +158,7 @@ sink_impl::sink_impl( const std::string &args )
     BOOST_FOREACH( std::string dev, hackrf_sink_c::get_devices() )
       dev_list.push_back( dev );
 #endif
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
     BOOST_FOREACH( std::string dev, soapy_sink_c::get_devices() )
       dev_list.push_back( dev );
 #endif
@@ -152,6 +175,16 @@ sink_impl::sink_impl( const std::string &args )
       dev_list.push_back( dev );
 #endif
 
+    /* a full enumeration is one of the two events that resolve the
+     * installed backend plugins (the other is their arg key) */
+    BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() ) {
+      osmosdr::plugin_get_devices_fn get_devices =
+          (osmosdr::plugin_get_devices_fn)
+              osmosdr::plugin_loader::entry( plugin, OSMOSDR_PLUGIN_SINK_DEVICES );
+      if ( get_devices )
+        get_devices( dev_list );
+    }
+
 //    std::cerr << std::endl;
 //    BOOST_FOREACH( std::string dev, dev_list )
 //      std::cerr << "'" << dev << "'" << std::endl;
@@ -173,7 +206,7 @@ sink_impl::sink_impl( const std::string &args )
     sink_iface *iface = NULL;
     gr::basic_block_sptr block;
 
-#ifdef ENABLE_UHD
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
     if ( dict.count("uhd") ) {
       uhd_sink_c_sptr sink = make_uhd_sink_c( arg );
       block = sink; iface = sink.get();
@@ -185,13 +218,13 @@ sink_impl::sink_impl( const std::string &args )
       block = sink; iface = sink.get();
     }
 #endif
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
     if ( dict.count("bladerf") ) {
       bladerf_sink_c_sptr sink = make_bladerf_sink_c( arg );
       block = sink; iface = sink.get();
     }
 #endif
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
     if ( dict.count("soapy") ) {
       soapy_sink_c_sptr sink = make_soapy_sink_c( arg );
       block = sink; iface = sink.get();
@@ -203,6 +236,12 @@ sink_impl::sink_impl( const std::string &args )
       block = sink; iface = sink.get();
     }
 #endif
+#ifdef ENABLE_RTL_TCP
+    if ( dict.count("rtl_tcp") ) {
+      rtl_tcp_sink_c_sptr sink = make_rtl_tcp_sink_c( arg );
+      block = sink; iface = sink.get();
+    }
+#endif
 #ifdef ENABLE_FREESRP
     if ( dict.count("freesrp") ) {
       freesrp_sink_c_sptr sink = make_freesrp_sink_c( arg );
@@ -216,6 +255,22 @@ sink_impl::sink_impl( const std::string &args )
     }
 #endif
 
+    if ( iface == NULL ) {
+      /* the arg may belong to a backend built as a plugin, which is
+       * dlopen'd here on first use */
+      BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() ) {
+        if ( ! dict.count( plugin ) )
+          continue;
+        osmosdr::plugin_make_sink_fn make_sink =
+            (osmosdr::plugin_make_sink_fn)
+                osmosdr::plugin_loader::entry( plugin, OSMOSDR_PLUGIN_MAKE_SINK );
+        if ( make_sink ) {
+          block = make_sink( arg, &iface );
+          break;
+        }
+      }
+    }
+
     if ( iface != NULL && long(block.get()) != 0 ) {
       _devs.push_back( iface );
 
@@ -229,6 +284,26 @@ sink_impl::sink_impl( const std::string &args )
 
   if (!_devs.size())
     throw std::runtime_error("No devices specified via device arguments.");
+
+  /* runtime control: command dicts arriving here are queued on the
+   * control executor, so a closed loop never blocks on hardware */
+  message_port_register_hier_in( pmt::mp("cmd") );
+  msg_connect( self(), "cmd",
+               osmosdr::cmd_msg_rx::make(
+                   boost::bind( &sink_impl::handle_cmd_msg, this, _1 ) ),
+               "cmd" );
+}
+
+sink_impl::~sink_impl()
+{
+  {
+    boost::mutex::scoped_lock lock(_ctrl_mutex);
+    _ctrl_shutdown = true;
+  }
+  _ctrl_cond.notify_one();
+
+  if (_ctrl_thread_running)
+    _ctrl_thread.join();
 }
 
 size_t sink_impl::get_num_channels()
@@ -302,7 +377,7 @@ double sink_impl::set_center_freq( double freq, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _center_freq[ chan ] != freq ) {
+        if ( !_center_freq.count( chan ) || _center_freq[ chan ] != freq ) {
           _center_freq[ chan ] = freq;
           return dev->set_center_freq( freq, dev_chan );
         } else { return _center_freq[ chan ]; }
@@ -322,13 +397,82 @@ double sink_impl::get_center_freq( size_t chan )
   return 0;
 }
 
+void sink_impl::ctrl_task( void )
+{
+  boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+  while ( true ) {
+    while ( _ctrl_queue.empty() && ! _ctrl_shutdown )
+      _ctrl_cond.wait(lock);
+
+    if ( _ctrl_queue.empty() && _ctrl_shutdown )
+      return;
+
+    boost::function<void ()> request = _ctrl_queue.front();
+    _ctrl_queue.pop_front();
+
+    /* the hardware call runs unlocked so callers never block on it */
+    lock.unlock();
+    request();
+    lock.lock();
+  }
+}
+
+void sink_impl::exec_async( const boost::function<void ()> &fn )
+{
+  {
+    boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+    if ( ! _ctrl_thread_running ) {
+      _ctrl_thread = gr::thread::thread(
+            boost::bind( &sink_impl::ctrl_task, this ) );
+      _ctrl_thread_running = true;
+    }
+
+    _ctrl_queue.push_back( fn );
+  }
+
+  _ctrl_cond.notify_one();
+}
+
+void sink_impl::do_tune( double freq, size_t chan, promise_sptr result )
+{
+  try {
+    double actual = set_center_freq( freq, chan );
+
+    if ( result )
+      result->set_value( actual );
+  } catch ( const std::exception &ex ) {
+    if ( result )
+      result->set_exception( boost::current_exception() );
+    else /* a fire-and-forget request has nobody to report to */
+      std::cerr << "Async tune failed: " << ex.what() << std::endl;
+  }
+}
+
+void sink_impl::set_center_freq_async( double freq, size_t chan )
+{
+  exec_async( boost::bind( &sink_impl::do_tune, this, freq, chan,
+                           promise_sptr() ) );
+}
+
+boost::unique_future<double> sink_impl::set_center_freq_future( double freq,
+                                                                size_t chan )
+{
+  promise_sptr result( new boost::promise<double>() );
+
+  exec_async( boost::bind( &sink_impl::do_tune, this, freq, chan, result ) );
+
+  return result->get_future();
+}
+
 double sink_impl::set_freq_corr( double ppm, size_t chan )
 {
   size_t channel = 0;
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _freq_corr[ chan ] != ppm ) {
+        if ( !_freq_corr.count( chan ) || _freq_corr[ chan ] != ppm ) {
           _freq_corr[ chan ] = ppm;
           return dev->set_freq_corr( ppm, dev_chan );
         } else { return _freq_corr[ chan ]; }
@@ -387,7 +531,7 @@ bool sink_impl::set_gain_mode( bool automatic, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _gain_mode[ chan ] != automatic ) {
+        if ( !_gain_mode.count( chan ) || _gain_mode[ chan ] != automatic ) {
           _gain_mode[ chan ] = automatic;
           bool mode = dev->set_gain_mode( automatic, dev_chan );
           if (!automatic) // reapply gain value when switched to manual mode
@@ -416,7 +560,7 @@ double sink_impl::set_gain( double gain, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _gain[ chan ] != gain ) {
+        if ( !_gain.count( chan ) || _gain[ chan ] != gain ) {
           _gain[ chan ] = gain;
           return dev->set_gain( gain, dev_chan );
         } else { return _gain[ chan ]; }
@@ -430,12 +574,65 @@ double sink_impl::set_gain( double gain, const std::string & name, size_t chan)
   size_t channel = 0;
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
-      if ( chan == channel++ )
-        return dev->set_gain( gain, name, dev_chan );
+      if ( chan == channel++ ) {
+        std::map< std::string, double > &gains = _named_gain[ chan ];
+        if ( !gains.count( name ) || gains[ name ] != gain ) {
+          gains[ name ] = gain;
+          return dev->set_gain( gain, name, dev_chan );
+        } else { return gains[ name ]; }
+      }
 
   return 0;
 }
 
+void sink_impl::do_set_gain( double gain, size_t chan, promise_sptr result )
+{
+  try {
+    double actual = set_gain( gain, chan );
+
+    if ( result )
+      result->set_value( actual );
+  } catch ( const std::exception &ex ) {
+    if ( result )
+      result->set_exception( boost::current_exception() );
+    else /* a fire-and-forget request has nobody to report to */
+      std::cerr << "Async gain change failed: " << ex.what() << std::endl;
+  }
+}
+
+void sink_impl::do_set_gain_named( double gain, std::string name, size_t chan )
+{
+  try {
+    set_gain( gain, name, chan );
+  } catch ( const std::exception &ex ) {
+    std::cerr << "Async gain change failed: " << ex.what() << std::endl;
+  }
+}
+
+void sink_impl::set_gain_async( double gain, size_t chan )
+{
+  exec_async( boost::bind( &sink_impl::do_set_gain, this, gain, chan,
+                           promise_sptr() ) );
+}
+
+void sink_impl::set_gain_async( double gain, const std::string & name,
+                                size_t chan )
+{
+  exec_async( boost::bind( &sink_impl::do_set_gain_named, this, gain,
+                           name, chan ) );
+}
+
+boost::unique_future<double> sink_impl::set_gain_future( double gain,
+                                                         size_t chan )
+{
+  promise_sptr result( new boost::promise<double>() );
+
+  exec_async( boost::bind( &sink_impl::do_set_gain, this, gain, chan,
+                           result ) );
+
+  return result->get_future();
+}
+
 double sink_impl::get_gain( size_t chan )
 {
   size_t channel = 0;
@@ -464,7 +661,7 @@ double sink_impl::set_if_gain( double gain, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _if_gain[ chan ] != gain ) {
+        if ( !_if_gain.count( chan ) || _if_gain[ chan ] != gain ) {
           _if_gain[ chan ] = gain;
           return dev->set_if_gain( gain, dev_chan );
         } else { return _if_gain[ chan ]; }
@@ -479,7 +676,7 @@ double sink_impl::set_bb_gain( double gain, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _bb_gain[ chan ] != gain ) {
+        if ( !_bb_gain.count( chan ) || _bb_gain[ chan ] != gain ) {
           _bb_gain[ chan ] = gain;
           return dev->set_bb_gain( gain, dev_chan );
         } else { return _bb_gain[ chan ]; }
@@ -505,7 +702,7 @@ std::string sink_impl::set_antenna( const std::string & antenna, size_t chan )
   BOOST_FOREACH( sink_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _antenna[ chan ] != antenna ) {
+        if ( !_antenna.count( chan ) || _antenna[ chan ] != antenna ) {
           _antenna[ chan ] = antenna;
           return dev->set_antenna( antenna, dev_chan );
         } else { return _antenna[ chan ]; }
@@ -558,6 +755,21 @@ double sink_impl::set_bandwidth( double bandwidth, size_t chan )
   return 0;
 }
 
+void sink_impl::do_set_bandwidth( double bandwidth, size_t chan )
+{
+  try {
+    set_bandwidth( bandwidth, chan );
+  } catch ( const std::exception &ex ) {
+    std::cerr << "Async bandwidth change failed: " << ex.what() << std::endl;
+  }
+}
+
+void sink_impl::set_bandwidth_async( double bandwidth, size_t chan )
+{
+  exec_async( boost::bind( &sink_impl::do_set_bandwidth, this, bandwidth,
+                           chan ) );
+}
+
 double sink_impl::get_bandwidth( size_t chan )
 {
   size_t channel = 0;
@@ -678,3 +890,114 @@ void sink_impl::set_time_unknown_pps(const osmosdr::time_spec_t &time_spec)
     dev->set_time_unknown_pps( time_spec );
   }
 }
+
+void sink_impl::queue_burst( const osmosdr::time_spec_t &time,
+                             size_t nsamps, size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( sink_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        dev->queue_burst( time, nsamps, dev_chan );
+}
+
+osmosdr::stream_stats_t sink_impl::get_stream_stats( size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( sink_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        return dev->get_stream_stats( dev_chan );
+
+  return osmosdr::stream_stats_t();
+}
+
+void sink_impl::clear_settings_cache( void )
+{
+  _sample_rate = NAN;
+  _center_freq.clear();
+  _freq_corr.clear();
+  _gain_mode.clear();
+  _gain.clear();
+  _named_gain.clear();
+  _if_gain.clear();
+  _bb_gain.clear();
+  _antenna.clear();
+  _bandwidth.clear();
+}
+
+void sink_impl::apply( const std::map< std::string, std::string > &settings,
+                       size_t chan )
+{
+  /* the batch goes straight to the device, so the dedup cache must
+   * not swallow a later setter call repeating one of these values */
+  if ( settings.count("rate") )
+    _sample_rate = NAN;
+  if ( settings.count("corr") )
+    _freq_corr.erase( chan );
+  if ( settings.count("freq") )
+    _center_freq.erase( chan );
+  if ( settings.count("gain_mode") )
+    _gain_mode.erase( chan );
+  if ( settings.count("gain") )
+    _gain.erase( chan );
+  if ( settings.count("if_gain") )
+    _if_gain.erase( chan );
+  if ( settings.count("bb_gain") )
+    _bb_gain.erase( chan );
+  if ( settings.count("antenna") )
+    _antenna.erase( chan );
+  if ( settings.count("bandwidth") )
+    _bandwidth.erase( chan );
+
+  size_t channel = 0;
+  BOOST_FOREACH( sink_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        dev->apply( settings, dev_chan );
+}
+
+void sink_impl::handle_cmd_msg( pmt::pmt_t msg )
+{
+  /* accept both a bare dict and the (dict . data) pair convention */
+  if ( pmt::is_pair( msg ) && ! pmt::is_dict( msg ) )
+    msg = pmt::car( msg );
+
+  if ( ! pmt::is_dict( msg ) )
+    return;
+
+  size_t chan = 0;
+  pmt::pmt_t val = pmt::dict_ref( msg, pmt::mp("chan"), pmt::PMT_NIL );
+  if ( pmt::is_number( val ) )
+    chan = pmt::to_long( val );
+
+  std::map< std::string, std::string > settings;
+
+  pmt::pmt_t keys = pmt::dict_keys( msg );
+  for ( size_t i = 0; i < pmt::length( keys ); i++ ) {
+    std::string key = pmt::symbol_to_string( pmt::nth( i, keys ) );
+    pmt::pmt_t value = pmt::dict_ref( msg, pmt::nth( i, keys ),
+                                      pmt::PMT_NIL );
+
+    if ( "chan" == key )
+      continue;
+
+    if ( pmt::is_symbol( value ) )
+      settings[key] = pmt::symbol_to_string( value );
+    else if ( pmt::is_bool( value ) )
+      settings[key] = pmt::to_bool( value ) ? "1" : "0";
+    else if ( pmt::is_number( value ) )
+      settings[key] =
+          boost::lexical_cast< std::string >( pmt::to_double( value ) );
+
+    /* keys the devices do not know are dropped inside apply(), so a
+     * dict may carry entries meant for other blocks */
+  }
+
+  if ( settings.empty() )
+    return;
+
+  /* hardware calls happen on the control executor, never on the
+   * scheduler thread delivering the message */
+  exec_async( boost::bind( &sink_impl::apply, this, settings, chan ) );
+}
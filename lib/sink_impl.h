@@ -24,12 +24,20 @@
 
 #include "sink_iface.h"
 
+#include <gnuradio/thread/thread.h>
+#include <pmt/pmt.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
 #include <map>
 
 class sink_impl : public osmosdr::sink
 {
 public:
   sink_impl(const std::string & args);
+  ~sink_impl();
 
   size_t get_num_channels( void );
 
@@ -39,6 +47,8 @@ public:
 
   osmosdr::freq_range_t get_freq_range( size_t chan = 0 );
   double set_center_freq( double freq, size_t chan = 0 );
+  void set_center_freq_async( double freq, size_t chan = 0 );
+  boost::unique_future<double> set_center_freq_future( double freq, size_t chan = 0 );
   double get_center_freq( size_t chan = 0 );
   double set_freq_corr( double ppm, size_t chan = 0 );
   double get_freq_corr( size_t chan = 0 );
@@ -50,6 +60,9 @@ public:
   bool get_gain_mode( size_t chan = 0 );
   double set_gain( double gain, size_t chan = 0 );
   double set_gain( double gain, const std::string & name, size_t chan = 0 );
+  void set_gain_async( double gain, size_t chan = 0 );
+  void set_gain_async( double gain, const std::string & name, size_t chan = 0 );
+  boost::unique_future<double> set_gain_future( double gain, size_t chan = 0 );
   double get_gain( size_t chan = 0 );
   double get_gain( const std::string & name, size_t chan = 0 );
 
@@ -65,6 +78,7 @@ public:
   void set_iq_balance( const std::complex<double> &balance, size_t chan = 0 );
 
   double set_bandwidth( double bandwidth, size_t chan = 0 );
+  void set_bandwidth_async( double bandwidth, size_t chan = 0 );
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
@@ -81,16 +95,45 @@ public:
   void set_time_now(const ::osmosdr::time_spec_t &time_spec, size_t mboard = 0);
   void set_time_next_pps(const ::osmosdr::time_spec_t &time_spec);
   void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec);
+  void queue_burst( const ::osmosdr::time_spec_t &time,
+                    size_t nsamps, size_t chan = 0 );
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+  void clear_settings_cache( void );
+  void apply( const std::map< std::string, std::string > &settings,
+              size_t chan = 0 );
 
 private:
+  void ctrl_task( void );
+  void exec_async( const boost::function<void ()> &fn );
+
+  /* parse one "cmd" port dict and queue it on the control executor */
+  void handle_cmd_msg( pmt::pmt_t msg );
+
+  typedef boost::shared_ptr< boost::promise<double> > promise_sptr;
+  void do_tune( double freq, size_t chan, promise_sptr result );
+  void do_set_gain( double gain, size_t chan, promise_sptr result );
+  void do_set_gain_named( double gain, std::string name, size_t chan );
+  void do_set_bandwidth( double bandwidth, size_t chan );
+
   std::vector< sink_iface * > _devs;
 
+  /* the control executor: asynchronous requests queue here and a
+   * lazily started command thread performs the blocking hardware
+   * calls in order, off the data path */
+  std::deque< boost::function<void ()> > _ctrl_queue;
+  boost::mutex _ctrl_mutex;
+  boost::condition_variable _ctrl_cond;
+  gr::thread::thread _ctrl_thread;
+  bool _ctrl_thread_running;
+  bool _ctrl_shutdown;
+
   /* cache to prevent multiple device calls with the same value coming from grc */
   double _sample_rate;
   std::map< size_t, double > _center_freq;
   std::map< size_t, double > _freq_corr;
   std::map< size_t, bool > _gain_mode;
   std::map< size_t, double > _gain;
+  std::map< size_t, std::map< std::string, double > > _named_gain;
   std::map< size_t, double > _if_gain;
   std::map< size_t, double > _bb_gain;
   std::map< size_t, std::string > _antenna;
@@ -30,6 +30,7 @@
 
 #include <iostream>
 #include <algorithm> //find
+#include <cstring> //memcpy
 
 #include <boost/assign.hpp>
 #include <boost/format.hpp>
@@ -45,6 +46,10 @@
 
 using namespace boost::assign;
 
+/* how long a partial batch may sit in the staging buffers before it is
+ * flushed to the driver regardless of its size */
+#define SOAPY_SINK_FLUSH_MS 10
+
 /*
  * Create a new instance of soapy_sink_c and return
  * a boost shared_ptr.  This is effectively the public constructor.
@@ -70,6 +75,14 @@ soapy_sink_c::soapy_sink_c (const std::string &args)
     std::vector<size_t> channels;
     for (size_t i = 0; i < _nchan; i++) channels.push_back(i);
     _stream = _device->setupStream(SOAPY_SDR_TX, "CF32", channels);
+
+    /* stage samples up to one stream MTU per submission; sub-MTU writes
+     * leave the driver's USB pipeline with partial transfers and cause
+     * underruns at high rates */
+    _mtu = _device->getStreamMTU(_stream);
+    _batch_fill = 0;
+    _batch.resize(_nchan);
+    for (size_t i = 0; i < _nchan; i++) _batch[i].resize(_mtu);
 }
 
 soapy_sink_c::~soapy_sink_c(void)
@@ -86,21 +99,83 @@ bool soapy_sink_c::start()
 
 bool soapy_sink_c::stop()
 {
+    if (_batch_fill) submit_batch(); //drain the staged tail
     return _device->deactivateStream(_stream) == 0;
 }
 
+bool soapy_sink_c::submit_batch(void)
+{
+    int flags = 0;
+    long long timeNs = 0;
+    size_t offset = 0;
+    std::vector<const void *> buffs(_nchan);
+
+    while (offset < _batch_fill)
+    {
+        for (size_t i = 0; i < _nchan; i++) buffs[i] = &_batch[i][offset];
+        int ret = _device->writeStream(
+            _stream, &buffs[0],
+            _batch_fill - offset, flags, timeNs);
+        if (ret < 0) break;
+        offset += ret;
+    }
+
+    if (offset < _batch_fill)
+    {
+        //keep the unwritten tail staged for the next attempt
+        for (size_t i = 0; i < _nchan; i++)
+            std::memmove(&_batch[i][0], &_batch[i][offset],
+                         (_batch_fill - offset) * sizeof(gr_complex));
+        _batch_fill -= offset;
+        return false;
+    }
+
+    _batch_fill = 0;
+    return true;
+}
+
 int soapy_sink_c::work( int noutput_items,
                             gr_vector_const_void_star &input_items,
                             gr_vector_void_star &output_items )
 {
-    int flags = 0;
-    long long timeNs = 0;
-    int ret = _device->writeStream(
-        _stream, &input_items[0],
-        noutput_items, flags, timeNs);
+    if (0 == _mtu) //driver reported no MTU, submit as-is
+    {
+        int flags = 0;
+        long long timeNs = 0;
+        int ret = _device->writeStream(
+            _stream, &input_items[0],
+            noutput_items, flags, timeNs);
+
+        if (ret < 0) return 0; //call again
+        return ret;
+    }
+
+    int consumed = 0;
+    while (consumed < noutput_items)
+    {
+        if (_batch_fill == _mtu && !submit_batch())
+            break; //driver busy, retry with the rest later
+
+        size_t n = std::min<size_t>(noutput_items - consumed,
+                                    _mtu - _batch_fill);
+        if (0 == _batch_fill)
+            _batch_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < _nchan; i++)
+            std::memcpy(&_batch[i][_batch_fill],
+                        (const gr_complex *)input_items[i] + consumed,
+                        n * sizeof(gr_complex));
+        _batch_fill += n;
+        consumed += n;
+    }
+
+    if (_batch_fill == _mtu)
+        submit_batch();
+    else if (_batch_fill &&
+             std::chrono::steady_clock::now() - _batch_start >=
+             std::chrono::milliseconds(SOAPY_SINK_FLUSH_MS))
+        submit_batch(); //latency bound reached, flush the partial batch
 
-    if (ret < 0) return 0; //call again
-    return ret;
+    return consumed;
 }
 
 std::vector<std::string> soapy_sink_c::get_devices()
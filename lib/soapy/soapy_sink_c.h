@@ -24,6 +24,9 @@
 #include <gnuradio/block.h>
 #include <gnuradio/sync_block.h>
 
+#include <chrono>
+#include <vector>
+
 #include "osmosdr/ranges.h"
 #include "sink_iface.h"
 
@@ -130,9 +133,20 @@ void set_time_next_pps(const ::osmosdr::time_spec_t &time_spec);
 void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec);
 
 private:
+    //! submit the staged batch; keeps the unwritten tail on driver errors
+    bool submit_batch(void);
+
     SoapySDR::Device *_device;
     SoapySDR::Stream *_stream;
     size_t _nchan;
+
+    /* work() stages samples here until a full stream MTU is available,
+     * so the driver always receives full-sized transfers; a partial
+     * batch is flushed once it has aged past the latency bound */
+    size_t _mtu;
+    size_t _batch_fill;
+    std::vector< std::vector<gr_complex> > _batch;
+    std::chrono::steady_clock::time_point _batch_start;
 };
 
 #endif /* INCLUDED_SOAPY_SINK_C_H */
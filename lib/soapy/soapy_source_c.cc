@@ -30,6 +30,7 @@
 
 #include <iostream>
 #include <algorithm> //find
+#include <cstring> //memcpy
 
 #include <boost/assign.hpp>
 #include <boost/format.hpp>
@@ -42,6 +43,7 @@
 #include "soapy_common.h"
 #include "osmosdr/source.h"
 #include <SoapySDR/Device.hpp>
+#include <SoapySDR/Errors.hpp>
 #include <SoapySDR/Version.hpp>
 
 using namespace boost::assign;
@@ -71,6 +73,23 @@ soapy_source_c::soapy_source_c (const std::string &args)
     std::vector<size_t> channels;
     for (size_t i = 0; i < _nchan; i++) channels.push_back(i);
     _stream = _device->setupStream(SOAPY_SDR_RX, "CF32", channels);
+
+    /* stream straight out of the driver's buffers when it offers direct
+     * access; this saves one copy of every sample compared to readStream.
+     * direct=0 forces the copying path. */
+    _direct = _device->getNumDirectAccessBuffers(_stream) > 0;
+
+    dict_t dict = params_to_dict(args);
+    if (dict.count("direct"))
+        _direct = ("0" != dict["direct"]) && ("false" != dict["direct"]);
+
+    if (_direct)
+        std::cerr << "Using direct buffer access." << std::endl;
+
+    _direct_handle = 0;
+    _direct_buffs.resize(_nchan);
+    _direct_avail = 0;
+    _direct_offset = 0;
 }
 
 soapy_source_c::~soapy_source_c(void)
@@ -87,6 +106,12 @@ bool soapy_source_c::start()
 
 bool soapy_source_c::stop()
 {
+    if (_direct_avail)
+    {
+        _device->releaseReadBuffer(_stream, _direct_handle);
+        _direct_avail = 0;
+        _direct_offset = 0;
+    }
     return _device->deactivateStream(_stream) == 0;
 }
 
@@ -96,6 +121,45 @@ int soapy_source_c::work( int noutput_items,
 {
     int flags = 0;
     long long timeNs = 0;
+
+    if (_direct)
+    {
+        if (0 == _direct_avail)
+        {
+            int ret = _device->acquireReadBuffer(
+                _stream, _direct_handle, &_direct_buffs[0], flags, timeNs);
+
+            if (ret == SOAPY_SDR_NOT_SUPPORTED)
+            {
+                _direct = false; //fall back to readStream below
+            }
+            else
+            {
+                if (ret < 0) return 0; //call again
+                _direct_avail = ret;
+                _direct_offset = 0;
+            }
+        }
+
+        if (_direct)
+        {
+            size_t elems = std::min(size_t(noutput_items), _direct_avail);
+
+            for (size_t i = 0; i < _nchan; i++)
+                std::memcpy(output_items[i],
+                            (const gr_complex *)_direct_buffs[i] + _direct_offset,
+                            elems * sizeof(gr_complex));
+
+            _direct_offset += elems;
+            _direct_avail -= elems;
+
+            if (0 == _direct_avail)
+                _device->releaseReadBuffer(_stream, _direct_handle);
+
+            return elems;
+        }
+    }
+
     int ret = _device->readStream(
         _stream, &output_items[0],
         noutput_items, flags, timeNs);
@@ -135,6 +135,14 @@ private:
     SoapySDR::Device *_device;
     SoapySDR::Stream *_stream;
     size_t _nchan;
+
+    /* zero-copy direct buffer access, active when the driver offers it;
+     * a partially consumed buffer stays acquired across work() calls */
+    bool _direct;
+    size_t _direct_handle;
+    std::vector<const void *> _direct_buffs;
+    size_t _direct_avail;
+    size_t _direct_offset;
 };
 
 #endif /* INCLUDED_SOAPY_SOURCE_C_H */
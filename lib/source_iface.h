@@ -22,9 +22,14 @@
 #define OSMOSDR_SOURCE_IFACE_H
 
 #include <osmosdr/ranges.h>
+#include <osmosdr/stream_stats.h>
 #include <osmosdr/time_spec.h>
 #include <gnuradio/basic_block.h>
 
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+
 /*!
  * TODO: document
  *
@@ -47,6 +52,30 @@ public:
    */
   virtual bool seek( long seek_point, int whence, size_t chan = 0 ) { return false; }
 
+  /*!
+   * \brief seek file to the absolute \p timestamp
+   *
+   * \param timestamp target time in seconds (epoch seconds with SigMF
+   *                  time anchors, seconds from the file start without)
+   * \param chan the channel index 0 to N-1
+   * \return true on success
+   */
+  virtual bool seek_time( double timestamp, size_t chan = 0 ) { return false; }
+
+  /*!
+   * \brief apply a retune when the stream reaches \p sample
+   * \return true if the backend supports scheduled changes
+   */
+  virtual bool set_center_freq_at( double freq, uint64_t sample,
+                                   size_t chan = 0 ) { return false; }
+
+  /*!
+   * \brief apply a gain change when the stream reaches \p sample
+   * \return true if the backend supports scheduled changes
+   */
+  virtual bool set_gain_at( double gain, uint64_t sample,
+                            size_t chan = 0 ) { return false; }
+
   /*!
    * Get the possible sample rates for the underlying radio hardware.
    * \return a range of rates in Sps
@@ -395,6 +424,77 @@ public:
    * \param time_spec the new time
    */
   virtual void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec) { }
+
+  /*!
+   * Get streaming health counters for the specified channel.
+   * \param chan the channel index 0 to N-1
+   * \return a snapshot, all zeros when the backend is not instrumented
+   */
+  virtual osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 )
+    { return osmosdr::stream_stats_t(); }
+
+  /*!
+   * Execute a frequency scan plan autonomously in the driver.
+   * The backend cycles through \p freqs with \p dwell seconds per hop
+   * until the plan is cleared, tagging each hop in the sample stream.
+   * \param freqs the frequencies to visit, in order, repeated forever
+   * \param dwell seconds to stay on each frequency
+   * \param chan the channel index 0 to N-1
+   * \return true when the backend executes the plan
+   */
+  virtual bool set_scan_plan( const std::vector<double> &freqs,
+                              double dwell, size_t chan = 0 )
+    { return false; }
+
+  /*!
+   * Stop a running scan plan. The tuner stays on the last hop.
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void clear_scan_plan( size_t chan = 0 ) { }
+
+  /*!
+   * Apply several settings as one batch. Supported keys are rate,
+   * corr, freq, gain_mode, gain, if_gain, bb_gain, antenna and
+   * bandwidth; unknown keys are ignored so one settings map can serve
+   * several backends. The default simply walks the individual setters
+   * in a sensible order (correction before tuning); backends talking
+   * to remote hardware override this to coalesce the batch into fewer
+   * device round-trips.
+   * \param settings the settings to apply, keyed as in device args
+   * \param chan the channel index 0 to N-1
+   */
+  virtual void apply( const std::map< std::string, std::string > &settings,
+                      size_t chan = 0 )
+  {
+    std::map< std::string, std::string >::const_iterator it;
+
+    if ( (it = settings.find("rate")) != settings.end() )
+      set_sample_rate( boost::lexical_cast< double >( it->second ) );
+
+    if ( (it = settings.find("corr")) != settings.end() )
+      set_freq_corr( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("freq")) != settings.end() )
+      set_center_freq( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("gain_mode")) != settings.end() )
+      set_gain_mode( boost::lexical_cast< bool >( it->second ), chan );
+
+    if ( (it = settings.find("gain")) != settings.end() )
+      set_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("if_gain")) != settings.end() )
+      set_if_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("bb_gain")) != settings.end() )
+      set_bb_gain( boost::lexical_cast< double >( it->second ), chan );
+
+    if ( (it = settings.find("antenna")) != settings.end() )
+      set_antenna( it->second, chan );
+
+    if ( (it = settings.find("bandwidth")) != settings.end() )
+      set_bandwidth( boost::lexical_cast< double >( it->second ), chan );
+  }
 };
 
 #endif // OSMOSDR_SOURCE_IFACE_H
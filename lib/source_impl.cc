@@ -32,6 +32,16 @@
 #include <gnuradio/blocks/throttle.h>
 #include <gnuradio/constants.h>
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <volk/volk.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
 #ifdef ENABLE_OSMOSDR
 #include <osmosdr_src_c.h>
 #endif
@@ -44,6 +54,10 @@
 #include <file_source_c.h>
 #endif
 
+#ifdef ENABLE_NULL
+#include <null_source_c.h>
+#endif
+
 #ifdef ENABLE_RTL
 #include <rtl_source_c.h>
 #endif
@@ -52,7 +66,7 @@
 #include <rtl_tcp_source_c.h>
 #endif
 
-#ifdef ENABLE_UHD
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
 #include <uhd_source_c.h>
 #endif
 
@@ -68,7 +82,7 @@
 #include <hackrf_source_c.h>
 #endif
 
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
 #include <bladerf_source_c.h>
 #endif
 
@@ -80,7 +94,7 @@
 #include <airspy_source_c.h>
 #endif
 
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
 #include <soapy_source_c.h>
 #endif
 
@@ -93,8 +107,400 @@
 #endif
 
 #include "arg_helpers.h"
+#include "cmd_msg_rx.h"
+#include "device_cache.h"
+#include "drift_sync.h"
+#include "plugin_loader.h"
+#include "shm_ring.h"
 #include "source_impl.h"
 
+/*!
+ * Keeps the most recent samples of one channel in a fixed circular
+ * buffer for the zero-copy probe API (see source::get_probe_buffer).
+ * The buffer never reallocates, so language bindings can hand out a
+ * long-lived read-only view of it instead of copying samples across
+ * the language boundary on every poll.
+ */
+class sample_probe_c : public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr<sample_probe_c> sptr;
+
+  static sptr make( size_t depth )
+  {
+    return gnuradio::get_initial_sptr( new sample_probe_c( depth ) );
+  }
+
+  sample_probe_c( size_t depth )
+    : gr::sync_block( "sample_probe_c",
+                      gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                      gr::io_signature::make(0, 0, 0) ),
+      _buf( depth ),
+      _pos( 0 ),
+      _count( 0 )
+  {
+  }
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items )
+  {
+    const gr_complex *in = (const gr_complex *)input_items[0];
+    int processed = 0;
+
+    while ( processed < noutput_items ) {
+      size_t chunk = std::min( size_t(noutput_items - processed),
+                               _buf.size() - _pos );
+
+      memcpy( &_buf[_pos], in + processed, chunk * sizeof(gr_complex) );
+
+      _pos = (_pos + chunk) % _buf.size();
+      processed += chunk;
+    }
+
+    /* published after the data so a reader polling the count never
+     * sees it ahead of the samples it accounts for */
+    _count.fetch_add( noutput_items, std::memory_order_release );
+
+    return noutput_items;
+  }
+
+  size_t depth( void ) const { return _buf.size(); }
+  uint64_t count( void ) const { return _count.load( std::memory_order_acquire ); }
+  const void *buffer( void ) const { return &_buf[0]; }
+
+private:
+  std::vector< gr_complex > _buf;
+  size_t _pos;
+  std::atomic< uint64_t > _count;
+};
+
+/* software AGC tuning: smoothing factor per buffer, the dead band
+ * around the target, the commanded gain step and how many buffers a
+ * step gets to reach the hardware before the level is trusted again */
+#define SOFT_AGC_ALPHA       0.2f
+#define SOFT_AGC_HYST_DB     3.0f
+#define SOFT_AGC_STEP_DB     2.0
+#define SOFT_AGC_SETTLE_BUFS 8
+
+/*!
+ * Optional software AGC stage (swagc= argument): measures the mean
+ * power of every buffer with VOLK, smooths it with a one pole filter
+ * and steps the device gain whenever the level leaves a hysteresis
+ * window around the target. Decisions run at buffer granularity on
+ * the scheduler thread; the hardware call itself goes through the
+ * parent's asynchronous control queue, so the loop never stalls the
+ * stream and needs no Python round-trip.
+ */
+class soft_agc_c : public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr<soft_agc_c> sptr;
+
+  static sptr make( source_impl *parent, size_t chan, double target_db )
+  {
+    return gnuradio::get_initial_sptr(
+        new soft_agc_c( parent, chan, target_db ) );
+  }
+
+  soft_agc_c( source_impl *parent, size_t chan, double target_db )
+    : gr::sync_block( "soft_agc_c",
+                      gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                      gr::io_signature::make(0, 0, 0) ),
+      _parent( parent ),
+      _chan( chan ),
+      _target_db( target_db ),
+      _active( false ),
+      _avg( 0.0f ),
+      _gain( 0.0 ),
+      _settle( 0 )
+  {
+  }
+
+  bool start( void )
+  {
+    /* one hardware round-trip before streaming starts, afterwards
+     * the loop relies on its own bookkeeping */
+    _range = _parent->get_gain_range( _chan );
+    _gain = _parent->get_gain( _chan );
+    _active = ! _range.empty();
+    _avg = 0.0f;
+    _settle = 0;
+
+    return true;
+  }
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items )
+  {
+    const gr_complex *in = (const gr_complex *)input_items[0];
+
+    if ( ! _active )
+      return noutput_items;
+
+    if ( _mag2.size() < size_t(noutput_items) )
+      _mag2.resize( noutput_items );
+
+    float sum = 0.0f;
+    volk_32fc_magnitude_squared_32f( &_mag2[0], in, noutput_items );
+    volk_32f_accumulator_s32f( &sum, &_mag2[0], noutput_items );
+
+    /* one pole smoothing over a few buffers evens out modulation */
+    _avg += SOFT_AGC_ALPHA * ( sum / noutput_items - _avg );
+
+    if ( _settle ) { /* a commanded step is still propagating */
+      _settle--;
+      return noutput_items;
+    }
+
+    float level = 10.0f * log10f( _avg + 1.0e-20f );
+
+    double gain = _gain;
+    if ( level > _target_db + SOFT_AGC_HYST_DB )
+      gain = _range.clip( _gain - SOFT_AGC_STEP_DB, true );
+    else if ( level < _target_db - SOFT_AGC_HYST_DB )
+      gain = _range.clip( _gain + SOFT_AGC_STEP_DB, true );
+
+    if ( gain != _gain ) {
+      _gain = gain;
+      _parent->set_gain_async( gain, _chan );
+      _settle = SOFT_AGC_SETTLE_BUFS;
+    }
+
+    return noutput_items;
+  }
+
+private:
+  source_impl *_parent;
+  size_t _chan;
+  double _target_db;
+  bool _active;
+  osmosdr::gain_range_t _range;
+  std::vector<float> _mag2;
+  float _avg;
+  double _gain;
+  unsigned int _settle;
+};
+
+#ifndef _WIN32
+
+/* payload bytes per published channel, about 0.8s at 2.4 Msps */
+#define SHM_PUB_SIZE (16 * 1024 * 1024)
+
+/*!
+ * Publishes the post-conversion samples of one channel into a POSIX
+ * shared memory ring (shm_pub= argument), where any number of local
+ * processes can pick them up through the shm= backend - one physical
+ * device fanned out without sockets or extra copies. The writer
+ * never waits for readers; a consumer that falls behind loses data
+ * on its own cursor only (see shm_ring.h).
+ */
+class shm_pub_c : public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr<shm_pub_c> sptr;
+
+  static sptr make( const std::string &name )
+  {
+    return gnuradio::get_initial_sptr( new shm_pub_c( name ) );
+  }
+
+  shm_pub_c( const std::string &name )
+    : gr::sync_block( "shm_pub_c",
+                      gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                      gr::io_signature::make(0, 0, 0) )
+  {
+    std::string segment = name;
+    if ( segment.empty() || '/' != segment[0] )
+      segment = "/" + segment;
+
+    if ( ! _ring.create( segment, SHM_PUB_SIZE, sizeof(gr_complex) ) )
+      throw std::runtime_error( "Could not create shm segment " + segment );
+  }
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items )
+  {
+    _ring.write( (const unsigned char *)input_items[0],
+                 noutput_items * sizeof(gr_complex) );
+
+    return noutput_items;
+  }
+
+private:
+  osmosdr::shm_ring_writer _ring;
+};
+
+/*!
+ * Consumer side of the local fan-out (shm=<segment> device
+ * argument): attaches a read-only cursor to a segment published by
+ * shm_pub= in another process and replays it as an ordinary source
+ * channel. Overruns hit only the consumer that lagged and appear in
+ * its own stream stats; rate= and freq= describe the publisher's
+ * tuning for the blocks downstream.
+ */
+class shm_source_c : public gr::sync_block, public source_iface
+{
+public:
+  typedef boost::shared_ptr<shm_source_c> sptr;
+
+  static sptr make( const std::string &args )
+  {
+    return gnuradio::get_initial_sptr( new shm_source_c( args ) );
+  }
+
+  shm_source_c( const std::string &args )
+    : gr::sync_block( "shm_source_c",
+                      gr::io_signature::make(0, 0, 0),
+                      gr::io_signature::make(1, 1, sizeof(gr_complex)) ),
+      _running( false ),
+      _freq( 0.0 ),
+      _rate( 0.0 )
+  {
+    dict_t dict = params_to_dict( args );
+
+    std::string segment = dict["shm"];
+    if ( segment.empty() || '/' != segment[0] )
+      segment = "/" + segment;
+
+    if ( dict.count("rate") )
+      _rate = boost::lexical_cast< double >( dict["rate"] );
+
+    if ( dict.count("freq") )
+      _freq = boost::lexical_cast< double >( dict["freq"] );
+
+    if ( ! _reader.attach( segment ) )
+      throw std::runtime_error( "Could not attach to shm segment " + segment +
+                                " (is the publishing source running?)" );
+  }
+
+  bool start( void ) { _running = true; return true; }
+  bool stop( void ) { _running = false; return true; }
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items )
+  {
+    unsigned char *out = (unsigned char *)output_items[0];
+    size_t got;
+
+    while ( 0 == ( got = _reader.read( out, noutput_items * sizeof(gr_complex) ) ) ) {
+      if ( ! _running )
+        return WORK_DONE;
+
+      /* the writer publishes every buffer, a millisecond is plenty */
+      boost::this_thread::sleep( boost::posix_time::milliseconds(1) );
+    }
+
+    return got / sizeof(gr_complex);
+  }
+
+  std::string name() { return "Shared Memory"; }
+
+  size_t get_num_channels( void ) { return 1; }
+
+  osmosdr::meta_range_t get_sample_rates( void )
+  {
+    osmosdr::meta_range_t range;
+    range.push_back( osmosdr::range_t( _rate ) );
+    return range;
+  }
+
+  double set_sample_rate( double rate ) { _rate = rate; return _rate; }
+  double get_sample_rate( void ) { return _rate; }
+
+  osmosdr::freq_range_t get_freq_range( size_t chan = 0 )
+    { return osmosdr::freq_range_t( _freq, _freq ); }
+  double set_center_freq( double freq, size_t chan = 0 ) { return _freq; }
+  double get_center_freq( size_t chan = 0 ) { return _freq; }
+  double set_freq_corr( double ppm, size_t chan = 0 ) { return 0.0; }
+  double get_freq_corr( size_t chan = 0 ) { return 0.0; }
+
+  std::vector<std::string> get_gain_names( size_t chan = 0 )
+    { return std::vector< std::string >(); }
+  osmosdr::gain_range_t get_gain_range( size_t chan = 0 )
+    { return osmosdr::gain_range_t(); }
+  osmosdr::gain_range_t get_gain_range( const std::string & name, size_t chan = 0 )
+    { return osmosdr::gain_range_t(); }
+  double set_gain( double gain, size_t chan = 0 ) { return 0.0; }
+  double set_gain( double gain, const std::string & name, size_t chan = 0 )
+    { return 0.0; }
+  double get_gain( size_t chan = 0 ) { return 0.0; }
+  double get_gain( const std::string & name, size_t chan = 0 ) { return 0.0; }
+
+  std::vector< std::string > get_antennas( size_t chan = 0 )
+    { return std::vector< std::string >( 1, get_antenna( chan ) ); }
+  std::string set_antenna( const std::string & antenna, size_t chan = 0 )
+    { return get_antenna( chan ); }
+  std::string get_antenna( size_t chan = 0 ) { return "RX"; }
+
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 )
+  {
+    osmosdr::stream_stats_t stats;
+
+    /* the counters are kept on this consumer's own cursor, other
+     * processes attached to the same segment are not mixed in */
+    stats.dropped_buffers = _reader.overruns();
+    stats.dropped_samples = _reader.dropped_bytes() / sizeof(gr_complex);
+
+    return stats;
+  }
+
+private:
+  osmosdr::shm_ring_reader _reader;
+  bool _running;
+  double _freq;
+  double _rate;
+};
+
+#endif /* !_WIN32 */
+
+#ifdef HAVE_IQBALANCE
+/*!
+ * Receives "iqbal_corr" messages from gr-iqbalance's optimize_c and
+ * forwards them to the device channel they belong to, where they are
+ * applied by the fused in-place pass (see osmosdr::iq_correction).
+ * This replaces the per-channel fix_cc block in the stream path.
+ */
+class iqbal_corr_rx : public gr::block
+{
+public:
+  typedef boost::shared_ptr<iqbal_corr_rx> sptr;
+
+  static sptr make( source_impl *parent, size_t chan )
+  {
+    return gnuradio::get_initial_sptr( new iqbal_corr_rx( parent, chan ) );
+  }
+
+  iqbal_corr_rx( source_impl *parent, size_t chan )
+    : gr::block( "iqbal_corr_rx",
+                 gr::io_signature::make(0, 0, 0),
+                 gr::io_signature::make(0, 0, 0) ),
+      _parent( parent ),
+      _chan( chan )
+  {
+    message_port_register_in( pmt::mp("iqbal_corr") );
+    set_msg_handler( pmt::mp("iqbal_corr"),
+                     boost::bind( &iqbal_corr_rx::handle_correction, this, _1 ) );
+  }
+
+private:
+  void handle_correction( pmt::pmt_t msg )
+  {
+    if ( ! pmt::is_f32vector( msg ) || pmt::length( msg ) < 2 )
+      return;
+
+    _parent->iqbal_update( _chan, pmt::f32vector_ref( msg, 0 ),
+                           pmt::f32vector_ref( msg, 1 ) );
+  }
+
+  source_impl *_parent;
+  size_t _chan;
+};
+#endif
+
 /*
  * Create a new instance of source_impl and return
  * a boost shared_ptr.  This is effectively the public constructor.
@@ -112,18 +518,42 @@ source_impl::source_impl( const std::string &args )
   : gr::hier_block2 ("source_impl",
         gr::io_signature::make(0, 0, 0),
         args_to_io_signature(args)),
-    _sample_rate(NAN)
+    _sample_rate(NAN),
+    _ctrl_thread_running(false),
+    _ctrl_shutdown(false)
 {
   size_t channel = 0;
   bool device_specified = false;
+  bool device_from_cache = false;
+
+  /* with format=sc16 the backend output goes straight to the user, so
+   * the float-only helper blocks must stay out of the signal path */
+  const bool sc16 = args_to_sc16_output(args);
 
   std::vector< std::string > arg_list = args_to_vector(args);
 
+  /* drift=1 inserts the inter channel drift compensation stage into
+   * every channel of a multi device aggregate */
+  osmosdr::drift_group::sptr drift_grp;
+  BOOST_FOREACH(std::string arg, arg_list) {
+    dict_t dict = params_to_dict(arg);
+    if ( dict.count("drift") &&
+         boost::lexical_cast<bool>( dict["drift"] ) ) {
+      if ( sc16 )
+        throw std::runtime_error("drift= is not available with format=sc16");
+      drift_grp.reset( new osmosdr::drift_group() );
+    }
+  }
+
   std::vector< std::string > dev_types;
 
 #ifdef ENABLE_FILE
   dev_types.push_back("file");
 #endif
+#ifdef ENABLE_NULL
+  dev_types.push_back("null");
+  dev_types.push_back("loopback");
+#endif
 #ifdef ENABLE_OSMOSDR
   dev_types.push_back("osmosdr");
 #endif
@@ -136,7 +566,7 @@ source_impl::source_impl( const std::string &args )
 #ifdef ENABLE_RTL_TCP
   dev_types.push_back("rtl_tcp");
 #endif
-#ifdef ENABLE_UHD
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
   dev_types.push_back("uhd");
 #endif
 #ifdef ENABLE_MIRI
@@ -148,7 +578,7 @@ source_impl::source_impl( const std::string &args )
 #ifdef ENABLE_HACKRF
   dev_types.push_back("hackrf");
 #endif
-#ifdef ENABLE_BLADERF
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
   dev_types.push_back("bladerf");
 #endif
 #ifdef ENABLE_RFSPACE
@@ -157,7 +587,7 @@ source_impl::source_impl( const std::string &args )
 #ifdef ENABLE_AIRSPY
   dev_types.push_back("airspy");
 #endif
-#ifdef ENABLE_SOAPY
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
   dev_types.push_back("soapy");
 #endif
 #ifdef ENABLE_REDPITAYA
@@ -165,6 +595,9 @@ source_impl::source_impl( const std::string &args )
 #endif
 #ifdef ENABLE_FREESRP
   dev_types.push_back("freesrp");
+#endif
+#ifndef _WIN32
+  dev_types.push_back("shm");
 #endif
   std::cerr << "gr-osmosdr "
             << GR_OSMOSDR_VERSION << " (" << GR_OSMOSDR_LIBVER << ") "
@@ -181,6 +614,12 @@ source_impl::source_impl( const std::string &args )
   dev_types.push_back("cloudiq");
 #endif
 
+  /* backends that may live in lazily loaded plugins announce their
+   * type key here without touching the plugin library itself */
+  BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() )
+    if ( std::find( dev_types.begin(), dev_types.end(), plugin ) == dev_types.end() )
+      dev_types.push_back( plugin );
+
   BOOST_FOREACH(std::string arg, arg_list) {
     dict_t dict = params_to_dict(arg);
     BOOST_FOREACH(std::string dev_type, dev_types) {
@@ -193,58 +632,81 @@ source_impl::source_impl( const std::string &args )
 
   if ( ! device_specified ) {
     std::vector< std::string > dev_list;
+
+    /* an opt-in on-disk cache keyed by the attached USB devices skips
+     * the backend probes entirely when the hardware has not changed */
+    if ( osmosdr::device_cache::enabled() )
+      dev_list = osmosdr::device_cache::load();
+
+    device_from_cache = ! dev_list.empty();
+
+    if ( ! device_from_cache ) {
 #ifdef ENABLE_OSMOSDR
-    BOOST_FOREACH( std::string dev, osmosdr_src_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, osmosdr_src_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_FCD
-    BOOST_FOREACH( std::string dev, fcd_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, fcd_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_RTL
-    BOOST_FOREACH( std::string dev, rtl_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, rtl_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
-#ifdef ENABLE_UHD
-    BOOST_FOREACH( std::string dev, uhd_source_c::get_devices() )
-      dev_list.push_back( dev );
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
+      BOOST_FOREACH( std::string dev, uhd_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_MIRI
-    BOOST_FOREACH( std::string dev, miri_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, miri_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_SDRPLAY
-    BOOST_FOREACH( std::string dev, sdrplay_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, sdrplay_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
-#ifdef ENABLE_BLADERF
-    BOOST_FOREACH( std::string dev, bladerf_source_c::get_devices() )
-      dev_list.push_back( dev );
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
+      BOOST_FOREACH( std::string dev, bladerf_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_RFSPACE
-    BOOST_FOREACH( std::string dev, rfspace_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, rfspace_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_HACKRF
-    BOOST_FOREACH( std::string dev, hackrf_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, hackrf_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_AIRSPY
-    BOOST_FOREACH( std::string dev, airspy_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, airspy_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
-#ifdef ENABLE_SOAPY
-    BOOST_FOREACH( std::string dev, soapy_source_c::get_devices() )
-      dev_list.push_back( dev );
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
+      BOOST_FOREACH( std::string dev, soapy_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_REDPITAYA
-    BOOST_FOREACH( std::string dev, redpitaya_source_c::get_devices() )
-      dev_list.push_back( dev );
+      BOOST_FOREACH( std::string dev, redpitaya_source_c::get_devices() )
+        dev_list.push_back( dev );
 #endif
 #ifdef ENABLE_FREESRP
-    BOOST_FOREACH( std::string dev, freesrp_source_c::get_devices() )
-      dev_list.push_back( dev );
-#endif
+      BOOST_FOREACH( std::string dev, freesrp_source_c::get_devices() )
+        dev_list.push_back( dev );
+#endif
+
+      /* a full enumeration is one of the two events that resolve the
+       * installed backend plugins (the other is their arg key) */
+      BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() ) {
+        osmosdr::plugin_get_devices_fn get_devices =
+            (osmosdr::plugin_get_devices_fn)
+                osmosdr::plugin_loader::entry( plugin, OSMOSDR_PLUGIN_SOURCE_DEVICES );
+        if ( get_devices )
+          get_devices( dev_list );
+      }
+
+      if ( osmosdr::device_cache::enabled() )
+        osmosdr::device_cache::store( dev_list );
+    }
 
 //    std::cerr << std::endl;
 //    BOOST_FOREACH( std::string dev, dev_list )
@@ -256,153 +718,289 @@ source_impl::source_impl( const std::string &args )
       throw std::runtime_error("No supported devices found (check the connection and/or udev rules).");
   }
 
-  BOOST_FOREACH(std::string arg, arg_list) {
+  try {
 
-    dict_t dict = params_to_dict(arg);
+    BOOST_FOREACH(std::string arg, arg_list) {
+
+      dict_t dict = params_to_dict(arg);
 
 //    std::cerr << std::endl;
 //    BOOST_FOREACH( dict_t::value_type &entry, dict )
 //      std::cerr << "'" << entry.first << "' = '" << entry.second << "'" << std::endl;
 
-    source_iface *iface = NULL;
-    gr::basic_block_sptr block;
+      size_t probe_depth = 0;
+      if ( dict.count("probe") )
+        probe_depth = boost::lexical_cast< size_t >( dict["probe"] );
+
+      /* swagc=1 enables the software AGC with its default target,
+       * any other value is the target level itself in dBFS */
+      bool agc_enable = false;
+      double agc_target = -12.0;
+      if ( dict.count("swagc") ) {
+        double value = boost::lexical_cast< double >( dict["swagc"] );
+        agc_enable = true;
+        if ( value != 1.0 )
+          agc_target = value;
+      }
+
+      /* shm_pub= publishes the post-conversion samples of every
+       * channel into shared memory for the shm= backend */
+      std::string shm_pub;
+#ifndef _WIN32
+      if ( dict.count("shm_pub") )
+        shm_pub = dict["shm_pub"];
+#endif
+
+      source_iface *iface = NULL;
+      gr::basic_block_sptr block;
 
 #ifdef ENABLE_OSMOSDR
-    if ( dict.count("osmosdr") ) {
-      osmosdr_src_c_sptr src = osmosdr_make_src_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("osmosdr") ) {
+        osmosdr_src_c_sptr src = osmosdr_make_src_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_FCD
-    if ( dict.count("fcd") ) {
-      fcd_source_c_sptr src = make_fcd_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("fcd") ) {
+        fcd_source_c_sptr src = make_fcd_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_FILE
-    if ( dict.count("file") ) {
-      file_source_c_sptr src = make_file_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("file") ) {
+        file_source_c_sptr src = make_file_source_c( arg );
+        block = src; iface = src.get();
+      }
+#endif
+
+#ifdef ENABLE_NULL
+      if ( dict.count("null") || dict.count("loopback") ) {
+        null_source_c_sptr src = make_null_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_RTL
-    if ( dict.count("rtl") ) {
-      rtl_source_c_sptr src = make_rtl_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("rtl") ) {
+        rtl_source_c_sptr src = make_rtl_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_RTL_TCP
-    if ( dict.count("rtl_tcp") ) {
-      rtl_tcp_source_c_sptr src = make_rtl_tcp_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("rtl_tcp") ) {
+        rtl_tcp_source_c_sptr src = make_rtl_tcp_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
-#ifdef ENABLE_UHD
-    if ( dict.count("uhd") ) {
-      uhd_source_c_sptr src = make_uhd_source_c( arg );
-      block = src; iface = src.get();
-    }
+#if defined(ENABLE_UHD) && !defined(PLUGIN_UHD)
+      if ( dict.count("uhd") ) {
+        uhd_source_c_sptr src = make_uhd_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_MIRI
-    if ( dict.count("miri") ) {
-      miri_source_c_sptr src = make_miri_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("miri") ) {
+        miri_source_c_sptr src = make_miri_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_SDRPLAY
-    if ( dict.count("sdrplay") ) {
-      sdrplay_source_c_sptr src = make_sdrplay_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("sdrplay") ) {
+        sdrplay_source_c_sptr src = make_sdrplay_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_HACKRF
-    if ( dict.count("hackrf") ) {
-      hackrf_source_c_sptr src = make_hackrf_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("hackrf") ) {
+        hackrf_source_c_sptr src = make_hackrf_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
-#ifdef ENABLE_BLADERF
-    if ( dict.count("bladerf") ) {
-      bladerf_source_c_sptr src = make_bladerf_source_c( arg );
-      block = src; iface = src.get();
-    }
+#if defined(ENABLE_BLADERF) && !defined(PLUGIN_BLADERF)
+      if ( dict.count("bladerf") ) {
+        bladerf_source_c_sptr src = make_bladerf_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_RFSPACE
-    if ( dict.count("rfspace") ||
-         dict.count("sdr-iq") ||
-         dict.count("sdr-ip") ||
-         dict.count("netsdr") ||
-         dict.count("cloudiq") ) {
-      rfspace_source_c_sptr src = make_rfspace_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("rfspace") ||
+           dict.count("sdr-iq") ||
+           dict.count("sdr-ip") ||
+           dict.count("netsdr") ||
+           dict.count("cloudiq") ) {
+        rfspace_source_c_sptr src = make_rfspace_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_AIRSPY
-    if ( dict.count("airspy") ) {
-      airspy_source_c_sptr src = make_airspy_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("airspy") ) {
+        airspy_source_c_sptr src = make_airspy_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
-#ifdef ENABLE_SOAPY
-    if ( dict.count("soapy") ) {
-      soapy_source_c_sptr src = make_soapy_source_c( arg );
-      block = src; iface = src.get();
-    }
+#if defined(ENABLE_SOAPY) && !defined(PLUGIN_SOAPY)
+      if ( dict.count("soapy") ) {
+        soapy_source_c_sptr src = make_soapy_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_REDPITAYA
-    if ( dict.count("redpitaya") ) {
-      redpitaya_source_c_sptr src = make_redpitaya_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("redpitaya") ) {
+        redpitaya_source_c_sptr src = make_redpitaya_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
 #ifdef ENABLE_FREESRP
-    if ( dict.count("freesrp") ) {
-      freesrp_source_c_sptr src = make_freesrp_source_c( arg );
-      block = src; iface = src.get();
-    }
+      if ( dict.count("freesrp") ) {
+        freesrp_source_c_sptr src = make_freesrp_source_c( arg );
+        block = src; iface = src.get();
+      }
 #endif
 
-    if ( iface != NULL && long(block.get()) != 0 ) {
-      _devs.push_back( iface );
+#ifndef _WIN32
+      if ( dict.count("shm") ) {
+        shm_source_c::sptr src = shm_source_c::make( arg );
+        block = src; iface = src.get();
+      }
+#endif
+
+      if ( iface == NULL ) {
+        /* the arg may belong to a backend built as a plugin, which is
+         * dlopen'd here on first use */
+        BOOST_FOREACH( std::string plugin, osmosdr::plugin_loader::candidates() ) {
+          if ( ! dict.count( plugin ) )
+            continue;
+          osmosdr::plugin_make_source_fn make_source =
+              (osmosdr::plugin_make_source_fn)
+                  osmosdr::plugin_loader::entry( plugin, OSMOSDR_PLUGIN_MAKE_SOURCE );
+          if ( make_source ) {
+            block = make_source( arg, &iface );
+            break;
+          }
+        }
+      }
+
+      if ( iface != NULL && long(block.get()) != 0 ) {
+        _devs.push_back( iface );
+
+        for (size_t i = 0; i < iface->get_num_channels(); i++) {
+          gr::basic_block_sptr chan_out = block;
+          int chan_port = i;
+
+          if ( drift_grp ) {
+            /* channel 0 stays the pace reference, the compensators of
+             * the other channels resample against it */
+            osmosdr::drift_sync_c::sptr comp =
+                osmosdr::drift_sync_c::make( drift_grp, channel );
+            connect(block, i, comp, 0);
+            chan_out = comp;
+            chan_port = 0;
+          }
 
-      for (size_t i = 0; i < iface->get_num_channels(); i++) {
 #ifdef HAVE_IQBALANCE
-        gr::iqbalance::optimize_c::sptr iq_opt = gr::iqbalance::optimize_c::make( 0 );
-        gr::iqbalance::fix_cc::sptr     iq_fix = gr::iqbalance::fix_cc::make();
+          if ( sc16 ) {
+            /* the IQ imbalance optimizer taps complex floats only */
+            connect(chan_out, chan_port, self(), channel++);
+          } else {
+            gr::iqbalance::optimize_c::sptr iq_opt = gr::iqbalance::optimize_c::make( 0 );
+            iqbal_corr_rx::sptr iq_rx = iqbal_corr_rx::make( this, channel );
 
-        connect(block, i, iq_fix, 0);
-        connect(iq_fix, 0, self(), channel++);
+            /* the optimizer only taps the stream, the corrections are
+             * applied in place inside the device's own work() */
+            connect(chan_out, chan_port, self(), channel++);
 
-        connect(block, i, iq_opt, 0);
-        msg_connect(iq_opt, "iqbal_corr", iq_fix, "iqbal_corr");
+            connect(block, i, iq_opt, 0);
+            msg_connect(iq_opt, "iqbal_corr", iq_rx, "iqbal_corr");
 
-        _iq_opt.push_back( iq_opt.get() );
-        _iq_fix.push_back( iq_fix.get() );
+            _iq_opt.push_back( iq_opt.get() );
+          }
 #else
-        connect(block, i, self(), channel++);
+          connect(chan_out, chan_port, self(), channel++);
 #endif
-      }
-    } else if ( (iface != NULL) || (long(block.get()) != 0) )
-      throw std::runtime_error("Either iface or block are NULL.");
 
+          if ( probe_depth ) {
+            if ( sc16 )
+              throw std::runtime_error("probe= is not available with format=sc16");
+
+            sample_probe_c::sptr probe = sample_probe_c::make( probe_depth );
+            connect(block, i, probe, 0);
+            _probes.push_back( probe );
+          } else {
+            _probes.push_back( sample_probe_c::sptr() );
+          }
+
+          if ( agc_enable ) {
+            if ( sc16 )
+              throw std::runtime_error("swagc= is not available with format=sc16");
+
+            /* the edge keeps the block alive, no member needed */
+            connect(block, i,
+                    soft_agc_c::make( this, channel - 1, agc_target ), 0);
+          }
+
+#ifndef _WIN32
+          if ( shm_pub.length() ) {
+            if ( sc16 )
+              throw std::runtime_error("shm_pub= is not available with format=sc16");
+
+            /* one segment per channel when the device has several */
+            std::string segment = shm_pub;
+            if ( iface->get_num_channels() > 1 )
+              segment += "." + boost::lexical_cast< std::string >( i );
+
+            connect(block, i, shm_pub_c::make( segment ), 0);
+          }
+#endif
+        }
+      } else if ( (iface != NULL) || (long(block.get()) != 0) )
+        throw std::runtime_error("Either iface or block are NULL.");
+
+    }
+
+  } catch ( ... ) {
+    if ( device_from_cache ) {
+      /* the cached device could not be opened - it was probably
+       * unplugged or claimed elsewhere, so stop trusting the cache */
+      osmosdr::device_cache::invalidate();
+    }
+    throw;
   }
 
   if (!_devs.size())
     throw std::runtime_error("No devices specified via device arguments.");
+
+  /* runtime control: command dicts arriving here are queued on the
+   * control executor, so a closed loop never blocks on hardware */
+  message_port_register_hier_in( pmt::mp("cmd") );
+  msg_connect( self(), "cmd",
+               osmosdr::cmd_msg_rx::make(
+                   boost::bind( &source_impl::handle_cmd_msg, this, _1 ) ),
+               "cmd" );
+}
+
+source_impl::~source_impl()
+{
+  {
+    boost::mutex::scoped_lock lock(_ctrl_mutex);
+    _ctrl_shutdown = true;
+  }
+  _ctrl_cond.notify_one();
+
+  if (_ctrl_thread_running)
+    _ctrl_thread.join();
 }
 
 size_t source_impl::get_num_channels()
@@ -426,6 +1024,17 @@ bool source_impl::seek( long seek_point, int whence, size_t chan )
   return false;
 }
 
+bool source_impl::seek_time( double timestamp, size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        return dev->seek_time( timestamp, dev_chan );
+
+  return false;
+}
+
 #define NO_DEVICES_MSG  "FATAL: No device(s) available to work with."
 
 osmosdr::meta_range_t source_impl::get_sample_rates()
@@ -505,7 +1114,7 @@ double source_impl::set_center_freq( double freq, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _center_freq[ chan ] != freq ) {
+        if ( !_center_freq.count( chan ) || _center_freq[ chan ] != freq ) {
           _center_freq[ chan ] = freq;
           return dev->set_center_freq( freq, dev_chan );
         } else { return _center_freq[ chan ]; }
@@ -525,13 +1134,105 @@ double source_impl::get_center_freq( size_t chan )
   return 0;
 }
 
+void source_impl::ctrl_task( void )
+{
+  boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+  while ( true ) {
+    while ( _ctrl_queue.empty() && ! _ctrl_shutdown )
+      _ctrl_cond.wait(lock);
+
+    if ( _ctrl_queue.empty() && _ctrl_shutdown )
+      return;
+
+    boost::function<void ()> request = _ctrl_queue.front();
+    _ctrl_queue.pop_front();
+
+    /* the hardware call runs unlocked so callers never block on it */
+    lock.unlock();
+    request();
+    lock.lock();
+  }
+}
+
+void source_impl::exec_async( const boost::function<void ()> &fn )
+{
+  {
+    boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+    if ( ! _ctrl_thread_running ) {
+      _ctrl_thread = gr::thread::thread(
+            boost::bind( &source_impl::ctrl_task, this ) );
+      _ctrl_thread_running = true;
+    }
+
+    _ctrl_queue.push_back( fn );
+  }
+
+  _ctrl_cond.notify_one();
+}
+
+void source_impl::do_tune( double freq, size_t chan, promise_sptr result )
+{
+  try {
+    double actual = set_center_freq( freq, chan );
+
+    if ( result )
+      result->set_value( actual );
+  } catch ( const std::exception &ex ) {
+    if ( result )
+      result->set_exception( boost::current_exception() );
+    else /* a fire-and-forget request has nobody to report to */
+      std::cerr << "Async tune failed: " << ex.what() << std::endl;
+  }
+
+  boost::mutex::scoped_lock lock(_ctrl_mutex);
+  _tune_counts[ chan ]++;
+}
+
+void source_impl::set_center_freq_async( double freq, size_t chan )
+{
+  exec_async( boost::bind( &source_impl::do_tune, this, freq, chan,
+                           promise_sptr() ) );
+}
+
+boost::unique_future<double> source_impl::set_center_freq_future( double freq,
+                                                                  size_t chan )
+{
+  promise_sptr result( new boost::promise<double>() );
+
+  exec_async( boost::bind( &source_impl::do_tune, this, freq, chan, result ) );
+
+  return result->get_future();
+}
+
+bool source_impl::set_center_freq_at( double freq, uint64_t sample,
+                                      size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        return dev->set_center_freq_at( freq, sample, dev_chan );
+
+  return false;
+}
+
+uint64_t source_impl::get_tune_count( size_t chan )
+{
+  boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+  return _tune_counts[ chan ];
+}
+
+
 double source_impl::set_freq_corr( double ppm, size_t chan )
 {
   size_t channel = 0;
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _freq_corr[ chan ] != ppm ) {
+        if ( !_freq_corr.count( chan ) || _freq_corr[ chan ] != ppm ) {
           _freq_corr[ chan ] = ppm;
           return dev->set_freq_corr( ppm, dev_chan );
         } else { return _freq_corr[ chan ]; }
@@ -590,7 +1291,7 @@ bool source_impl::set_gain_mode( bool automatic, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _gain_mode[ chan ] != automatic ) {
+        if ( !_gain_mode.count( chan ) || _gain_mode[ chan ] != automatic ) {
           _gain_mode[ chan ] = automatic;
           bool mode = dev->set_gain_mode( automatic, dev_chan );
           if (!automatic) // reapply gain value when switched to manual mode
@@ -619,7 +1320,7 @@ double source_impl::set_gain( double gain, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _gain[ chan ] != gain ) {
+        if ( !_gain.count( chan ) || _gain[ chan ] != gain ) {
           _gain[ chan ] = gain;
           return dev->set_gain( gain, dev_chan );
         } else { return _gain[ chan ]; }
@@ -633,12 +1334,76 @@ double source_impl::set_gain( double gain, const std::string & name, size_t chan
   size_t channel = 0;
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
-      if ( chan == channel++ )
-        return dev->set_gain( gain, name, dev_chan );
+      if ( chan == channel++ ) {
+        std::map< std::string, double > &gains = _named_gain[ chan ];
+        if ( !gains.count( name ) || gains[ name ] != gain ) {
+          gains[ name ] = gain;
+          return dev->set_gain( gain, name, dev_chan );
+        } else { return gains[ name ]; }
+      }
 
   return 0;
 }
 
+void source_impl::do_set_gain( double gain, size_t chan, promise_sptr result )
+{
+  try {
+    double actual = set_gain( gain, chan );
+
+    if ( result )
+      result->set_value( actual );
+  } catch ( const std::exception &ex ) {
+    if ( result )
+      result->set_exception( boost::current_exception() );
+    else /* a fire-and-forget request has nobody to report to */
+      std::cerr << "Async gain change failed: " << ex.what() << std::endl;
+  }
+}
+
+void source_impl::do_set_gain_named( double gain, std::string name, size_t chan )
+{
+  try {
+    set_gain( gain, name, chan );
+  } catch ( const std::exception &ex ) {
+    std::cerr << "Async gain change failed: " << ex.what() << std::endl;
+  }
+}
+
+void source_impl::set_gain_async( double gain, size_t chan )
+{
+  exec_async( boost::bind( &source_impl::do_set_gain, this, gain, chan,
+                           promise_sptr() ) );
+}
+
+void source_impl::set_gain_async( double gain, const std::string & name,
+                                  size_t chan )
+{
+  exec_async( boost::bind( &source_impl::do_set_gain_named, this, gain,
+                           name, chan ) );
+}
+
+boost::unique_future<double> source_impl::set_gain_future( double gain,
+                                                           size_t chan )
+{
+  promise_sptr result( new boost::promise<double>() );
+
+  exec_async( boost::bind( &source_impl::do_set_gain, this, gain, chan,
+                           result ) );
+
+  return result->get_future();
+}
+
+bool source_impl::set_gain_at( double gain, uint64_t sample, size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        return dev->set_gain_at( gain, sample, dev_chan );
+
+  return false;
+}
+
 double source_impl::get_gain( size_t chan )
 {
   size_t channel = 0;
@@ -667,7 +1432,7 @@ double source_impl::set_if_gain( double gain, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _if_gain[ chan ] != gain ) {
+        if ( !_if_gain.count( chan ) || _if_gain[ chan ] != gain ) {
           _if_gain[ chan ] = gain;
           return dev->set_if_gain( gain, dev_chan );
         } else { return _if_gain[ chan ]; }
@@ -682,7 +1447,7 @@ double source_impl::set_bb_gain( double gain, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _bb_gain[ chan ] != gain ) {
+        if ( !_bb_gain.count( chan ) || _bb_gain[ chan ] != gain ) {
           _bb_gain[ chan ] = gain;
           return dev->set_bb_gain( gain, dev_chan );
         } else { return _bb_gain[ chan ]; }
@@ -708,7 +1473,7 @@ std::string source_impl::set_antenna( const std::string & antenna, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs )
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
       if ( chan == channel++ ) {
-        if ( _antenna[ chan ] != antenna ) {
+        if ( !_antenna.count( chan ) || _antenna[ chan ] != antenna ) {
           _antenna[ chan ] = antenna;
           return dev->set_antenna( antenna, dev_chan );
         } else { return _antenna[ chan ]; }
@@ -753,22 +1518,19 @@ void source_impl::set_iq_balance_mode( int mode, size_t chan )
   BOOST_FOREACH( source_iface *dev, _devs ) {
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++) {
       if ( chan == channel++ ) {
-        if ( chan < _iq_opt.size() && chan < _iq_fix.size() ) {
+        if ( chan < _iq_opt.size() ) {
           gr::iqbalance::optimize_c *opt = _iq_opt[chan];
-          gr::iqbalance::fix_cc *fix = _iq_fix[chan];
 
           if ( IQBalanceOff == mode  ) {
             opt->set_period( 0 );
-            /* store current values in order to be able to restore them later */
-            _vals[ chan ] = std::pair< float, float >( fix->mag(), fix->phase() );
-            fix->set_mag( 0.0f );
-            fix->set_phase( 0.0f );
+            /* _vals still holds the last correction for a later Manual */
+            dev->set_iq_balance( std::complex<double>( 0.0, 0.0 ), dev_chan );
           } else if ( IQBalanceManual == mode ) {
             if ( opt->period() == 0 ) { /* transition from Off to Manual */
               /* restore previous values */
               std::pair< float, float > val = _vals[ chan ];
-              fix->set_mag( val.first );
-              fix->set_phase( val.second );
+              dev->set_iq_balance(
+                    std::complex<double>( val.first, val.second ), dev_chan );
             }
             opt->set_period( 0 );
           } else if ( IQBalanceAutomatic == mode ) {
@@ -794,13 +1556,13 @@ void source_impl::set_iq_balance( const std::complex<double> &balance, size_t ch
   BOOST_FOREACH( source_iface *dev, _devs ) {
     for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++) {
       if ( chan == channel++ ) {
-        if ( chan < _iq_opt.size() && chan < _iq_fix.size() ) {
+        if ( chan < _iq_opt.size() ) {
           gr::iqbalance::optimize_c *opt = _iq_opt[chan];
-          gr::iqbalance::fix_cc *fix = _iq_fix[chan];
 
           if ( opt->period() == 0 ) { /* automatic optimization desabled */
-            fix->set_mag( balance.real() );
-            fix->set_phase( balance.imag() );
+            _vals[ chan ] =
+                std::pair< float, float >( balance.real(), balance.imag() );
+            dev->set_iq_balance( balance, dev_chan );
           }
         }
       }
@@ -814,6 +1576,19 @@ void source_impl::set_iq_balance( const std::complex<double> &balance, size_t ch
 #endif
 }
 
+#ifdef HAVE_IQBALANCE
+void source_impl::iqbal_update( size_t chan, float mag, float phase )
+{
+  _vals[ chan ] = std::pair< float, float >( mag, phase );
+
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        dev->set_iq_balance( std::complex<double>( mag, phase ), dev_chan );
+}
+#endif
+
 double source_impl::set_bandwidth( double bandwidth, size_t chan )
 {
   size_t channel = 0;
@@ -829,6 +1604,21 @@ double source_impl::set_bandwidth( double bandwidth, size_t chan )
   return 0;
 }
 
+void source_impl::do_set_bandwidth( double bandwidth, size_t chan )
+{
+  try {
+    set_bandwidth( bandwidth, chan );
+  } catch ( const std::exception &ex ) {
+    std::cerr << "Async bandwidth change failed: " << ex.what() << std::endl;
+  }
+}
+
+void source_impl::set_bandwidth_async( double bandwidth, size_t chan )
+{
+  exec_async( boost::bind( &source_impl::do_set_bandwidth, this, bandwidth,
+                           chan ) );
+}
+
 double source_impl::get_bandwidth( size_t chan )
 {
   size_t channel = 0;
@@ -949,3 +1739,153 @@ void source_impl::set_time_unknown_pps(const osmosdr::time_spec_t &time_spec)
     dev->set_time_unknown_pps( time_spec );
   }
 }
+
+osmosdr::stream_stats_t source_impl::get_stream_stats( size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        return dev->get_stream_stats( dev_chan );
+
+  return osmosdr::stream_stats_t();
+}
+
+size_t source_impl::get_probe_depth( size_t chan )
+{
+  if ( chan < _probes.size() && _probes[chan] )
+    return _probes[chan]->depth();
+
+  return 0;
+}
+
+uint64_t source_impl::get_probe_count( size_t chan )
+{
+  if ( chan < _probes.size() && _probes[chan] )
+    return _probes[chan]->count();
+
+  return 0;
+}
+
+const void *source_impl::get_probe_buffer( size_t chan )
+{
+  if ( chan < _probes.size() && _probes[chan] )
+    return _probes[chan]->buffer();
+
+  return NULL;
+}
+
+void source_impl::clear_settings_cache( void )
+{
+  _sample_rate = NAN;
+  _center_freq.clear();
+  _freq_corr.clear();
+  _gain_mode.clear();
+  _gain.clear();
+  _named_gain.clear();
+  _if_gain.clear();
+  _bb_gain.clear();
+  _antenna.clear();
+  _bandwidth.clear();
+}
+
+bool source_impl::set_scan_plan( const std::vector<double> &freqs,
+                                 double dwell, size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ ) {
+        /* the driver owns the tuner now, a stale cache entry must not
+         * swallow the set_center_freq call ending the scan */
+        _center_freq.erase( chan );
+        return dev->set_scan_plan( freqs, dwell, dev_chan );
+      }
+
+  return false;
+}
+
+void source_impl::clear_scan_plan( size_t chan )
+{
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        dev->clear_scan_plan( dev_chan );
+}
+
+void source_impl::apply( const std::map< std::string, std::string > &settings,
+                         size_t chan )
+{
+  /* the batch goes straight to the device, so the dedup cache must
+   * not swallow a later setter call repeating one of these values */
+  if ( settings.count("rate") )
+    _sample_rate = NAN;
+  if ( settings.count("corr") )
+    _freq_corr.erase( chan );
+  if ( settings.count("freq") )
+    _center_freq.erase( chan );
+  if ( settings.count("gain_mode") )
+    _gain_mode.erase( chan );
+  if ( settings.count("gain") )
+    _gain.erase( chan );
+  if ( settings.count("if_gain") )
+    _if_gain.erase( chan );
+  if ( settings.count("bb_gain") )
+    _bb_gain.erase( chan );
+  if ( settings.count("antenna") )
+    _antenna.erase( chan );
+  if ( settings.count("bandwidth") )
+    _bandwidth.erase( chan );
+
+  size_t channel = 0;
+  BOOST_FOREACH( source_iface *dev, _devs )
+    for (size_t dev_chan = 0; dev_chan < dev->get_num_channels(); dev_chan++)
+      if ( chan == channel++ )
+        dev->apply( settings, dev_chan );
+}
+
+void source_impl::handle_cmd_msg( pmt::pmt_t msg )
+{
+  /* accept both a bare dict and the (dict . data) pair convention */
+  if ( pmt::is_pair( msg ) && ! pmt::is_dict( msg ) )
+    msg = pmt::car( msg );
+
+  if ( ! pmt::is_dict( msg ) )
+    return;
+
+  size_t chan = 0;
+  pmt::pmt_t val = pmt::dict_ref( msg, pmt::mp("chan"), pmt::PMT_NIL );
+  if ( pmt::is_number( val ) )
+    chan = pmt::to_long( val );
+
+  std::map< std::string, std::string > settings;
+
+  pmt::pmt_t keys = pmt::dict_keys( msg );
+  for ( size_t i = 0; i < pmt::length( keys ); i++ ) {
+    std::string key = pmt::symbol_to_string( pmt::nth( i, keys ) );
+    pmt::pmt_t value = pmt::dict_ref( msg, pmt::nth( i, keys ),
+                                      pmt::PMT_NIL );
+
+    if ( "chan" == key )
+      continue;
+
+    if ( pmt::is_symbol( value ) )
+      settings[key] = pmt::symbol_to_string( value );
+    else if ( pmt::is_bool( value ) )
+      settings[key] = pmt::to_bool( value ) ? "1" : "0";
+    else if ( pmt::is_number( value ) )
+      settings[key] =
+          boost::lexical_cast< std::string >( pmt::to_double( value ) );
+
+    /* keys the devices do not know are dropped inside apply(), so a
+     * dict may carry entries meant for other blocks */
+  }
+
+  if ( settings.empty() )
+    return;
+
+  /* hardware calls happen on the control executor, never on the
+   * scheduler thread delivering the message */
+  exec_async( boost::bind( &source_impl::apply, this, settings, chan ) );
+}
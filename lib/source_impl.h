@@ -24,21 +24,31 @@
 
 #ifdef HAVE_IQBALANCE
 #include <gnuradio/iqbalance/optimize_c.h>
-#include <gnuradio/iqbalance/fix_cc.h>
 #endif
 
 #include <source_iface.h>
 
+#include <gnuradio/thread/thread.h>
+#include <pmt/pmt.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
 #include <map>
 
+class sample_probe_c;
+
 class source_impl : public osmosdr::source
 {
 public:
   source_impl( const std::string & args );
+  ~source_impl();
 
   size_t get_num_channels( void );
 
   bool seek( long seek_point, int whence, size_t chan );
+  bool seek_time( double timestamp, size_t chan = 0 );
 
   osmosdr::meta_range_t get_sample_rates( void );
   double set_sample_rate( double rate );
@@ -46,6 +56,10 @@ public:
 
   osmosdr::freq_range_t get_freq_range( size_t chan = 0 );
   double set_center_freq( double freq, size_t chan = 0 );
+  void set_center_freq_async( double freq, size_t chan = 0 );
+  boost::unique_future<double> set_center_freq_future( double freq, size_t chan = 0 );
+  bool set_center_freq_at( double freq, uint64_t sample, size_t chan = 0 );
+  uint64_t get_tune_count( size_t chan = 0 );
   double get_center_freq( size_t chan = 0 );
   double set_freq_corr( double ppm, size_t chan = 0 );
   double get_freq_corr( size_t chan = 0 );
@@ -57,6 +71,10 @@ public:
   bool get_gain_mode( size_t chan = 0 );
   double set_gain( double gain, size_t chan = 0 );
   double set_gain( double gain, const std::string & name, size_t chan = 0 );
+  void set_gain_async( double gain, size_t chan = 0 );
+  void set_gain_async( double gain, const std::string & name, size_t chan = 0 );
+  boost::unique_future<double> set_gain_future( double gain, size_t chan = 0 );
+  bool set_gain_at( double gain, uint64_t sample, size_t chan = 0 );
   double get_gain( size_t chan = 0 );
   double get_gain( const std::string & name, size_t chan = 0 );
 
@@ -74,6 +92,7 @@ public:
   void set_iq_balance( const std::complex<double> &balance, size_t chan = 0 );
 
   double set_bandwidth( double bandwidth, size_t chan = 0 );
+  void set_bandwidth_async( double bandwidth, size_t chan = 0 );
   double get_bandwidth( size_t chan = 0 );
   osmosdr::freq_range_t get_bandwidth_range( size_t chan = 0 );
 
@@ -90,22 +109,64 @@ public:
   void set_time_now(const ::osmosdr::time_spec_t &time_spec, size_t mboard = 0);
   void set_time_next_pps(const ::osmosdr::time_spec_t &time_spec);
   void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec);
+  osmosdr::stream_stats_t get_stream_stats( size_t chan = 0 );
+  size_t get_probe_depth( size_t chan = 0 );
+  uint64_t get_probe_count( size_t chan = 0 );
+  const void *get_probe_buffer( size_t chan = 0 );
+  void clear_settings_cache( void );
+  bool set_scan_plan( const std::vector<double> &freqs,
+                      double dwell, size_t chan = 0 );
+  void clear_scan_plan( size_t chan = 0 );
+  void apply( const std::map< std::string, std::string > &settings,
+              size_t chan = 0 );
+
+#ifdef HAVE_IQBALANCE
+  /*! Apply an optimizer supplied correction to \p chan's device. */
+  void iqbal_update( size_t chan, float mag, float phase );
+#endif
 
 private:
+  void ctrl_task( void );
+  void exec_async( const boost::function<void ()> &fn );
+
+  /* parse one "cmd" port dict and queue it on the control executor */
+  void handle_cmd_msg( pmt::pmt_t msg );
+
+  typedef boost::shared_ptr< boost::promise<double> > promise_sptr;
+  void do_tune( double freq, size_t chan, promise_sptr result );
+  void do_set_gain( double gain, size_t chan, promise_sptr result );
+  void do_set_gain_named( double gain, std::string name, size_t chan );
+  void do_set_bandwidth( double bandwidth, size_t chan );
+
   std::vector< source_iface * > _devs;
 
+  /* per channel history probe, empty sptr when not requested */
+  std::vector< boost::shared_ptr<sample_probe_c> > _probes;
+
+  /* the control executor: asynchronous requests queue here and a
+   * lazily started command thread performs the blocking hardware
+   * calls in order, off the data path */
+  std::deque< boost::function<void ()> > _ctrl_queue;
+  std::map< size_t, uint64_t > _tune_counts;
+  boost::mutex _ctrl_mutex;
+  boost::condition_variable _ctrl_cond;
+  gr::thread::thread _ctrl_thread;
+  bool _ctrl_thread_running;
+  bool _ctrl_shutdown;
+
   /* cache to prevent multiple device calls with the same value coming from grc */
   double _sample_rate;
   std::map< size_t, double > _center_freq;
   std::map< size_t, double > _freq_corr;
   std::map< size_t, bool > _gain_mode;
   std::map< size_t, double > _gain;
+  std::map< size_t, std::map< std::string, double > > _named_gain;
   std::map< size_t, double > _if_gain;
   std::map< size_t, double > _bb_gain;
   std::map< size_t, std::string > _antenna;
 #ifdef HAVE_IQBALANCE
-  std::vector< gr::iqbalance::fix_cc * > _iq_fix;
   std::vector< gr::iqbalance::optimize_c * > _iq_opt;
+  /* last correction applied per channel, kept for Off -> Manual */
   std::map< size_t, std::pair<float, float> > _vals;
 #endif
   std::map< size_t, double > _bandwidth;
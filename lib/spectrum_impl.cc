@@ -0,0 +1,215 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/fft/window.h>
+
+#include <volk/volk.h>
+
+#include "spectrum_impl.h"
+
+/*
+ * Create a new instance of spectrum_impl and return
+ * a boost shared_ptr.  This is effectively the public constructor.
+ */
+osmosdr::spectrum::sptr
+osmosdr::spectrum::make( size_t fft_size, double avg_alpha, size_t emit_every )
+{
+  return gnuradio::get_initial_sptr(
+        new spectrum_impl(fft_size, avg_alpha, emit_every) );
+}
+
+spectrum_impl::spectrum_impl( size_t fft_size, double avg_alpha,
+                              size_t emit_every )
+  : gr::sync_block( "spectrum",
+                    gr::io_signature::make(1, 1, sizeof(gr_complex)),
+                    gr::io_signature::make(0, 0, 0) ),
+    _fft_size(fft_size),
+    _center_freq(0.0),
+    _sample_rate(0.0),
+    _psd(fft_size),
+    _avg(fft_size),
+    _max(fft_size),
+    _avg_primed(false),
+    _frames(0),
+    _frames_pending(0)
+{
+  if ( 0 == fft_size )
+    throw std::invalid_argument("fft_size must be > 0");
+
+  _fft = new gr::fft::fft_complex( fft_size, true );
+
+  set_window( gr::fft::window::blackman_harris( fft_size ) );
+  set_avg_alpha( avg_alpha );
+
+  _emit_every = emit_every ? emit_every : 1;
+
+  message_port_register_out( pmt::mp("spectrum") );
+
+  /* work() always consumes whole frames */
+  set_output_multiple( fft_size );
+}
+
+spectrum_impl::~spectrum_impl()
+{
+  delete _fft;
+}
+
+void spectrum_impl::set_window( const std::vector<float> &window )
+{
+  if ( window.size() != _fft_size )
+    throw std::invalid_argument("window length must equal fft_size");
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _window = window;
+
+  float power = 0.0f;
+  for ( size_t i = 0; i < _fft_size; i++ )
+    power += window[i] * window[i];
+
+  _win_power = power / _fft_size;
+}
+
+void spectrum_impl::set_avg_alpha( double alpha )
+{
+  if ( alpha <= 0.0 || alpha > 1.0 )
+    throw std::invalid_argument("avg_alpha must be in (0.0, 1.0]");
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _avg_alpha = alpha;
+}
+
+void spectrum_impl::set_center_freq( double freq )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _center_freq = freq;
+}
+
+void spectrum_impl::set_sample_rate( double rate )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _sample_rate = rate;
+}
+
+void spectrum_impl::reset_avg( void )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  _avg_primed = false;
+  _frames_pending = 0;
+}
+
+void spectrum_impl::reset_max_hold( void )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  std::fill( _max.begin(), _max.end(), 0.0f );
+  _max_db.clear();
+}
+
+std::vector<float> spectrum_impl::levels( void )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  return _levels_db;
+}
+
+std::vector<float> spectrum_impl::max_hold( void )
+{
+  boost::mutex::scoped_lock lock(_mutex);
+
+  return _max_db;
+}
+
+void spectrum_impl::process_frame( const gr_complex *in )
+{
+  volk_32fc_32f_multiply_32fc( (lv_32fc_t *)_fft->get_inbuf(),
+                               (const lv_32fc_t *)in,
+                               &_window[0], _fft_size );
+
+  _fft->execute();
+
+  volk_32fc_magnitude_squared_32f( &_psd[0],
+                                   (const lv_32fc_t *)_fft->get_outbuf(),
+                                   _fft_size );
+
+  if ( ! _avg_primed ) {
+    _avg = _psd;
+    _avg_primed = true;
+  } else {
+    for ( size_t i = 0; i < _fft_size; i++ )
+      _avg[i] += _avg_alpha * (_psd[i] - _avg[i]);
+  }
+
+  volk_32f_x2_max_32f( &_max[0], &_max[0], &_psd[0], _fft_size );
+
+  _frames++;
+
+  if ( ++_frames_pending >= _emit_every ) {
+    _frames_pending = 0;
+    emit_results();
+  }
+}
+
+void spectrum_impl::emit_results( void )
+{
+  const float scale = 1.0f / (_win_power * _fft_size * _fft_size);
+
+  _levels_db.resize( _fft_size );
+  _max_db.resize( _fft_size );
+
+  /* reorder to DC centered display order while converting to dB */
+  for ( size_t i = 0; i < _fft_size; i++ ) {
+    size_t j = (i + _fft_size / 2) % _fft_size;
+
+    _levels_db[i] = 10.0f * log10f( _avg[j] * scale + 1e-20f );
+    _max_db[i] = 10.0f * log10f( _max[j] * scale + 1e-20f );
+  }
+
+  pmt::pmt_t meta = pmt::make_dict();
+  meta = pmt::dict_add( meta, pmt::mp("freq"), pmt::from_double(_center_freq) );
+  meta = pmt::dict_add( meta, pmt::mp("rate"), pmt::from_double(_sample_rate) );
+  meta = pmt::dict_add( meta, pmt::mp("frames"), pmt::from_uint64(_frames) );
+
+  message_port_pub( pmt::mp("spectrum"),
+                    pmt::cons( meta, pmt::init_f32vector( _fft_size,
+                                                          _levels_db ) ) );
+}
+
+int spectrum_impl::work( int noutput_items,
+                         gr_vector_const_void_star &input_items,
+                         gr_vector_void_star &output_items )
+{
+  const gr_complex *in = (const gr_complex *)input_items[0];
+
+  boost::mutex::scoped_lock lock(_mutex);
+
+  for ( int i = 0; i + (int)_fft_size <= noutput_items; i += _fft_size )
+    process_frame( in + i );
+
+  return noutput_items;
+}
@@ -0,0 +1,76 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef INCLUDED_OSMOSDR_SPECTRUM_IMPL_H
+#define INCLUDED_OSMOSDR_SPECTRUM_IMPL_H
+
+#include <osmosdr/spectrum.h>
+
+#include <gnuradio/fft/fft.h>
+
+#include <boost/thread/mutex.hpp>
+
+class spectrum_impl : public osmosdr::spectrum
+{
+public:
+  spectrum_impl( size_t fft_size, double avg_alpha, size_t emit_every );
+  ~spectrum_impl();
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items );
+
+  void set_window( const std::vector<float> &window );
+  void set_avg_alpha( double alpha );
+  void set_center_freq( double freq );
+  void set_sample_rate( double rate );
+  void reset_avg( void );
+  void reset_max_hold( void );
+  std::vector<float> levels( void );
+  std::vector<float> max_hold( void );
+
+private:
+  void process_frame( const gr_complex *in );
+  void emit_results( void );
+
+  size_t _fft_size;
+  gr::fft::fft_complex *_fft;
+
+  boost::mutex _mutex; /* guards everything below */
+
+  std::vector<float> _window;
+  float _win_power; /* mean of the squared coefficients */
+  float _avg_alpha;
+  size_t _emit_every;
+  double _center_freq;
+  double _sample_rate;
+
+  std::vector<float> _psd;      /* per frame |X(f)|^2 scratch */
+  std::vector<float> _avg;      /* running average, natural order */
+  std::vector<float> _max;      /* max-hold, natural order */
+  bool _avg_primed;
+  uint64_t _frames;
+  size_t _frames_pending;
+
+  /* last emitted traces in display order, polled via levels()/max_hold() */
+  std::vector<float> _levels_db;
+  std::vector<float> _max_db;
+};
+
+#endif /* INCLUDED_OSMOSDR_SPECTRUM_IMPL_H */
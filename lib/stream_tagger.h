@@ -0,0 +1,144 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_STREAM_TAGGER_H
+#define OSMOSDR_STREAM_TAGGER_H
+
+#include <osmosdr/time_spec.h>
+
+#include <gnuradio/sync_block.h>
+
+#include <stdint.h>
+
+namespace osmosdr {
+
+/*!
+ * UHD-style rx_time / rx_rate stream tagging for source blocks.
+ *
+ * The hardware on most supported devices has no notion of time, so
+ * the tagger anchors the stream to the system clock when streaming
+ * starts and lets downstream blocks extrapolate by sample counting
+ * from the last tag - the UHD convention. Tags are only emitted when
+ * the anchor changes (start, rate change, after lost samples), so the
+ * steady-state cost is a single branch per work() call.
+ */
+class stream_tagger
+{
+public:
+  stream_tagger()
+    : _rate(0.0),
+      _samples(0),
+      _armed(false),
+      _rearm(false),
+      _tune_freq(0.0),
+      _tune_armed(false)
+  {
+  }
+
+  /*! Anchor the time base to the system clock. Call when streaming
+   * (re)starts. */
+  void start(double rate)
+  {
+    _rate = rate;
+    _anchor = time_spec_t::get_system_time();
+    _samples = 0;
+    _armed = true;
+    _rearm = false;
+  }
+
+  /*! The sample rate changed. Keeps the time base continuous and
+   * emits fresh tags at the next work() call. */
+  void set_rate(double rate)
+  {
+    if (_rate > 0.0)
+      _anchor += time_spec_t::from_ticks(_samples, _rate);
+    else
+      _anchor = time_spec_t::get_system_time();
+
+    _samples = 0;
+    _rate = rate;
+    _armed = true;
+  }
+
+  /*! Samples were lost, the counted time base is no longer valid.
+   * Re-anchors to the system clock at the next work() call. May be
+   * called from the producer thread. */
+  void discontinuity()
+  {
+    _rearm = true;
+  }
+
+  /*! The tuner was retuned to \p freq. Emits a "freq" tag - the same
+   * convention the hackrf sweep mode uses - at the next work() call,
+   * which is as close to the hop boundary as the ring granularity
+   * allows. May be called from the producer or a scanner thread. */
+  void retune(double freq)
+  {
+    _tune_freq = freq;
+    _tune_armed = true;
+  }
+
+  /*! Tag the first item about to be produced on output \p chan when a
+   * new anchor is pending, then account for \p nitems produced items.
+   * Call once per work() invocation from the consumer thread. */
+  void tag_work(gr::sync_block *block, size_t chan, int nitems)
+  {
+    if (_rearm) {
+      _anchor = time_spec_t::get_system_time();
+      _samples = 0;
+      _armed = true;
+      _rearm = false;
+    }
+
+    if (_armed && _rate > 0.0) {
+      uint64_t offset = block->nitems_written(chan);
+
+      block->add_item_tag(chan, offset, pmt::mp("rx_time"),
+          pmt::make_tuple(pmt::from_uint64(_anchor.get_full_secs()),
+                          pmt::from_double(_anchor.get_frac_secs())));
+      block->add_item_tag(chan, offset, pmt::mp("rx_rate"),
+          pmt::from_double(_rate));
+
+      _armed = false;
+    }
+
+    if (_tune_armed) {
+      block->add_item_tag(chan, block->nitems_written(chan),
+          pmt::mp("freq"), pmt::from_double(_tune_freq));
+
+      _tune_armed = false;
+    }
+
+    _samples += nitems;
+  }
+
+private:
+  double _rate;
+  time_spec_t _anchor;
+  uint64_t _samples;
+  bool _armed;
+  bool _rearm;
+  double _tune_freq;
+  bool _tune_armed;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_STREAM_TAGGER_H */
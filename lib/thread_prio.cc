@@ -0,0 +1,123 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thread_prio.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <boost/lexical_cast.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace osmosdr {
+
+thread_prio::thread_prio()
+  : _realtime(false),
+    _cpu(-1),
+    _numa_node(-1)
+{
+}
+
+void thread_prio::parse( const std::map< std::string, std::string > &dict )
+{
+  std::map< std::string, std::string >::const_iterator it;
+
+  it = dict.find("rx_prio");
+  if (it != dict.end()) {
+    if ("rt" == it->second || "realtime" == it->second)
+      _realtime = true;
+    else
+      std::cerr << "Unsupported rx_prio value '" << it->second
+                << "', expected 'rt'" << std::endl;
+  }
+
+  it = dict.find("rx_cpu");
+  if (it != dict.end())
+    _cpu = boost::lexical_cast< int >( it->second );
+
+  it = dict.find("rx_numa");
+  if (it != dict.end())
+    _numa_node = boost::lexical_cast< int >( it->second );
+}
+
+int thread_prio::numa_node() const
+{
+  if (_numa_node >= 0)
+    return _numa_node;
+
+#ifdef HAVE_LIBNUMA
+  if (_cpu >= 0 && numa_available() >= 0)
+    return numa_node_of_cpu(_cpu);
+#endif
+
+  return -1;
+}
+
+void thread_prio::apply() const
+{
+#ifdef _WIN32
+  if (_cpu >= 0)
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << _cpu);
+
+  if (_realtime)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+#ifdef __linux__
+  if (_cpu >= 0) {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(_cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+      std::cerr << "Failed to pin streaming thread to CPU " << _cpu
+                << std::endl;
+  }
+#endif
+
+  if (_realtime) {
+    struct sched_param param;
+
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) +
+                            sched_get_priority_max(SCHED_FIFO)) / 2;
+
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+      std::cerr << "Failed to raise streaming thread priority, "
+                   "check your rtprio limits" << std::endl;
+  }
+#endif
+}
+
+} /* namespace osmosdr */
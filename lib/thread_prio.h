@@ -0,0 +1,71 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_THREAD_PRIO_H
+#define OSMOSDR_THREAD_PRIO_H
+
+#include <map>
+#include <string>
+
+namespace osmosdr {
+
+/*!
+ * Scheduling setup for backend streaming threads.
+ *
+ * The threads that move samples (USB event loops, socket readers)
+ * run at default priority on whatever core the kernel picks; under
+ * CPU contention they lose the race to the DSP threads and drop
+ * samples. Backends parse the configuration once from the device
+ * arguments and apply() it from inside the streaming thread:
+ *
+ *   - rx_prio=rt   run the streaming thread under SCHED_FIFO
+ *   - rx_cpu=<n>   pin the streaming thread to CPU core n
+ *   - rx_numa=<n>  allocate the transfer rings on NUMA node n
+ *                  (defaults to the node of rx_cpu when libnuma is
+ *                  available)
+ *
+ * Elevating the priority usually requires CAP_SYS_NICE or an rtprio
+ * entry in /etc/security/limits.conf; failures are reported on the
+ * console and streaming continues at default priority.
+ */
+class thread_prio
+{
+public:
+  thread_prio();
+
+  /*! Pick up rx_prio= / rx_cpu= / rx_numa= from the device arguments. */
+  void parse( const std::map< std::string, std::string > &dict );
+
+  /*! Apply the configuration to the calling thread. */
+  void apply() const;
+
+  /*! The NUMA node the rings should live on: rx_numa= when given,
+   * else the node of the rx_cpu core, else -1 (no preference). */
+  int numa_node() const;
+
+private:
+  bool _realtime;
+  int _cpu;
+  int _numa_node;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_THREAD_PRIO_H */
@@ -0,0 +1,53 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#ifndef OSMOSDR_TRACE_H
+#define OSMOSDR_TRACE_H
+
+/*
+ * Static USDT tracepoints under the gr_osmosdr provider. A disabled
+ * probe costs a single nop, so they stay in production builds; perf
+ * and bpftrace attach to the running process without a rebuild, e.g.
+ *
+ *   bpftrace -e 'usdt:libgnuradio-osmosdr.so:gr_osmosdr:ring_overflow
+ *                { printf("dropped %d bytes\n", arg0); }'
+ *
+ * The macros compile to nothing when sys/sdt.h (systemtap-sdt-dev)
+ * was not found at configure time.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define OSMOSDR_TRACE1(name, a1)         DTRACE_PROBE1(gr_osmosdr, name, a1)
+#define OSMOSDR_TRACE2(name, a1, a2)     DTRACE_PROBE2(gr_osmosdr, name, a1, a2)
+#define OSMOSDR_TRACE3(name, a1, a2, a3) DTRACE_PROBE3(gr_osmosdr, name, a1, a2, a3)
+
+#else
+
+#define OSMOSDR_TRACE1(name, a1)
+#define OSMOSDR_TRACE2(name, a1, a2)
+#define OSMOSDR_TRACE3(name, a1, a2, a3)
+
+#endif
+
+#endif /* OSMOSDR_TRACE_H */
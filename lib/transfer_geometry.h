@@ -0,0 +1,115 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_TRANSFER_GEOMETRY_H
+#define OSMOSDR_TRANSFER_GEOMETRY_H
+
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+#include <string>
+
+namespace osmosdr {
+
+/*!
+ * Sample-rate-aware USB transfer geometry.
+ *
+ * The compile-time buffer defaults of the USB backends are one
+ * compromise for all rates: deep enough to bridge scheduler stalls at
+ * 20 Msps, the very same geometry holds seconds worth of samples at a
+ * 250 ksps pager channel. With latency=<ms> in the device arguments
+ * the backend sizes transfer length and count at start() from the
+ * sample rate configured by then, targeting the given buffering
+ * budget instead. Explicit buffers= / buflen= settings keep working
+ * and take precedence over the auto mode.
+ */
+class transfer_geometry
+{
+public:
+  transfer_geometry() : _budget_ms(0.0) { }
+
+  /*! Pick up latency=<ms> from the device arguments. */
+  void parse(const std::map<std::string, std::string> &dict)
+  {
+    std::map<std::string, std::string>::const_iterator it =
+        dict.find("latency");
+
+    if (dict.end() == it)
+      return;
+
+    _budget_ms = boost::lexical_cast<double>(it->second);
+
+    if (_budget_ms < 0.0)
+      _budget_ms = 0.0;
+  }
+
+  /*! An automatic geometry was requested. */
+  bool active() const { return _budget_ms > 0.0; }
+
+  /*! The configured buffering budget in milliseconds. */
+  double budget_ms() const { return _budget_ms; }
+
+  /*! Size \p buf_num transfers of \p buf_len bytes each so the ring
+   * holds about the configured budget worth of samples at \p rate.
+   * Each transfer covers roughly an eighth of the budget - frequent
+   * enough completions for smooth refills, large enough to keep the
+   * per-URB overhead down - rounded to the 512 byte bulk endpoint
+   * granule and clamped to sane bounds. */
+  void compute(double rate, size_t bytes_per_sample,
+               unsigned int &buf_num, unsigned int &buf_len) const
+  {
+    if (!active() || rate <= 0.0)
+      return;
+
+    const double budget_bytes = rate * bytes_per_sample * _budget_ms / 1e3;
+
+    unsigned int len = (unsigned int)(budget_bytes / 8);
+    len -= len % 512;
+
+    if (len < MIN_LEN)
+      len = MIN_LEN;
+    if (len > MAX_LEN)
+      len = MAX_LEN;
+
+    unsigned int num = (unsigned int)((budget_bytes + len - 1) / len);
+
+    if (num < MIN_NUM)
+      num = MIN_NUM;
+    if (num > MAX_NUM)
+      num = MAX_NUM;
+
+    buf_num = num;
+    buf_len = len;
+  }
+
+private:
+  enum {
+    MIN_LEN = 4 * 512,   /* keeps the completion rate bounded */
+    MAX_LEN = 512 * 512, /* the usual libusb bulk transfer ceiling */
+    MIN_NUM = 4,         /* always enough transfers in flight */
+    MAX_NUM = 64
+  };
+
+  double _budget_ms;
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_TRANSFER_GEOMETRY_H */
@@ -0,0 +1,139 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_TX_BURST_TAGGER_H
+#define OSMOSDR_TX_BURST_TAGGER_H
+
+#include <osmosdr/time_spec.h>
+
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdint.h>
+
+namespace osmosdr {
+
+/*!
+ * Pass-through block translating queued burst descriptors into the
+ * UHD-style tx_time / tx_sob / tx_eob stream tags.
+ *
+ * Each queued burst claims the next \p nsamps samples flowing through
+ * the block: the first one is tagged with start-of-burst and the
+ * scheduled time, the last one with end-of-burst. The driver stages
+ * tagged bursts into its stream buffers ahead of time and the device
+ * clock releases them, so back-to-back bursts need no host round-trip
+ * and no zero padding between them. Samples arriving while no burst
+ * is queued pass through untagged, i.e. flow graphs that never queue
+ * a burst keep streaming continuously as before.
+ */
+class tx_burst_tagger : public gr::sync_block
+{
+public:
+  typedef boost::shared_ptr< tx_burst_tagger > sptr;
+
+  static sptr make( size_t itemsize )
+  {
+    return gnuradio::get_initial_sptr( new tx_burst_tagger( itemsize ) );
+  }
+
+  /*! Queue a burst of \p nsamps samples starting at \p time. Bursts
+   * consume input in the order they were queued. May be called from
+   * any thread. */
+  void queue_burst( const time_spec_t &time, size_t nsamps )
+  {
+    if ( 0 == nsamps )
+      return;
+
+    boost::mutex::scoped_lock lock( _queue_lock );
+    _queue.push_back( burst_t( time, nsamps ) );
+  }
+
+  int work( int noutput_items,
+            gr_vector_const_void_star &input_items,
+            gr_vector_void_star &output_items )
+  {
+    memcpy( output_items[0], input_items[0], noutput_items * _itemsize );
+
+    int item = 0;
+    while ( item < noutput_items ) {
+      if ( 0 == _remaining ) {
+        burst_t burst;
+        {
+          boost::mutex::scoped_lock lock( _queue_lock );
+          if ( _queue.empty() )
+            break; /* nothing pending, stream continuously */
+          burst = _queue.front();
+          _queue.pop_front();
+        }
+
+        const uint64_t offset = nitems_written(0) + item;
+        add_item_tag( 0, offset, pmt::mp("tx_time"),
+            pmt::make_tuple(pmt::from_uint64(burst.time.get_full_secs()),
+                            pmt::from_double(burst.time.get_frac_secs())) );
+        add_item_tag( 0, offset, pmt::mp("tx_sob"), pmt::PMT_T );
+        _remaining = burst.nsamps;
+      }
+
+      const size_t chunk = std::min( size_t(noutput_items - item), _remaining );
+      item += chunk;
+      _remaining -= chunk;
+
+      if ( 0 == _remaining )
+        add_item_tag( 0, nitems_written(0) + item - 1,
+                      pmt::mp("tx_eob"), pmt::PMT_T );
+    }
+
+    return noutput_items;
+  }
+
+private:
+  tx_burst_tagger( size_t itemsize )
+    : gr::sync_block( "tx_burst_tagger",
+                      gr::io_signature::make(1, 1, itemsize),
+                      gr::io_signature::make(1, 1, itemsize) ),
+      _itemsize( itemsize ),
+      _remaining( 0 )
+  {
+  }
+
+  struct burst_t
+  {
+    burst_t() : nsamps( 0 ) { }
+    burst_t( const time_spec_t &time_, size_t nsamps_ )
+      : time( time_ ), nsamps( nsamps_ ) { }
+
+    time_spec_t time;
+    size_t nsamps;
+  };
+
+  size_t _itemsize;
+  std::deque< burst_t > _queue;
+  boost::mutex _queue_lock;
+  size_t _remaining; /* samples left in the burst currently being tagged */
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_TX_BURST_TAGGER_H */
@@ -123,7 +123,14 @@ uhd_sink_c::uhd_sink_c(const std::string &args) :
   set_input_signature( gr::io_signature::makev( nchan, nchan, sizes ) );
 #endif
   for ( size_t i = 0; i < nchan; i++ )
-    connect( self(), i, _snk, i );
+  {
+    /* the tagger translates queued bursts into the tx_time / tx_sob /
+     * tx_eob stream tags the UHD sink turns into timed TX metadata */
+    _taggers.push_back( osmosdr::tx_burst_tagger::make( sizeof(gr_complex) ) );
+
+    connect( self(), i, _taggers[i], 0 );
+    connect( _taggers[i], 0, _snk, i );
+  }
 }
 
 uhd_sink_c::~uhd_sink_c()
@@ -423,3 +430,10 @@ void uhd_sink_c::set_time_unknown_pps(const osmosdr::time_spec_t &time_spec)
 {
   _snk->set_time_unknown_pps( uhd::time_spec_t( time_spec.get_full_secs(), time_spec.get_frac_secs() ) );
 }
+
+void uhd_sink_c::queue_burst(const osmosdr::time_spec_t &time,
+                             size_t nsamps, size_t chan)
+{
+  if ( chan < _taggers.size() )
+    _taggers[chan]->queue_burst( time, nsamps );
+}
@@ -24,6 +24,7 @@
 #include <gnuradio/uhd/usrp_sink.h>
 
 #include "sink_iface.h"
+#include "tx_burst_tagger.h"
 
 class uhd_sink_c;
 
@@ -92,12 +93,15 @@ public:
   void set_time_now(const ::osmosdr::time_spec_t &time_spec, size_t mboard = 0);
   void set_time_next_pps(const ::osmosdr::time_spec_t &time_spec);
   void set_time_unknown_pps(const ::osmosdr::time_spec_t &time_spec);
+  void queue_burst( const ::osmosdr::time_spec_t &time,
+                    size_t nsamps, size_t chan = 0 );
 
 private:
   double _center_freq;
   double _freq_corr;
   double _lo_offset;
   gr::uhd::usrp_sink::sptr _snk;
+  std::vector< osmosdr::tx_burst_tagger::sptr > _taggers;
 };
 
 #endif // UHD_SINK_C_H
@@ -78,12 +78,18 @@ uhd_source_c::uhd_source_c(const std::string &args) :
          "otw_format" == entry.first ||
          "fullscale" == entry.first ||
          "peak" == entry.first ||
+         "spp" == entry.first ||
          "nchan" == entry.first ||
          "subdev" == entry.first ||
          "lo_offset" == entry.first ||
+         "start_time" == entry.first ||
+         "start_delay" == entry.first ||
          "uhd" == entry.first )
       continue;
 
+    /* everything else, including UHD transport tuning arguments like
+     * recv_frame_size, num_recv_frames or recv_buff_size, belongs into
+     * the device address and is forwarded verbatim */
     arguments += entry.first + "=" + entry.second + ",";
   }
 
@@ -105,6 +111,9 @@ uhd_source_c::uhd_source_c(const std::string &args) :
   if (dict.count("fullscale") )
     stream_args.args["fullscale"] = dict["fullscale"];
 
+  if (dict.count("spp") )
+    stream_args.args["spp"] = dict["spp"];
+
   _src = gr::uhd::usrp_source::make( arguments, stream_args );
 
   if (dict.count("subdev"))
@@ -115,6 +124,29 @@ uhd_source_c::uhd_source_c(const std::string &args) :
 
   if (0.0 != _lo_offset)
     std::cerr << "-- Using LO offset of " << _lo_offset << " Hz." << std::endl;
+
+  /* a timed stream start makes the device begin streaming all channels at
+   * the same tick, which is what keeps a multi-channel (MIMO) group phase
+   * aligned. default to a short delay whenever more than one channel was
+   * requested; start_delay=0 restores the immediate start. the delay is
+   * measured from block creation, so it has to outlast the remaining
+   * flowgraph setup or the stream command arrives late. */
+  double start_delay = nchan > 1 ? 0.5 : 0.0;
+
+  if (dict.count("start_delay"))
+    start_delay = boost::lexical_cast< double >( dict["start_delay"] );
+
+  if (dict.count("start_time")) {
+    double start_time = boost::lexical_cast< double >( dict["start_time"] );
+    _src->set_start_time( uhd::time_spec_t( start_time ) );
+    std::cerr << "-- Starting stream at device time " << start_time << " s."
+              << std::endl;
+  } else if (start_delay > 0.0) {
+    uhd::time_spec_t now = _src->get_device()->get_time_now();
+    _src->set_start_time( now + uhd::time_spec_t( start_delay ) );
+    std::cerr << "-- Starting stream " << start_delay << " s from now."
+              << std::endl;
+  }
 #if 0
   std::vector<int> sizes = _src->output_signature()->sizeof_stream_items();
 
@@ -31,6 +31,14 @@ typedef boost::shared_ptr< uhd_source_c > uhd_source_c_sptr;
 
 uhd_source_c_sptr make_uhd_source_c(const std::string &args = "");
 
+/*!
+ * \brief Adapts gr-uhd's usrp_source to the source_iface control API.
+ *
+ * The hier shell only exists for the control plumbing: flowgraph
+ * flattening dissolves it before the scheduler starts, so samples
+ * flow from the usrp_source buffers straight to the consumer without
+ * an extra copy hop.
+ */
 class uhd_source_c :
     public gr::hier_block2,
     public source_iface
@@ -0,0 +1,268 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "uring_reader.h"
+
+#include <stddef.h>
+
+#ifdef HAVE_LIBURING
+
+#include <errno.h>
+#include <string.h>
+
+#include <liburing.h>
+
+#define URING_ENTRIES 64
+#define URING_NBUFS   32
+
+namespace {
+
+struct uring_state
+{
+  struct io_uring ring;
+  struct io_uring_buf_ring *br;
+  unsigned char *bufs;
+  unsigned int buf_len;
+  int fd;
+  int last_bid; /* buffer handed out by the last next() call, -1 if none */
+};
+
+/* (re)arm the multishot receive; the kernel cancels it when the
+ * buffer pool runs dry or the request errors out */
+bool uring_arm( uring_state *st )
+{
+  struct io_uring_sqe *sqe = io_uring_get_sqe( &st->ring );
+
+  if ( !sqe )
+    return false;
+
+  io_uring_prep_recv_multishot( sqe, st->fd, NULL, 0, 0 );
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+
+  return io_uring_submit( &st->ring ) >= 0;
+}
+
+/* hand the buffer from the previous completion back to the kernel */
+void uring_recycle( uring_state *st )
+{
+  if ( st->last_bid < 0 )
+    return;
+
+  io_uring_buf_ring_add( st->br,
+                         st->bufs + st->last_bid * st->buf_len,
+                         st->buf_len,
+                         st->last_bid,
+                         io_uring_buf_ring_mask( URING_NBUFS ),
+                         0 );
+  io_uring_buf_ring_advance( st->br, 1 );
+
+  st->last_bid = -1;
+}
+
+void uring_teardown( uring_state *st )
+{
+  io_uring_free_buf_ring( &st->ring, st->br, URING_NBUFS, 0 );
+  io_uring_queue_exit( &st->ring );
+  delete [] st->bufs;
+  delete st;
+}
+
+} /* anonymous namespace */
+
+#endif /* HAVE_LIBURING */
+
+namespace osmosdr {
+
+uring_reader::uring_reader() :
+  _impl( NULL )
+{
+}
+
+uring_reader::~uring_reader()
+{
+  stop();
+}
+
+bool uring_reader::start( int fd, bool datagram )
+{
+#ifdef HAVE_LIBURING
+  uring_state *st = new uring_state;
+
+  memset( st, 0, sizeof(*st) );
+  st->fd = fd;
+  st->last_bid = -1;
+
+  /* a buffer takes whole datagrams (which stay below the MTU) or an
+   * arbitrary slice of a TCP stream */
+  st->buf_len = datagram ? 4096 : 16384;
+
+  if ( io_uring_queue_init( URING_ENTRIES, &st->ring, 0 ) < 0 )
+  {
+    delete st;
+    return false;
+  }
+
+  int err = 0;
+  st->br = io_uring_setup_buf_ring( &st->ring, URING_NBUFS, 0, 0, &err );
+  if ( !st->br )
+  {
+    io_uring_queue_exit( &st->ring );
+    delete st;
+    return false;
+  }
+
+  st->bufs = new unsigned char[ URING_NBUFS * st->buf_len ];
+
+  for ( int i = 0; i < URING_NBUFS; i++ )
+    io_uring_buf_ring_add( st->br,
+                           st->bufs + i * st->buf_len,
+                           st->buf_len,
+                           i,
+                           io_uring_buf_ring_mask( URING_NBUFS ),
+                           i );
+  io_uring_buf_ring_advance( st->br, URING_NBUFS );
+
+  if ( !uring_arm( st ) )
+  {
+    uring_teardown( st );
+    return false;
+  }
+
+  /* a kernel without multishot receive fails the request right at
+   * submit time, so a peek tells it apart from an armed read. A
+   * positive completion (data was already queued on the socket) is
+   * left for the first next() call. */
+  struct io_uring_cqe *cqe;
+  if ( 0 == io_uring_peek_cqe( &st->ring, &cqe ) && cqe->res < 0 &&
+       -ENOBUFS != cqe->res )
+  {
+    io_uring_cqe_seen( &st->ring, cqe );
+    uring_teardown( st );
+    return false;
+  }
+
+  _impl = st;
+
+  return true;
+#else
+  (void) fd;
+  (void) datagram;
+
+  return false;
+#endif
+}
+
+void uring_reader::stop()
+{
+#ifdef HAVE_LIBURING
+  if ( _impl )
+  {
+    uring_teardown( (uring_state *)_impl );
+    _impl = NULL;
+  }
+#endif
+}
+
+int uring_reader::next( const unsigned char **data, int timeout_ms )
+{
+#ifdef HAVE_LIBURING
+  uring_state *st = (uring_state *)_impl;
+
+  if ( !st )
+    return ERROR;
+
+  uring_recycle( st );
+
+  for (;;)
+  {
+    struct io_uring_cqe *cqe;
+
+    if ( io_uring_peek_cqe( &st->ring, &cqe ) < 0 )
+    {
+      int ret;
+
+      if ( 0 == timeout_ms )
+        return TIMEOUT;
+
+      if ( timeout_ms < 0 )
+      {
+        ret = io_uring_wait_cqe( &st->ring, &cqe );
+      }
+      else
+      {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        ret = io_uring_wait_cqe_timeout( &st->ring, &cqe, &ts );
+
+        if ( -ETIME == ret )
+          return TIMEOUT;
+      }
+
+      if ( -EINTR == ret )
+        continue;
+
+      if ( ret < 0 )
+        return ERROR;
+    }
+
+    int res = cqe->res;
+    unsigned int flags = cqe->flags;
+
+    io_uring_cqe_seen( &st->ring, cqe );
+
+    if ( -ENOBUFS == res )
+    {
+      /* the consumer held buffers longer than the pool lasted */
+      if ( !uring_arm( st ) )
+        return ERROR;
+      continue;
+    }
+
+    if ( res <= 0 )
+      return ( 0 == res ) ? CLOSED : ERROR;
+
+    /* the kernel drops the multishot when it runs low on resources */
+    if ( !(flags & IORING_CQE_F_MORE) )
+      if ( !uring_arm( st ) )
+        return ERROR;
+
+    if ( !(flags & IORING_CQE_F_BUFFER) )
+      return ERROR;
+
+    st->last_bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    *data = st->bufs + st->last_bid * st->buf_len;
+
+    return res;
+  }
+#else
+  (void) data;
+  (void) timeout_ms;
+
+  return ERROR;
+#endif
+}
+
+} /* namespace osmosdr */
@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018 Free Software Foundation, Inc.
+ *
+ * GNU Radio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * GNU Radio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef OSMOSDR_URING_READER_H
+#define OSMOSDR_URING_READER_H
+
+namespace osmosdr {
+
+/*!
+ * io_uring backed socket reader for the network backends.
+ *
+ * The classic read paths cost one syscall per buffer (recv/recvfrom,
+ * plus a select() where a timeout is needed). This engine arms one
+ * multishot receive on the socket instead: the kernel keeps filling
+ * buffers from a registered pool as data arrives, and one
+ * io_uring_enter() wakeup reaps a whole batch of completions. With a
+ * dozen network receivers on a host the syscall overhead is
+ * measurable, and this removes most of it.
+ *
+ * The engine is strictly optional: start() reports whether io_uring
+ * with multishot receive is actually available (liburing at build
+ * time, a recent enough kernel at run time), and every caller keeps
+ * its blocking read path as the fallback.
+ */
+class uring_reader
+{
+public:
+  enum {
+    CLOSED = 0,   /*!< orderly shutdown of the connection */
+    ERROR = -1,   /*!< receive error, the stream is dead */
+    TIMEOUT = -2  /*!< no data within the requested time */
+  };
+
+  uring_reader();
+  ~uring_reader();
+
+  /*!
+   * Arm the engine on a connected (or bound, for datagram sockets)
+   * descriptor. \return false when io_uring is unavailable and the
+   * caller should keep using its blocking read path.
+   */
+  bool start( int fd, bool datagram );
+
+  /*! Tear down the ring and release the registered buffers. */
+  void stop();
+
+  /*!
+   * The next chunk of received data, one datagram per call on
+   * datagram sockets. The chunk stays valid until the following call.
+   *
+   * \param data receives a pointer into the registered buffer pool
+   * \param timeout_ms negative blocks, zero polls the completion
+   *                   queue, positive waits up to that many ms
+   * \return the chunk length, or CLOSED / ERROR / TIMEOUT
+   */
+  int next( const unsigned char **data, int timeout_ms = -1 );
+
+private:
+  void *_impl; /* io_uring state, NULL when the engine is inactive */
+};
+
+} /* namespace osmosdr */
+
+#endif /* OSMOSDR_URING_READER_H */
@@ -12,8 +12,11 @@
 
 %{
 #include "osmosdr/device.h"
+#include "osmosdr/stream_stats.h"
 #include "osmosdr/source.h"
 #include "osmosdr/sink.h"
+#include "osmosdr/spectrum.h"
+#include "osmosdr/siggen.h"
 %}
 
 // Workaround for a SWIG 2.0.4 bug with templates. Probably needs to be looked in to.
@@ -26,6 +29,7 @@
 %}
 
 %template(string_vector_t) std::vector<std::string>;
+%template(double_vector_t) std::vector<double>;
 
 //%template(size_vector_t) std::vector<size_t>;
 
@@ -45,6 +49,10 @@
 %template(range_vector_t) std::vector<osmosdr::range_t>; //define before range
 %include <osmosdr/ranges.h>
 
+%include <stdint.i>
+%template(uint64_vector_t) std::vector<uint64_t>;
+%include <osmosdr/stream_stats.h>
+
 %include <osmosdr/time_spec.h>
 
 %extend osmosdr::time_spec_t{
@@ -70,11 +78,56 @@ BASE_NAME = BASE_NAME.make;
 %}
 %enddef
 
+%extend osmosdr::source{
+    PyObject *get_probe_view( size_t chan = 0 )
+    {
+        const void *buf = self->get_probe_buffer( chan );
+        size_t len = self->get_probe_depth( chan ) * 2 * sizeof(float);
+
+        if ( !buf || !len )
+            Py_RETURN_NONE;
+
+#if PY_VERSION_HEX >= 0x03030000
+        return PyMemoryView_FromMemory( (char *)buf, len, PyBUF_READ );
+#else
+        Py_buffer view;
+        if ( PyBuffer_FillInfo( &view, NULL, (void *)buf, len, 1,
+                                PyBUF_SIMPLE ) )
+            return NULL;
+        return PyMemoryView_FromBuffer( &view );
+#endif
+    }
+};
+
+/* the future returning variants are for C++ users, boost futures
+ * have no sensible python mapping */
+%ignore osmosdr::source::set_center_freq_future;
+%ignore osmosdr::source::set_gain_future;
+%ignore osmosdr::sink::set_center_freq_future;
+%ignore osmosdr::sink::set_gain_future;
+
 %include "osmosdr/source.h"
 %include "osmosdr/sink.h"
+%include "osmosdr/spectrum.h"
+%include "osmosdr/siggen.h"
 
 OSMOSDR_SWIG_BLOCK_MAGIC2(osmosdr,source);
 OSMOSDR_SWIG_BLOCK_MAGIC2(osmosdr,sink);
+OSMOSDR_SWIG_BLOCK_MAGIC2(osmosdr,spectrum);
+OSMOSDR_SWIG_BLOCK_MAGIC2(osmosdr,siggen);
+
+%pythoncode %{
+def _source_probe_array(self, chan=0):
+    """View the channel's history probe as a read-only complex64 numpy
+    array without copying, or None when no probe=<depth> was requested.
+    Order the contents with get_probe_count() % get_probe_depth()."""
+    view = self.get_probe_view(chan)
+    if view is None:
+        return None
+    import numpy
+    return numpy.frombuffer(view, dtype=numpy.complex64)
+source_sptr.probe_array = _source_probe_array
+%}
 
 %{
 static const size_t ALL_MBOARDS = osmosdr::ALL_MBOARDS;